@@ -57,11 +57,9 @@ void Boat::Update(float deltaTime)
 // Interprets key input for starting the game
 void Boat::InputStart()
 {
-	//Left
-	if (inputManager->GetKey(VK_LEFT) || inputManager->GetKey(VK_UP) ||
-		inputManager->GetKey('A') || inputManager->GetKey('W') ||
-		inputManager->GetKey(VK_RIGHT) || inputManager->GetKey(VK_DOWN) ||
-		inputManager->GetKey('D') || inputManager->GetKey('S'))
+	//Any movement key starts
+	if (inputManager->GetAnyKey(turnLeftKeys) || inputManager->GetAnyKey(turnRightKeys) ||
+		inputManager->GetKeyHeldFraction(turnLeftKeys) > 0 || inputManager->GetKeyHeldFraction(turnRightKeys) > 0)
 	{
 		state = BoatState::Playing;
 	}
@@ -70,17 +68,20 @@ void Boat::InputStart()
 // Interprets key input
 void Boat::Input(float deltaTime)
 {
+	//Turn for as much of the frame as the key was held, so taps
+	//shorter than a frame still steer
+	float left = inputManager->GetKeyHeldFraction(turnLeftKeys);
+	float right = inputManager->GetKeyHeldFraction(turnRightKeys);
+
 	//Left
-	if ((inputManager->GetKey(VK_LEFT) || inputManager->GetKey(VK_UP) ||
-		inputManager->GetKey('A') || inputManager->GetKey('W')))
+	if (left > 0)
 	{
-		Rotate(0, turnSpeed * deltaTime * -1, 0);
+		Rotate(0, turnSpeed * deltaTime * left * -1, 0);
 	}
 	//Right
-	else if ((inputManager->GetKey(VK_RIGHT) || inputManager->GetKey(VK_DOWN) ||
-		inputManager->GetKey('D') || inputManager->GetKey('S')))
+	else if (right > 0)
 	{
-		Rotate(0, turnSpeed * deltaTime * 1, 0);
+		Rotate(0, turnSpeed * deltaTime * right, 0);
 	}
 
 //If we are in debug, allow us to click to spawn swimmers on our tail
@@ -152,7 +153,8 @@ void Boat::SeekOrigin(float deltaTime)
 	SetPosition(movement);
 
 	//Rotate the boat
-	XMVECTOR slerp = XMQuaternionSlerp(XMLoadFloat4(&GetRotation()), XMVectorSet(0, 0, 0, 1), seekTimer);
+	XMFLOAT4 currentRot = GetRotation();
+	XMVECTOR slerp = XMQuaternionSlerp(XMLoadFloat4(&currentRot), XMVectorSet(0, 0, 0, 1), seekTimer);
 	XMFLOAT4 rotation;
 	XMStoreFloat4(&rotation, slerp);
 	SetRotation(rotation);
@@ -161,11 +163,10 @@ void Boat::SeekOrigin(float deltaTime)
 // Checks for collisions and calls corresponding collide methods
 void Boat::CheckCollisions()
 {
-	float x = this->GetPosition().x;
-	float z = this->GetPosition().z;
+	XMFLOAT3 position = GetPosition();
 
 	//Checking Within Level Bounds
-	float dist = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&GetPosition()), XMVectorSet(0, 0, 0, 0))));
+	float dist = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&position), XMVectorSet(0, 0, 0, 0))));
 	if (dist > levelRadius)
 	{
 		//Game Over
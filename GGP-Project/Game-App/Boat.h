@@ -21,6 +21,10 @@ private:
 	BoatState state;
 	SwimmerManager* swimmerManager;
 	InputManager* inputManager;
+
+	//Steering keys
+	KeyMask turnLeftKeys = { VK_LEFT, VK_UP, 'A', 'W' };
+	KeyMask turnRightKeys = { VK_RIGHT, VK_DOWN, 'D', 'S' };
 	std::vector<Swimmer*> trail;
 
 	//Seek timer
@@ -0,0 +1,155 @@
+#ifdef CAPTURE_REPLAY
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include "RenderCapture.h"
+#include "NullRenderBackend.h"
+
+//Names of RenderCommandType, for the report
+static const char* commandNames[(int)RenderCommandType::Count] =
+{
+	"BindPipeline",
+	"BindVertexBuffer",
+	"BindIndexBuffer",
+	"BindConstantBuffer",
+	"BindResource",
+	"BindSampler",
+	"SetConstants",
+	"Draw",
+	"DrawIndexed",
+	"DrawIndexedInstanced",
+};
+
+// --------------------------------------------------------
+// Counts from a NullRenderBackend at one point in a replay
+// --------------------------------------------------------
+struct ReplayCounts
+{
+	unsigned long long commands[(int)RenderCommandType::Count];
+	unsigned long long redundant[(int)RenderCommandType::Count];
+	unsigned long long primitiveVertices;
+	unsigned long long constantBytes;
+	unsigned int errors;
+};
+
+// --------------------------------------------------------
+// Read the backend's running counts
+// --------------------------------------------------------
+static ReplayCounts GetCounts(NullRenderBackend& backend)
+{
+	ReplayCounts counts;
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+	{
+		counts.commands[i] = backend.GetCommandCount((RenderCommandType)i);
+		counts.redundant[i] = backend.GetRedundantCount((RenderCommandType)i);
+	}
+	counts.primitiveVertices = backend.GetPrimitiveVertexCount();
+	counts.constantBytes = backend.GetConstantBytes();
+	counts.errors = backend.GetErrorCount();
+	return counts;
+}
+
+// --------------------------------------------------------
+// Print what a pass submitted, from the counts before and
+// after it ran
+// --------------------------------------------------------
+static void PrintPass(const char* name, const ReplayCounts& before, const ReplayCounts& after)
+{
+	unsigned long long commands = 0;
+	unsigned long long draws = 0;
+	unsigned long long redundant = 0;
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+	{
+		commands += after.commands[i] - before.commands[i];
+		redundant += after.redundant[i] - before.redundant[i];
+	}
+	draws = after.commands[(int)RenderCommandType::Draw] - before.commands[(int)RenderCommandType::Draw] +
+		after.commands[(int)RenderCommandType::DrawIndexed] - before.commands[(int)RenderCommandType::DrawIndexed] +
+		after.commands[(int)RenderCommandType::DrawIndexedInstanced] - before.commands[(int)RenderCommandType::DrawIndexedInstanced];
+
+	printf("%s: %llu commands, %llu draws, %llu vertices, %llu constant bytes, %llu redundant binds, %u errors\n",
+		name, commands, draws, after.primitiveVertices - before.primitiveVertices,
+		after.constantBytes - before.constantBytes, redundant, after.errors - before.errors);
+
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+	{
+		unsigned long long count = after.commands[i] - before.commands[i];
+		if (count == 0)
+			continue;
+
+		unsigned long long redundantCount = after.redundant[i] - before.redundant[i];
+		if (redundantCount > 0)
+			printf("  %-22s %10llu (%llu redundant)\n", commandNames[i], count, redundantCount);
+		else printf("  %-22s %10llu\n", commandNames[i], count);
+	}
+}
+
+// --------------------------------------------------------
+// Entry point for the render capture replay tool
+//
+// Loads a render capture, runs it through the null backend
+// and prints per-pass call counts, bytes uploaded and
+// redundant binds. Needs no graphics device.
+//
+// usage: capture-file [-repeat n]
+//
+// -repeat replays the capture n times to time submission
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: %s capture-file [-repeat n]\n", argv[0]);
+		return 1;
+	}
+
+	int repeat = 1;
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-repeat") == 0) repeat = atoi(argv[i + 1]);
+		else
+		{
+			printf("Unknown option \"%s\"\n", argv[i]);
+			return 1;
+		}
+	}
+	if (repeat < 1)
+		repeat = 1;
+
+	RenderCapture capture;
+	if (!capture.Load(argv[1]))
+		return 1;
+	printf("Capture: %d passes, %u objects\n", capture.GetPassCount(), capture.GetObjectCount());
+
+	//Replay once, reporting each pass. Bindings carry over
+	//between passes like they would on a device
+	NullRenderBackend backend;
+	ReplayCounts frameStart = GetCounts(backend);
+	for (int p = 0; p < capture.GetPassCount(); p++)
+	{
+		ReplayCounts before = GetCounts(backend);
+		backend.Execute(capture.GetPassCommands(p));
+		PrintPass(capture.GetPassName(p), before, GetCounts(backend));
+	}
+	PrintPass("Frame", frameStart, GetCounts(backend));
+
+	//Time repeated replays
+	if (repeat > 1)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < repeat; r++)
+		{
+			backend.Reset();
+			for (int p = 0; p < capture.GetPassCount(); p++)
+				backend.Execute(capture.GetPassCommands(p));
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		printf("Replayed %d times: %.3fms, average: %.4fms\n", repeat, elapsed.count(), elapsed.count() / repeat);
+	}
+
+	return backend.GetErrorCount() > 0 ? 2 : 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+// Include guard
+#ifndef _CLUSTERS_HLSL
+#define _CLUSTERS_HLSL
+
+#include "Lighting.hlsli"
+
+//Must match the defines in LightClusters.h
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+
+//Where to find a pixel's cluster
+cbuffer clusters : register(b3)
+{
+	float2 ClusterTileScale;	//tiles per pixel
+	float ClusterDepthScale;	//slice = log(view depth) * scale + bias
+	float ClusterDepthBias;
+	int DirectionalLightCount;	//directional lights are at the front of Lights
+	float3 ClusterPadding;
+}
+
+// Every light this frame, directional lights first
+StructuredBuffer<Light> Lights			: register(t8);
+
+// (offset, count) into ClusterLightIndices per cluster
+Buffer<uint2> ClusterLightGrid			: register(t9);
+Buffer<uint> ClusterLightIndices		: register(t10);
+
+// Get the (offset, count) of the lights in a pixel's cluster
+//
+// svPosition - the pixel's SV_POSITION. w holds its view depth
+uint2 GetClusterLights(float4 svPosition)
+{
+	uint2 tile = min(uint2(svPosition.xy * ClusterTileScale), uint2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+	int slice = clamp((int)floor(log(svPosition.w) * ClusterDepthScale + ClusterDepthBias), 0, CLUSTER_SLICES - 1);
+	return ClusterLightGrid[tile.x + CLUSTER_TILES_X * (tile.y + CLUSTER_TILES_Y * slice)];
+}
+
+#endif
@@ -577,6 +577,24 @@ LRESULT DXCore::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 	case WM_MOUSEWHEEL:
 		OnMouseWheel(GET_WHEEL_DELTA_WPARAM(wParam) / (float)WHEEL_DELTA, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
+
+	// Key pressed or released
+	case WM_KEYDOWN:
+		OnKeyDown(wParam);
+		return 0;
+
+	case WM_KEYUP:
+		OnKeyUp(wParam);
+		return 0;
+
+	// System keys (alt combinations, F10) still need default handling
+	case WM_SYSKEYDOWN:
+		OnKeyDown(wParam);
+		break;
+
+	case WM_SYSKEYUP:
+		OnKeyUp(wParam);
+		break;
 	}
 
 	// Let Windows handle any messages we're not touching
@@ -49,6 +49,11 @@ public:
 	virtual void OnMouseUp	 (WPARAM buttonState, int x, int y, int button) { }
 	virtual void OnMouseMove (WPARAM buttonState, int x, int y) { }
 	virtual void OnMouseWheel(float wheelDelta,   int x, int y) { }
+
+	// Key transitions, pushed as they arrive so the game
+	// can see input timing finer than a frame
+	virtual void OnKeyDown(WPARAM key) { }
+	virtual void OnKeyUp  (WPARAM key) { }
 	
 protected:
 	HINSTANCE	hInstance;		// The handle to the application
@@ -5,6 +5,7 @@
 #include "MAT_Water.h"
 #include "MAT_Skybox.h"
 #include "MAT_Basic.h"
+#include <random>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -25,6 +26,10 @@ Game::Game(HINSTANCE hInstance)
 		720,			// Height of the window's client area
 		true)			// Show extra stats (fps) in title bar?
 {
+	simulation = nullptr;
+	camera = nullptr;
+	recorder = nullptr;
+
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
 	CreateConsoleWindow(500, 120, 32, 120);
@@ -45,8 +50,14 @@ Game::~Game()
 	waterSamplerState->Release();
 	shadowSampler->Release();
 
+	//Finish the input log
+	if (recorder) { delete recorder; }
+
 	//Delete the camera
 	if (camera) { delete camera; }
+
+	//Delete the world and everything in it
+	if (simulation) { delete simulation; }
 }
 
 // --------------------------------------------------------
@@ -59,19 +70,34 @@ void Game::Init()
 	resourceManager = ResourceManager::GetInstance();
 	LoadAssets();
 
-	//Initialize singletons
+	//Create the world and bind it to this thread
+	simulation = new Simulation();
+
+	//Seed the world so the recording can be replayed
+	if (!recordPath.empty())
+	{
+		std::random_device rseed;
+		unsigned int seed = rseed();
+		SwimmerManager::GetInstance()->Seed(seed);
+
+		recorder = new InputRecorder();
+		if (!recorder->Open(recordPath.c_str(), seed))
+		{
+			delete recorder;
+			recorder = nullptr;
+		}
+	}
+
+	//Get the world's managers
 	inputManager = InputManager::GetInstance();
 	renderer = Renderer::GetInstance();
 	renderer->Init(device, width, height);
-	entityManager = EntityManager::GetInstance();
-	swimmerManager = SwimmerManager::GetInstance();
-	swimmerManager->SetLevelRadius(LEVEL_RADIUS - 1);
+	resourceManager->SetShaderStateCache(renderer->GetStateCache());
 
-	//Initialize singleton data
+	//Initialize manager data
 	inputManager->Init(hWnd);
 
 	//Create game entities
-	gameState = GameState::Menu;
 	CreateEntities();
 
 	//Initialize transformation modifiers
@@ -98,6 +124,14 @@ void Game::Init()
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
+// --------------------------------------------------------
+// Record this session's input to a log for replaying later
+// --------------------------------------------------------
+void Game::RecordInput(const char* path)
+{
+	recordPath = path;
+}
+
 // --------------------------------------------------------
 // Creates the geometry we're going to draw - a single triangle for now
 // --------------------------------------------------------
@@ -105,6 +139,7 @@ void Game::LoadAssets()
 {
 	//Load shaders
 	resourceManager->LoadVertexShader("VertexShader.cso", device, context);
+	resourceManager->LoadVertexShader("VS_Instanced.cso", device, context);
 	resourceManager->LoadPixelShader("PixelShader.cso", device, context);
 
 	resourceManager->LoadPixelShader("PS_Water.cso", device, context);
@@ -190,8 +225,8 @@ void Game::LoadAssets()
 		0, 50, shadowSampler);
 	resourceManager->AddMaterial("boat", mat_boat);
 
-	//Swimmer Material
-	Material* mat_swimmer = new MAT_Basic(vs, ps_basic, XMFLOAT2(1, 1), samplerState,
+	//Swimmer Material, instanced since there are many swimmers sharing a mesh
+	Material* mat_swimmer = new MAT_Basic(resourceManager->GetVertexShader("VS_Instanced.cso"), ps_basic, XMFLOAT2(1, 1), samplerState,
 		resourceManager->GetTexture2D("Assets/Textures/Swimmer/swimmer_albedo.png"),
 		resourceManager->GetTexture2D("Assets/Textures/Swimmer/swimmer_normals.png"),
 		0, 50, shadowSampler);
@@ -225,32 +260,14 @@ void Game::LoadAssets()
 
 void Game::CreateEntities()
 {
-	//Create water
-	/*Entity* water = new Entity(
-		resourceManager->GetMesh("Assets\\Models\\cube.obj"),
-		resourceManager->GetMaterial("water")
-	);
-	water->SetScale(26, 0.1f, 26);*/
-
-	//Create area
-	Entity* area = new Entity(resourceManager->GetMesh("Assets\\Models\\area.obj"),
-		resourceManager->GetMaterial("area"));
-	area->SetScale(2.18f, 0.5f, 2.18f);
-
-	// Player (Boat) - Create the player.
-	player = new Boat(
-		resourceManager->GetMesh("Assets\\Models\\boat.obj"),
-		resourceManager->GetMaterial("boat"),
-		LEVEL_RADIUS
-	);
-	player->SetPosition(0, 0, 0); // Set the player's initial position.
-	player->AddCollider(XMFLOAT3(0.9f, 0.8f, 2.3f), XMFLOAT3(0, 0, 0));
-#if defined(DEBUG) || defined(_DEBUG)
-	player->SetDebug(true);
-#endif
+	//Create the level and the player
+	simulation->CreateEntities();
+
+	//Merge the level's static props now that they are placed
+	renderer->BuildStaticBatches(device);
 
 	//Create the camera and initialize matrices
-	camera = new FocusCamera(player, XMFLOAT3(0, 16, -23), XMFLOAT3(40.75f, 0, 0), 4, 2);
+	camera = new FocusCamera(simulation->GetPlayer(), XMFLOAT3(0, 16, -23), XMFLOAT3(40.75f, 0, 0), 4, 2);
 	camera->CreateProjectionMatrix(0.25f * XM_PI, (float)width / height, 0.1f, 100.0f);
 }
 
@@ -269,7 +286,6 @@ void Game::OnResize()
 		(float)width / height,	// Aspect ratio
 		0.1f,				  	// Near clip plane distance
 		100.0f);			  	// Far clip plane distance
-	renderer->CreatePostProcessingResources(device, width, height);
 }
 
 // --------------------------------------------------------
@@ -279,11 +295,18 @@ void Game::Update(float deltaTime, float totalTime)
 {
 	inputManager->UpdateFocus();
 	if (!inputManager->IsWindowFocused())
+	{
+		//Unfocused frames are still logged so replays keep the same timing
+		if (recorder) { recorder->Record(deltaTime, inputManager); }
 		return;
+	}
 
 	//The only call to UpdateMousePos() for the InputManager
 	//Get the current mouse position
 	inputManager->UpdateMousePos();
+
+	//Log this frame's input
+	if (recorder) { recorder->Record(deltaTime, inputManager); }
 	// --------------------------------------------------------
 	//All game code goes below
 
@@ -292,43 +315,15 @@ void Game::Update(float deltaTime, float totalTime)
 	if (inputManager->GetKey(VK_ESCAPE))
 		Quit();
 
+	//Capture the next frame's render commands for the replay tool
+	if (inputManager->GetKeyDown(VK_F12))
+		renderer->CaptureNextFrame("frame.rcap");
+
 	//Update the camera
 	camera->Update(deltaTime);
 	
-	//Gamestate switch
-	switch (gameState)
-	{
-		case GameState::Menu:
-			gameState = GameState::Playing;
-			break;
-
-		case GameState::Playing:
-			// Updates the swimmer generator/manager.
-			if(player->GetState() == BoatState::Playing)
-				swimmerManager->Update(deltaTime);
-
-			entityManager->Update(deltaTime);
-
-			//Check for gameover
-			if (player->GetState() == BoatState::Crashed)
-				gameState = GameState::GameOver;
-			break;
-
-		case GameState::GameOver:
-			entityManager->Update(deltaTime);
-
-			//Check for reset input
-			if (inputManager->GetKey(VK_SPACE))
-			{
-				player->Reset();
-				swimmerManager->Reset();
-				gameState = GameState::Playing;
-			}
-			break;
-
-		default:
-			break;
-	}
+	//Step the gameplay
+	simulation->Update(deltaTime);
 
 	//Updates water's scrolling normal map
 	translate += 0.025f * deltaTime;
@@ -397,4 +392,24 @@ void Game::OnMouseWheel(float wheelDelta, int x, int y)
 {
 	inputManager->OnMouseWheel(wheelDelta, x, y);
 }
+#pragma endregion
+
+#pragma region Key Input
+
+// --------------------------------------------------------
+// Helper method for key presses.  Queued with a timestamp
+// and applied at the start of the next Update
+// --------------------------------------------------------
+void Game::OnKeyDown(WPARAM key)
+{
+	inputManager->OnKeyDown(key);
+}
+
+// --------------------------------------------------------
+// Helper method for key releases
+// --------------------------------------------------------
+void Game::OnKeyUp(WPARAM key)
+{
+	inputManager->OnKeyUp(key);
+}
 #pragma endregion
\ No newline at end of file
@@ -4,15 +4,11 @@
 #include <DirectXMath.h>
 #include "Renderer.h"
 #include "InputManager.h"
-#include "EntityManager.h"
 #include "FocusCamera.h"
 #include "ResourceManager.h"
-#include "SwimmerManager.h"
-#include "Boat.h"
-
-#define LEVEL_RADIUS 13
-
-enum class GameState {Menu, Playing, GameOver};
+#include "Simulation.h"
+#include "InputRecorder.h"
+#include <string>
 
 class Game 
 	: public DXCore
@@ -32,22 +28,35 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
+	// --------------------------------------------------------
+	// Record this session's input to a log for replaying later.
+	// Call before Run()
+	//
+	// path - the file address of the log
+	// --------------------------------------------------------
+	void RecordInput(const char* path);
+
 	// Overridden mouse input helper methods
 	void OnMouseDown (WPARAM buttonState, int x, int y);
 	void OnMouseUp	 (WPARAM buttonState, int x, int y, int button);
 	void OnMouseMove (WPARAM buttonState, int x, int y);
 	void OnMouseWheel(float wheelDelta,   int x, int y);
+
+	// Overridden key input helper methods
+	void OnKeyDown(WPARAM key);
+	void OnKeyUp  (WPARAM key);
 private:
-	//Singletons
+	//Gameplay, owns the world the managers below belong to
+	Simulation* simulation;
+
+	//Managers
 	Renderer* renderer;
 	InputManager* inputManager;
 	ResourceManager* resourceManager;
-	EntityManager* entityManager;
-	SwimmerManager* swimmerManager;
 
-	//Gameplay
-	GameState gameState;
-	Boat* player;
+	//Input recording
+	std::string recordPath;
+	InputRecorder* recorder;
 
 	//Sampler states
 	ID3D11SamplerState* samplerState;
@@ -0,0 +1,29 @@
+#include "GameContext.h"
+
+// Construct a world and all of its managers
+GameContext::GameContext() : EngineContext()
+{
+	swimmerManager = new SwimmerManager();
+}
+
+// Destroy the game managers, then the engine managers
+GameContext::~GameContext()
+{
+	//Swimmers are handed back to the entity manager, which the base class deletes
+	EngineContext* previous = current;
+	current = this;
+	delete swimmerManager;
+	current = previous;
+}
+
+// Get the game context bound to the calling thread
+GameContext* GameContext::GetCurrent()
+{
+	return dynamic_cast<GameContext*>(EngineContext::GetCurrent());
+}
+
+// Get this world's swimmer manager
+SwimmerManager* GameContext::GetSwimmerManager()
+{
+	return swimmerManager;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "EngineContext.h"
+#include "SwimmerManager.h"
+
+// --------------------------------------------------------
+// Engine context for one game world
+//
+// Adds the game's own managers on top of the engine's
+// --------------------------------------------------------
+class GameContext :
+	public EngineContext
+{
+private:
+	//Per-world game managers
+	SwimmerManager* swimmerManager;
+
+public:
+	// --------------------------------------------------------
+	// Construct a world and all of its managers
+	// --------------------------------------------------------
+	GameContext();
+
+	// --------------------------------------------------------
+	// Destroy the game managers, then the engine managers
+	// --------------------------------------------------------
+	~GameContext();
+
+	// --------------------------------------------------------
+	// Get the game context bound to the calling thread.
+	// Returns nullptr if the current context is not a game context
+	// --------------------------------------------------------
+	static GameContext* GetCurrent();
+
+	// --------------------------------------------------------
+	// Get this world's swimmer manager
+	// --------------------------------------------------------
+	SwimmerManager* GetSwimmerManager();
+};
@@ -0,0 +1,506 @@
+#ifdef HEADLESS
+
+#include "HeadlessChecks.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+#include "SpatialHash.h"
+#include "RenderQueue.h"
+#include "EngineContext.h"
+#include "EntityManager.h"
+#include "StaticBatch.h"
+#include "MeshSimplifier.h"
+
+using namespace DirectX;
+
+static int failures;
+
+// --------------------------------------------------------
+// Count and report a failed condition
+// --------------------------------------------------------
+static void Check(bool condition, const char* what)
+{
+	if (condition)
+		return;
+
+	printf("FAILED: %s\n", what);
+	failures++;
+}
+
+// --------------------------------------------------------
+// Count the lines a call prints to stdout, keeping them
+// off the console
+// --------------------------------------------------------
+static int CountPrintedLines(const std::function<void()>& call)
+{
+	FILE* capture = tmpfile();
+	if (capture == nullptr)
+		return -1;
+
+	fflush(stdout);
+	int saved = dup(fileno(stdout));
+	dup2(fileno(capture), fileno(stdout));
+	call();
+	fflush(stdout);
+	dup2(saved, fileno(stdout));
+	close(saved);
+
+	int lines = 0;
+	rewind(capture);
+	for (int c = fgetc(capture); c != EOF; c = fgetc(capture))
+		lines += c == '\n';
+	fclose(capture);
+	return lines;
+}
+
+// --------------------------------------------------------
+// Compare the spatial hash's queries against brute force
+// --------------------------------------------------------
+static void CheckSpatialHash()
+{
+	//A fixed seed keeps failures reproducible
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> coord(-20.0f, 20.0f);
+
+	std::vector<XMFLOAT3> points(2000);
+	for (size_t i = 0; i < points.size(); i++)
+		points[i] = XMFLOAT3(coord(rng), coord(rng), coord(rng));
+
+	//Stacked points and points far outside the hashed table
+	points[10] = points[11] = points[12];
+	points[20] = XMFLOAT3(5000, 0, -5000);
+
+	SpatialHash hash(1.5f);
+	hash.Build(points.data(), (int)points.size());
+	Check(hash.GetCount() == (int)points.size(), "spatial hash holds every point");
+
+	std::vector<int> found;
+	std::vector<std::pair<float, int>> expected;
+	for (int q = 0; q < 200; q++)
+	{
+		int self = q * 10;
+		XMFLOAT3 position = points[self];
+		float radius = 0.5f + (q % 8);
+		int k = 1 + q % 12;
+
+		//Every point in the radius but the querying one, nearest first
+		expected.clear();
+		for (int i = 0; i < (int)points.size(); i++)
+		{
+			float dx = points[i].x - position.x;
+			float dy = points[i].y - position.y;
+			float dz = points[i].z - position.z;
+			float distSq = dx * dx + dy * dy + dz * dz;
+			if (i != self && distSq <= radius * radius)
+				expected.push_back(std::make_pair(distSq, i));
+		}
+		std::sort(expected.begin(), expected.end());
+
+		hash.QueryRadius(position, radius, found, self);
+		std::sort(found.begin(), found.end());
+		std::vector<int> expectedIndices;
+		for (size_t i = 0; i < expected.size(); i++)
+			expectedIndices.push_back(expected[i].second);
+		std::sort(expectedIndices.begin(), expectedIndices.end());
+		Check(found == expectedIndices, "QueryRadius finds every point in the radius");
+
+		//Ties can come back in any order, so compare distances
+		int count = hash.QueryKNearest(position, k, radius, found, self);
+		int expectedCount = (std::min)(k, (int)expected.size());
+		Check(count == expectedCount && (int)found.size() == count, "QueryKNearest returns min(k, points in radius)");
+		for (int i = 0; i < count && i < expectedCount; i++)
+		{
+			float dx = points[found[i]].x - position.x;
+			float dy = points[found[i]].y - position.y;
+			float dz = points[found[i]].z - position.z;
+			Check(dx * dx + dy * dy + dz * dz == expected[i].first, "QueryKNearest returns the nearest points, closest first");
+		}
+	}
+
+	//Stacked points still find each other
+	hash.QueryKNearest(points[10], 2, 0.1f, found, 10);
+	std::sort(found.begin(), found.end());
+	Check(found.size() == 2 && found[0] == 11 && found[1] == 12, "QueryKNearest finds stacked points");
+}
+
+// --------------------------------------------------------
+// Round trip a recorded frame with taps and partly held
+// keys through a scripted input manager
+// --------------------------------------------------------
+static void CheckInputFrames()
+{
+	EngineContext context;
+	context.MakeCurrent();
+	InputManager* input = InputManager::GetInstance();
+	input->Init(nullptr);
+	input->SetScripted(true);
+
+	//UP is held all frame, LEFT goes down late, RIGHT is tapped
+	//and DOWN is let go halfway. Partial keys are in key order
+	InputFrame frame = {};
+	frame.deltaTime = 1.0f / 60.0f;
+	frame.keys[VK_UP >> 3] |= 1 << (VK_UP & 7);
+	frame.keys[VK_LEFT >> 3] |= 1 << (VK_LEFT & 7);
+	frame.tapped[VK_RIGHT >> 3] |= 1 << (VK_RIGHT & 7);
+	frame.mouseX = 12;
+	frame.mouseY = 34;
+	frame.focused = 1;
+	frame.partialCount = 3;
+	frame.partialKeys[0] = VK_LEFT;
+	frame.partialFractions[0] = 0.25f;
+	frame.partialKeys[1] = VK_RIGHT;
+	frame.partialFractions[1] = 0.1f;
+	frame.partialKeys[2] = VK_DOWN;
+	frame.partialFractions[2] = 0.5f;
+
+	input->SetFrame(frame);
+	input->UpdateFocus();
+	input->UpdateMousePos();
+	Check(input->GetKeyHeldFraction(VK_UP) == 1.0f, "a key held all frame replays as held all frame");
+	Check(input->GetKeyHeldFraction(VK_LEFT) == 0.25f, "a key pressed late replays its held fraction");
+	Check(input->GetKeyHeldFraction(VK_RIGHT) == 0.1f && input->GetKeyDown(VK_RIGHT), "a tapped key replays as pressed");
+	Check(input->GetKeyHeldFraction(VK_DOWN) == 0.5f && !input->GetKey(VK_DOWN), "a key let go replays its held fraction");
+
+	InputFrame recorded = input->GetFrame(frame.deltaTime);
+	Check(memcmp(&recorded, &frame, sizeof(InputFrame)) == 0, "a replayed frame records back unchanged");
+
+	//Taps and partial keys only last one frame
+	input->UpdateStates();
+	input->UpdateFocus();
+	Check(input->GetKeyHeldFraction(VK_LEFT) == 1.0f, "a key still down is held all of the next frame");
+	Check(input->GetKeyHeldFraction(VK_RIGHT) == 0.0f && !input->GetKeyDown(VK_RIGHT), "a tap does not repeat");
+}
+
+// --------------------------------------------------------
+// Merge a row of entities into a CPU-only static batch and
+// check its ranges and the runs it culls to
+// --------------------------------------------------------
+static void CheckStaticBatch()
+{
+	EngineContext context;
+	context.MakeCurrent();
+
+	//A unit quad, placed 10 units apart along x
+	Vertex vertices[4] = {};
+	vertices[0].Position = XMFLOAT3(0, 0, 0);
+	vertices[1].Position = XMFLOAT3(0, 1, 0);
+	vertices[2].Position = XMFLOAT3(1, 1, 0);
+	vertices[3].Position = XMFLOAT3(1, 0, 0);
+	unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+	Mesh quad(vertices, 4, indices, 6, nullptr);
+
+	std::vector<Entity*> entities;
+	for (int i = 0; i < 4; i++)
+	{
+		Entity* e = new Entity(&quad, nullptr, "batched");
+		e->SetPosition(i * 10.0f, 0, 0);
+		entities.push_back(e);
+	}
+
+	StaticBatch batch(entities, nullptr);
+	Mesh* merged = batch.GetMesh();
+	Check(batch.GetRangeCount() == 4 && merged->GetIndexCount() == 24, "a batch merges every entity's indices");
+	Check(merged->GetVertices()[10].Position.x == 21.0f && merged->GetIndices()[18] == 12,
+		"merged vertices are in world space and indices point at them");
+
+	std::vector<unsigned int> runs;
+	Frustum everything;
+	std::vector<unsigned int> expected = { 0, 24 };
+	Check(batch.Cull(everything, runs) == 4 && runs == expected, "visible neighbours are drawn as one run");
+
+	//Looking down +z at the first two quads only
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookToLH(XMVectorSet(5, 0, -10, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0))));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixOrthographicLH(14, 14, 0.1f, 100)));
+	Frustum firstTwo;
+	firstTwo.SetFromMatrices(view, projection);
+	expected = { 0, 12 };
+	Check(batch.Cull(firstTwo, runs) == 2 && runs == expected, "ranges outside the frustum are skipped");
+
+	entities[1]->SetEnabled(false);
+	expected = { 0, 6, 12, 12 };
+	Check(batch.Cull(everything, runs) == 3 && runs == expected, "a disabled entity splits the runs around it");
+	entities[1]->SetEnabled(true);
+
+	EntityManager::GetInstance()->RemoveEntity(entities[2], true);
+	EntityManager::GetInstance()->Update(0);
+	expected = { 0, 12, 18, 6 };
+	Check(batch.Cull(everything, runs) == 3 && runs == expected && !batch.IsRangeDrawn(2),
+		"a deleted entity is left out of its batch");
+}
+
+// --------------------------------------------------------
+// Simplify a grid with a UV seam and open borders and check
+// that both keep their shape, then check an imported mesh's
+// detail levels and how SelectLod() moves between them
+// --------------------------------------------------------
+static void CheckMeshLods()
+{
+	//A bumpy grid on x and z. Columns left and right of the seam
+	//are separate UV islands, so the seam column is split
+	const int size = 24;
+	const int seam = 12;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> left((size + 1) * (size + 1));
+	std::vector<unsigned int> right((size + 1) * (size + 1));
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			Vertex v = {};
+			v.Position = XMFLOAT3((float)x, 0.1f * sinf(x * 0.7f) * cosf(z * 0.5f), (float)z);
+			v.Normal = XMFLOAT3(0, 1, 0);
+			v.UV = XMFLOAT2(x / (float)size, z / (float)size);
+			if (x <= seam)
+			{
+				left[z * (size + 1) + x] = (unsigned int)vertices.size();
+				vertices.push_back(v);
+			}
+			v.UV.x += 1.0f;
+			if (x >= seam)
+			{
+				right[z * (size + 1) + x] = (unsigned int)vertices.size();
+				vertices.push_back(v);
+			}
+		}
+	}
+
+	std::vector<unsigned int> indices;
+	for (int z = 0; z < size; z++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			const std::vector<unsigned int>& island = x < seam ? left : right;
+			unsigned int a = island[z * (size + 1) + x];
+			unsigned int b = island[(z + 1) * (size + 1) + x];
+			unsigned int c = island[(z + 1) * (size + 1) + x + 1];
+			unsigned int d = island[z * (size + 1) + x + 1];
+			unsigned int quad[6] = { a, b, c, a, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size());
+	unsigned int triangles = (unsigned int)indices.size() / 3;
+	bool inRange = true;
+	bool seamKept = true;
+	bool bordersKept = true;
+	for (int level = 1; level < MESH_MAX_LODS; level++)
+	{
+		std::vector<unsigned int> levelIndices;
+		triangles = simplifier.Simplify(triangles / 2, levelIndices);
+
+		//Open edges, found by welded grid position, have to run along a border
+		std::map<std::pair<int, int>, int> edgeUses;
+		for (size_t t = 0; t < levelIndices.size(); t += 3)
+		{
+			int cell[3];
+			bool leftSide = false;
+			bool rightSide = false;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = levelIndices[t + k];
+				if (vertex >= vertices.size())
+				{
+					inRange = false;
+					cell[k] = 0;
+					continue;
+				}
+				const Vertex& v = vertices[vertex];
+				cell[k] = (int)v.Position.z * (size + 1) + (int)v.Position.x;
+				leftSide = leftSide || v.Position.x < seam || v.UV.x <= 0.5f;
+				rightSide = rightSide || v.Position.x > seam || v.UV.x >= 1.0f;
+			}
+			seamKept = seamKept && !(leftSide && rightSide);
+
+			for (int k = 0; k < 3; k++)
+			{
+				int a = cell[k];
+				int b = cell[(k + 1) % 3];
+				edgeUses[std::make_pair((std::min)(a, b), (std::max)(a, b))]++;
+			}
+		}
+
+		for (auto& edge : edgeUses)
+		{
+			if (edge.second != 1)
+				continue;
+			int ax = edge.first.first % (size + 1), az = edge.first.first / (size + 1);
+			int bx = edge.first.second % (size + 1), bz = edge.first.second / (size + 1);
+			bool onBorder = (ax == bx && (ax == 0 || ax == size)) || (az == bz && (az == 0 || az == size));
+			bordersKept = bordersKept && onBorder;
+		}
+	}
+	Check(inRange, "simplified triangles index the original vertices");
+	Check(seamKept, "seam vertices stay on the seam");
+	Check(bordersKept, "open edge vertices stay on their edge");
+
+	Mesh mesh("Assets/Models/swimmer.obj", nullptr);
+	Check(mesh.IsMeshLoaded() && mesh.GetLodCount() >= 3, "an imported mesh gets simplified levels");
+
+	const std::vector<unsigned int>& meshIndices = mesh.GetIndices();
+	bool levelsInRange = true;
+	bool levelsHalve = true;
+	for (int lod = 0; lod < mesh.GetLodCount(); lod++)
+	{
+		unsigned int start = mesh.GetLodStartIndex(lod);
+		unsigned int count = mesh.GetLodIndexCount(lod);
+		if (start + count > meshIndices.size())
+		{
+			levelsInRange = false;
+			continue;
+		}
+		for (unsigned int i = start; i < start + count; i++)
+			levelsInRange = levelsInRange && meshIndices[i] < (unsigned int)mesh.GetVertexCount();
+
+		if (lod > 0)
+		{
+			float kept = count / (float)mesh.GetLodIndexCount(lod - 1);
+			levelsHalve = levelsHalve && kept > MESH_LOD_REDUCTION * 0.8f && kept <= (1.0f + MESH_LOD_REDUCTION) * 0.5f;
+		}
+	}
+	Check(levelsInRange, "every detail level indexes inside the vertex buffer");
+	Check(levelsHalve, "every detail level has about half the triangles of the one before");
+
+	//Level 1 starts below MESH_LOD_SCREEN_SIZE, give or take MESH_LOD_HYSTERESIS
+	float below = MESH_LOD_SCREEN_SIZE * (1.0f - MESH_LOD_HYSTERESIS);
+	float above = MESH_LOD_SCREEN_SIZE * (1.0f + MESH_LOD_HYSTERESIS);
+	Check(mesh.SelectLod(below * 1.05f, 0) == 0 && mesh.SelectLod(above * 0.95f, 1) == 1,
+		"the detail level holds inside the hysteresis band");
+	Check(mesh.SelectLod(below * 0.95f, 0) == 1 && mesh.SelectLod(above * 1.05f, 1) == 0,
+		"the detail level changes once the size is past the band");
+	Check(mesh.SelectLod(1.0f, mesh.GetLodCount() - 1) == 0 && mesh.SelectLod(0.0f, 0) == mesh.GetLodCount() - 1,
+		"the detail level can move more than one level at once");
+}
+
+// --------------------------------------------------------
+// Compare the render queue's radix sort against a stable
+// sort, and check that the id tables recycle and wrap ids
+// --------------------------------------------------------
+static void CheckRenderQueue()
+{
+	std::mt19937_64 rng(1234);
+
+	//Masks of the bits that vary: all of them, then one, two
+	//and three varying bytes so the sort ends in either buffer,
+	//then none. Few distinct values keep plenty of ties
+	const unsigned long long masks[] = {
+		~0ull,
+		0xFFull,
+		0xFF0000FFull,
+		0x00FF00FF0000FF00ull,
+		0x0ull
+	};
+	RenderQueue queue;
+	for (unsigned long long mask : masks)
+	{
+		for (size_t count : { 1000, 1001 })
+		{
+			unsigned long long base = rng() & ~mask;
+			std::vector<unsigned long long> values(37);
+			for (unsigned long long& value : values)
+				value = base | (rng() & mask);
+
+			queue.Clear();
+			std::vector<DrawPacket> expected;
+			for (size_t i = 0; i < count; i++)
+			{
+				DrawPacket packet = { values[rng() % values.size()], (unsigned int)i };
+				queue.Add(packet.key, packet.transformIndex);
+				expected.push_back(packet);
+			}
+			std::stable_sort(expected.begin(), expected.end(),
+				[](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+
+			queue.Sort();
+			bool same = queue.GetCount() == count;
+			for (size_t i = 0; same && i < count; i++)
+				same = queue.GetPackets()[i].key == expected[i].key && queue.GetPackets()[i].transformIndex == expected[i].transformIndex;
+			Check(same, "the render queue sorts like a stable sort");
+		}
+	}
+
+	//Freed ids are handed out again before new ones
+	int objects[7];
+	RenderIdTable ids("objects", 4);
+	Check(ids.Acquire(&objects[0]) == 0 && ids.Acquire(&objects[1]) == 1 && ids.Acquire(&objects[2]) == 2,
+		"ids are handed out in order");
+	Check(ids.Acquire(&objects[1]) == 1 && ids.GetCount() == 3, "an object keeps its id while it has users");
+	ids.Release(&objects[1]);
+	Check(ids.Acquire(&objects[3]) == 3, "an id stays taken while its object has users left");
+	ids.Release(&objects[1]);
+	Check(ids.GetCount() == 3 && ids.Acquire(&objects[4]) == 1, "a freed id is reused");
+
+	//Past the limit ids wrap, with one warning
+	unsigned int wrapped[2] = {};
+	int lines = CountPrintedLines([&]()
+	{
+		wrapped[0] = ids.Acquire(&objects[5]);
+		wrapped[1] = ids.Acquire(&objects[6]);
+	});
+	Check(wrapped[0] == 0 && wrapped[1] == 1, "ids wrap once the key field is full");
+	Check(lines == 1, "running out of ids warns once");
+}
+
+// Run the self checks in a group
+int RunHeadlessChecks(const char* name)
+{
+	bool all = strcmp(name, "all") == 0;
+	bool ran = false;
+	failures = 0;
+
+	if (all || strcmp(name, "spatial") == 0)
+	{
+		CheckSpatialHash();
+		ran = true;
+	}
+
+	if (all || strcmp(name, "input") == 0)
+	{
+		CheckInputFrames();
+		ran = true;
+	}
+
+	if (all || strcmp(name, "batch") == 0)
+	{
+		CheckStaticBatch();
+		ran = true;
+	}
+
+	if (all || strcmp(name, "queue") == 0)
+	{
+		CheckRenderQueue();
+		ran = true;
+	}
+
+	if (all || strcmp(name, "lod") == 0)
+	{
+		CheckMeshLods();
+		ran = true;
+	}
+
+	if (!ran)
+	{
+		printf("Unknown check \"%s\"\n", name);
+		return -1;
+	}
+
+	printf("Checks: %d failed\n", failures);
+	return failures;
+}
+
+#endif
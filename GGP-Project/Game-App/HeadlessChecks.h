@@ -0,0 +1,11 @@
+#pragma once
+
+// --------------------------------------------------------
+// Self checks for engine code the running game can't
+// exercise on its own, run by the headless runner's -check
+//
+// name - the group of checks to run, or "all"
+// Returns the number of failed checks, or -1 for an
+// unknown group
+// --------------------------------------------------------
+int RunHeadlessChecks(const char* name);
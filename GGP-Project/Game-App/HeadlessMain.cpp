@@ -0,0 +1,482 @@
+#ifdef HEADLESS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include "Simulation.h"
+#include "InputScript.h"
+#include "InputRecorder.h"
+#include "InputReplay.h"
+#include "RenderCommandList.h"
+#include "NullRenderBackend.h"
+#include "RenderCapture.h"
+#include "SoftwareRenderBackend.h"
+#include "OcclusionCuller.h"
+#include "DrawRecorder.h"
+#include "WorkerPool.h"
+#include "HeadlessChecks.h"
+
+//Packets per recorded list, matches the renderer's segments
+#define HEADLESS_RECORD_SEGMENT 256
+
+//Size of images from -render
+#define HEADLESS_RENDER_WIDTH 1280
+#define HEADLESS_RENDER_HEIGHT 720
+
+//There are no device objects, so any non-null handles stand in for
+//the pipeline and the per object constant buffer
+static const int headlessPipelineObject = 0;
+static const int headlessObjectBuffer = 0;
+
+// --------------------------------------------------------
+// Per-object vertex constants, laid out like
+// PerObjectVSConstants (which needs the graphics headers)
+// --------------------------------------------------------
+struct HeadlessObjectConstants
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTrans;
+};
+
+// --------------------------------------------------------
+// Gather the enabled entities with meshes and their
+// constants, repeated a number of times
+// --------------------------------------------------------
+static void GatherObjects(int copies, std::vector<Entity*>& objects, std::vector<HeadlessObjectConstants>& constants)
+{
+	EntityManager* entityManager = EntityManager::GetInstance();
+	objects.clear();
+	constants.clear();
+	for (int c = 0; c < copies; c++)
+	{
+		for (int e = 0; e < entityManager->GetEntityCount(); e++)
+		{
+			Entity* entity = entityManager->GetEntityAt(e);
+			if (!entity->GetEnabled() || entity->GetMesh() == nullptr)
+				continue;
+
+			HeadlessObjectConstants objectConstants;
+			objectConstants.world = entity->GetWorldMatrix();
+			objectConstants.worldInvTrans = entity->GetWorldInvTransMatrix();
+			objects.push_back(entity);
+			constants.push_back(objectConstants);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Feeds gathered objects to the renderer's DrawRecorder.
+// Meshes stand in for their vertex and index buffers.
+// Objects are drawn at the detail level in lods, or at full
+// detail without it
+// --------------------------------------------------------
+class HeadlessRecorder : public DrawRecorder
+{
+private:
+	const std::vector<Entity*>* objects;
+	const std::vector<HeadlessObjectConstants>* constants;
+	const std::vector<int>* lods;
+
+protected:
+	Mesh* GetMesh(size_t object) override { return (*objects)[object]->GetMesh(); }
+	int GetLod(size_t object) override { return lods != nullptr ? (*lods)[object] : 0; }
+
+	void RecordObject(RenderCommandList& list, size_t object) override
+	{
+		list.SetConstants(&headlessObjectBuffer, (*constants)[object]);
+	}
+
+	void BindMesh(RenderCommandList& list, Mesh* mesh) override
+	{
+		list.BindVertexBuffer(0, mesh, sizeof(Vertex), 0);
+		list.BindIndexBuffer(mesh);
+	}
+
+public:
+	HeadlessRecorder(const std::vector<Entity*>* objects, const std::vector<HeadlessObjectConstants>* constants,
+		const std::vector<int>* lods)
+	{
+		this->objects = objects;
+		this->constants = constants;
+		this->lods = lods;
+	}
+};
+
+// --------------------------------------------------------
+// Record the draws for a range of objects the way the
+// renderer's opaque pass does
+// --------------------------------------------------------
+static void RecordObjects(RenderCommandList* list, const std::vector<Entity*>* objects,
+	const std::vector<HeadlessObjectConstants>* constants, size_t first, size_t end,
+	const std::vector<int>* lods = nullptr)
+{
+	RenderPipeline pipeline = {};
+	pipeline.inputLayout = &headlessPipelineObject;
+	pipeline.vertexShader = &headlessPipelineObject;
+	pipeline.pixelShader = &headlessPipelineObject;
+
+	list->Clear();
+	HeadlessRecorder recorder(objects, constants, lods);
+	recorder.Record(*list, pipeline, first, end, false);
+}
+
+// --------------------------------------------------------
+// Draw the world on the CPU from the game camera's usual
+// spot behind the player, and save the image
+// Returns the image's hash
+// --------------------------------------------------------
+static unsigned int RenderImage(const char* path, int threads, Boat* player)
+{
+	using namespace DirectX;
+
+	std::vector<Entity*> objects;
+	std::vector<HeadlessObjectConstants> constants;
+	GatherObjects(1, objects, constants);
+
+	SoftwareRenderBackend backend;
+	backend.Init(HEADLESS_RENDER_WIDTH, HEADLESS_RENDER_HEIGHT, threads);
+	backend.SetObjectConstantBuffer(&headlessObjectBuffer);
+	for (Entity* entity : objects)
+	{
+		Mesh* mesh = entity->GetMesh();
+		backend.SetVertexData(mesh, mesh->GetVertices().data(), (unsigned int)mesh->GetVertices().size());
+		backend.SetIndexData(mesh, mesh->GetIndices().data(), (unsigned int)mesh->GetIndices().size());
+	}
+
+	//Same placement, projection and light as Game
+	XMFLOAT3 target = player->GetPosition();
+	XMFLOAT3 eye = XMFLOAT3(target.x, target.y + 16, target.z - 23);
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0, 1, 0, 0))));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI,
+		(float)HEADLESS_RENDER_WIDTH / HEADLESS_RENDER_HEIGHT, 0.1f, 100.0f)));
+	backend.SetCamera(view, projection);
+
+	//Leave out what the renderer would find hidden behind occluders
+	OcclusionCuller occlusionCuller;
+	occlusionCuller.Init(threads);
+	occlusionCuller.BeginFrame(view, projection);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (objects[i]->IsOccluder())
+			occlusionCuller.AddOccluder(objects[i]->GetMesh(), constants[i].world);
+	}
+	occlusionCuller.Rasterize();
+
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		Mesh* mesh = objects[i]->GetMesh();
+		if (!objects[i]->IsOccluder() && !occlusionCuller.IsVisible(mesh->GetBoundsMin(), mesh->GetBoundsMax(), constants[i].world))
+			continue;
+		objects[visibleCount] = objects[i];
+		constants[visibleCount] = constants[i];
+		visibleCount++;
+	}
+	objects.resize(visibleCount);
+	constants.resize(visibleCount);
+
+	//Pick detail levels from the size on screen like the renderer
+	std::vector<int> lods(objects.size());
+	std::vector<float> depths(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		Mesh* mesh = objects[i]->GetMesh();
+		XMFLOAT3 center;
+		float radius;
+		mesh->GetWorldSphere(constants[i].world, center, radius);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&center), XMLoadFloat3(&eye))));
+		lods[i] = mesh->SelectLod(Mesh::GetScreenSize(radius, distance, projection._22), 0);
+		depths[i] = distance;
+	}
+
+	//Draw front to back, as the renderer's queue does, so fewer
+	//pixels are shaded only to be covered later
+	std::vector<size_t> order(objects.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&depths](size_t a, size_t b) { return depths[a] < depths[b]; });
+	std::vector<Entity*> sortedObjects;
+	std::vector<HeadlessObjectConstants> sortedConstants;
+	std::vector<int> sortedLods;
+	for (size_t i : order)
+	{
+		sortedObjects.push_back(objects[i]);
+		sortedConstants.push_back(constants[i]);
+		sortedLods.push_back(lods[i]);
+	}
+	objects.swap(sortedObjects);
+	constants.swap(sortedConstants);
+	lods.swap(sortedLods);
+
+	XMFLOAT3 lightDirection;
+	XMVECTOR lightRotation = XMQuaternionRotationRollPitchYaw(XMConvertToRadians(60), XMConvertToRadians(-45), 0);
+	XMStoreFloat3(&lightDirection, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), lightRotation));
+	backend.SetLighting(lightDirection, XMFLOAT3(1, 1, 1), XMFLOAT3(0.35f, 0.19f, 0.02f), XMFLOAT3(0.8f, 0.8f, 0.8f));
+
+	auto start = std::chrono::high_resolution_clock::now();
+	RenderCommandList list;
+	RecordObjects(&list, &objects, &constants, 0, objects.size(), &lods);
+	backend.BeginFrame(0.1f, 0.2f, 0.35f);
+	backend.Execute(list);
+	backend.Finish();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	backend.SaveImage(path);
+	printf("Rendered %dx%d to \"%s\" in %.3fms, triangles: %llu (%llu culled), pixels: %llu, hash: %08x\n",
+		HEADLESS_RENDER_WIDTH, HEADLESS_RENDER_HEIGHT, path, elapsed.count(),
+		backend.GetTriangleCount(), backend.GetCulledTriangleCount(), backend.GetShadedPixelCount(), backend.GetImageHash());
+	printf("Occlusion: %u occluder triangles, %u of %u objects hidden\n",
+		occlusionCuller.GetOccluderTriangleCount(), occlusionCuller.GetOccludedCount(), occlusionCuller.GetTestedCount());
+	return backend.GetImageHash();
+}
+
+// --------------------------------------------------------
+// Entry point for the headless simulation runner
+//
+// Steps the game with a fixed timestep and no window or
+// graphics device, then prints timing stats. Run it from
+// the Game-App folder so the asset paths resolve.
+//
+// usage: [-frames n] [-dt seconds] [-seed n]
+//        [-script file | -replay file] [-record file]
+//        [-record-threads n] [-record-copies k] [-capture file]
+//        [-render file] [-render-threads n] [-expect-hash hex]
+//        [-check name]
+//
+// A replay brings its own seed and each frame's timestep,
+// and runs for as many frames as were recorded unless
+// -frames is given.
+// With -record-threads, each frame also records the scene's
+// draws (repeated k times) into render command lists on up
+// to n WorkerPool threads and executes them on the null
+// backend. -capture
+// writes the last frame's lists for the capture replay tool.
+// -render draws the final frame on the CPU to a PPM image,
+// and -expect-hash fails the run if its hash differs.
+// -check runs a group of self checks (or "all") and exits,
+// with a non-zero code if any failed
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int frames = -1;
+	float deltaTime = 1.0f / 60.0f;
+	unsigned int seed = 0;
+	const char* scriptPath = nullptr;
+	const char* replayPath = nullptr;
+	const char* recordPath = nullptr;
+	int recordThreads = 0;
+	int recordCopies = 1;
+	const char* capturePath = nullptr;
+	const char* renderPath = nullptr;
+	int renderThreads = 0;
+	const char* expectHash = nullptr;
+	const char* checkName = nullptr;
+
+	//Every option takes a value
+	for (int i = 1; i < argc; i += 2)
+	{
+		if (i + 1 == argc)
+		{
+			printf("Option \"%s\" is missing its value\n", argv[i]);
+			return 1;
+		}
+
+		if (strcmp(argv[i], "-frames") == 0) frames = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-dt") == 0) deltaTime = (float)atof(argv[i + 1]);
+		else if (strcmp(argv[i], "-seed") == 0) seed = (unsigned int)strtoul(argv[i + 1], nullptr, 10);
+		else if (strcmp(argv[i], "-script") == 0) scriptPath = argv[i + 1];
+		else if (strcmp(argv[i], "-replay") == 0) replayPath = argv[i + 1];
+		else if (strcmp(argv[i], "-record") == 0) recordPath = argv[i + 1];
+		else if (strcmp(argv[i], "-record-threads") == 0) recordThreads = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-record-copies") == 0) recordCopies = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-capture") == 0) capturePath = argv[i + 1];
+		else if (strcmp(argv[i], "-render") == 0) renderPath = argv[i + 1];
+		else if (strcmp(argv[i], "-render-threads") == 0) renderThreads = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-expect-hash") == 0) expectHash = argv[i + 1];
+		else if (strcmp(argv[i], "-check") == 0) checkName = argv[i + 1];
+		else
+		{
+			printf("Unknown option \"%s\"\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (checkName)
+		return RunHeadlessChecks(checkName) == 0 ? 0 : 1;
+
+	if (scriptPath && replayPath)
+	{
+		printf("Use either -script or -replay, not both\n");
+		return 1;
+	}
+
+	//Input comes from a script, a recording or nowhere
+	InputScript script;
+	if (scriptPath && !script.Load(scriptPath))
+		return 1;
+
+	InputReplay replay;
+	if (replayPath)
+	{
+		if (!replay.Load(replayPath))
+			return 1;
+		seed = replay.GetSeed();
+		if (frames < 0)
+			frames = replay.GetFrameCount();
+	}
+	if (frames < 0)
+		frames = 3600;
+
+	//Only CPU-side mesh data can be loaded without a device
+	ResourceManager* resourceManager = ResourceManager::GetInstance();
+	resourceManager->LoadMesh("Assets\\Models\\cube.obj", nullptr);
+	resourceManager->LoadMesh("Assets\\Models\\boat.obj", nullptr);
+	resourceManager->LoadMesh("Assets\\Models\\swimmer.obj", nullptr);
+	resourceManager->LoadMesh("Assets\\Models\\area.obj", nullptr);
+
+	//Create the world
+	Simulation* simulation = new Simulation();
+	SwimmerManager::GetInstance()->Seed(seed);
+	InputManager* inputManager = InputManager::GetInstance();
+	inputManager->Init(nullptr);
+	inputManager->SetScripted(true);
+
+	InputRecorder recorder;
+	if (recordPath)
+		recorder.Open(recordPath, seed);
+
+	simulation->CreateEntities();
+
+	//Command recording benchmark state
+	NullRenderBackend nullBackend;
+	std::vector<Entity*> recordObjects;
+	std::vector<HeadlessObjectConstants> recordConstants;
+	std::vector<RenderCommandList> recordLists;
+	size_t recordSegments = 0;
+	double recordTime = 0;
+	if (recordCopies < 1)
+		recordCopies = 1;
+
+	//Fixed timestep loop, or the recorded timesteps when replaying.
+	//Mirrors Game::Update minus the camera and water
+	double slowest = 0;
+	double totalTime = 0;
+	int frame = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (; frame < frames; frame++)
+	{
+		auto frameStart = std::chrono::high_resolution_clock::now();
+
+		if (replayPath)
+			deltaTime = replay.Step(inputManager);
+		else script.Apply((float)totalTime, inputManager);
+
+		inputManager->UpdateFocus();
+		if (inputManager->IsWindowFocused())
+		{
+			inputManager->UpdateMousePos();
+			recorder.Record(deltaTime, inputManager);
+			if (inputManager->GetKey(VK_ESCAPE))
+				break;
+
+			simulation->Update(deltaTime);
+			inputManager->UpdateStates();
+		}
+		else recorder.Record(deltaTime, inputManager);
+		totalTime += deltaTime;
+
+		if (recordThreads > 0)
+		{
+			auto recordStart = std::chrono::high_resolution_clock::now();
+
+			//Matrices are built here so the workers only read
+			GatherObjects(recordCopies, recordObjects, recordConstants);
+
+			size_t segmentCount = (recordObjects.size() + HEADLESS_RECORD_SEGMENT - 1) / HEADLESS_RECORD_SEGMENT;
+			if (recordLists.size() < segmentCount)
+				recordLists.resize(segmentCount);
+
+			//Pool threads take segments until there are none left
+			WorkerPool::GetInstance()->ParallelFor((int)segmentCount, recordThreads, [&](int s, int)
+			{
+				size_t first = s * HEADLESS_RECORD_SEGMENT;
+				size_t end = first + HEADLESS_RECORD_SEGMENT < recordObjects.size() ? first + HEADLESS_RECORD_SEGMENT : recordObjects.size();
+				RecordObjects(&recordLists[s], &recordObjects, &recordConstants, first, end);
+			});
+
+			//Submission stays in order on this thread
+			for (size_t s = 0; s < segmentCount; s++)
+				nullBackend.Execute(recordLists[s]);
+
+			recordSegments = segmentCount;
+			std::chrono::duration<double, std::milli> recordFrameTime = std::chrono::high_resolution_clock::now() - recordStart;
+			recordTime += recordFrameTime.count();
+		}
+
+		std::chrono::duration<double, std::milli> frameTime = std::chrono::high_resolution_clock::now() - frameStart;
+		if (frameTime.count() > slowest)
+			slowest = frameTime.count();
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	recorder.Close();
+
+	if (capturePath)
+	{
+		if (recordThreads <= 0)
+			printf("-capture needs -record-threads, nothing was recorded\n");
+		else
+		{
+			RenderCapture capture;
+			capture.BeginPass("Opaque");
+			for (size_t s = 0; s < recordSegments; s++)
+				capture.AddList(recordLists[s]);
+			capture.Save(capturePath);
+		}
+	}
+
+	//Report
+	Boat* player = simulation->GetPlayer();
+	DirectX::XMFLOAT3 playerPos = player->GetPosition();
+	printf("Frames: %d (%.2fs simulated), seed: %u\n", frame, totalTime, seed);
+	printf("Total: %.3fms, average: %.4fms, slowest: %.4fms\n",
+		elapsed.count(), elapsed.count() / (frame > 0 ? frame : 1), slowest);
+	printf("Entities: %d, game state: %d, player: (%.4f, %.4f, %.4f)\n",
+		EntityManager::GetInstance()->GetEntityCount(), (int)simulation->GetGameState(),
+		playerPos.x, playerPos.y, playerPos.z);
+	if (recordThreads > 0)
+	{
+		printf("Recording (%d threads): %.3fms, average: %.4fms\n",
+			(std::min)(recordThreads, WorkerPool::GetInstance()->GetThreadCount()), recordTime, recordTime / (frame > 0 ? frame : 1));
+		printf("Commands: %llu, draws: %llu, constant bytes: %llu, errors: %u\n",
+			nullBackend.GetCommandCount(),
+			nullBackend.GetDrawCount(), nullBackend.GetConstantBytes(), nullBackend.GetErrorCount());
+	}
+
+	int result = 0;
+	if (renderPath)
+	{
+		unsigned int hash = RenderImage(renderPath, renderThreads, player);
+		unsigned int expected = expectHash ? (unsigned int)strtoul(expectHash, nullptr, 16) : hash;
+		if (hash != expected)
+		{
+			printf("Image hash %08x does not match the expected %08x\n", hash, expected);
+			result = 1;
+		}
+	}
+	else if (expectHash)
+	{
+		printf("-expect-hash needs -render, nothing was compared\n");
+		result = 1;
+	}
+
+	delete simulation;
+	return result;
+}
+
+#endif
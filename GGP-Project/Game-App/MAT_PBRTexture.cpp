@@ -1,4 +1,5 @@
 #include "MAT_PBRTexture.h"
+#include "MaterialConstants.h"
 #include "LightManager.h"
 
 // Constructor - Set up a material
@@ -27,24 +28,22 @@ MAT_PBRTexture::~MAT_PBRTexture()
 void MAT_PBRTexture::PrepareMaterialCombo(GameObject* entityObj, Camera* cam)
 {
 	LightManager* lightManager = LightManager::GetInstance();
-	std::vector<Light*> lights = LightManager::GetInstance()->GetShadowCastingLights();
 
 	// Vertex shader data
-	vertexShader->SetMatrix4x4("projection", cam->GetProjectionMatrix());
-	vertexShader->SetMatrix4x4("view", cam->GetViewMatrix());
-	vertexShader->SetFloat2("uvScale", uvScale);
-	vertexShader->SetMatrix4x4("shadowView", lights[0]->GetViewMatrix());
-	vertexShader->SetMatrix4x4("shadowProj", lights[0]->GetProjectionMatrix());
+	PerComboVSConstants vsData = {};
+	vsData.view = cam->GetViewMatrix();
+	vsData.projection = cam->GetProjectionMatrix();
+	vsData.uvScale = uvScale;
+	vertexShader->SetBufferData(vsPerComboBuffer, vsData);
 
 	//Pixel shader data
-	pixelShader->SetFloat3("CameraPosition", cam->GetPosition());
+	PBRPerComboPSConstants psData = {};
+	psData.CameraPosition = cam->GetPosition();
+	psData.AmbLight = *lightManager->GetAmbientLight();
+	pixelShader->SetBufferData(psPerComboBuffer, psData);
+
 	//Set lights
-	int amnt = lightManager->GetLightAmnt();
-	LightStruct* arr = lightManager->GetLightStructArray();
-	pixelShader->SetData("Lights", (void*)arr,
-		sizeof(LightStruct) * MAX_LIGHTS);
-	pixelShader->SetInt("LightCount", amnt);
-	pixelShader->SetData("AmbLight", lightManager->GetAmbientLight(), sizeof(AmbientLightStruct));
+	PrepareLights();
 
 	//Set PBR vars
 	pixelShader->SetShaderResourceView("AlbedoTexture", albedoSRV);
@@ -54,18 +53,18 @@ void MAT_PBRTexture::PrepareMaterialCombo(GameObject* entityObj, Camera* cam)
 	pixelShader->SetSamplerState("BasicSampler", sampler);
 
 	//Set shadow vars
-	ID3D11ShaderResourceView* shadowSRV = lights[0]->GetShadowSRV();
-	pixelShader->SetShaderResourceView("ShadowMap", shadowSRV);
-	pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
+	PrepareShadows(cam, shadowSampler);
 
-	vertexShader->CopyBufferData("perCombo");
-	pixelShader->CopyBufferData("perCombo");
+	vertexShader->CopyBufferData(vsPerComboBuffer);
+	pixelShader->CopyBufferData(psPerComboBuffer);
 }
 
 // Prepare this material's shader's per object variables
 void MAT_PBRTexture::PrepareMaterialObject(GameObject* entityObj)
 {
-	vertexShader->SetMatrix4x4("world", entityObj->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("worldInvTrans", entityObj->GetWorldInvTransMatrix());
-	vertexShader->CopyBufferData("perObject");
+	PerObjectVSConstants vsData = {};
+	vsData.world = entityObj->GetWorldMatrix();
+	vsData.worldInvTrans = entityObj->GetWorldInvTransMatrix();
+	vertexShader->SetBufferData(vsPerObjectBuffer, vsData);
+	vertexShader->CopyBufferData(vsPerObjectBuffer);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "MAT_Water.h"
+#include "MaterialConstants.h"
 
 // Constructor - Set up a material
 MAT_Water::MAT_Water(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader,
@@ -28,7 +29,9 @@ void MAT_Water::PrepareMaterialCombo(GameObject* entityObj, Camera* cam)
 void MAT_Water::PrepareMaterialObject(GameObject * entityObj)
 {
 	//Sends the translate value to the pixel shader
-	pixelShader->SetFloat("Translate", *translate);
-	pixelShader->CopyBufferData("perObject");
+	WaterPerObjectPSConstants psData = {};
+	psData.Translate = *translate;
+	pixelShader->SetBufferData(psPerObjectBuffer, psData);
+	pixelShader->CopyBufferData(psPerObjectBuffer);
 	MAT_Basic::PrepareMaterialObject(entityObj);
 }
@@ -1,3 +1,4 @@
+#ifndef HEADLESS
 
 #include <Windows.h>
 #include "Game.h"
@@ -48,6 +49,10 @@ int WINAPI WinMain(
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
 
+	// Record input for replaying later with: -record <file>
+	if (strncmp(lpCmdLine, "-record ", 8) == 0)
+		dxGame.RecordInput(lpCmdLine + 8);
+
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
@@ -65,3 +70,5 @@ int WINAPI WinMain(
 	// whatever we get back once the game loop is over
 	return dxGame.Run();
 }
+
+#endif
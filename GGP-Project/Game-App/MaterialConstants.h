@@ -0,0 +1,49 @@
+#pragma once
+#include "ShaderConstants.h"
+
+// --------------------------------------------------------
+// C++ mirrors of the game's material pixel shader cbuffers.
+// See ShaderConstants.h
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// perCombo in PixelShader.hlsl and PS_ShineWater.hlsl
+// --------------------------------------------------------
+struct BasicPerComboPSConstants
+{
+	DirectX::XMFLOAT3 CameraPosition;
+	float padding0;
+	AmbientLightStruct AmbLight;
+	float Shininess;
+	float Roughness;
+	DirectX::XMFLOAT2 padding1;
+};
+CHECK_CONSTANT_OFFSET(BasicPerComboPSConstants, CameraPosition, 0);
+CHECK_CONSTANT_OFFSET(BasicPerComboPSConstants, AmbLight, 16);
+CHECK_CONSTANT_OFFSET(BasicPerComboPSConstants, Shininess, 32);
+CHECK_CONSTANT_OFFSET(BasicPerComboPSConstants, Roughness, 36);
+CHECK_CONSTANT_SIZE(BasicPerComboPSConstants, 48);
+
+// --------------------------------------------------------
+// perCombo in PS_PBR.hlsl
+// --------------------------------------------------------
+struct PBRPerComboPSConstants
+{
+	DirectX::XMFLOAT3 CameraPosition;
+	float padding;
+	AmbientLightStruct AmbLight;
+};
+CHECK_CONSTANT_OFFSET(PBRPerComboPSConstants, CameraPosition, 0);
+CHECK_CONSTANT_OFFSET(PBRPerComboPSConstants, AmbLight, 16);
+CHECK_CONSTANT_SIZE(PBRPerComboPSConstants, 32);
+
+// --------------------------------------------------------
+// perObject in PS_Water.hlsl and PS_ShineWater.hlsl
+// --------------------------------------------------------
+struct WaterPerObjectPSConstants
+{
+	float Translate;
+	DirectX::XMFLOAT3 padding;
+};
+CHECK_CONSTANT_OFFSET(WaterPerObjectPSConstants, Translate, 0);
+CHECK_CONSTANT_SIZE(WaterPerObjectPSConstants, 16);
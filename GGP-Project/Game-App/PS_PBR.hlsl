@@ -1,11 +1,11 @@
 
 #include "Lighting.hlsli"
+#include "Shadows.hlsli"
+#include "Clusters.hlsli"
 
 //Data that changes once per MatMesh combo
 cbuffer perCombo : register(b0)
 {
-	Light Lights[MAX_LIGHTS]; //array of lights
-	int LightCount; //amount of lights
 	float3 CameraPosition;
 	AmbientLight AmbLight;
 }
@@ -20,7 +20,6 @@ struct VertexToPixel
 	float3 normal		: NORMAL;
 	float3 tangent		: TANGENT;
 	float3 worldPos		: POSITION; // The world position of this PIXEL
-	float4 posForShadow : SHADOW;
 };
 
 
@@ -32,7 +31,7 @@ Texture2D MetalTexture			: register(t3);
 SamplerState BasicSampler		: register(s0);
 
 // Shadow-related variables
-Texture2D ShadowMap						: register(t4);
+Texture2DArray ShadowMap					: register(t4);
 SamplerComparisonState ShadowSampler	: register(s1);
 
 
@@ -62,10 +61,7 @@ float4 main(VertexToPixel input) : SV_TARGET
 
 	//Sample shadowmap
 	//Shadows are only on the singular directional light
-	float depthFromLight = input.posForShadow.z / input.posForShadow.w;
-	float2 shadowUV = input.posForShadow.xy / input.posForShadow.w * 0.5f + 0.5f;
-	shadowUV.y = 1.0f - shadowUV.y;
-	float shadowAmount = ShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, depthFromLight);
+	float shadowAmount = SampleCascadedShadow(ShadowMap, ShadowSampler, input.worldPos);
 
 	// Total color for this pixel
 	float3 totalColor = float3(0,0,0);
@@ -73,26 +69,31 @@ float4 main(VertexToPixel input) : SV_TARGET
 	//Add ambient light
 	totalColor += AmbLight.Color * AmbLight.Intensity * surfaceColor.rgb;
 
-	// Loop through all lights this frame
-	for (int i = 0; i < LightCount; i++)
+	// Directional lights reach every pixel
+	for (int i = 0; i < DirectionalLightCount; i++)
 	{
+		float3 dL = DirLightPBR(Lights[i], input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
+		dL *= shadowAmount;
+		totalColor += dL;
+	}
+
+	// Only loop through the lights binned into this pixel's cluster
+	uint2 cluster = GetClusterLights(input.position);
+	for (uint c = 0; c < cluster.y; c++)
+	{
+		Light light = Lights[ClusterLightIndices[cluster.x + c]];
+
 		// Which kind of light?
-		switch (Lights[i].Type)
+		switch (light.Type)
 		{
-		case LIGHT_TYPE_DIRECTIONAL:
-			float3 dL = DirLightPBR(Lights[i], input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
-			dL *= shadowAmount;
-			totalColor += dL;
-			break;
-
 		case LIGHT_TYPE_POINT:
-			float3 pL = PointLightPBR(Lights[i], input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
+			float3 pL = PointLightPBR(light, input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
 			//pL *= shadowAmount;
 			totalColor += pL;
 			break;
 
 		case LIGHT_TYPE_SPOT:
-			float3 sL = SpotLightPBR(Lights[i], input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
+			float3 sL = SpotLightPBR(light, input.normal, input.worldPos, CameraPosition, roughness, metal, surfaceColor.rgb, specColor);
 			//sL *= shadowAmount;
 			totalColor += sL;
 			break;
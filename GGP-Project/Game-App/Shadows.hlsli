@@ -0,0 +1,51 @@
+// Include guard
+#ifndef _SHADOWS_HLSL
+#define _SHADOWS_HLSL
+
+//Must match MAX_SHADOW_CASCADES in Lights.h
+#define MAX_SHADOW_CASCADES 4
+
+//Cascades of the shadow casting directional light
+cbuffer shadows : register(b2)
+{
+	matrix ShadowViewProj[MAX_SHADOW_CASCADES]; //view * projection of each cascade
+	float4 CascadeSplits;						//view depth at which each cascade ends
+	float3 ShadowCameraPosition;
+	int CascadeCount;
+	float3 ShadowCameraForward;
+	float ShadowPadding;
+}
+
+// Sample a cascaded shadow map. Returns 1 if fully lit
+//
+// shadowMap - one array slice per cascade
+// shadowSampler - comparison sampler
+// worldPos - world position of the pixel
+float SampleCascadedShadow(Texture2DArray shadowMap, SamplerComparisonState shadowSampler, float3 worldPos)
+{
+	//No light casts shadows
+	if (CascadeCount == 0)
+		return 1.0f;
+
+	//Pick the first cascade that reaches this far from the camera
+	float viewDepth = dot(worldPos - ShadowCameraPosition, ShadowCameraForward);
+	int cascade = 0;
+	[unroll]
+	for (int i = 0; i < MAX_SHADOW_CASCADES - 1; i++)
+	{
+		if (i < CascadeCount - 1 && viewDepth > CascadeSplits[i])
+			cascade = i + 1;
+	}
+
+	//Past the last cascade nothing casts shadows
+	if (viewDepth > CascadeSplits[CascadeCount - 1])
+		return 1.0f;
+
+	float4 posForShadow = mul(float4(worldPos, 1.0f), ShadowViewProj[cascade]);
+	float depthFromLight = posForShadow.z / posForShadow.w;
+	float2 shadowUV = posForShadow.xy / posForShadow.w * 0.5f + 0.5f;
+	shadowUV.y = 1.0f - shadowUV.y;
+	return shadowMap.SampleCmpLevelZero(shadowSampler, float3(shadowUV, cascade), depthFromLight);
+}
+
+#endif
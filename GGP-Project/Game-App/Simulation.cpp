@@ -0,0 +1,113 @@
+#include "Simulation.h"
+
+using namespace DirectX;
+
+// Create a world and bind it to the calling thread
+Simulation::Simulation()
+{
+	world = new GameContext();
+	world->MakeCurrent();
+
+	//Get the world's managers
+	resourceManager = ResourceManager::GetInstance();
+	inputManager = InputManager::GetInstance();
+	entityManager = EntityManager::GetInstance();
+	swimmerManager = SwimmerManager::GetInstance();
+	swimmerManager->SetLevelRadius(LEVEL_RADIUS - 1);
+
+	gameState = GameState::Menu;
+	player = nullptr;
+}
+
+// Delete the world and everything in it
+Simulation::~Simulation()
+{
+	if (world) { delete world; }
+}
+
+// Create the level and the player
+void Simulation::CreateEntities()
+{
+	//Create water
+	/*Entity* water = new Entity(
+		resourceManager->GetMesh("Assets\\Models\\cube.obj"),
+		resourceManager->GetMaterial("water")
+	);
+	water->SetScale(26, 0.1f, 26);*/
+
+	//Create area
+	Entity* area = new Entity(resourceManager->GetMesh("Assets\\Models\\area.obj"),
+		resourceManager->GetMaterial("area"));
+	area->SetScale(2.18f, 0.5f, 2.18f);
+	area->SetStatic(true);
+	area->SetOccluder(true);
+
+	// Player (Boat) - Create the player.
+	player = new Boat(
+		resourceManager->GetMesh("Assets\\Models\\boat.obj"),
+		resourceManager->GetMaterial("boat"),
+		LEVEL_RADIUS
+	);
+	player->SetPosition(0, 0, 0); // Set the player's initial position.
+	player->AddCollider(XMFLOAT3(0.9f, 0.8f, 2.3f), XMFLOAT3(0, 0, 0));
+#if defined(DEBUG) || defined(_DEBUG)
+	player->SetDebug(true);
+#endif
+}
+
+// Step the game state and every entity
+void Simulation::Update(float deltaTime)
+{
+	//Gamestate switch
+	switch (gameState)
+	{
+		case GameState::Menu:
+			gameState = GameState::Playing;
+			break;
+
+		case GameState::Playing:
+			// Updates the swimmer generator/manager.
+			if(player->GetState() == BoatState::Playing)
+				swimmerManager->Update(deltaTime);
+
+			entityManager->Update(deltaTime);
+
+			//Check for gameover
+			if (player->GetState() == BoatState::Crashed)
+				gameState = GameState::GameOver;
+			break;
+
+		case GameState::GameOver:
+			entityManager->Update(deltaTime);
+
+			//Check for reset input
+			if (inputManager->GetKey(VK_SPACE))
+			{
+				player->Reset();
+				swimmerManager->Reset();
+				gameState = GameState::Playing;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+// Get the player's boat
+Boat* Simulation::GetPlayer()
+{
+	return player;
+}
+
+// Get the current game state
+GameState Simulation::GetGameState()
+{
+	return gameState;
+}
+
+// Get the world this simulation runs in
+GameContext* Simulation::GetWorld()
+{
+	return world;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "GameContext.h"
+#include "InputManager.h"
+#include "EntityManager.h"
+#include "ResourceManager.h"
+#include "SwimmerManager.h"
+#include "Boat.h"
+
+#define LEVEL_RADIUS 13
+
+enum class GameState {Menu, Playing, GameOver};
+
+// --------------------------------------------------------
+// The gameplay side of the game, with no window or device
+//
+// Owns a world and steps its entities, swimmers and game
+// state. The windowed Game and the headless runner both
+// drive one of these
+// --------------------------------------------------------
+class Simulation
+{
+private:
+	//World owning the managers below
+	GameContext* world;
+
+	//Managers
+	ResourceManager* resourceManager;
+	InputManager* inputManager;
+	EntityManager* entityManager;
+	SwimmerManager* swimmerManager;
+
+	//Gameplay
+	GameState gameState;
+	Boat* player;
+
+public:
+	// --------------------------------------------------------
+	// Create a world and bind it to the calling thread.
+	// Meshes and materials must already be loaded
+	// --------------------------------------------------------
+	Simulation();
+
+	// --------------------------------------------------------
+	// Delete the world and everything in it
+	// --------------------------------------------------------
+	~Simulation();
+
+	// --------------------------------------------------------
+	// Create the level and the player
+	// --------------------------------------------------------
+	void CreateEntities();
+
+	// --------------------------------------------------------
+	// Step the game state and every entity
+	//
+	// deltaTime - the time of this step in seconds
+	// --------------------------------------------------------
+	void Update(float deltaTime);
+
+	// --------------------------------------------------------
+	// Get the player's boat
+	// --------------------------------------------------------
+	Boat* GetPlayer();
+
+	// --------------------------------------------------------
+	// Get the current game state
+	// --------------------------------------------------------
+	GameState GetGameState();
+
+	// --------------------------------------------------------
+	// Get the world this simulation runs in
+	// --------------------------------------------------------
+	GameContext* GetWorld();
+};
@@ -38,6 +38,7 @@ Swimmer::Swimmer(Mesh* mesh, Material* material, std::string name)
 	acceleration = 0;
 	sinAmnt = 0;
 	gravityMult = 0;
+	separation = XMFLOAT3(0, 0, 0);
 
 	oldestIndex = 0;
 	newestIndex = 1;
@@ -164,6 +165,9 @@ void Swimmer::Float(float deltaTime)
 {
 	ApplyWaterPhysics(deltaTime, true);
 
+	// Drift away from nearby swimmers.
+	MoveAbsolute(XMFLOAT3(separation.x * deltaTime, 0, separation.z * deltaTime));
+
 	// Rotate when idle.
 	Rotate(0, 5 * deltaTime, 0);
 }
@@ -212,9 +216,10 @@ XMFLOAT3 Swimmer::GetTrailPos(float deltaTime)
 // Get the rotation for following on the trail
 DirectX::XMFLOAT4 Swimmer::GetTrailRotation(float deltaTime)
 {
-	XMFLOAT4 rot;
+	XMFLOAT4 rot = GetRotation();
+	XMFLOAT4 leaderRot = leader->GetRotation();
 	XMStoreFloat4(&rot,
-		XMQuaternionSlerp(XMLoadFloat4(&GetRotation()), XMLoadFloat4(&leader->GetRotation()), 1.4f * deltaTime));
+		XMQuaternionSlerp(XMLoadFloat4(&rot), XMLoadFloat4(&leaderRot), 1.4f * deltaTime));
 	return rot;
 }
 
@@ -241,9 +246,10 @@ void Swimmer::Join(float deltaTime)
 
 	//Seek trail
 	XMFLOAT3 trailPos = GetTrailPos(deltaTime);
+	XMFLOAT3 position = GetPosition();
 	XMFLOAT3 lerp;
 	XMStoreFloat3(&lerp, XMVectorScale(XMVector3Normalize(
-		XMLoadFloat3(&trailPos) - XMLoadFloat3(&GetPosition())), 5 * deltaTime)
+		XMLoadFloat3(&trailPos) - XMLoadFloat3(&position)), 5 * deltaTime)
 	);
 	MoveAbsolute(lerp);
 	SetRotation(GetTrailRotation(deltaTime));
@@ -314,6 +320,12 @@ void Swimmer::SetLagSeconds(float lagSeconds)
 	this->lagSeconds = lagSeconds;
 }
 
+// Set the separation velocity applied while floating
+void Swimmer::SetSeparation(DirectX::XMFLOAT3 separation)
+{
+	this->separation = separation;
+}
+
 // Get the state of the swimmer
 SwimmerState Swimmer::GetState()
 {
@@ -31,6 +31,9 @@ private:
 	float sinAmnt;
 	float gravityMult;
 
+	//Avoidance vars
+	DirectX::XMFLOAT3 separation;
+
 	// --------------------------------------------------------
 	// Run this swimmer's entering behaviour
 	//---------------------------------------------------------
@@ -110,6 +113,11 @@ public:
 	// --------------------------------------------------------
 	void SetLagSeconds(float lagSeconds);
 
+	// --------------------------------------------------------
+	// Set the separation velocity applied while floating
+	// --------------------------------------------------------
+	void SetSeparation(DirectX::XMFLOAT3 separation);
+
 	// --------------------------------------------------------
 	// Get the state of the swimmer
 	// --------------------------------------------------------
@@ -1,11 +1,17 @@
 #include "SwimmerManager.h"
 #include "ResourceManager.h"
 #include "EntityManager.h"
+#include "GameContext.h"
+
+//Separation consts
+#define SEPARATION_RADIUS 1.5f
+#define SEPARATION_STRENGTH 1.0f
+#define SEPARATION_MAX_NEIGHBOURS 8 //Keeps the cost per swimmer flat in crowds
 
 using namespace DirectX;
 
 // Default constructor.
-SwimmerManager::SwimmerManager() 
+SwimmerManager::SwimmerManager() : spatialHash(SEPARATION_RADIUS)
 {
 	// Seed the random.
 	std::random_device rseed;
@@ -23,6 +29,18 @@ SwimmerManager::~SwimmerManager()
 	Reset();
 }
 
+// Swimmer manager of the current game context.
+SwimmerManager* SwimmerManager::GetInstance()
+{
+	GameContext* world = GameContext::GetCurrent();
+	if (world == nullptr)
+	{
+		printf("No GameContext is current on this thread. Cannot get the SwimmerManager\n");
+		return nullptr;
+	}
+	return world->GetSwimmerManager();
+}
+
 // Set level radius
 void SwimmerManager::SetLevelRadius(float radius)
 {
@@ -30,11 +48,17 @@ void SwimmerManager::SetLevelRadius(float radius)
 
 }
 
+// Reseed the spawn generator
+void SwimmerManager::Seed(unsigned int seed)
+{
+	rng.seed(seed);
+}
+
 // Get next random position.
 DirectX::XMFLOAT3 SwimmerManager::GetNextPosition()
 {	// Create uniform distribution ranges.
-	std::uniform_real<float> angle(0, XM_2PI);
-	std::uniform_real<float> distR(0, levelRadius);
+	std::uniform_real_distribution<float> angle(0, XM_2PI);
+	std::uniform_real_distribution<float> distR(0, levelRadius);
 	float theta = angle(rng);
 	float rad = distR(rng);
 
@@ -66,7 +90,6 @@ bool SwimmerManager::IsReadyToSpawn()
 // Reset the manager.
 void SwimmerManager::Reset() 
 {
-	EntityManager* entityManager = EntityManager::GetInstance();
 	for (int i = 0; i < swimmers.size(); i++)
 	{
 		if (swimmers[i] != nullptr)
@@ -92,9 +115,68 @@ void SwimmerManager::Update(float deltaTime)
 			SpawnSwimmer();
 			currentTTS = 0;
 		}
+
+		UpdateSeparation();
+	}
+}
+
+// Rebuild the spatial hash and steer floating swimmers apart
+void SwimmerManager::UpdateSeparation()
+{
+	//Rebuild the hash from this tick's positions
+	swimmerPositions.resize(swimmers.size());
+	for (size_t i = 0; i < swimmers.size(); i++)
+		swimmerPositions[i] = swimmers[i]->GetPosition();
+	spatialHash.Build(swimmerPositions.data(), (int)swimmerPositions.size());
+
+	for (size_t i = 0; i < swimmers.size(); i++)
+	{
+		if (swimmers[i]->GetState() != SwimmerState::Floating)
+		{
+			swimmers[i]->SetSeparation(XMFLOAT3(0, 0, 0));
+			continue;
+		}
+
+		//Push away from the nearest neighbours, harder the closer they are
+		XMFLOAT3 pos = swimmerPositions[i];
+		XMFLOAT3 push = XMFLOAT3(0, 0, 0);
+		spatialHash.QueryKNearest(pos, SEPARATION_MAX_NEIGHBOURS, SEPARATION_RADIUS, neighbours, (int)i);
+		for (size_t n = 0; n < neighbours.size(); n++)
+		{
+			XMFLOAT3 other = swimmerPositions[neighbours[n]];
+			float dx = pos.x - other.x;
+			float dz = pos.z - other.z;
+			float dist = sqrtf(dx * dx + dz * dz);
+			if (dist < 0.0001f)
+			{
+				//Stacked exactly on top of each other, the lower index goes left
+				//and the higher right, so the pair always splits
+				dx = (int)i < neighbours[n] ? -1.0f : 1.0f;
+				dz = 0;
+				dist = 1;
+			}
+
+			float weight = (1 - dist / SEPARATION_RADIUS) / dist;
+			push.x += dx * weight;
+			push.z += dz * weight;
+		}
+
+		//Don't push swimmers out of the level
+		float nextX = pos.x + push.x;
+		float nextZ = pos.z + push.z;
+		if (nextX * nextX + nextZ * nextZ > levelRadius * levelRadius)
+			push = XMFLOAT3(0, 0, 0);
+
+		swimmers[i]->SetSeparation(XMFLOAT3(push.x * SEPARATION_STRENGTH, 0, push.z * SEPARATION_STRENGTH));
 	}
 }
 
+// Get the spatial hash of every swimmer
+SpatialHash* SwimmerManager::GetSpatialHash()
+{
+	return &spatialHash;
+}
+
 // Create a swimmer and spawn at a random position.
 Swimmer* SwimmerManager::SpawnSwimmer()
 {
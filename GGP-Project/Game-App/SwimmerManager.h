@@ -2,6 +2,7 @@
 #include <DirectXMath.h>
 #include "Entity.h"
 #include "Swimmer.h"
+#include "SpatialHash.h"
 #include <random>
 
 class SwimmerManager :
@@ -17,9 +18,10 @@ private: // PRIVATE ------------------------------------
 	std::mt19937 rng;
 	float levelRadius;
 
-	//Singleton
+	//One per GameContext
 	SwimmerManager();
 	~SwimmerManager();
+	friend class GameContext;
 
 	// Generates random position that's in bounds.
 	DirectX::XMFLOAT3 GetNextPosition();
@@ -31,14 +33,20 @@ private: // PRIVATE ------------------------------------
 
 	std::vector<Swimmer*> swimmers;
 
+	//Neighbour query vars
+	SpatialHash spatialHash;
+	std::vector<DirectX::XMFLOAT3> swimmerPositions;
+	std::vector<int> neighbours;
+
+	// --------------------------------------------------------
+	// Rebuild the spatial hash and steer floating swimmers apart
+	// --------------------------------------------------------
+	void UpdateSeparation();
+
 public: // PUBLIC --------------------------------------
 
-	// Singleton.
-	static SwimmerManager* GetInstance()
-	{
-		static SwimmerManager instance;
-		return &instance;
-	}
+	// Swimmer manager of the current game context.
+	static SwimmerManager* GetInstance();
 	//Delete this
 	SwimmerManager(SwimmerManager const&) = delete;
 	void operator=(SwimmerManager const&) = delete;
@@ -77,6 +85,18 @@ public: // PUBLIC --------------------------------------
 	// Set level radius
 	// --------------------------------------------------------
 	void SetLevelRadius(float radius);
+
+	// --------------------------------------------------------
+	// Reseed the spawn generator, for repeatable runs
+	// --------------------------------------------------------
+	void Seed(unsigned int seed);
+
+	// --------------------------------------------------------
+	// Get the spatial hash of every swimmer, whatever its
+	// state. Indices match GetSwimmer() and are valid until
+	// the next Update
+	// --------------------------------------------------------
+	SpatialHash* GetSpatialHash();
 		
 	// --------------------------------------------------------
 	// Attach swimmer to a leader.
@@ -0,0 +1,70 @@
+
+//Data that changes once per MatMesh combo
+cbuffer perCombo : register(b0)
+{
+	matrix view;
+	matrix projection;
+	float2 uvScale;
+}
+
+// Struct representing a single vertex worth of data
+// - The first four members come from the mesh's vertex buffer (slot 0)
+// - Anything ending in _PER_INSTANCE comes from the renderer's instance
+//   buffer (slot 1) and steps once per instance instead of once per vertex
+struct VertexShaderInput
+{
+	float3 position		: POSITION;	     // XYZ position
+	float2 uv			: TEXCOORD;		 // XY uv
+	float3 normal		: NORMAL;        // XYZ normal
+	float3 tangent		: TANGENT;
+
+	// Top three rows of the (transposed) world matrix, the
+	// bottom row is always (0, 0, 0, 1)
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+};
+
+// Struct representing the data we're sending down the pipeline
+// - Must match VertexShader.hlsl so the same pixel shaders work
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;	 // XYZW position (System Value Position)
+	float2 uv			: TEXCOORD;		 // XY uv
+	float3 normal		: NORMAL;        // XYZ normal
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;		 // world position of the vertex
+};
+
+// --------------------------------------------------------
+// Instanced version of VertexShader.hlsl
+//
+// The world matrix comes from per-instance data instead of
+// a constant buffer, so a whole batch draws in one call
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	// Rebuild the world matrix from its rows
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, float4(0, 0, 0, 1)));
+
+	// The inverse transpose of the upper 3x3 is its cofactor matrix scaled
+	// by 1 / determinant. The scale drops out when normalizing, so the
+	// cofactors (cross products of the rows) are enough
+	float3x3 rotScale = (float3x3)world;
+	float3x3 normalMatrix = float3x3(
+		cross(rotScale[1], rotScale[2]),
+		cross(rotScale[2], rotScale[0]),
+		cross(rotScale[0], rotScale[1]));
+
+	float4 worldPos = mul(float4(input.position, 1.0f), world);
+
+	output.position = mul(mul(worldPos, view), projection);
+	output.worldPos = worldPos.xyz;
+	output.normal = normalize(mul(input.normal, normalMatrix));
+	output.tangent = normalize(mul(input.tangent, normalMatrix));
+	output.uv = input.uv * uvScale;
+
+	return output;
+}
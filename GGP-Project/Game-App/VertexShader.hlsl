@@ -5,8 +5,6 @@ cbuffer perCombo : register(b0)
 	matrix view;
 	matrix projection;
 	float2 uvScale;
-	matrix shadowView;
-	matrix shadowProj;
 }
 
 //Data that changes once per MatMesh combo
@@ -51,7 +49,6 @@ struct VertexToPixel
 	float3 normal		: NORMAL;        // XYZ normal
 	float3 tangent		: TANGENT;
 	float3 worldPos		: POSITION;		 // world position of the vertex
-	float4 posForShadow : SHADOW;
 };
 
 // --------------------------------------------------------
@@ -75,16 +72,16 @@ VertexToPixel main(VertexShaderInput input )
 	// all of those transformations (world to view to projection space)
 	matrix worldViewProj = mul(mul(world, view), projection);
 
-	// Calculate shadow map position
-	matrix shadowWVP = mul(mul(world, shadowView), shadowProj);
-	output.posForShadow = mul(float4(input.position, 1.0f), shadowWVP);
-
 	// Then we convert our 3-component position vector to a 4-component vector
 	// and multiply it by our final 4x4 matrix.
 	//
 	// The result is essentially the position (XY) of the vertex on our 2D 
 	// screen and the distance (Z) from the camera (the "depth" of the pixel)
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	//
+	// precise stops the compiler from reordering this math, so it gives
+	// exactly the depths VS_Shadow wrote in the depth pre-pass
+	precise float4 position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = position;
 	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
 	output.normal = normalize(mul(input.normal, (float3x3)worldInvTrans));
 	output.tangent = normalize(mul(input.tangent, (float3x3)worldInvTrans));
@@ -7,6 +7,11 @@ Camera::Camera()
 {
 	//Default transformation values
 	up = XMFLOAT3(0, 1, 0);
+	fov = 0.25f * XM_PI;
+	aspectRatio = 1;
+	nearClip = 0.1f;
+	farClip = 100;
+	XMStoreFloat4x4(&projection, XMMatrixIdentity());
 	CreateViewMatrix();
 }
 
@@ -33,6 +38,7 @@ void Camera::CreateViewMatrix()
 	XMStoreFloat4x4(&view, XMMatrixTranspose(
 		XMMatrixLookToLH(XMLoadFloat3(&GetPosition()), 
 		forward, up)));
+	frustum.SetFromMatrices(view, projection);
 }
 
 // Get the camera's view matrix
@@ -45,16 +51,52 @@ XMFLOAT4X4 Camera::GetViewMatrix()
 void Camera::CreateProjectionMatrix(float fov, float aspectRatio, 
 										float nearClip, float farClip)
 {
+	this->fov = fov;
+	this->aspectRatio = aspectRatio;
+	this->nearClip = nearClip;
+	this->farClip = farClip;
+
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
 		fov,			// Field of View Angle
 		aspectRatio,	// Aspect ratio
 		nearClip,		// Near clip plane distance
 		farClip);		// Far clip plane distance
 	XMStoreFloat4x4(&projection, XMMatrixTranspose(P)); // Transpose for HLSL!
+	frustum.SetFromMatrices(view, projection);
 }
 
 // Get the camera's projection matrix
 XMFLOAT4X4 Camera::GetProjectionMatrix()
 {
 	return projection;
+}
+
+// Get the field of view the projection was made with
+float Camera::GetFov()
+{
+	return fov;
+}
+
+// Get the aspect ratio the projection was made with
+float Camera::GetAspectRatio()
+{
+	return aspectRatio;
+}
+
+// Get the near clip distance the projection was made with
+float Camera::GetNearClip()
+{
+	return nearClip;
+}
+
+// Get the far clip distance the projection was made with
+float Camera::GetFarClip()
+{
+	return farClip;
+}
+
+// Get the camera's frustum planes
+const Frustum& Camera::GetFrustum()
+{
+	return frustum;
 }
\ No newline at end of file
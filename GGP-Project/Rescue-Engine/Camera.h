@@ -1,6 +1,7 @@
 #pragma once
 #include <DirectXMath.h>
 #include "GameObject.h"
+#include "Frustum.h"
 
 // --------------------------------------------------------
 // A camera definition.
@@ -11,6 +12,13 @@ private:
 	//Matrices
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 projection;
+	Frustum frustum;
+
+	//Projection parameters, kept for fitting shadow cascades
+	float fov;
+	float aspectRatio;
+	float nearClip;
+	float farClip;
 
 	//Transformation data
 	DirectX::XMFLOAT3 up;
@@ -59,5 +67,19 @@ public:
 	// Get the camera's projection matrix
 	// --------------------------------------------------------
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
+
+	// --------------------------------------------------------
+	// Get the parameters the projection matrix was made from
+	// --------------------------------------------------------
+	float GetFov();
+	float GetAspectRatio();
+	float GetNearClip();
+	float GetFarClip();
+
+	// --------------------------------------------------------
+	// Get the camera's frustum planes.
+	// Kept in sync with the view and projection matrices
+	// --------------------------------------------------------
+	const Frustum& GetFrustum();
 };
 
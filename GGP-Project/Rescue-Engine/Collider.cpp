@@ -1,5 +1,6 @@
 #include "Collider.h"
-#include "ResourceManager.h"
+#include <cmath>
+#include <limits>
 
 using namespace DirectX;
 
@@ -87,7 +88,8 @@ DirectX::XMFLOAT3 Collider::GetHalfSize() const
 DirectX::XMVECTOR Collider::GetNormal(DirectX::XMFLOAT4 axis)
 {
 	//return worldMatrix * axis
-	XMMATRIX world = XMLoadFloat4x4(&GetWorldMatrix());
+	XMFLOAT4X4 worldMat = GetWorldMatrix();
+	XMMATRIX world = XMLoadFloat4x4(&worldMat);
 	XMVECTOR direction = XMLoadFloat4(&axis);
 
 	return XMVector4Transform(direction, world);
@@ -192,27 +194,31 @@ bool Collider::SAT(Collider* other)
 			rotAinB.m[i][j] = XMVectorGetX(XMVector3Dot(axesA[i], axesB[j]));
 
 	//Vector between rigidbodies
-	XMVECTOR translation = XMLoadFloat3(&other->GetPosition()) - XMLoadFloat3(&GetPosition());
+	XMFLOAT3 thisPos = GetPosition();
+	XMFLOAT3 otherPos = other->GetPosition();
+	XMVECTOR translation = XMLoadFloat3(&otherPos) - XMLoadFloat3(&thisPos);
 	//Converted into A's vector space
 	float tx = XMVectorGetX(XMVector3Dot(translation, axesA[0]));
 	float ty = XMVectorGetX(XMVector3Dot(translation, axesA[1]));
 	float tz = XMVectorGetX(XMVector3Dot(translation, axesA[2]));
-	translation = XMLoadFloat3(&XMFLOAT3(tx, ty, tz));
+	translation = XMVectorSet(tx, ty, tz, 0);
 
 	//Populates subexpressions
 	for (int i = 0; i < 3; i++)
 		for (int j = 0; j < 3; j++)
-			subexpressions.m[i][j] = abs(rotAinB.m[i][j]) + std::numeric_limits<float>::epsilon();
+			subexpressions.m[i][j] = fabsf(rotAinB.m[i][j]) + std::numeric_limits<float>::epsilon();
 
-	XMVECTOR thisHalf = XMLoadFloat3(&GetHalfSize()); //half size of this collider
-	XMVECTOR otherHalf = XMLoadFloat3(&other->GetHalfSize()); //half size of other collider
+	XMFLOAT3 thisHalfSize = GetHalfSize();
+	XMFLOAT3 otherHalfSize = other->GetHalfSize();
+	XMVECTOR thisHalf = XMLoadFloat3(&thisHalfSize); //half size of this collider
+	XMVECTOR otherHalf = XMLoadFloat3(&otherHalfSize); //half size of other collider
 
 	//Checks first three axes (A's xyz)
 	for (int i = 0; i < 3; i++)
 	{
 		ra = XMVectorGetByIndex(thisHalf, i);
 		rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[i][0] + XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[i][1] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[i][2];
-		if (abs(XMVectorGetByIndex(translation, i)) > ra + rb) return false;
+		if (fabsf(XMVectorGetByIndex(translation, i)) > ra + rb) return false;
 	}
 
 	//Checks next three axes (B's xyz)
@@ -220,7 +226,7 @@ bool Collider::SAT(Collider* other)
 	{
 		ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[0][i] + XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[1][i] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[2][i];
 		rb = XMVectorGetByIndex(otherHalf, i);
-		if (abs(XMVectorGetByIndex(translation, 0) * rotAinB.m[0][i] + XMVectorGetByIndex(translation, 1) * rotAinB.m[1][i] + XMVectorGetByIndex(translation, 2) * rotAinB.m[2][i]) > ra + rb) return false;
+		if (fabsf(XMVectorGetByIndex(translation, 0) * rotAinB.m[0][i] + XMVectorGetByIndex(translation, 1) * rotAinB.m[1][i] + XMVectorGetByIndex(translation, 2) * rotAinB.m[2][i]) > ra + rb) return false;
 	}
 
 	//Tests nine more axes
@@ -230,39 +236,39 @@ bool Collider::SAT(Collider* other)
 	// Test axis L = A0 x B0
 	ra = XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[2][0] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[1][0];
 	rb = XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[0][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[0][1];
-	if (abs(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][0] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][0]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][0] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][0]) > ra + rb) return false;
 	// Test axis L = A0 x B1
 	ra = XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[2][1] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[1][1];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[0][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[0][0];
-	if (abs(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][1] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][1]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][1] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][1]) > ra + rb) return false;
 	// Test axis L = A0 x B2
 	ra = XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[2][2] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[1][2];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[0][1] + XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[0][0];
-	if (abs(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][2] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][2]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 2) * rotAinB.m[1][2] - XMVectorGetByIndex(translation, 1) * rotAinB.m[2][2]) > ra + rb) return false;
 	// Test axis L = A1 x B0
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[2][0] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[0][0];
 	rb = XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[1][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[1][1];
-	if (abs(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][0] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][0]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][0] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][0]) > ra + rb) return false;
 	// Test axis L = A1 x B1
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[2][1] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[0][1];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[1][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[1][0];
-	if (abs(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][1] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][1]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][1] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][1]) > ra + rb) return false;
 	// Test axis L = A1 x B2
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[2][2] + XMVectorGetByIndex(thisHalf, 2) * subexpressions.m[0][2];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[1][1] + XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[1][0];
-	if (abs(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][2] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][2]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 0) * rotAinB.m[2][2] - XMVectorGetByIndex(translation, 2) * rotAinB.m[0][2]) > ra + rb) return false;
 	// Test axis L = A2 x B0
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[1][0] + XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[0][0];
 	rb = XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[2][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[2][1];
-	if (abs(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][0] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][0]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][0] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][0]) > ra + rb) return false;
 	// Test axis L = A2 x B1
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[1][1] + XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[0][1];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[2][2] + XMVectorGetByIndex(otherHalf, 2) * subexpressions.m[2][0];
-	if (abs(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][1] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][1]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][1] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][1]) > ra + rb) return false;
 	// Test axis L = A2 x B2
 	ra = XMVectorGetByIndex(thisHalf, 0) * subexpressions.m[1][2] + XMVectorGetByIndex(thisHalf, 1) * subexpressions.m[0][2];
 	rb = XMVectorGetByIndex(otherHalf, 0) * subexpressions.m[2][1] + XMVectorGetByIndex(otherHalf, 1) * subexpressions.m[2][0];
-	if (abs(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][2] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][2]) > ra + rb) return false;
+	if (fabsf(XMVectorGetByIndex(translation, 1) * rotAinB.m[0][2] - XMVectorGetByIndex(translation, 0) * rotAinB.m[1][2]) > ra + rb) return false;
 
 	return true;
 }
@@ -0,0 +1,99 @@
+#include "D3D11RenderBackend.h"
+#include <cstring>
+
+// Constructor - Call Init() before use
+D3D11RenderBackend::D3D11RenderBackend()
+{
+	stateCache = nullptr;
+}
+
+// Set the state cache commands bind through
+void D3D11RenderBackend::Init(RenderStateCache* stateCache)
+{
+	this->stateCache = stateCache;
+}
+
+// Submit every command in a list to the context
+void D3D11RenderBackend::Execute(const RenderCommandList& list)
+{
+	ID3D11DeviceContext* context = stateCache->GetContext();
+
+	for (const RenderCommand& command : list.GetCommands())
+	{
+		switch (command.type)
+		{
+		case RenderCommandType::BindPipeline:
+		{
+			const RenderPipeline& pipeline = list.GetPipeline(command);
+			stateCache->SetInputLayout((ID3D11InputLayout*)pipeline.inputLayout);
+			stateCache->SetVertexShader((ID3D11VertexShader*)pipeline.vertexShader);
+			stateCache->SetPixelShader((ID3D11PixelShader*)pipeline.pixelShader);
+			stateCache->SetRasterizerState((ID3D11RasterizerState*)pipeline.rasterizerState);
+			stateCache->SetBlendState((ID3D11BlendState*)pipeline.blendState);
+			stateCache->SetDepthStencilState((ID3D11DepthStencilState*)pipeline.depthStencilState);
+			break;
+		}
+
+		case RenderCommandType::BindVertexBuffer:
+			stateCache->SetVertexBuffer(command.slot, (ID3D11Buffer*)command.object, command.args[0], command.args[1]);
+			break;
+
+		case RenderCommandType::BindIndexBuffer:
+			stateCache->SetIndexBuffer((ID3D11Buffer*)command.object, DXGI_FORMAT_R32_UINT, command.args[0]);
+			break;
+
+		case RenderCommandType::BindConstantBuffer:
+			if (command.stage == RenderStage::Vertex)
+				stateCache->SetVSConstantBuffer(command.slot, (ID3D11Buffer*)command.object);
+			else
+				stateCache->SetPSConstantBuffer(command.slot, (ID3D11Buffer*)command.object);
+			break;
+
+		case RenderCommandType::BindResource:
+		{
+			ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)command.object;
+			if (command.stage == RenderStage::Vertex)
+				context->VSSetShaderResources(command.slot, 1, &srv);
+			else
+				stateCache->SetPSShaderResource(command.slot, srv);
+			break;
+		}
+
+		case RenderCommandType::BindSampler:
+		{
+			ID3D11SamplerState* sampler = (ID3D11SamplerState*)command.object;
+			if (command.stage == RenderStage::Vertex)
+				context->VSSetSamplers(command.slot, 1, &sampler);
+			else
+				stateCache->SetPSSampler(command.slot, sampler);
+			break;
+		}
+
+		case RenderCommandType::SetConstants:
+		{
+			ID3D11Buffer* buffer = (ID3D11Buffer*)command.object;
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+				break;
+			memcpy(mapped.pData, list.GetConstants(command), command.args[1]);
+			context->Unmap(buffer, 0);
+			break;
+		}
+
+		case RenderCommandType::Draw:
+			context->Draw(command.args[0], command.args[1]);
+			break;
+
+		case RenderCommandType::DrawIndexed:
+			context->DrawIndexed(command.args[0], command.args[1], (INT)command.args[2]);
+			break;
+
+		case RenderCommandType::DrawIndexedInstanced:
+			context->DrawIndexedInstanced(command.args[0], command.args[3], command.args[1], (INT)command.args[2], command.args[4]);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
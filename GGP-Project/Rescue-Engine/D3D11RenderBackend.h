@@ -0,0 +1,35 @@
+#pragma once
+#include <d3d11.h>
+#include "RenderCommandList.h"
+#include "RenderStateCache.h"
+
+// --------------------------------------------------------
+// A RenderBackend that submits to a D3D11 device context
+//
+// Binds go through a RenderStateCache so they are filtered
+// like the renderer's own, and constants are written with
+// Map(WRITE_DISCARD). Objects in the lists must be the
+// matching D3D11 interfaces.
+// --------------------------------------------------------
+class D3D11RenderBackend : public RenderBackend
+{
+private:
+	RenderStateCache* stateCache;
+
+public:
+	// --------------------------------------------------------
+	// Construct a backend. Call Init() before use
+	// --------------------------------------------------------
+	D3D11RenderBackend();
+
+	// --------------------------------------------------------
+	// Set the state cache commands bind through. Commands are
+	// submitted to the context it is tracking
+	// --------------------------------------------------------
+	void Init(RenderStateCache* stateCache);
+
+	// --------------------------------------------------------
+	// Submit every command in a list to the context
+	// --------------------------------------------------------
+	void Execute(const RenderCommandList& list);
+};
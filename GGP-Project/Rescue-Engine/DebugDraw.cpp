@@ -0,0 +1,145 @@
+#include "DebugDraw.h"
+#include "EngineContext.h"
+#include <cmath>
+
+using namespace DirectX;
+
+//Corner pairs of the 12 edges of a cube, corners indexed by their xyz bits
+static const int boxEdges[24] =
+{
+	0, 1,  2, 3,  4, 5,  6, 7, //along x
+	0, 2,  1, 3,  4, 6,  5, 7, //along y
+	0, 4,  1, 5,  2, 6,  3, 7  //along z
+};
+
+// Get the debug drawer of the current context's renderer
+DebugDraw* DebugDraw::GetInstance()
+{
+	return EngineContext::GetCurrent()->GetRenderer()->GetDebugDraw();
+}
+
+// Check whether an owner already added a shape this frame
+bool DebugDraw::IsDuplicate(const void* owner)
+{
+	if (owner == nullptr)
+		return false;
+	return !owners.insert(owner).second;
+}
+
+// Add a line between two world space points
+void DebugDraw::AddLine(XMFLOAT3 from, XMFLOAT3 to, XMFLOAT4 color, DebugDepth depth)
+{
+	std::vector<DebugVertex>& batch = vertices[(int)depth];
+	batch.push_back({ from, color });
+	batch.push_back({ to, color });
+}
+
+// Add the edges of a unit cube transformed by a world matrix
+void DebugDraw::AddBox(const XMFLOAT4X4& world, XMFLOAT4 color, const void* owner, DebugDepth depth)
+{
+	if (IsDuplicate(owner))
+		return;
+
+	//The stored matrix is transposed for HLSL
+	XMMATRIX transform = XMMatrixTranspose(XMLoadFloat4x4(&world));
+	XMFLOAT3 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? 0.5f : -0.5f,
+			(i & 2) ? 0.5f : -0.5f,
+			(i & 4) ? 0.5f : -0.5f, 1);
+		XMStoreFloat3(&corners[i], XMVector3Transform(corner, transform));
+	}
+
+	for (int i = 0; i < 24; i += 2)
+		AddLine(corners[boxEdges[i]], corners[boxEdges[i + 1]], color, depth);
+}
+
+// Add the edges of an axis aligned box
+void DebugDraw::AddBox(XMFLOAT3 center, XMFLOAT3 size, XMFLOAT4 color, const void* owner, DebugDepth depth)
+{
+	XMMATRIX world = XMMatrixScalingFromVector(XMLoadFloat3(&size)) *
+		XMMatrixTranslationFromVector(XMLoadFloat3(&center));
+	XMFLOAT4X4 boxWorld;
+	XMStoreFloat4x4(&boxWorld, XMMatrixTranspose(world));
+	AddBox(boxWorld, color, owner, depth);
+}
+
+// Add a sphere as three circles around its axes
+void DebugDraw::AddSphere(XMFLOAT3 center, float radius, XMFLOAT4 color, const void* owner, DebugDepth depth)
+{
+	if (IsDuplicate(owner))
+		return;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		XMFLOAT3 last;
+		for (int i = 0; i <= DEBUG_SPHERE_SEGMENTS; i++)
+		{
+			float angle = XM_2PI * i / DEBUG_SPHERE_SEGMENTS;
+			float a = cosf(angle) * radius;
+			float b = sinf(angle) * radius;
+
+			//Circle in the plane perpendicular to this axis
+			XMFLOAT3 point = center;
+			if (axis == 0) { point.y += a; point.z += b; }
+			else if (axis == 1) { point.x += a; point.z += b; }
+			else { point.x += a; point.y += b; }
+
+			if (i > 0)
+				AddLine(last, point, color, depth);
+			last = point;
+		}
+	}
+}
+
+// Add an arrow from one point to another
+void DebugDraw::AddArrow(XMFLOAT3 from, XMFLOAT3 to, XMFLOAT4 color, float headSize, DebugDepth depth)
+{
+	AddLine(from, to, color, depth);
+
+	XMVECTOR tip = XMLoadFloat3(&to);
+	XMVECTOR dir = tip - XMLoadFloat3(&from);
+	if (XMVectorGetX(XMVector3LengthSq(dir)) < 1e-8f)
+		return;
+	dir = XMVector3Normalize(dir);
+
+	//Two directions perpendicular to the arrow for the head's fins
+	XMVECTOR up = fabsf(XMVectorGetY(dir)) < 0.99f ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0);
+	XMVECTOR side = XMVector3Normalize(XMVector3Cross(dir, up));
+	XMVECTOR side2 = XMVector3Cross(dir, side);
+
+	XMVECTOR base = tip - dir * headSize;
+	float width = headSize * 0.5f;
+	XMVECTOR fins[4] = { side * width, -side * width, side2 * width, -side2 * width };
+	for (int i = 0; i < 4; i++)
+	{
+		XMFLOAT3 fin;
+		XMStoreFloat3(&fin, base + fins[i]);
+		AddLine(to, fin, color, depth);
+	}
+}
+
+// Get the line list vertices of a batch
+const std::vector<DebugVertex>& DebugDraw::GetVertices(DebugDepth depth)
+{
+	return vertices[(int)depth];
+}
+
+// Get the total number of vertices in every batch
+size_t DebugDraw::GetVertexCount()
+{
+	size_t count = 0;
+	for (int i = 0; i < (int)DebugDepth::Count; i++)
+		count += vertices[i].size();
+	return count;
+}
+
+// Remove every shape, ready for the next frame
+void DebugDraw::Clear()
+{
+	for (int i = 0; i < (int)DebugDepth::Count; i++)
+		vertices[i].clear();
+	owners.clear();
+}
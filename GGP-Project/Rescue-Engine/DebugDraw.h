@@ -0,0 +1,108 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_set>
+
+//Segments used for each circle of a debug sphere
+#define DEBUG_SPHERE_SEGMENTS 16
+
+// --------------------------------------------------------
+// A vertex of a debug line. Matches VS_ColDebug's input
+// --------------------------------------------------------
+struct DebugVertex
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 color;
+};
+
+// --------------------------------------------------------
+// Which batch a debug shape is drawn with
+// --------------------------------------------------------
+enum class DebugDepth
+{
+	Tested,		//Hidden behind scene geometry
+	Overlay,	//Always drawn on top
+	Count
+};
+
+// --------------------------------------------------------
+// One per renderer
+//
+// Immediate mode debug drawing. Shapes are turned into line
+// list vertices as they are added and the renderer draws each
+// batch with a single draw call at the end of the frame, then
+// clears them. Nothing carries over between frames, so add
+// shapes every frame they should be visible.
+// --------------------------------------------------------
+class DebugDraw
+{
+private:
+	//Line list vertices, one list per DebugDepth
+	std::vector<DebugVertex> vertices[(int)DebugDepth::Count];
+
+	//Owners that have already added a shape this frame
+	std::unordered_set<const void*> owners;
+
+	// --------------------------------------------------------
+	// Check whether an owner already added a shape this frame,
+	// remembering it if not. Null owners are never deduplicated
+	// --------------------------------------------------------
+	bool IsDuplicate(const void* owner);
+
+public:
+	// --------------------------------------------------------
+	// Get the debug drawer of the current context's renderer
+	// --------------------------------------------------------
+	static DebugDraw* GetInstance();
+
+	// --------------------------------------------------------
+	// Add a line between two world space points
+	// --------------------------------------------------------
+	void AddLine(DirectX::XMFLOAT3 from, DirectX::XMFLOAT3 to, DirectX::XMFLOAT4 color,
+		DebugDepth depth = DebugDepth::Tested);
+
+	// --------------------------------------------------------
+	// Add the edges of a unit cube transformed by a world matrix
+	//
+	// world - transposed world matrix, as stored for HLSL
+	// owner - object adding the box. Later boxes from the same
+	//         owner are ignored until the next frame
+	// --------------------------------------------------------
+	void AddBox(const DirectX::XMFLOAT4X4& world, DirectX::XMFLOAT4 color,
+		const void* owner = nullptr, DebugDepth depth = DebugDepth::Tested);
+
+	// --------------------------------------------------------
+	// Add the edges of an axis aligned box
+	// --------------------------------------------------------
+	void AddBox(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 size, DirectX::XMFLOAT4 color,
+		const void* owner = nullptr, DebugDepth depth = DebugDepth::Tested);
+
+	// --------------------------------------------------------
+	// Add a sphere as three circles around its axes
+	// --------------------------------------------------------
+	void AddSphere(DirectX::XMFLOAT3 center, float radius, DirectX::XMFLOAT4 color,
+		const void* owner = nullptr, DebugDepth depth = DebugDepth::Tested);
+
+	// --------------------------------------------------------
+	// Add an arrow from one point to another
+	//
+	// headSize - length of the arrow head
+	// --------------------------------------------------------
+	void AddArrow(DirectX::XMFLOAT3 from, DirectX::XMFLOAT3 to, DirectX::XMFLOAT4 color,
+		float headSize = 0.25f, DebugDepth depth = DebugDepth::Tested);
+
+	// --------------------------------------------------------
+	// Get the line list vertices of a batch
+	// --------------------------------------------------------
+	const std::vector<DebugVertex>& GetVertices(DebugDepth depth);
+
+	// --------------------------------------------------------
+	// Get the total number of vertices in every batch
+	// --------------------------------------------------------
+	size_t GetVertexCount();
+
+	// --------------------------------------------------------
+	// Remove every shape, ready for the next frame
+	// --------------------------------------------------------
+	void Clear();
+};
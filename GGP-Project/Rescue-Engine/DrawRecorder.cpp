@@ -0,0 +1,64 @@
+#include "DrawRecorder.h"
+#include "Vertex.h"
+
+// Bind a mesh's vertex and index buffers
+void DrawRecorder::BindMesh(RenderCommandList& list, Mesh* mesh)
+{
+	list.BindVertexBuffer(0, mesh->GetVertexBuffer(), sizeof(Vertex), 0);
+	list.BindIndexBuffer(mesh->GetIndexBuffer());
+}
+
+// Objects draw their detail level unless a subclass says otherwise
+const std::vector<unsigned int>* DrawRecorder::GetRuns(size_t)
+{
+	return nullptr;
+}
+
+// Subclasses that instance record their runs here
+void DrawRecorder::RecordInstances(RenderCommandList&, size_t, size_t, Mesh*, int)
+{
+}
+
+// Record the draws of objects [first, end)
+void DrawRecorder::Record(RenderCommandList& list, const RenderPipeline& pipeline, size_t first, size_t end, bool instanced)
+{
+	list.BindPipeline(pipeline);
+
+	//Objects are often in depth order rather than grouped by
+	//mesh, so buffers are rebound whenever the mesh changes
+	Mesh* lastMesh = nullptr;
+	size_t i = first;
+	while (i < end)
+	{
+		Mesh* mesh = GetMesh(i);
+		int lod = GetLod(i);
+		if (mesh != lastMesh)
+		{
+			BindMesh(list, mesh);
+			lastMesh = mesh;
+		}
+
+		//Instanced runs draw every neighbour with the same mesh and level at once
+		if (instanced)
+		{
+			size_t runEnd = i + 1;
+			while (runEnd < end && GetMesh(runEnd) == mesh && GetLod(runEnd) == lod)
+				runEnd++;
+
+			RecordInstances(list, i, runEnd - i, mesh, lod);
+			i = runEnd;
+			continue;
+		}
+
+		RecordObject(list, i);
+		const std::vector<unsigned int>* runs = GetRuns(i);
+		if (runs != nullptr)
+		{
+			for (size_t r = 0; r < runs->size(); r += 2)
+				list.DrawIndexed((*runs)[r + 1], (*runs)[r]);
+		}
+		else
+			list.DrawIndexed(mesh->GetLodIndexCount(lod), mesh->GetLodStartIndex(lod));
+		i++;
+	}
+}
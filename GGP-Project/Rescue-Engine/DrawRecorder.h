@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "RenderCommandList.h"
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Records the draws of a run of objects that share a
+// pipeline into a command list, the way the renderer's
+// opaque pass draws them
+//
+// Buffers are rebound whenever the mesh changes, and each
+// object sets its own constants before drawing its detail
+// level. Instanced runs draw every neighbouring object with
+// the same mesh and detail level at once. Subclasses supply
+// the objects; the renderer records its opaque packets with
+// one, and the headless runner its scene, so both record
+// the same commands. Record() only reads the subclass, so
+// several segments can be recorded at once
+// --------------------------------------------------------
+class DrawRecorder
+{
+protected:
+	// --------------------------------------------------------
+	// Get the mesh and detail level an object draws
+	// --------------------------------------------------------
+	virtual Mesh* GetMesh(size_t object) = 0;
+	virtual int GetLod(size_t object) = 0;
+
+	// --------------------------------------------------------
+	// Record an object's per object constants
+	// --------------------------------------------------------
+	virtual void RecordObject(RenderCommandList& list, size_t object) = 0;
+
+	// --------------------------------------------------------
+	// Bind a mesh's vertex and index buffers
+	// --------------------------------------------------------
+	virtual void BindMesh(RenderCommandList& list, Mesh* mesh);
+
+	// --------------------------------------------------------
+	// Get the (start index, index count) pairs an object draws
+	// instead of its detail level, or null to draw the level
+	// --------------------------------------------------------
+	virtual const std::vector<unsigned int>* GetRuns(size_t object);
+
+	// --------------------------------------------------------
+	// Record count objects from object on as one instanced
+	// draw. Only called when Record() is told to instance
+	// --------------------------------------------------------
+	virtual void RecordInstances(RenderCommandList& list, size_t object, size_t count, Mesh* mesh, int lod);
+
+public:
+	virtual ~DrawRecorder() {}
+
+	// --------------------------------------------------------
+	// Record the draws of objects [first, end)
+	//
+	// list - the list to record into, after what it holds
+	// pipeline - the pipeline every object draws with
+	// instanced - draw runs with RecordInstances()
+	// --------------------------------------------------------
+	void Record(RenderCommandList& list, const RenderPipeline& pipeline, size_t first, size_t end, bool instanced);
+};
@@ -0,0 +1,79 @@
+#include "EngineContext.h"
+#include <cassert>
+#include <cstdio>
+
+thread_local EngineContext* EngineContext::current = nullptr;
+
+// Construct a context and all of its managers
+EngineContext::EngineContext()
+{
+	entityManager = new EntityManager();
+	inputManager = new InputManager();
+#ifndef HEADLESS
+	renderer = new Renderer();
+	lightManager = new LightManager();
+#endif
+}
+
+// Destroy all of this context's entities and managers
+EngineContext::~EngineContext()
+{
+	//Entities unregister from the current renderer when deleted,
+	//so this context has to be current while tearing down
+	EngineContext* previous = current;
+	current = this;
+
+	//Entities first, they still talk to the renderer
+	delete entityManager;
+#ifndef HEADLESS
+	delete renderer;
+	delete lightManager;
+#endif
+	delete inputManager;
+
+	current = (previous == this) ? nullptr : previous;
+}
+
+// Bind this context to the calling thread
+void EngineContext::MakeCurrent()
+{
+	current = this;
+}
+
+// Get the context bound to the calling thread
+EngineContext* EngineContext::GetCurrent()
+{
+	//Sharing a fallback context would let threads race on one world
+	if (current == nullptr)
+	{
+		printf("No EngineContext is current on this thread. Call MakeCurrent() first\n");
+		assert(false && "No EngineContext is current on this thread");
+	}
+	return current;
+}
+
+// Get this context's entity manager
+EntityManager* EngineContext::GetEntityManager()
+{
+	return entityManager;
+}
+
+// Get this context's input manager
+InputManager* EngineContext::GetInputManager()
+{
+	return inputManager;
+}
+
+#ifndef HEADLESS
+// Get this context's renderer
+Renderer* EngineContext::GetRenderer()
+{
+	return renderer;
+}
+
+// Get this context's light manager
+LightManager* EngineContext::GetLightManager()
+{
+	return lightManager;
+}
+#endif
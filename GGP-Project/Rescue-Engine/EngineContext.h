@@ -0,0 +1,87 @@
+#pragma once
+#include "EntityManager.h"
+#include "InputManager.h"
+#ifndef HEADLESS
+#include "Renderer.h"
+#include "LightManager.h"
+#endif
+
+// --------------------------------------------------------
+// Owns the managers for a single world
+//
+// Each manager's GetInstance() returns the manager of the
+// context that is current on the calling thread, so a
+// process can run several worlds side by side on different
+// threads. The ResourceManager is NOT owned by a context;
+// it stays process-wide and is shared read-only, so load
+// every resource before any world threads start.
+//
+// There is no default context: a thread has to bind one
+// with MakeCurrent() before using any of the managers.
+//
+// HEADLESS builds have no renderer or lights.
+// --------------------------------------------------------
+class EngineContext
+{
+private:
+	//Per-world managers
+	EntityManager* entityManager;
+	InputManager* inputManager;
+#ifndef HEADLESS
+	Renderer* renderer;
+	LightManager* lightManager;
+#endif
+
+protected:
+	//Context bound to the calling thread
+	static thread_local EngineContext* current;
+
+public:
+	// --------------------------------------------------------
+	// Construct a context and all of its managers.
+	// Call MakeCurrent() before using it
+	// --------------------------------------------------------
+	EngineContext();
+
+	// --------------------------------------------------------
+	// Destroy all of this context's entities and managers
+	// --------------------------------------------------------
+	virtual ~EngineContext();
+
+	//Delete this
+	EngineContext(EngineContext const&) = delete;
+	void operator=(EngineContext const&) = delete;
+
+	// --------------------------------------------------------
+	// Bind this context to the calling thread
+	// --------------------------------------------------------
+	void MakeCurrent();
+
+	// --------------------------------------------------------
+	// Get the context bound to the calling thread. Reports
+	// and returns nullptr if the thread never bound one
+	// --------------------------------------------------------
+	static EngineContext* GetCurrent();
+
+	// --------------------------------------------------------
+	// Get this context's entity manager
+	// --------------------------------------------------------
+	EntityManager* GetEntityManager();
+
+	// --------------------------------------------------------
+	// Get this context's input manager
+	// --------------------------------------------------------
+	InputManager* GetInputManager();
+
+#ifndef HEADLESS
+	// --------------------------------------------------------
+	// Get this context's renderer
+	// --------------------------------------------------------
+	Renderer* GetRenderer();
+
+	// --------------------------------------------------------
+	// Get this context's light manager
+	// --------------------------------------------------------
+	LightManager* GetLightManager();
+#endif
+};
@@ -1,6 +1,9 @@
-#include "Renderer.h"
+#include "Entity.h"
 #include "EntityManager.h"
-#include <sstream> 
+#include "StaticBatch.h"
+#ifndef HEADLESS
+#include "Renderer.h"
+#endif
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -11,17 +14,20 @@ Entity::Entity(Mesh* mesh, Material* material)
 	this->mesh = mesh;
 	this->material = material;
 
-	//Create a unique identifer (combination of the two addresses).
-	//	Used in the renderer
-	const void * addressMat = static_cast<const void*>(material);
-	const void * addressMesh = static_cast<const void*>(mesh);
-	std::stringstream ss;
-	ss << addressMat << addressMesh;
-	std::string temp = ss.str();
-	identifier = ss.str();
-
+	//Filled in by the renderer
+	renderIndex = -1;
+	renderKey = 0;
+	shadowKey = 0;
+	staticShadowKey = 0;
+	lodLevel = 0;
+	staticBatch = nullptr;
+	mergedInto = nullptr;
+	isStatic = false;
+	isOccluder = false;
 
+#ifndef HEADLESS
 	Renderer::GetInstance()->AddEntityToRenderer(this);
+#endif
 	EntityManager::GetInstance()->AddEntity(this);
 }
 
@@ -35,7 +41,15 @@ Entity::Entity(Mesh * mesh, Material * material, std::string name)
 // Destructor for when an instance is deleted
 Entity::~Entity()
 { 
-	Renderer::GetInstance()->RemoveEntityFromRenderer(this);
+	//Stop drawing with the batch this was merged into
+	if (mergedInto != nullptr)
+		mergedInto->RemoveEntity(this);
+
+#ifndef HEADLESS
+	//Entities merged into a static batch have already left the renderer
+	if (Renderer::GetInstance()->IsEntityInRenderer(this))
+		Renderer::GetInstance()->RemoveEntityFromRenderer(this);
+#endif
 }
 
 // Get the material this entity uses
@@ -50,8 +64,26 @@ Mesh* Entity::GetMesh()
 	return mesh;
 }
 
-// Get the material/mesh identifier
-std::string Entity::GetMatMeshIdentifier()
+// Get whether this entity is static
+bool Entity::IsStatic()
+{
+	return isStatic;
+}
+
+// Mark this entity as static (never moving)
+void Entity::SetStatic(bool isStatic)
+{
+	this->isStatic = isStatic;
+}
+
+// Get whether this entity hides what is behind it from occlusion culling
+bool Entity::IsOccluder()
+{
+	return isOccluder;
+}
+
+// Mark this entity as an occluder
+void Entity::SetOccluder(bool isOccluder)
 {
-	return identifier;
+	this->isOccluder = isOccluder;
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "GameObject.h"
 #include "Mesh.h"
+#ifndef HEADLESS
 #include "Material.h"
+#else
+class Material;
+#endif
+
+class StaticBatch;
 
 // --------------------------------------------------------
 // A entity definition.
@@ -15,7 +22,23 @@ private:
 	//Rendering
 	Mesh* mesh;
 	Material* material;
-	std::string identifier;
+
+	//Render queue bookkeeping, owned by the Renderer
+	int renderIndex;
+	unsigned long long renderKey;
+	unsigned long long shadowKey;
+	unsigned long long staticShadowKey;
+	int lodLevel; //Detail level drawn last frame, see Mesh::SelectLod()
+	StaticBatch* staticBatch; //Set when this entity draws a batch of static entities
+	StaticBatch* mergedInto; //Set when a batch draws this entity in its place
+	friend class Renderer;
+	friend class StaticBatch;
+
+	//Static entities promise not to move, so their shadows can be cached
+	bool isStatic;
+
+	//Occluders are drawn into the occlusion buffer to hide what is behind them
+	bool isOccluder;
 
 public:
 	// --------------------------------------------------------
@@ -53,7 +76,29 @@ public:
 	Mesh* GetMesh();
 
 	// --------------------------------------------------------
-	// Get the material/mesh identifier
+	// Get whether this entity is static
+	// --------------------------------------------------------
+	bool IsStatic();
+
+	// --------------------------------------------------------
+	// Mark this entity as static (never moving). Static
+	// entities are drawn into cached shadow layers, moving
+	// one still works but re-renders those layers. Once
+	// Renderer::BuildStaticBatches() merges it, it must not
+	// move at all, but can still be disabled or deleted
+	// --------------------------------------------------------
+	void SetStatic(bool isStatic);
+
+	// --------------------------------------------------------
+	// Get whether this entity hides what is behind it from
+	// occlusion culling
+	// --------------------------------------------------------
+	bool IsOccluder();
+
+	// --------------------------------------------------------
+	// Mark this entity as an occluder. Keep to a few large,
+	// simple meshes; their triangles are rasterized on the
+	// CPU every frame
 	// --------------------------------------------------------
-	std::string GetMatMeshIdentifier();
+	void SetOccluder(bool isOccluder);
 };
\ No newline at end of file
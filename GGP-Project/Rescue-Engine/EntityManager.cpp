@@ -1,14 +1,22 @@
 #include "EntityManager.h"
+#include "EngineContext.h"
+#include <algorithm>
 
 //Releases the entities in the Entity Manager.
 EntityManager::~EntityManager()
 {
 	for (auto i = 0; i < entities.size(); i++)
 	{
-		if (entities[i]) { delete[] entities[i]; }
+		if (entities[i]) { delete entities[i]; }
 	}
 }
 
+//Returns the current context's Entity Manager.
+EntityManager* EntityManager::GetInstance()
+{
+	return EngineContext::GetCurrent()->GetEntityManager();
+}
+
 //Adds an entity to the Entity Manager with a unique ID.
 void EntityManager::AddEntity(Entity* e)
 {
@@ -36,6 +44,20 @@ Entity* EntityManager::GetEntity(std::string id)
 	return nullptr;
 }
 
+// Get the number of entities in the manager
+int EntityManager::GetEntityCount()
+{
+	return (int)entities.size();
+}
+
+// Get an entity by its position in the manager
+Entity* EntityManager::GetEntityAt(int index)
+{
+	if (index < 0 || index >= (int)entities.size())
+		return nullptr;
+	return entities[index];
+}
+
 // Remove an entity by its object
 void EntityManager::RemoveEntityFromList(Entity* entity, bool release)
 {
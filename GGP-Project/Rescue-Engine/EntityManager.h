@@ -12,10 +12,11 @@ class EntityManager
 {
 private:
 	// --------------------------------------------------------
-	// Singleton Constructor - Set up the singleton instance of the EntityManager
+	// Constructor - Only an EngineContext creates entity managers
 	// --------------------------------------------------------
 	EntityManager() { }
 	~EntityManager();
+	friend class EngineContext;
 
 	std::vector<Entity*> entities;       //A vector of entities
 	std::vector<EntityRemoval> remove_entities;       //A vector of entities
@@ -27,12 +28,8 @@ private:
 
 public:
 
-	// Returns an Entity Manager Instance ---
-	static EntityManager* GetInstance()
-	{
-		static EntityManager instance;
-		return &instance;
-	}
+	// Returns the current context's Entity Manager ---
+	static EntityManager* GetInstance();
 
 	//Delete this
 	EntityManager(EntityManager const&) = delete;
@@ -51,6 +48,16 @@ public:
 	// --------------------------------------------------------
 	Entity* GetEntity(std::string name);
 
+	// --------------------------------------------------------
+	// Get an entity by its position in the manager
+	// --------------------------------------------------------
+	Entity* GetEntityAt(int index);
+
+	// --------------------------------------------------------
+	// Get the number of entities in the manager
+	// --------------------------------------------------------
+	int GetEntityCount();
+
 	// --------------------------------------------------------
 	// Remove an entity by its name
 	// --------------------------------------------------------
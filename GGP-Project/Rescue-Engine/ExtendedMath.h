@@ -1,6 +1,7 @@
 #pragma once
 #include <DirectXMath.h>
 #include <algorithm>
+#include <cmath>
 
 class ExtendedMath
 {
@@ -26,9 +27,9 @@ public:
 	}
 
 	//Lerps until the result is negligably close to the target value.
-	static float LerpThreshhold(float v1, float v2, float t, float thresh = 0.001)
+	static float LerpThreshhold(float v1, float v2, float t, float thresh = 0.001f)
 	{
-		if (abs(v1 - v2) > thresh)
+		if (fabsf(v1 - v2) > thresh)
 			return v1 + t * (v2 - v1);
 		else
 			return v2;
@@ -83,5 +84,17 @@ public:
 		DirectX::XMFLOAT4 quat = DirectX::XMFLOAT4(x, y, z, w);
 		return quat;
 	}
+
+	//FNV-1a over a block of memory, continuing from a previous hash
+	static unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
 };
 
@@ -0,0 +1,118 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+// Construct a frustum that contains everything
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++)
+		planes[i] = XMFLOAT4(0, 0, 0, 1);
+}
+
+// Destructor for when an instance is deleted
+Frustum::~Frustum()
+{ }
+
+// Extract the planes of a view projection
+void Frustum::SetFromMatrices(XMFLOAT4X4 view, XMFLOAT4X4 projection)
+{
+	//Both matrices are stored transposed, so (V * P)^T = P^T * V^T
+	//and the rows of this matrix are the columns of the view projection
+	XMMATRIX m = XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view));
+
+	XMVECTOR extracted[6] =
+	{
+		XMVectorAdd(m.r[3], m.r[0]),		//Left
+		XMVectorSubtract(m.r[3], m.r[0]),	//Right
+		XMVectorAdd(m.r[3], m.r[1]),		//Bottom
+		XMVectorSubtract(m.r[3], m.r[1]),	//Top
+		m.r[2],								//Near (D3D depth starts at 0)
+		XMVectorSubtract(m.r[3], m.r[2])	//Far
+	};
+
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(extracted[i]));
+}
+
+// Get one of the six normalized planes
+XMFLOAT4 Frustum::GetPlane(int index) const
+{
+	return planes[index];
+}
+
+// Check if a single sphere is at least partially inside
+bool Frustum::IntersectsSphere(XMFLOAT3 center, float radius) const
+{
+	XMVECTOR c = XMLoadFloat3(&center);
+	for (int i = 0; i < 6; i++)
+	{
+		if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&planes[i]), c)) < -radius)
+			return false;
+	}
+	return true;
+}
+
+// Cull a set of spheres stored as separate arrays
+int Frustum::CullSpheres(const float* x, const float* y, const float* z, const float* radius, int count, int* visible) const
+{
+	//Splat every plane once up front
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[p]);
+		planeX[p] = XMVectorSplatX(plane);
+		planeY[p] = XMVectorSplatY(plane);
+		planeZ[p] = XMVectorSplatZ(plane);
+		planeW[p] = XMVectorSplatW(plane);
+	}
+
+	int visibleCount = 0;
+	int i = 0;
+
+	//Two groups of four per iteration keeps both dependency chains busy
+	for (; i + 8 <= count; i += 8)
+	{
+		XMVECTOR x0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x + i));
+		XMVECTOR y0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y + i));
+		XMVECTOR z0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(z + i));
+		XMVECTOR r0 = XMVectorNegate(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(radius + i)));
+		XMVECTOR x1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x + i + 4));
+		XMVECTOR y1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y + i + 4));
+		XMVECTOR z1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(z + i + 4));
+		XMVECTOR r1 = XMVectorNegate(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(radius + i + 4)));
+
+		XMVECTOR inside0 = XMVectorTrueInt();
+		XMVECTOR inside1 = XMVectorTrueInt();
+		for (int p = 0; p < 6; p++)
+		{
+			//Signed distance from the plane: ax + by + cz + d
+			XMVECTOR d0 = XMVectorMultiplyAdd(planeX[p], x0, planeW[p]);
+			XMVECTOR d1 = XMVectorMultiplyAdd(planeX[p], x1, planeW[p]);
+			d0 = XMVectorMultiplyAdd(planeY[p], y0, d0);
+			d1 = XMVectorMultiplyAdd(planeY[p], y1, d1);
+			d0 = XMVectorMultiplyAdd(planeZ[p], z0, d0);
+			d1 = XMVectorMultiplyAdd(planeZ[p], z1, d1);
+			inside0 = XMVectorAndInt(inside0, XMVectorGreaterOrEqual(d0, r0));
+			inside1 = XMVectorAndInt(inside1, XMVectorGreaterOrEqual(d1, r1));
+		}
+
+		uint32_t mask[8];
+		XMStoreInt4(mask, inside0);
+		XMStoreInt4(mask + 4, inside1);
+		for (int k = 0; k < 8; k++)
+		{
+			//Branchless append
+			visible[visibleCount] = i + k;
+			visibleCount += mask[k] & 1;
+		}
+	}
+
+	//Leftovers one at a time
+	for (; i < count; i++)
+	{
+		if (IntersectsSphere(XMFLOAT3(x[i], y[i], z[i]), radius[i]))
+			visible[visibleCount++] = i;
+	}
+
+	return visibleCount;
+}
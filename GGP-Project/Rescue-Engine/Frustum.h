@@ -0,0 +1,54 @@
+#pragma once
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// A view frustum as six inward facing planes.
+//
+// Built from the transposed (HLSL ready) view and projection
+// matrices that cameras and lights already keep, so any of
+// them can be used to cull.
+// --------------------------------------------------------
+class Frustum
+{
+private:
+	//Left, right, bottom, top, near, far. (a, b, c, d) with ax + by + cz + d >= 0 inside
+	DirectX::XMFLOAT4 planes[6];
+
+public:
+	// --------------------------------------------------------
+	// Construct a frustum that contains everything
+	// --------------------------------------------------------
+	Frustum();
+	~Frustum();
+
+	// --------------------------------------------------------
+	// Extract the planes of a view projection
+	//
+	// view - the transposed view matrix
+	// projection - the transposed projection matrix
+	// --------------------------------------------------------
+	void SetFromMatrices(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection);
+
+	// --------------------------------------------------------
+	// Get one of the six normalized planes
+	// --------------------------------------------------------
+	DirectX::XMFLOAT4 GetPlane(int index) const;
+
+	// --------------------------------------------------------
+	// Check if a single sphere is at least partially inside
+	// --------------------------------------------------------
+	bool IntersectsSphere(DirectX::XMFLOAT3 center, float radius) const;
+
+	// --------------------------------------------------------
+	// Cull a set of spheres stored as separate arrays.
+	// Tests 8 spheres per iteration, 4 per SIMD lane group
+	//
+	// x, y, z - sphere centers
+	// radius - sphere radii
+	// count - the number of spheres
+	// visible - filled with the indices of the spheres that
+	//			 are at least partially inside. Needs room for count
+	// Returns the number of visible spheres
+	// --------------------------------------------------------
+	int CullSpheres(const float* x, const float* y, const float* z, const float* radius, int count, int* visible) const;
+};
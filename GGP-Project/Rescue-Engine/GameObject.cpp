@@ -1,5 +1,4 @@
 #include "GameObject.h"
-#include "Renderer.h"
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -69,10 +68,6 @@ XMFLOAT4X4 GameObject::GetWorldMatrix()
 	if (worldDirty)
 		RebuildWorld();
 
-	//Add collider to render list
-	if (collider != nullptr && IsDebug())
-		Renderer::GetInstance()->AddDebugCubeToThisFrame(collider->GetWorldMatrix());
-
 	return world;
 }
 
@@ -103,7 +98,7 @@ void GameObject::RebuildWorld()
 	XMStoreFloat4x4(&world, newWorld);
 
 	//Calculate inverse transpose
-	XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(&XMVectorSet(-1, -1, -1, -1), XMMatrixTranspose(newWorld)));
+	XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(nullptr, XMMatrixTranspose(newWorld)));
 
 	worldDirty = false;
 }
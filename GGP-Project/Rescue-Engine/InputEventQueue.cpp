@@ -0,0 +1,54 @@
+#include "InputEventQueue.h"
+#include "Platform.h"
+#ifdef HEADLESS
+#include <chrono>
+#endif
+
+// Construct an empty queue
+InputEventQueue::InputEventQueue()
+{
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+}
+
+// Add an event (producer only)
+bool InputEventQueue::Push(const InputEvent& e)
+{
+	unsigned int h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= INPUT_EVENT_CAPACITY)
+		return false;
+
+	events[h & (INPUT_EVENT_CAPACITY - 1)] = e;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+// Take the oldest event (consumer only)
+bool InputEventQueue::Pop(InputEvent& e)
+{
+	unsigned int t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire))
+		return false;
+
+	e = events[t & (INPUT_EVENT_CAPACITY - 1)];
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+// Drop every queued event (consumer only)
+void InputEventQueue::Clear()
+{
+	tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+// Get a high resolution timestamp for an event
+long long InputEventQueue::GetTimestamp()
+{
+#ifdef HEADLESS
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#else
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+#endif
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+
+//Capacity of the queue, must be a power of two
+#define INPUT_EVENT_CAPACITY 256
+
+// --------------------------------------------------------
+// A timestamped key transition
+// --------------------------------------------------------
+struct InputEvent
+{
+	long long timestamp;	//Ticks from InputEventQueue::GetTimestamp()
+	unsigned char key;		//Virtual key code
+	bool down;
+};
+
+// --------------------------------------------------------
+// Lock-free single producer, single consumer ring of input
+// events.
+//
+// The window procedure pushes and the update pops, so they
+// can run on different threads without locking. When the
+// queue is full new events are dropped.
+// --------------------------------------------------------
+class InputEventQueue
+{
+private:
+	InputEvent events[INPUT_EVENT_CAPACITY];
+
+	//Producer and consumer cursors, kept off each other's cache line
+	std::atomic<unsigned int> head; //Next slot to write
+	char padding[64];
+	std::atomic<unsigned int> tail; //Next slot to read
+
+public:
+	InputEventQueue();
+
+	// --------------------------------------------------------
+	// Add an event (producer only). Returns false when full
+	// --------------------------------------------------------
+	bool Push(const InputEvent& e);
+
+	// --------------------------------------------------------
+	// Take the oldest event (consumer only). Returns false when empty
+	// --------------------------------------------------------
+	bool Pop(InputEvent& e);
+
+	// --------------------------------------------------------
+	// Drop every queued event (consumer only)
+	// --------------------------------------------------------
+	void Clear();
+
+	// --------------------------------------------------------
+	// Get a high resolution timestamp for an event
+	// --------------------------------------------------------
+	static long long GetTimestamp();
+};
@@ -1,4 +1,27 @@
 #include "InputManager.h"
+#include "EngineContext.h"
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero word
+static inline int LowestBit(unsigned long long word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+//Get the input manager of the current context
+InputManager* InputManager::GetInstance()
+{
+	return EngineContext::GetCurrent()->GetInputManager();
+}
 
 //Initialize default values
 void InputManager::Init(HWND hWnd)
@@ -13,27 +36,128 @@ void InputManager::Init(HWND hWnd)
 	prev_MB_R_Down = false;
 	prev_MB_M_Down = false;
 	wheelDelta = 0;
+	windowFocused = false;
+
+	scripted = false;
+	scriptedFocus = true;
+	memset(scriptedTapped, 0, sizeof(scriptedTapped));
+	scriptedPartialCount = 0;
+	memset(keys, 0, sizeof(keys));
+	memset(prevKeys, 0, sizeof(prevKeys));
+	memset(tappedKeys, 0, sizeof(tappedKeys));
+	memset(keyHeldFraction, 0, sizeof(keyHeldFraction));
+	memset(keyDownTime, 0, sizeof(keyDownTime));
+	keyEvents.Clear();
+	frameStartTime = InputEventQueue::GetTimestamp();
 
 	GetCursorPos(&mousePos);
 	prevMousePos = mousePos;
+	scriptedMousePos = mousePos;
 }
 
 InputManager::~InputManager()
 { }
 
-//Update the focus state of the window
+//Update the focus state of the window and apply this frame's key events
 void InputManager::UpdateFocus()
 {
+	//Scripted keys are set directly and held for whole frames,
+	//unless a recorded frame says otherwise
+	if (scripted)
+	{
+		windowFocused = scriptedFocus;
+		for (int i = 0; i < 256; i++)
+			keyHeldFraction[i] = (keys[i >> 6] >> (i & 63)) & 1 ? 1.0f : 0.0f;
+		for (int i = 0; i < scriptedPartialCount; i++)
+			keyHeldFraction[scriptedPartialKeys[i]] = scriptedPartialFractions[i];
+		memcpy(tappedKeys, scriptedTapped, sizeof(tappedKeys));
+
+		memset(scriptedTapped, 0, sizeof(scriptedTapped));
+		scriptedPartialCount = 0;
+		return;
+	}
+
 	if (GetFocus() == hWnd)
 	{
 		windowFocused = true;
 	}
 	else windowFocused = false;
+
+	//Key releases can go to another window while unfocused, so drop
+	//everything rather than leave keys stuck down
+	if (!windowFocused)
+	{
+		keyEvents.Clear();
+		memset(keys, 0, sizeof(keys));
+		memset(tappedKeys, 0, sizeof(tappedKeys));
+		memset(keyHeldFraction, 0, sizeof(keyHeldFraction));
+		frameStartTime = InputEventQueue::GetTimestamp();
+		return;
+	}
+
+	ProcessKeyEvents();
+}
+
+//Apply the queued key events for the frame ending now
+void InputManager::ProcessKeyEvents()
+{
+	long long frameEndTime = InputEventQueue::GetTimestamp();
+	long long heldTicks[256] = {};
+	memset(tappedKeys, 0, sizeof(tappedKeys));
+
+	//Replay the transitions in order, timing how long each key was down
+	InputEvent e;
+	while (keyEvents.Pop(e))
+	{
+		int word = e.key >> 6;
+		unsigned long long bit = 1ull << (e.key & 63);
+		if (e.down)
+		{
+			//Ignore auto-repeat
+			if (keys[word] & bit)
+				continue;
+			keys[word] |= bit;
+			keyDownTime[e.key] = e.timestamp;
+		}
+		else if (keys[word] & bit)
+		{
+			keys[word] &= ~bit;
+			long long from = keyDownTime[e.key] > frameStartTime ? keyDownTime[e.key] : frameStartTime;
+			heldTicks[e.key] += e.timestamp - from;
+			if (!(prevKeys[word] & bit))
+				tappedKeys[word] |= bit;
+		}
+	}
+
+	//Keys still down were held until the end of the frame
+	for (int w = 0; w < 4; w++)
+	{
+		unsigned long long held = keys[w];
+		while (held)
+		{
+			int key = (w << 6) | LowestBit(held);
+			held &= held - 1;
+			long long from = keyDownTime[key] > frameStartTime ? keyDownTime[key] : frameStartTime;
+			heldTicks[key] += frameEndTime - from;
+		}
+	}
+
+	float frameTicks = (float)(frameEndTime - frameStartTime);
+	for (int i = 0; i < 256; i++)
+	{
+		float fraction = frameTicks > 0 ? heldTicks[i] / frameTicks : 0.0f;
+		keyHeldFraction[i] = fraction > 1.0f ? 1.0f : fraction;
+	}
+	frameStartTime = frameEndTime;
 }
 
 //Update the input manager (only call ONCE PER FRAME!)
 void InputManager::UpdateStates()
 {
+	//Previous key states
+	for (int i = 0; i < 4; i++)
+		prevKeys[i] = keys[i];
+
 	//Previous mouse button states
 	prev_MB_L_Down = mb_L_Down;
 	prev_MB_R_Down = mb_R_Down;
@@ -46,7 +170,9 @@ void InputManager::UpdateMousePos()
 {
 	//Get new cursor position
 	prevMousePos = mousePos;
-	GetCursorPos(&mousePos);
+	if (scripted)
+		mousePos = scriptedMousePos;
+	else GetCursorPos(&mousePos);
 }
 
 // Change the window focus requirement
@@ -124,6 +250,20 @@ void InputManager::OnMouseWheel(float wheelDelta, int x, int y)
 	this->wheelDelta = wheelDelta;
 }
 
+// Queue a key press from the window procedure
+void InputManager::OnKeyDown(WPARAM key)
+{
+	if (key < 256)
+		keyEvents.Push(InputEvent{ InputEventQueue::GetTimestamp(), (unsigned char)key, true });
+}
+
+// Queue a key release from the window procedure
+void InputManager::OnKeyUp(WPARAM key)
+{
+	if (key < 256)
+		keyEvents.Push(InputEvent{ InputEventQueue::GetTimestamp(), (unsigned char)key, false });
+}
+
 //Returns true while the inputted key is held down
 bool InputManager::GetKey(char key)
 {
@@ -131,24 +271,90 @@ bool InputManager::GetKey(char key)
 	if (winRequireFocus && !windowFocused)
 		return false;
 
-	return GetAsyncKeyState(key) & 0x8000;
+	unsigned char k = (unsigned char)key;
+	return (keys[k >> 6] >> (k & 63)) & 1;
 }
 
-//TODO: Implement keyboard states
-
-/*
 //Returns true during the frame the user pressed down the inputted key
 bool InputManager::GetKeyDown(char key)
 {
-	return false;
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return false;
+
+	unsigned char k = (unsigned char)key;
+	unsigned long long pressed = (keys[k >> 6] & ~prevKeys[k >> 6]) | tappedKeys[k >> 6];
+	return (pressed >> (k & 63)) & 1;
 }
 
 //Returns true the first frame the user releases the inputted key
 bool InputManager::GetKeyUp(char key)
 {
-	return false;
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return false;
+
+	unsigned char k = (unsigned char)key;
+	unsigned long long released = (~keys[k >> 6] & prevKeys[k >> 6]) | tappedKeys[k >> 6];
+	return (released >> (k & 63)) & 1;
+}
+
+//Returns true while any key in the mask is held down
+bool InputManager::GetAnyKey(const KeyMask& mask)
+{
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return false;
+
+	return ((keys[0] & mask.words[0]) | (keys[1] & mask.words[1]) |
+		(keys[2] & mask.words[2]) | (keys[3] & mask.words[3])) != 0;
+}
+
+//Returns true during the frame the user pressed down any key in the mask
+bool InputManager::GetAnyKeyDown(const KeyMask& mask)
+{
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return false;
+
+	unsigned long long pressed = 0;
+	for (int i = 0; i < 4; i++)
+		pressed |= ((keys[i] & ~prevKeys[i]) | tappedKeys[i]) & mask.words[i];
+	return pressed != 0;
+}
+
+//Get how much of the last frame a key was held
+float InputManager::GetKeyHeldFraction(char key)
+{
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return 0;
+
+	return keyHeldFraction[(unsigned char)key];
+}
+
+//Get the largest held fraction of any key in the mask
+float InputManager::GetKeyHeldFraction(const KeyMask& mask)
+{
+	//Early return if we need focus and we don't have it
+	if (winRequireFocus && !windowFocused)
+		return 0;
+
+	//Only visit the keys that are in the mask and were down or tapped
+	float fraction = 0;
+	for (int w = 0; w < 4; w++)
+	{
+		unsigned long long candidates = mask.words[w] & (keys[w] | prevKeys[w] | tappedKeys[w]);
+		while (candidates)
+		{
+			int key = (w << 6) | LowestBit(candidates);
+			candidates &= candidates - 1;
+			if (keyHeldFraction[key] > fraction)
+				fraction = keyHeldFraction[key];
+		}
+	}
+	return fraction;
 }
-*/
 
 // Returns true while the inputted mouse button is held down
 bool InputManager::GetMouseButton(MouseButtons button)
@@ -297,3 +503,104 @@ long InputManager::GetWindowHeight()
 	GetWindowRect(hWnd, &rect);
 	return (rect.right - rect.left) / 2;
 }
+
+// Drive input from code instead of the OS
+void InputManager::SetScripted(bool scripted)
+{
+	this->scripted = scripted;
+	memset(keys, 0, sizeof(keys));
+	memset(tappedKeys, 0, sizeof(tappedKeys));
+	memset(scriptedTapped, 0, sizeof(scriptedTapped));
+	scriptedPartialCount = 0;
+	keyEvents.Clear();
+}
+
+// Set whether a key is held (scripted mode only)
+void InputManager::SetKey(char key, bool down)
+{
+	if (!scripted)
+		return;
+	unsigned char k = (unsigned char)key;
+	if (down)
+		keys[k >> 6] |= 1ull << (k & 63);
+	else keys[k >> 6] &= ~(1ull << (k & 63));
+}
+
+// Set whether a mouse button is held (scripted mode only)
+void InputManager::SetMouseButton(MouseButtons button, bool down)
+{
+	if (!scripted)
+		return;
+
+	switch (button)
+	{
+		case MouseButtons::L: mb_L_Down = down; break;
+		case MouseButtons::R: mb_R_Down = down; break;
+		case MouseButtons::M: mb_M_Down = down; break;
+	}
+}
+
+// Set the mouse position picked up by the next UpdateMousePos()
+void InputManager::SetMousePosition(long x, long y)
+{
+	if (!scripted)
+		return;
+	scriptedMousePos.x = x;
+	scriptedMousePos.y = y;
+}
+
+// Set the focus picked up by the next UpdateFocus()
+void InputManager::SetFocus(bool focused)
+{
+	if (!scripted)
+		return;
+	scriptedFocus = focused;
+}
+
+// Capture this frame's input for recording
+InputFrame InputManager::GetFrame(float deltaTime)
+{
+	InputFrame frame = {};
+	frame.deltaTime = deltaTime;
+	//Bit i of the key words is bit (i & 7) of byte (i >> 3) on little-endian
+	memcpy(frame.keys, keys, sizeof(frame.keys));
+	frame.mouseX = (int)mousePos.x;
+	frame.mouseY = (int)mousePos.y;
+	frame.wheelDelta = wheelDelta;
+	frame.buttons = (mb_L_Down ? 1 : 0) | (mb_R_Down ? 2 : 0) | (mb_M_Down ? 4 : 0);
+	frame.focused = windowFocused ? 1 : 0;
+	memcpy(frame.tapped, tappedKeys, sizeof(frame.tapped));
+
+	//Keep the exact fraction of keys that changed during the frame
+	for (int i = 0; i < 256 && frame.partialCount < INPUT_FRAME_PARTIAL_KEYS; i++)
+	{
+		float whole = (keys[i >> 6] >> (i & 63)) & 1 ? 1.0f : 0.0f;
+		if (keyHeldFraction[i] == whole)
+			continue;
+
+		frame.partialKeys[frame.partialCount] = (unsigned char)i;
+		frame.partialFractions[frame.partialCount] = keyHeldFraction[i];
+		frame.partialCount++;
+	}
+	return frame;
+}
+
+// Load a recorded frame as the scripted input
+void InputManager::SetFrame(const InputFrame& frame)
+{
+	if (!scripted)
+		return;
+
+	memcpy(keys, frame.keys, sizeof(keys));
+	memcpy(scriptedTapped, frame.tapped, sizeof(scriptedTapped));
+	scriptedPartialCount = frame.partialCount < INPUT_FRAME_PARTIAL_KEYS ? frame.partialCount : INPUT_FRAME_PARTIAL_KEYS;
+	memcpy(scriptedPartialKeys, frame.partialKeys, sizeof(scriptedPartialKeys));
+	memcpy(scriptedPartialFractions, frame.partialFractions, sizeof(scriptedPartialFractions));
+	scriptedMousePos.x = frame.mouseX;
+	scriptedMousePos.y = frame.mouseY;
+	wheelDelta = frame.wheelDelta;
+	mb_L_Down = (frame.buttons & 1) != 0;
+	mb_R_Down = (frame.buttons & 2) != 0;
+	mb_M_Down = (frame.buttons & 4) != 0;
+	scriptedFocus = frame.focused != 0;
+}
\ No newline at end of file
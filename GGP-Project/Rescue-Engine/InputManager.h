@@ -1,24 +1,80 @@
 #pragma once
-#include "Windows.h"
+#include "Platform.h"
+#include "InputEventQueue.h"
 #include <DirectXMath.h>
-#include <map>
+#include <initializer_list>
 
 //Enum for mouse buttons
 enum class MouseButtons {L, R, M};
 
-// Singleton basis from: https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+//Most keys a recorded frame holds for part of the frame
+#define INPUT_FRAME_PARTIAL_KEYS 8
 
 // --------------------------------------------------------
-// Singleton
+// A set of virtual keys, one bit per key.
+// Lets callers test several keys in one query
+// --------------------------------------------------------
+struct KeyMask
+{
+	unsigned long long words[4];
+
+	KeyMask() : words{ 0, 0, 0, 0 } { }
+	KeyMask(std::initializer_list<unsigned char> keys) : words{ 0, 0, 0, 0 }
+	{
+		for (unsigned char key : keys)
+			words[key >> 6] |= 1ull << (key & 63);
+	}
+};
+
+// --------------------------------------------------------
+// One frame of input, as recorded and replayed.
+// Fixed layout so it can be written straight to a log
+//
+// Keys are held for the whole frame when down and not at
+// all when up, apart from the partial keys listed, which
+// keep their exact held fraction. Should more keys than fit
+// change in one frame, the rest are rounded to whole frames
+// --------------------------------------------------------
+struct InputFrame
+{
+	float deltaTime;			//Seconds the frame simulated
+	unsigned char keys[32];		//One bit per virtual key, down at the end of the frame
+	unsigned char tapped[32];	//Keys pressed and released within the frame
+	int mouseX;
+	int mouseY;
+	float wheelDelta;
+	unsigned char buttons;		//Bit per MouseButtons value
+	unsigned char focused;
+	unsigned char partialCount;	//Keys held for part of the frame
+	unsigned char padding;
+	unsigned char partialKeys[INPUT_FRAME_PARTIAL_KEYS];
+	float partialFractions[INPUT_FRAME_PARTIAL_KEYS];	//Share of the frame each was down
+};
+
+// --------------------------------------------------------
+// One per EngineContext
 //
 // Handles input from keyboard and mouse
 // --------------------------------------------------------
 class InputManager
 {
 private:
-	//Keyboard Control
-	std::map<char, bool> pressedKeys;
-	std::map<char, bool> prevPressedKeys;
+	//Keyboard Control, one bit per virtual key.
+	//Updated once per frame so every query in a frame agrees
+	unsigned long long keys[4];
+	unsigned long long prevKeys[4];
+	unsigned long long tappedKeys[4];	//Pressed and released within the last frame
+
+	//Key events from the window procedure
+	InputEventQueue keyEvents;
+	long long frameStartTime;
+	float keyHeldFraction[256];			//Share of the last frame each key was down
+	long long keyDownTime[256];			//When each held key went down
+
+	// --------------------------------------------------------
+	// Apply the queued key events for the frame ending now
+	// --------------------------------------------------------
+	void ProcessKeyEvents();
 
 	//Mouse control
 	POINT mousePos;
@@ -38,15 +94,25 @@ private:
 	bool winRequireFocus;
 	bool windowFocused;
 
+	//Scripted control, replaces the OS as the input source
+	bool scripted;
+	bool scriptedFocus;
+	POINT scriptedMousePos;
+	unsigned long long scriptedTapped[4];		//From SetFrame(), used by the next UpdateFocus()
+	unsigned char scriptedPartialKeys[INPUT_FRAME_PARTIAL_KEYS];
+	float scriptedPartialFractions[INPUT_FRAME_PARTIAL_KEYS];
+	int scriptedPartialCount;
+
 	// --------------------------------------------------------
-	// Singleton Constructor - Set up the singleton instance of the input manager
+	// Constructor - Only an EngineContext creates input managers
 	// --------------------------------------------------------
 	InputManager() { }
 
 	// --------------------------------------------------------
-	// Destructor for when the singleton instance is deleted
+	// Destructor for when the context is deleted
 	// --------------------------------------------------------
 	~InputManager();
+	friend class EngineContext;
 
 public:
 	// --------------------------------------------------------
@@ -56,14 +122,9 @@ public:
 	void Init(HWND hWnd);
 
 	// --------------------------------------------------------
-	// Get the singleton instance of the renderer
+	// Get the input manager of the current context
 	// --------------------------------------------------------
-	static InputManager* GetInstance()
-	{
-		static InputManager instance;
-
-		return &instance;
-	}
+	static InputManager* GetInstance();
 
 	//Delete these functions
 	InputManager(InputManager const&) = delete;
@@ -112,9 +173,22 @@ public:
 	void OnMouseWheel(float wheelDelta, int x, int y);
 
 	// --------------------------------------------------------
-	//Update the focus state of the window
+	// NOT FOR USE OUTSIDE OF GAME.CPP
+	// Queue a key press from the window procedure
 	// --------------------------------------------------------
-	void InputManager::UpdateFocus();
+	void OnKeyDown(WPARAM key);
+
+	// --------------------------------------------------------
+	// NOT FOR USE OUTSIDE OF GAME.CPP
+	// Queue a key release from the window procedure
+	// --------------------------------------------------------
+	void OnKeyUp(WPARAM key);
+
+	// --------------------------------------------------------
+	// Update the focus state of the window and apply this
+	// frame's key events (call FIRST, only ONCE PER FRAME!)
+	// --------------------------------------------------------
+	void UpdateFocus();
 
 	// --------------------------------------------------------
 	// Update the input manager's key/button states (only call ONCE PER FRAME!)
@@ -131,9 +205,6 @@ public:
 	// --------------------------------------------------------
 	bool GetKey(char key);
 
-	//TODO: Implement key states
-
-	/*
 	// --------------------------------------------------------
 	// Returns true during the frame the user pressed down the inputted key
 	// --------------------------------------------------------
@@ -143,7 +214,28 @@ public:
 	// Returns true the first frame the user releases the inputted key
 	// --------------------------------------------------------
 	bool GetKeyUp(char key);
-	*/
+
+	// --------------------------------------------------------
+	// Returns true while any key in the mask is held down
+	// --------------------------------------------------------
+	bool GetAnyKey(const KeyMask& mask);
+
+	// --------------------------------------------------------
+	// Returns true during the frame the user pressed down any key in the mask
+	// --------------------------------------------------------
+	bool GetAnyKeyDown(const KeyMask& mask);
+
+	// --------------------------------------------------------
+	// Get how much of the last frame a key was held, from 0 to 1.
+	// Taps shorter than a frame still count, so scale movement
+	// by this instead of checking GetKey() for lower latency
+	// --------------------------------------------------------
+	float GetKeyHeldFraction(char key);
+
+	// --------------------------------------------------------
+	// Get the largest held fraction of any key in the mask
+	// --------------------------------------------------------
+	float GetKeyHeldFraction(const KeyMask& mask);
 
 	// --------------------------------------------------------
 	// Returns true while the inputted mouse button is held down
@@ -204,4 +296,50 @@ public:
 	// Get window height
 	// --------------------------------------------------------
 	long GetWindowHeight();
+
+	// --------------------------------------------------------
+	// Drive input from code instead of the OS.
+	// Used by the headless runner, which has no window
+	//
+	// scripted - Whether the Set* functions below are the input source
+	// --------------------------------------------------------
+	void SetScripted(bool scripted);
+
+	// --------------------------------------------------------
+	// Set whether a key is held (scripted mode only)
+	// --------------------------------------------------------
+	void SetKey(char key, bool down);
+
+	// --------------------------------------------------------
+	// Set whether a mouse button is held (scripted mode only)
+	// --------------------------------------------------------
+	void SetMouseButton(MouseButtons button, bool down);
+
+	// --------------------------------------------------------
+	// Set the mouse position picked up by the next UpdateMousePos()
+	// (scripted mode only)
+	// --------------------------------------------------------
+	void SetMousePosition(long x, long y);
+
+	// --------------------------------------------------------
+	// Set the focus picked up by the next UpdateFocus()
+	// (scripted mode only)
+	// --------------------------------------------------------
+	void SetFocus(bool focused);
+
+	// --------------------------------------------------------
+	// Capture this frame's input for recording.
+	// Call after UpdateFocus() and UpdateMousePos()
+	//
+	// deltaTime - the timestep the frame simulates with
+	// --------------------------------------------------------
+	InputFrame GetFrame(float deltaTime);
+
+	// --------------------------------------------------------
+	// Load a recorded frame as the scripted input, picked up
+	// by the next UpdateFocus() and UpdateMousePos(). Its taps
+	// and partly held keys only apply to that one frame
+	// (scripted mode only)
+	// --------------------------------------------------------
+	void SetFrame(const InputFrame& frame);
 };
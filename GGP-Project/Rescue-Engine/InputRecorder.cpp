@@ -0,0 +1,70 @@
+#include "InputRecorder.h"
+#include <cstring>
+
+//The log is read back with a straight copy
+static_assert(sizeof(InputFrame) == 124, "InputFrame layout changed, bump INPUT_LOG_VERSION");
+static_assert(sizeof(InputLogHeader) == 20, "InputLogHeader layout changed, bump INPUT_LOG_VERSION");
+
+// Construct a closed recorder
+InputRecorder::InputRecorder()
+{
+	header = {};
+}
+
+// Close the log if it is still open
+InputRecorder::~InputRecorder()
+{
+	Close();
+}
+
+// Start a new log
+bool InputRecorder::Open(const char* path, unsigned int seed)
+{
+	Close();
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Could not open input log \"%s\" for writing\n", path);
+		return false;
+	}
+
+	header = {};
+	memcpy(header.magic, "SMIR", 4);
+	header.version = INPUT_LOG_VERSION;
+	header.seed = seed;
+	header.frameCount = 0;
+	header.duration = 0;
+	file.write((const char*)&header, sizeof(header));
+	return true;
+}
+
+// Record this frame's input
+void InputRecorder::Record(float deltaTime, InputManager* input)
+{
+	if (!file.is_open())
+		return;
+
+	InputFrame frame = input->GetFrame(deltaTime);
+	file.write((const char*)&frame, sizeof(frame));
+	header.frameCount++;
+	header.duration += deltaTime;
+}
+
+// Finish the log and close the file
+void InputRecorder::Close()
+{
+	if (!file.is_open())
+		return;
+
+	//Patch the frame count and length now that they are known
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.close();
+}
+
+// Check if a log is being written
+bool InputRecorder::IsOpen()
+{
+	return file.is_open();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <fstream>
+#include "InputManager.h"
+
+// --------------------------------------------------------
+// Header at the start of every input log
+// --------------------------------------------------------
+struct InputLogHeader
+{
+	char magic[4];				//"SMIR"
+	unsigned int version;
+	unsigned int seed;			//Seed for the world's random generators
+	unsigned int frameCount;	//Frames stored after the header
+	float duration;				//Seconds recorded, the sum of every frame's timestep
+};
+
+#define INPUT_LOG_VERSION 3
+
+// --------------------------------------------------------
+// Writes input frames to a binary log
+//
+// Every simulated frame is stored with the timestep it ran
+// with, so a replay steps through exactly the frames of the
+// recorded session, however uneven their timing was
+// --------------------------------------------------------
+class InputRecorder
+{
+private:
+	std::ofstream file;
+	InputLogHeader header;
+
+public:
+	// --------------------------------------------------------
+	// Construct a closed recorder
+	// --------------------------------------------------------
+	InputRecorder();
+
+	// --------------------------------------------------------
+	// Close the log if it is still open
+	// --------------------------------------------------------
+	~InputRecorder();
+
+	// --------------------------------------------------------
+	// Start a new log, overwriting any existing file
+	//
+	// path - the file address of the log
+	// seed - the seed the world was created with
+	// --------------------------------------------------------
+	bool Open(const char* path, unsigned int seed);
+
+	// --------------------------------------------------------
+	// Record this frame's input. Call once per frame after
+	// the input manager has been updated
+	//
+	// deltaTime - the timestep this frame simulates with
+	// input - the input manager to capture
+	// --------------------------------------------------------
+	void Record(float deltaTime, InputManager* input);
+
+	// --------------------------------------------------------
+	// Finish the log and close the file
+	// --------------------------------------------------------
+	void Close();
+
+	// --------------------------------------------------------
+	// Check if a log is being written
+	// --------------------------------------------------------
+	bool IsOpen();
+};
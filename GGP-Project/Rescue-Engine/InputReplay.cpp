@@ -0,0 +1,107 @@
+#include "InputReplay.h"
+#include <cstring>
+
+// Construct an empty replay
+InputReplay::InputReplay()
+{
+	header = {};
+	nextFrame = 0;
+}
+
+// Destructor for when an instance is deleted
+InputReplay::~InputReplay()
+{ }
+
+// Load a log written by an InputRecorder
+bool InputReplay::Load(const char* path)
+{
+	frames.clear();
+	Rewind();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		printf("Input log \"%s\" could not be found\n", path);
+		return false;
+	}
+	unsigned long long fileSize = (unsigned long long)file.tellg();
+	file.seekg(0);
+
+	file.read((char*)&header, sizeof(header));
+	if (!file || memcmp(header.magic, "SMIR", 4) != 0)
+	{
+		printf("\"%s\" is not an input log\n", path);
+		return false;
+	}
+	if (header.version != INPUT_LOG_VERSION)
+	{
+		printf("Input log \"%s\" is version %u, expected %u\n", path, header.version, INPUT_LOG_VERSION);
+		return false;
+	}
+
+	//The frame count comes from the file, so check it against what
+	//is left of it before allocating
+	unsigned long long bytesLeft = fileSize - (unsigned long long)file.tellg();
+	if (header.frameCount > bytesLeft / sizeof(InputFrame))
+	{
+		printf("Input log \"%s\" is truncated\n", path);
+		return false;
+	}
+	frames.resize(header.frameCount);
+	if (header.frameCount > 0)
+		file.read((char*)frames.data(), sizeof(InputFrame) * header.frameCount);
+	if (!file)
+	{
+		printf("Input log \"%s\" is truncated\n", path);
+		frames.clear();
+		return false;
+	}
+
+	return true;
+}
+
+// Apply the next recorded frame's input
+float InputReplay::Step(InputManager* input)
+{
+	if (frames.empty())
+		return 0;
+
+	//Past the end the held input stays as it was
+	if (nextFrame >= frames.size())
+	{
+		InputFrame last = frames.back();
+		last.wheelDelta = 0;
+		memset(last.tapped, 0, sizeof(last.tapped));
+		last.partialCount = 0;
+		input->SetFrame(last);
+		return last.deltaTime;
+	}
+
+	const InputFrame& frame = frames[nextFrame++];
+	input->SetFrame(frame);
+	return frame.deltaTime;
+}
+
+// Restart the replay from the beginning
+void InputReplay::Rewind()
+{
+	nextFrame = 0;
+}
+
+// Check if every recorded frame has been applied
+bool InputReplay::IsFinished()
+{
+	return nextFrame >= frames.size();
+}
+
+// Get the seed the recording was made with
+unsigned int InputReplay::GetSeed()
+{
+	return header.seed;
+}
+
+// Get the number of recorded frames
+int InputReplay::GetFrameCount()
+{
+	return (int)frames.size();
+}
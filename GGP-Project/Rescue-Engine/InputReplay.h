@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "InputRecorder.h"
+
+// --------------------------------------------------------
+// Feeds an InputManager from a recorded input log
+//
+// Each step applies one recorded frame and hands back the
+// timestep it was recorded with, so a replay runs the same
+// frames as the recorded session no matter how fast the
+// machine is. The input manager must be in scripted mode
+// --------------------------------------------------------
+class InputReplay
+{
+private:
+	InputLogHeader header;
+	std::vector<InputFrame> frames;
+	size_t nextFrame;
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty replay
+	// --------------------------------------------------------
+	InputReplay();
+	~InputReplay();
+
+	// --------------------------------------------------------
+	// Load a log written by an InputRecorder
+	//
+	// path - the file address of the log
+	// --------------------------------------------------------
+	bool Load(const char* path);
+
+	// --------------------------------------------------------
+	// Apply the next recorded frame's input. Once the
+	// recording is finished the last frame's input is kept
+	//
+	// input - the input manager to drive
+	// Returns the timestep to simulate the frame with
+	// --------------------------------------------------------
+	float Step(InputManager* input);
+
+	// --------------------------------------------------------
+	// Restart the replay from the beginning
+	// --------------------------------------------------------
+	void Rewind();
+
+	// --------------------------------------------------------
+	// Check if every recorded frame has been applied
+	// --------------------------------------------------------
+	bool IsFinished();
+
+	// --------------------------------------------------------
+	// Get the seed the recording was made with
+	// --------------------------------------------------------
+	unsigned int GetSeed();
+
+	// --------------------------------------------------------
+	// Get the number of recorded frames
+	// --------------------------------------------------------
+	int GetFrameCount();
+};
@@ -0,0 +1,144 @@
+#include "InputScript.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+// Construct an empty script
+InputScript::InputScript()
+{
+	nextEvent = 0;
+}
+
+// Destructor for when an instance is deleted
+InputScript::~InputScript()
+{ }
+
+// Parse a key name into a key code
+int InputScript::ParseKey(const char* name)
+{
+	if (strcmp(name, "SPACE") == 0) return VK_SPACE;
+	if (strcmp(name, "ESCAPE") == 0) return VK_ESCAPE;
+	if (strcmp(name, "LEFT") == 0) return VK_LEFT;
+	if (strcmp(name, "RIGHT") == 0) return VK_RIGHT;
+	if (strcmp(name, "UP") == 0) return VK_UP;
+	if (strcmp(name, "DOWN") == 0) return VK_DOWN;
+
+	//Single characters map to their upper case virtual key
+	if (strlen(name) == 1)
+		return toupper(name[0]);
+	return -1;
+}
+
+// Load a script from a file
+bool InputScript::Load(const char* path)
+{
+	events.clear();
+	nextEvent = 0;
+
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		printf("Input script \"%s\" could not be found\n", path);
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream ss(line);
+		std::string type;
+		Event e = {};
+		if (!(ss >> e.time >> type))
+		{
+			printf("Input script \"%s\" line %d is malformed\n", path, lineNumber);
+			continue;
+		}
+
+		std::string arg;
+		std::string state;
+		if (type == "key" && ss >> arg >> state)
+		{
+			e.type = EventType::Key;
+			e.code = ParseKey(arg.c_str());
+			e.down = state == "down";
+			if (e.code < 0)
+			{
+				printf("Input script \"%s\" line %d has unknown key \"%s\"\n", path, lineNumber, arg.c_str());
+				continue;
+			}
+		}
+		else if (type == "mouse" && ss >> arg >> state)
+		{
+			e.type = EventType::Mouse;
+			e.code = arg == "R" ? (int)MouseButtons::R : arg == "M" ? (int)MouseButtons::M : (int)MouseButtons::L;
+			e.down = state == "down";
+		}
+		else if (type == "move" && ss >> e.x >> e.y)
+			e.type = EventType::Move;
+		else if (type == "wheel" && ss >> e.delta)
+			e.type = EventType::Wheel;
+		else if (type == "focus" && ss >> e.code)
+		{
+			e.type = EventType::Focus;
+			e.down = e.code != 0;
+		}
+		else
+		{
+			printf("Input script \"%s\" line %d is malformed\n", path, lineNumber);
+			continue;
+		}
+
+		events.push_back(e);
+	}
+
+	return true;
+}
+
+// Apply every event up to a time to an input manager
+void InputScript::Apply(float time, InputManager* input)
+{
+	while (nextEvent < events.size() && events[nextEvent].time <= time)
+	{
+		Event& e = events[nextEvent++];
+		switch (e.type)
+		{
+			case EventType::Key:
+				input->SetKey((char)e.code, e.down);
+				break;
+
+			case EventType::Mouse:
+				input->SetMouseButton((MouseButtons)e.code, e.down);
+				break;
+
+			case EventType::Move:
+				input->SetMousePosition(e.x, e.y);
+				break;
+
+			case EventType::Wheel:
+				input->OnMouseWheel(e.delta, 0, 0);
+				break;
+
+			case EventType::Focus:
+				input->SetFocus(e.down);
+				break;
+		}
+	}
+}
+
+// Restart the script from the beginning
+void InputScript::Rewind()
+{
+	nextEvent = 0;
+}
+
+// Get the number of loaded events
+int InputScript::GetEventCount()
+{
+	return (int)events.size();
+}
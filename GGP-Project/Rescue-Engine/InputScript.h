@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "InputManager.h"
+
+// --------------------------------------------------------
+// A timeline of scripted input events
+//
+// Loaded from a text file with one event per line:
+//   <time> key <char|SPACE|ESCAPE|LEFT|RIGHT|UP|DOWN> down|up
+//   <time> mouse L|R|M down|up
+//   <time> move <x> <y>
+//   <time> wheel <delta>
+//   <time> focus 0|1
+// Lines starting with # are comments. Events must be in time order.
+// --------------------------------------------------------
+class InputScript
+{
+private:
+	//The kinds of scripted event
+	enum class EventType { Key, Mouse, Move, Wheel, Focus };
+
+	//A single scripted event
+	struct Event
+	{
+		float time;
+		EventType type;
+		int code;
+		bool down;
+		long x;
+		long y;
+		float delta;
+	};
+
+	std::vector<Event> events;
+	size_t nextEvent;
+
+	// --------------------------------------------------------
+	// Parse a key name into a key code, returns -1 if unknown
+	// --------------------------------------------------------
+	int ParseKey(const char* name);
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty script
+	// --------------------------------------------------------
+	InputScript();
+	~InputScript();
+
+	// --------------------------------------------------------
+	// Load a script from a file, replacing any loaded events
+	//
+	// path - the file address of the script
+	// --------------------------------------------------------
+	bool Load(const char* path);
+
+	// --------------------------------------------------------
+	// Apply every event up to a time to an input manager.
+	// The manager must be in scripted mode
+	//
+	// time - the simulation time in seconds
+	// input - the input manager to drive
+	// --------------------------------------------------------
+	void Apply(float time, InputManager* input);
+
+	// --------------------------------------------------------
+	// Restart the script from the beginning
+	// --------------------------------------------------------
+	void Rewind();
+
+	// --------------------------------------------------------
+	// Get the number of loaded events
+	// --------------------------------------------------------
+	int GetEventCount();
+};
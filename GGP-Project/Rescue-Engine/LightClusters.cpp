@@ -0,0 +1,420 @@
+#include "LightClusters.h"
+#include "Camera.h"
+#include "WorkerPool.h"
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+
+//Smallest light buffer made, in lights
+#define MIN_CLUSTER_LIGHT_CAPACITY 16
+
+//Spot light penumbra below this is treated as outside the cone
+#define SPOT_CONE_CUTOFF (1.0f / 255.0f)
+
+using namespace DirectX;
+
+// Create a dynamic buffer and a shader resource view of it
+static void CreateDynamicBuffer(ID3D11Device* device, UINT elementSize, UINT count, DXGI_FORMAT format,
+	ID3D11Buffer** buffer, ID3D11ShaderResourceView** srv)
+{
+	//Structured buffers have no format
+	bool structured = format == DXGI_FORMAT_UNKNOWN;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = elementSize * count;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = structured ? D3D11_RESOURCE_MISC_BUFFER_STRUCTURED : 0;
+	desc.StructureByteStride = structured ? elementSize : 0;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer)))
+	{
+		printf("Failed to create light cluster buffer (%u bytes)\n", desc.ByteWidth);
+		*buffer = nullptr;
+		*srv = nullptr;
+		return;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = count;
+	device->CreateShaderResourceView(*buffer, &srvDesc, srv);
+}
+
+// Overwrite a dynamic buffer
+static void UploadBuffer(ID3D11DeviceContext* context, ID3D11Buffer* buffer, const void* data, size_t size)
+{
+	if (buffer == nullptr)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	if (size > 0)
+		memcpy(mapped.pData, data, size);
+	context->Unmap(buffer, 0);
+}
+
+// Get the next power of two at or above a value
+static unsigned int NextCapacity(unsigned int count, unsigned int minimum)
+{
+	unsigned int capacity = minimum;
+	while (capacity < count)
+		capacity *= 2;
+	return capacity;
+}
+
+// Construct empty clusters
+LightClusters::LightClusters()
+{
+	lightBuffer = nullptr;
+	lightSRV = nullptr;
+	gridBuffer = nullptr;
+	gridSRV = nullptr;
+	indexBuffer = nullptr;
+	indexSRV = nullptr;
+	lightCapacity = 0;
+	indexCapacity = 0;
+
+	boundsFov = boundsAspect = boundsNear = boundsFar = 0;
+	tileScale = XMFLOAT2(0, 0);
+	depthScale = 0;
+	depthBias = 0;
+	directionalCount = 0;
+	droppedLights = 0;
+	overflowWarned = false;
+
+	clusterLights.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+	clusterLightCounts.resize(CLUSTER_COUNT);
+	grid.resize(CLUSTER_COUNT * 2);
+}
+
+// Destructor for when an instance is deleted
+LightClusters::~LightClusters()
+{
+	Release();
+}
+
+// Release all GPU data
+void LightClusters::Release()
+{
+	if (lightSRV != nullptr) lightSRV->Release();
+	if (lightBuffer != nullptr) lightBuffer->Release();
+	if (gridSRV != nullptr) gridSRV->Release();
+	if (gridBuffer != nullptr) gridBuffer->Release();
+	if (indexSRV != nullptr) indexSRV->Release();
+	if (indexBuffer != nullptr) indexBuffer->Release();
+
+	lightBuffer = nullptr;
+	lightSRV = nullptr;
+	gridBuffer = nullptr;
+	gridSRV = nullptr;
+	indexBuffer = nullptr;
+	indexSRV = nullptr;
+	lightCapacity = 0;
+	indexCapacity = 0;
+}
+
+// Rebuild the view space bounds of every cluster
+void LightClusters::BuildClusterBounds(float fov, float aspectRatio, float nearClip, float farClip)
+{
+	boundsFov = fov;
+	boundsAspect = aspectRatio;
+	boundsNear = nearClip;
+	boundsFar = farClip;
+
+	boundsMinX.resize(CLUSTER_COUNT);
+	boundsMinY.resize(CLUSTER_COUNT);
+	boundsMinZ.resize(CLUSTER_COUNT);
+	boundsMaxX.resize(CLUSTER_COUNT);
+	boundsMaxY.resize(CLUSTER_COUNT);
+	boundsMaxZ.resize(CLUSTER_COUNT);
+
+	float tanY = tanf(fov * 0.5f);
+	float tanX = tanY * aspectRatio;
+	for (int s = 0; s < CLUSTER_SLICES; s++)
+	{
+		//Logarithmic slices keep clusters roughly cube shaped
+		float zNear = nearClip * powf(farClip / nearClip, (float)s / CLUSTER_SLICES);
+		float zFar = nearClip * powf(farClip / nearClip, (float)(s + 1) / CLUSTER_SLICES);
+
+		for (int ty = 0; ty < CLUSTER_TILES_Y; ty++)
+		{
+			//Tile rows start at the top of the screen
+			float ndcTop = 1.0f - 2.0f * ty / CLUSTER_TILES_Y;
+			float ndcBottom = ndcTop - 2.0f / CLUSTER_TILES_Y;
+
+			for (int tx = 0; tx < CLUSTER_TILES_X; tx++)
+			{
+				float ndcLeft = -1.0f + 2.0f * tx / CLUSTER_TILES_X;
+				float ndcRight = ndcLeft + 2.0f / CLUSTER_TILES_X;
+
+				//The tile's sides spread out with depth, so check both ends
+				float x[4] = { ndcLeft * tanX * zNear, ndcLeft * tanX * zFar, ndcRight * tanX * zNear, ndcRight * tanX * zFar };
+				float y[4] = { ndcBottom * tanY * zNear, ndcBottom * tanY * zFar, ndcTop * tanY * zNear, ndcTop * tanY * zFar };
+
+				int c = tx + CLUSTER_TILES_X * (ty + CLUSTER_TILES_Y * s);
+				boundsMinX[c] = boundsMaxX[c] = x[0];
+				boundsMinY[c] = boundsMaxY[c] = y[0];
+				for (int k = 1; k < 4; k++)
+				{
+					if (x[k] < boundsMinX[c]) boundsMinX[c] = x[k];
+					if (x[k] > boundsMaxX[c]) boundsMaxX[c] = x[k];
+					if (y[k] < boundsMinY[c]) boundsMinY[c] = y[k];
+					if (y[k] > boundsMaxY[c]) boundsMaxY[c] = y[k];
+				}
+				boundsMinZ[c] = zNear;
+				boundsMaxZ[c] = zFar;
+			}
+		}
+	}
+}
+
+// Get the depth slice a view space depth falls in
+int LightClusters::GetSlice(float viewDepth)
+{
+	if (viewDepth <= boundsNear)
+		return 0;
+
+	int slice = (int)floorf(logf(viewDepth) * depthScale + depthBias);
+	if (slice < 0)
+		return 0;
+	if (slice >= CLUSTER_SLICES)
+		return CLUSTER_SLICES - 1;
+	return slice;
+}
+
+// Bin lights into the camera's clusters and upload them
+void LightClusters::Build(ID3D11DeviceContext* context, ID3D11Device* device,
+	const std::vector<LightStruct>& lights, int directionalLights,
+	Camera* camera, unsigned int width, unsigned int height)
+{
+	float fov = camera->GetFov();
+	float aspectRatio = camera->GetAspectRatio();
+	float nearClip = camera->GetNearClip();
+	float farClip = camera->GetFarClip();
+	if (fov != boundsFov || aspectRatio != boundsAspect || nearClip != boundsNear || farClip != boundsFar)
+		BuildClusterBounds(fov, aspectRatio, nearClip, farClip);
+
+	//slice = log(z) * scale + bias
+	float logRange = logf(farClip / nearClip);
+	depthScale = CLUSTER_SLICES / logRange;
+	depthBias = -CLUSTER_SLICES * logf(nearClip) / logRange;
+	tileScale = XMFLOAT2((float)CLUSTER_TILES_X / width, (float)CLUSTER_TILES_Y / height);
+	directionalCount = directionalLights;
+
+	//Camera matrices are stored transposed
+	XMFLOAT4X4 viewT = camera->GetViewMatrix();
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewT));
+
+	//Move every local light into view space
+	lightX.clear(); lightY.clear(); lightZ.clear(); lightRange.clear();
+	lightDirX.clear(); lightDirY.clear(); lightDirZ.clear(); lightCosAngle.clear();
+	lightFirstSlice.clear(); lightLastSlice.clear(); lightIndex.clear();
+	for (size_t i = directionalLights; i < lights.size(); i++)
+	{
+		const LightStruct& light = lights[i];
+		XMFLOAT3 pos, dir;
+		XMStoreFloat3(&pos, XMVector3TransformCoord(XMLoadFloat3(&light.Position), view));
+		XMStoreFloat3(&dir, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view)));
+
+		//Outside the view's depth range
+		if (pos.z + light.Range < nearClip || pos.z - light.Range > farClip)
+			continue;
+
+		//Spot penumbra is pow(cos, falloff), so find where it fades out
+		float cosAngle = -1;
+		if (light.Type == (int)LightType::SpotLight && light.SpotFalloff > 0)
+			cosAngle = powf(SPOT_CONE_CUTOFF, 1.0f / light.SpotFalloff);
+
+		lightX.push_back(pos.x);
+		lightY.push_back(pos.y);
+		lightZ.push_back(pos.z);
+		lightRange.push_back(light.Range);
+		lightDirX.push_back(dir.x);
+		lightDirY.push_back(dir.y);
+		lightDirZ.push_back(dir.z);
+		lightCosAngle.push_back(cosAngle);
+		lightFirstSlice.push_back(GetSlice(pos.z - light.Range));
+		lightLastSlice.push_back(GetSlice(pos.z + light.Range));
+		lightIndex.push_back((unsigned int)i);
+	}
+
+	//Bin each depth slice on whichever pool thread is free
+	memset(clusterLightCounts.data(), 0, sizeof(unsigned int) * CLUSTER_COUNT);
+	WorkerPool::GetInstance()->ParallelFor(CLUSTER_SLICES, 0, [this](int slice, int) { BinSlice(slice); });
+
+	//Compact the per-cluster slots into one index list
+	indices.clear();
+	droppedLights = 0;
+	for (int c = 0; c < CLUSTER_COUNT; c++)
+	{
+		unsigned int count = clusterLightCounts[c];
+		if (count > MAX_LIGHTS_PER_CLUSTER)
+		{
+			droppedLights += count - MAX_LIGHTS_PER_CLUSTER;
+			count = MAX_LIGHTS_PER_CLUSTER;
+		}
+		grid[c * 2] = (unsigned int)indices.size();
+		grid[c * 2 + 1] = count;
+		const unsigned short* slots = &clusterLights[c * MAX_LIGHTS_PER_CLUSTER];
+		for (unsigned int k = 0; k < count; k++)
+			indices.push_back(slots[k]);
+	}
+
+	if (droppedLights > 0 && !overflowWarned)
+	{
+		printf("Some light clusters touch more than %d lights, the extra lights are not drawn there\n", MAX_LIGHTS_PER_CLUSTER);
+		overflowWarned = true;
+	}
+
+	Upload(context, device, lights);
+}
+
+// Bin every light into the clusters of one depth slice
+void LightClusters::BinSlice(int slice)
+{
+	int first = slice * CLUSTER_TILES;
+	for (size_t l = 0; l < lightIndex.size(); l++)
+	{
+		if (slice < lightFirstSlice[l] || slice > lightLastSlice[l])
+			continue;
+
+		XMVECTOR cx = XMVectorReplicate(lightX[l]);
+		XMVECTOR cy = XMVectorReplicate(lightY[l]);
+		XMVECTOR cz = XMVectorReplicate(lightZ[l]);
+		XMVECTOR r2 = XMVectorReplicate(lightRange[l] * lightRange[l]);
+		XMVECTOR zero = XMVectorZero();
+		bool cone = lightCosAngle[l] > 0;
+
+		//Sphere against four cluster boxes at a time. CLUSTER_TILES is a multiple of 4
+		for (int t = 0; t < CLUSTER_TILES; t += 4)
+		{
+			int c = first + t;
+			XMVECTOR dx = XMVectorMax(XMVectorMax(
+				XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMinX[c])), cx),
+				XMVectorSubtract(cx, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMaxX[c])))), zero);
+			XMVECTOR dy = XMVectorMax(XMVectorMax(
+				XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMinY[c])), cy),
+				XMVectorSubtract(cy, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMaxY[c])))), zero);
+			XMVECTOR dz = XMVectorMax(XMVectorMax(
+				XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMinZ[c])), cz),
+				XMVectorSubtract(cz, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundsMaxZ[c])))), zero);
+			XMVECTOR distSq = XMVectorMultiplyAdd(dz, dz, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dx, dx)));
+
+			uint32_t mask[4];
+			XMStoreInt4(mask, XMVectorLessOrEqual(distSq, r2));
+
+			for (int k = 0; k < 4; k++)
+			{
+				if (!mask[k])
+					continue;
+
+				int cluster = c + k;
+				if (cone)
+				{
+					//Cone against the cluster's bounding sphere
+					float hx = (boundsMaxX[cluster] - boundsMinX[cluster]) * 0.5f;
+					float hy = (boundsMaxY[cluster] - boundsMinY[cluster]) * 0.5f;
+					float hz = (boundsMaxZ[cluster] - boundsMinZ[cluster]) * 0.5f;
+					float radius = sqrtf(hx * hx + hy * hy + hz * hz);
+					float vx = boundsMinX[cluster] + hx - lightX[l];
+					float vy = boundsMinY[cluster] + hy - lightY[l];
+					float vz = boundsMinZ[cluster] + hz - lightZ[l];
+					float lengthSq = vx * vx + vy * vy + vz * vz;
+					float alongAxis = vx * lightDirX[l] + vy * lightDirY[l] + vz * lightDirZ[l];
+					float cosAngle = lightCosAngle[l];
+					float sinAngle = sqrtf(1 - cosAngle * cosAngle);
+					float acrossSq = lengthSq - alongAxis * alongAxis;
+					float closest = cosAngle * sqrtf(acrossSq > 0 ? acrossSq : 0) - alongAxis * sinAngle;
+					if (closest > radius || alongAxis < -radius)
+						continue;
+				}
+
+				unsigned int& count = clusterLightCounts[cluster];
+				if (count < MAX_LIGHTS_PER_CLUSTER)
+					clusterLights[cluster * MAX_LIGHTS_PER_CLUSTER + count] = (unsigned short)lightIndex[l];
+				count++;
+			}
+		}
+	}
+}
+
+// Upload the light, grid and index data
+void LightClusters::Upload(ID3D11DeviceContext* context, ID3D11Device* device, const std::vector<LightStruct>& lights)
+{
+	unsigned int lightCount = (unsigned int)lights.size();
+	if (lightBuffer == nullptr || lightCount > lightCapacity)
+	{
+		if (lightSRV != nullptr) lightSRV->Release();
+		if (lightBuffer != nullptr) lightBuffer->Release();
+		lightCapacity = NextCapacity(lightCount, MIN_CLUSTER_LIGHT_CAPACITY);
+		CreateDynamicBuffer(device, sizeof(LightStruct), lightCapacity, DXGI_FORMAT_UNKNOWN, &lightBuffer, &lightSRV);
+	}
+
+	if (gridBuffer == nullptr)
+		CreateDynamicBuffer(device, sizeof(unsigned int) * 2, CLUSTER_COUNT, DXGI_FORMAT_R32G32_UINT, &gridBuffer, &gridSRV);
+
+	unsigned int indexCount = (unsigned int)indices.size();
+	if (indexBuffer == nullptr || indexCount > indexCapacity)
+	{
+		if (indexSRV != nullptr) indexSRV->Release();
+		if (indexBuffer != nullptr) indexBuffer->Release();
+		indexCapacity = NextCapacity(indexCount, CLUSTER_COUNT);
+		CreateDynamicBuffer(device, sizeof(unsigned int), indexCapacity, DXGI_FORMAT_R32_UINT, &indexBuffer, &indexSRV);
+	}
+
+	UploadBuffer(context, lightBuffer, lights.data(), sizeof(LightStruct) * lightCount);
+	UploadBuffer(context, gridBuffer, grid.data(), sizeof(unsigned int) * grid.size());
+	UploadBuffer(context, indexBuffer, indices.data(), sizeof(unsigned int) * indexCount);
+}
+
+// Get the buffer of every light
+ID3D11ShaderResourceView* LightClusters::GetLightSRV()
+{
+	return lightSRV;
+}
+
+// Get the (offset, count) of every cluster
+ID3D11ShaderResourceView* LightClusters::GetGridSRV()
+{
+	return gridSRV;
+}
+
+// Get the light indices of every cluster
+ID3D11ShaderResourceView* LightClusters::GetIndexSRV()
+{
+	return indexSRV;
+}
+
+// Get the tiles per pixel on each axis
+XMFLOAT2 LightClusters::GetTileScale()
+{
+	return tileScale;
+}
+
+// Get the scale from log(view depth) to depth slice
+float LightClusters::GetDepthScale()
+{
+	return depthScale;
+}
+
+// Get the bias from log(view depth) to depth slice
+float LightClusters::GetDepthBias()
+{
+	return depthBias;
+}
+
+// Get how many lights at the front of the light buffer are directional
+int LightClusters::GetDirectionalCount()
+{
+	return directionalCount;
+}
+
+// Get how many lights the last build left out of full clusters
+unsigned int LightClusters::GetDroppedLightCount()
+{
+	return droppedLights;
+}
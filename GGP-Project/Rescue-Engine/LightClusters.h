@@ -0,0 +1,141 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+
+// --------------------------------------------------------
+// Size of the view space cluster grid. Must match the
+// defines in Clusters.hlsli
+// --------------------------------------------------------
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_TILES (CLUSTER_TILES_X * CLUSTER_TILES_Y)
+#define CLUSTER_COUNT (CLUSTER_TILES * CLUSTER_SLICES)
+
+//Lights past this in one cluster are dropped
+#define MAX_LIGHTS_PER_CLUSTER 64
+
+class Camera;
+
+// --------------------------------------------------------
+// Per-frame clustered light assignment.
+//
+// The camera's view is split into a grid of screen tiles and
+// logarithmic depth slices. Every frame each point and spot
+// light is binned into the clusters it touches, and shaders
+// only loop over their cluster's lights. Depth slices are
+// binned in parallel on the WorkerPool. Directional lights
+// reach everything and are kept at the front of the light
+// buffer instead.
+// --------------------------------------------------------
+class LightClusters
+{
+private:
+	//GPU data
+	ID3D11Buffer* lightBuffer;
+	ID3D11ShaderResourceView* lightSRV;
+	ID3D11Buffer* gridBuffer;
+	ID3D11ShaderResourceView* gridSRV;
+	ID3D11Buffer* indexBuffer;
+	ID3D11ShaderResourceView* indexSRV;
+	unsigned int lightCapacity;
+	unsigned int indexCapacity;
+
+	//View space bounds of every cluster, as separate arrays
+	std::vector<float> boundsMinX, boundsMinY, boundsMinZ;
+	std::vector<float> boundsMaxX, boundsMaxY, boundsMaxZ;
+	float boundsFov, boundsAspect, boundsNear, boundsFar;
+
+	//Lights in view space, as separate arrays
+	std::vector<float> lightX, lightY, lightZ, lightRange;
+	std::vector<float> lightDirX, lightDirY, lightDirZ, lightCosAngle;
+	std::vector<int> lightFirstSlice, lightLastSlice;
+	std::vector<unsigned int> lightIndex; //into the light buffer
+
+	//Binned lights, MAX_LIGHTS_PER_CLUSTER slots per cluster.
+	//Counts keep going past the slots so overflow can be reported
+	std::vector<unsigned short> clusterLights;
+	std::vector<unsigned int> clusterLightCounts;
+	unsigned int droppedLights;
+	bool overflowWarned;
+
+	//Compacted lists, sent to the GPU
+	std::vector<unsigned int> grid; //(offset, count) per cluster
+	std::vector<unsigned int> indices;
+
+	//Shader parameters
+	DirectX::XMFLOAT2 tileScale;
+	float depthScale;
+	float depthBias;
+	int directionalCount;
+
+	// --------------------------------------------------------
+	// Rebuild the view space bounds of every cluster
+	// --------------------------------------------------------
+	void BuildClusterBounds(float fov, float aspectRatio, float nearClip, float farClip);
+
+	// --------------------------------------------------------
+	// Get the depth slice a view space depth falls in
+	// --------------------------------------------------------
+	int GetSlice(float viewDepth);
+
+	// --------------------------------------------------------
+	// Bin every light into the clusters of one depth slice.
+	// Slices only write their own clusters, so they can be
+	// binned in any order or at the same time
+	// --------------------------------------------------------
+	void BinSlice(int slice);
+
+	// --------------------------------------------------------
+	// Upload the light, grid and index data, growing the
+	// buffers if needed
+	// --------------------------------------------------------
+	void Upload(ID3D11DeviceContext* context, ID3D11Device* device, const std::vector<LightStruct>& lights);
+
+	// --------------------------------------------------------
+	// Release all GPU data
+	// --------------------------------------------------------
+	void Release();
+
+public:
+	// --------------------------------------------------------
+	// Construct empty clusters. GPU data is made on first build
+	// --------------------------------------------------------
+	LightClusters();
+	~LightClusters();
+
+	// --------------------------------------------------------
+	// Bin lights into the camera's clusters and upload them
+	//
+	// lights - every light, directional lights first
+	// directionalLights - the number of directional lights
+	// camera - the camera to build clusters for
+	// width, height - size of the screen in pixels
+	// --------------------------------------------------------
+	void Build(ID3D11DeviceContext* context, ID3D11Device* device,
+		const std::vector<LightStruct>& lights, int directionalLights,
+		Camera* camera, unsigned int width, unsigned int height);
+
+	// --------------------------------------------------------
+	// Get the buffers shaders read the clusters from
+	// --------------------------------------------------------
+	ID3D11ShaderResourceView* GetLightSRV();
+	ID3D11ShaderResourceView* GetGridSRV();
+	ID3D11ShaderResourceView* GetIndexSRV();
+
+	// --------------------------------------------------------
+	// Get the values shaders need to find a pixel's cluster
+	// --------------------------------------------------------
+	DirectX::XMFLOAT2 GetTileScale();
+	float GetDepthScale();
+	float GetDepthBias();
+	int GetDirectionalCount();
+
+	// --------------------------------------------------------
+	// Get how many times the last build left a light out of a
+	// cluster that already had MAX_LIGHTS_PER_CLUSTER lights
+	// --------------------------------------------------------
+	unsigned int GetDroppedLightCount();
+};
@@ -1,8 +1,15 @@
 #include "LightManager.h"
+#include "EngineContext.h"
 #include <algorithm>
 
 using namespace DirectX;
 
+// Get the LightManager of the current context
+LightManager* LightManager::GetInstance()
+{
+	return EngineContext::GetCurrent()->GetLightManager();
+}
+
 LightManager::~LightManager()
 {
 	if (ambientLight) { delete ambientLight; }
@@ -38,15 +45,19 @@ void LightManager::Init()
 	// Create the depth/stencil desc
 	shadowDSDesc = {};
 	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
+	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	shadowDSDesc.Texture2DArray.MipSlice = 0;
+	shadowDSDesc.Texture2DArray.FirstArraySlice = 0;
+	shadowDSDesc.Texture2DArray.ArraySize = 1;
 
 	// Create the desc for shadow map creation
 	shadowSRVDesc = {};
 	shadowSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	shadowSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	shadowSRVDesc.Texture2D.MipLevels = 1;
-	shadowSRVDesc.Texture2D.MostDetailedMip = 0;
+	shadowSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	shadowSRVDesc.Texture2DArray.MipLevels = 1;
+	shadowSRVDesc.Texture2DArray.MostDetailedMip = 0;
+	shadowSRVDesc.Texture2DArray.FirstArraySlice = 0;
+	shadowSRVDesc.Texture2DArray.ArraySize = 1;
 }
 
 // Create a new directional light and add it to the light manager
@@ -280,6 +291,34 @@ std::vector<Light*> LightManager::GetShadowCastingLights()
 	return shadowLightList;
 }
 
+// Bin this frame's lights into the camera's clusters
+void LightManager::BuildClusters(ID3D11DeviceContext* context, ID3D11Device* device,
+	Camera* camera, unsigned int width, unsigned int height)
+{
+	//Lights can move without dirtying the list, so gather fresh
+	//structs every frame. Directional lights go first
+	frameLights.clear();
+	for (auto light : lightList)
+	{
+		if (light->GetType() == LightType::DirectionalLight)
+			frameLights.push_back(*light->GetLightStruct());
+	}
+	int directionalCount = (int)frameLights.size();
+	for (auto light : lightList)
+	{
+		if (light->GetType() != LightType::DirectionalLight)
+			frameLights.push_back(*light->GetLightStruct());
+	}
+
+	clusters.Build(context, device, frameLights, directionalCount, camera, width, height);
+}
+
+// Get the light clusters built for this frame
+LightClusters* LightManager::GetClusters()
+{
+	return &clusters;
+}
+
 // Get the shadow texture description for creating shadowTexs
 D3D11_TEXTURE2D_DESC* LightManager::GetShadowTexDesc()
 {
@@ -1,17 +1,20 @@
 #pragma once
 #include "Lights.h"
+#include "LightClusters.h"
 #include <vector>
 
-#define SHADOW_MAP_SIZE 2048
+//Size of each cascade of a shadow map
+#define SHADOW_MAP_SIZE 1024
 
 class LightManager
 {
 private:
 	// --------------------------------------------------------
-	// Singleton Constructor - Set up the singleton instance of the LightManager
+	// Constructor - Only an EngineContext creates light managers
 	// --------------------------------------------------------
 	LightManager() { Init(); }
 	~LightManager();
+	friend class EngineContext;
 
 	// --------------------------------------------------------
 	// Initialize values in the LightManager
@@ -27,6 +30,10 @@ private:
 	bool listDirty;
 	LightStruct* lightStructArr;
 
+	//Clustered lights, rebuilt every frame
+	LightClusters clusters;
+	std::vector<LightStruct> frameLights;
+
 	//Shadow descs
 	D3D11_TEXTURE2D_DESC shadowTexDesc;
 	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc;
@@ -56,14 +63,9 @@ private:
 
 public:
 	// --------------------------------------------------------
-	// Get the singleton instance of the LightManager
+	// Get the LightManager of the current context
 	// --------------------------------------------------------
-	static LightManager* GetInstance()
-	{
-		static LightManager instance;
-
-		return &instance;
-	}
+	static LightManager* GetInstance();
 
 	//Delete this
 	LightManager(LightManager const&) = delete;
@@ -167,6 +169,20 @@ public:
 	// --------------------------------------------------------
 	std::vector<Light*> GetShadowCastingLights();
 
+	// --------------------------------------------------------
+	// Bin this frame's lights into the camera's clusters
+	//
+	// camera - the camera that is about to draw
+	// width, height - size of the screen in pixels
+	// --------------------------------------------------------
+	void BuildClusters(ID3D11DeviceContext* context, ID3D11Device* device,
+		Camera* camera, unsigned int width, unsigned int height);
+
+	// --------------------------------------------------------
+	// Get the light clusters built for this frame
+	// --------------------------------------------------------
+	LightClusters* GetClusters();
+
 	// --------------------------------------------------------
 	// Get the shadow texture description for creating shadowTexs
 	// --------------------------------------------------------
@@ -1,4 +1,20 @@
 #include "LightManager.h"
+#include "Camera.h"
+#include <cfloat>
+#include <cmath>
+
+//Default cascade setup for directional lights
+#define DEFAULT_SHADOW_CASCADES 3
+#define DEFAULT_CASCADE_SPLIT_LAMBDA 0.75f
+#define DEFAULT_SHADOW_DISTANCE 60.0f
+
+//How far behind a cascade casters are still caught
+#define SHADOW_CASTER_PULLBACK 50.0f
+
+//Cascades move in steps of this fraction of their width, so
+//small camera moves keep their static shadow layer
+#define CASCADE_SNAP_STEPS 8
+static_assert(SHADOW_MAP_SIZE % CASCADE_SNAP_STEPS == 0, "Cascade steps must be whole texels");
 
 using namespace DirectX;
 
@@ -12,8 +28,15 @@ Light::Light(LightType type, bool castShadows)
 {
 	inLightManager = false;
 	SetCastsShadows(castShadows);
-	shadowDSV = nullptr;
+	shadowTexture = nullptr;
 	shadowSRV = nullptr;
+	staticShadowTexture = nullptr;
+	for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		shadowDSVs[i] = nullptr;
+		staticShadowDSVs[i] = nullptr;
+		shadowCaches[i] = {};
+	}
 
 	lightStruct = new LightStruct();
 	lightStruct->Type = (int)type;
@@ -32,8 +55,15 @@ Light::Light(LightType type, bool castShadows, XMFLOAT3 color, float intensity)
 {
 	inLightManager = false;
 	SetCastsShadows(castShadows);
-	shadowDSV = nullptr;
+	shadowTexture = nullptr;
 	shadowSRV = nullptr;
+	staticShadowTexture = nullptr;
+	for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		shadowDSVs[i] = nullptr;
+		staticShadowDSVs[i] = nullptr;
+		shadowCaches[i] = {};
+	}
 
 	lightStruct = new LightStruct();
 	lightStruct->Type = (int)type;
@@ -47,11 +77,35 @@ Light::~Light()
 	if (lightStruct)
 		delete lightStruct;
 
-	if (shadowDSV != nullptr)
-		shadowDSV->Release();
+	ReleaseShadowMap();
+}
+
+// Release the shadow map so it is recreated when next needed
+void Light::ReleaseShadowMap()
+{
+	for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		if (shadowDSVs[i] != nullptr)
+			shadowDSVs[i]->Release();
+		if (staticShadowDSVs[i] != nullptr)
+			staticShadowDSVs[i]->Release();
+		shadowDSVs[i] = nullptr;
+		staticShadowDSVs[i] = nullptr;
+		shadowCaches[i] = {};
+	}
 
 	if (shadowSRV != nullptr)
 		shadowSRV->Release();
+
+	if (shadowTexture != nullptr)
+		shadowTexture->Release();
+
+	if (staticShadowTexture != nullptr)
+		staticShadowTexture->Release();
+
+	shadowSRV = nullptr;
+	shadowTexture = nullptr;
+	staticShadowTexture = nullptr;
 }
 
 // Get the light struct to pass to the shader
@@ -123,10 +177,10 @@ void Light::SetCastsShadows(bool castShadows)
 	castsShadows = castShadows;
 }
 
-// Get the shadow depth/stencil for this light
-ID3D11DepthStencilView * Light::GetShadowDSV()
+// Get the shadow depth/stencil for one cascade
+ID3D11DepthStencilView * Light::GetShadowDSV(int cascade)
 {
-	return shadowDSV;
+	return shadowDSVs[cascade];
 }
 
 // Get the shadow SRV for this light
@@ -135,27 +189,91 @@ ID3D11ShaderResourceView* Light::GetShadowSRV()
 	return shadowSRV;
 }
 
+// Get the shadow map texture for this light
+ID3D11Texture2D* Light::GetShadowTexture()
+{
+	return shadowTexture;
+}
+
+// Get the cached static caster layer texture for this light
+ID3D11Texture2D* Light::GetStaticShadowTexture()
+{
+	return staticShadowTexture;
+}
+
+// Get the cached static caster layer depth/stencil for this light
+ID3D11DepthStencilView* Light::GetStaticShadowDSV(int cascade)
+{
+	return staticShadowDSVs[cascade];
+}
+
+// Get the cache state of one cascade of the shadow map
+ShadowCache* Light::GetShadowCache(int cascade)
+{
+	return &shadowCaches[cascade];
+}
+
 // Create the SRV for this light's shadow map
 void Light::InitShadowMap(ID3D11Device* device)
 {
 	if (shadowSRV != nullptr)
 		return;
 
-	//Create the shadow texture
+	int cascadeCount = GetCascadeCount();
+
+	//Create the shadow texture, one slice per cascade. Kept so the static layer can be copied in
 	D3D11_TEXTURE2D_DESC shadowTexDesc = *(LightManager::GetInstance()->GetShadowTexDesc());
-	ID3D11Texture2D* shadowTexture;
+	shadowTexDesc.ArraySize = cascadeCount;
 	device->CreateTexture2D(&shadowTexDesc, 0, &shadowTexture);
 
-	// Create the depth/stencil
+	// Static caster layer, same layout so slices can be copied across
+	device->CreateTexture2D(&shadowTexDesc, 0, &staticShadowTexture);
+
+	// Create a depth/stencil for each slice
 	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = *(LightManager::GetInstance()->GetShadowDSDesc());
-	device->CreateDepthStencilView(shadowTexture, &shadowDSDesc, &shadowDSV);
+	for (int i = 0; i < cascadeCount; i++)
+	{
+		shadowDSDesc.Texture2DArray.FirstArraySlice = i;
+		device->CreateDepthStencilView(shadowTexture, &shadowDSDesc, &shadowDSVs[i]);
+		device->CreateDepthStencilView(staticShadowTexture, &shadowDSDesc, &staticShadowDSVs[i]);
+
+		//Nothing has been rendered yet
+		shadowCaches[i] = {};
+	}
 
-	// Create the SRV for the shadow map
+	// Create the SRV for the whole array
 	D3D11_SHADER_RESOURCE_VIEW_DESC shadowSRVDesc = *(LightManager::GetInstance()->GetShadowSRVDesc());
+	shadowSRVDesc.Texture2DArray.ArraySize = cascadeCount;
 	device->CreateShaderResourceView(shadowTexture, &shadowSRVDesc, &shadowSRV);
+}
 
-	// Release the texture reference since we don't need it
-	shadowTexture->Release();
+// Get how many cascades this light's shadow map has
+int Light::GetCascadeCount()
+{
+	return 1;
+}
+
+// Fit the shadow cascades to a camera's view
+void Light::FitToCamera(Camera* camera)
+{ }
+
+// Get the view one cascade renders with
+XMFLOAT4X4 Light::GetCascadeViewMatrix(int cascade)
+{
+	return GetViewMatrix();
+}
+
+// Get the projection one cascade renders with
+XMFLOAT4X4 Light::GetCascadeProjectionMatrix(int cascade)
+{
+	return GetProjectionMatrix();
+}
+
+// Get the view depth at which a cascade ends
+float Light::GetCascadeSplit(int cascade)
+{
+	//A single map covers everything
+	return FLT_MAX;
 }
 
 #pragma endregion
@@ -172,6 +290,7 @@ DirectionalLight::DirectionalLight(bool castShadows) : Light::Light(LightType::D
 { 
 	CalculateViewMatrix();
 	CalculateProjMatrix();
+	InitCascades();
 }
 
 // Constructor - Set up a directional light
@@ -180,12 +299,29 @@ DirectionalLight::DirectionalLight(bool castShadows, XMFLOAT3 color, float inten
 { 
 	CalculateViewMatrix();
 	CalculateProjMatrix();
+	InitCascades();
 }
 
 // Destructor for when an instance is deleted
 DirectionalLight::~DirectionalLight()
 { }
 
+// Set the default cascade setup
+void DirectionalLight::InitCascades()
+{
+	cascadeCount = DEFAULT_SHADOW_CASCADES;
+	splitLambda = DEFAULT_CASCADE_SPLIT_LAMBDA;
+	shadowDistance = DEFAULT_SHADOW_DISTANCE;
+
+	//Until a camera is fitted every cascade uses the fixed projection
+	for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		cascadeViews[i] = shadowView;
+		cascadeProjs[i] = shadowProj;
+		cascadeSplits[i] = shadowDistance * (i + 1) / cascadeCount;
+	}
+}
+
 // Get the direction of this light
 XMFLOAT3 DirectionalLight::GetDirection()
 {
@@ -228,6 +364,146 @@ DirectX::XMFLOAT4X4 DirectionalLight::GetProjectionMatrix()
 	CalculateProjMatrix();
 	return shadowProj;
 }
+
+// Set how many cascades the shadow map is split into
+void DirectionalLight::SetCascadeCount(int count)
+{
+	if (count < 1)
+		count = 1;
+	if (count > MAX_SHADOW_CASCADES)
+		count = MAX_SHADOW_CASCADES;
+	if (count == cascadeCount)
+		return;
+
+	cascadeCount = count;
+	ReleaseShadowMap();
+}
+
+// Set how the camera's view is split between cascades
+void DirectionalLight::SetSplitLambda(float lambda)
+{
+	splitLambda = lambda < 0 ? 0 : (lambda > 1 ? 1 : lambda);
+}
+
+// Get how the camera's view is split between cascades
+float DirectionalLight::GetSplitLambda()
+{
+	return splitLambda;
+}
+
+// Set how far from the camera shadows are drawn
+void DirectionalLight::SetShadowDistance(float distance)
+{
+	shadowDistance = distance;
+}
+
+// Get how far from the camera shadows are drawn
+float DirectionalLight::GetShadowDistance()
+{
+	return shadowDistance;
+}
+
+// Get how many cascades the shadow map has
+int DirectionalLight::GetCascadeCount()
+{
+	return cascadeCount;
+}
+
+// Fit a texel snapped orthographic projection around each slice of the camera's view
+void DirectionalLight::FitToCamera(Camera* camera)
+{
+	float nearClip = camera->GetNearClip();
+	float farClip = shadowDistance < camera->GetFarClip() ? shadowDistance : camera->GetFarClip();
+	float tanY = tanf(camera->GetFov() * 0.5f);
+	float tanX = tanY * camera->GetAspectRatio();
+
+	//Camera matrices are stored transposed
+	XMFLOAT4X4 cameraView = camera->GetViewMatrix();
+	XMMATRIX invView = XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&cameraView)));
+
+	//Rotation only, so moving the camera slides the cascades across
+	//light space instead of changing their orientation
+	XMFLOAT3 forward = GetForwardAxis();
+	XMFLOAT3 up = GetUpAxis();
+	XMMATRIX lightView = XMMatrixLookToLH(XMVectorZero(), XMLoadFloat3(&forward), XMLoadFloat3(&up));
+	XMFLOAT4X4 lightViewT;
+	XMStoreFloat4x4(&lightViewT, XMMatrixTranspose(lightView));
+
+	float splitNear = nearClip;
+	for (int i = 0; i < cascadeCount; i++)
+	{
+		//Blend logarithmic and uniform splits
+		float p = (float)(i + 1) / cascadeCount;
+		float logSplit = nearClip * powf(farClip / nearClip, p);
+		float uniformSplit = nearClip + (farClip - nearClip) * p;
+		float splitFar = splitLambda * logSplit + (1 - splitLambda) * uniformSplit;
+
+		//Corners of the slice in world space
+		XMVECTOR corners[8];
+		XMVECTOR center = XMVectorZero();
+		for (int k = 0; k < 8; k++)
+		{
+			float z = k < 4 ? splitNear : splitFar;
+			float x = (k & 1 ? 1.0f : -1.0f) * tanX * z;
+			float y = (k & 2 ? 1.0f : -1.0f) * tanY * z;
+			corners[k] = XMVector3TransformCoord(XMVectorSet(x, y, z, 1), invView);
+			center = XMVectorAdd(center, corners[k]);
+		}
+		center = XMVectorScale(center, 1.0f / 8);
+
+		//Bound the slice with a sphere so the cascade's size does not
+		//change as the camera rotates. Rounded up to stop it flickering
+		float radius = 0;
+		for (int k = 0; k < 8; k++)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(corners[k], center)));
+			if (distance > radius)
+				radius = distance;
+		}
+		radius = ceilf(radius * 16) / 16;
+
+		//Snap the center to a coarse grid in light space. The projection,
+		//which the static shadow layer is cached against, then only changes
+		//when the camera crosses a grid line instead of every frame. The
+		//cascade is widened so the slice still fits anywhere within a step,
+		//and a step is a whole number of texels so edges do not shimmer
+		float halfWidth = radius * CASCADE_SNAP_STEPS / (CASCADE_SNAP_STEPS - 1);
+		float step = 2 * halfWidth / CASCADE_SNAP_STEPS;
+		XMFLOAT3 c;
+		XMStoreFloat3(&c, XMVector3TransformCoord(center, lightView));
+		c.x = (floorf(c.x / step) + 0.5f) * step;
+		c.y = (floorf(c.y / step) + 0.5f) * step;
+		c.z = (floorf(c.z / step) + 0.5f) * step;
+
+		XMMATRIX proj = XMMatrixOrthographicOffCenterLH(
+			c.x - halfWidth, c.x + halfWidth,
+			c.y - halfWidth, c.y + halfWidth,
+			c.z - halfWidth - SHADOW_CASTER_PULLBACK, c.z + halfWidth);
+
+		cascadeViews[i] = lightViewT;
+		XMStoreFloat4x4(&cascadeProjs[i], XMMatrixTranspose(proj));
+		cascadeSplits[i] = splitFar;
+		splitNear = splitFar;
+	}
+}
+
+// Get the view one cascade renders with
+XMFLOAT4X4 DirectionalLight::GetCascadeViewMatrix(int cascade)
+{
+	return cascadeViews[cascade];
+}
+
+// Get the projection one cascade renders with
+XMFLOAT4X4 DirectionalLight::GetCascadeProjectionMatrix(int cascade)
+{
+	return cascadeProjs[cascade];
+}
+
+// Get the view depth at which a cascade ends
+float DirectionalLight::GetCascadeSplit(int cascade)
+{
+	return cascadeSplits[cascade];
+}
 #pragma endregion
 
 
@@ -5,7 +5,14 @@
 
 enum class LightType { DirectionalLight = 0, PointLight = 1, SpotLight = 2};
 
-#define MAX_LIGHTS 10
+//Lights are binned into clusters, so shaders only pay for nearby ones
+#define MAX_LIGHTS 256
+
+//Most slices a light's shadow map can be split into.
+//Must match MAX_SHADOW_CASCADES in Shadows.hlsli
+#define MAX_SHADOW_CASCADES 4
+
+class Camera;
 
 // --------------------------------------------------------
 // A light struct definition
@@ -38,6 +45,20 @@ struct AmbientLightStruct
 	DirectX::XMFLOAT3	Color;		// 48 bytes
 };
 
+// --------------------------------------------------------
+// What one cascade of a light's shadow map was last rendered from.
+//
+// The renderer hashes the light's matrices and the casters
+// it can see, and skips work whose inputs did not change
+// --------------------------------------------------------
+struct ShadowCache
+{
+	bool staticValid;					//The static layer holds staticHash's casters
+	bool valid;							//The shadow map holds dynamicHash's casters
+	unsigned long long staticHash;		//Light matrices + static casters
+	unsigned long long dynamicHash;		//staticHash + dynamic casters
+};
+
 // --------------------------------------------------------
 // A light definition
 //
@@ -54,9 +75,18 @@ private:
 	// --------------------------------------------------------
 	friend void SetInLightManager(Light* light, bool val);
 	bool castsShadows;
-	ID3D11DepthStencilView* shadowDSV;
+
+	//One array slice (and depth/stencil) per cascade
+	ID3D11Texture2D* shadowTexture;
+	ID3D11DepthStencilView* shadowDSVs[MAX_SHADOW_CASCADES];
 	ID3D11ShaderResourceView* shadowSRV;
 
+	//Depth of static casters only, copied into the shadow map
+	//before the dynamic casters are drawn on top
+	ID3D11Texture2D* staticShadowTexture;
+	ID3D11DepthStencilView* staticShadowDSVs[MAX_SHADOW_CASCADES];
+	ShadowCache shadowCaches[MAX_SHADOW_CASCADES];
+
 protected:
 	bool inLightManager;
 	LightStruct* lightStruct;
@@ -73,6 +103,12 @@ protected:
 	// --------------------------------------------------------
 	virtual void CalculateProjMatrix() = 0;
 
+	// --------------------------------------------------------
+	// Release the shadow map so it is recreated the next
+	// time shadows are rendered
+	// --------------------------------------------------------
+	void ReleaseShadowMap();
+
 public:
 
 	// --------------------------------------------------------
@@ -146,9 +182,9 @@ public:
 	void SetCastsShadows(bool castShadows);
 
 	// --------------------------------------------------------
-	// Get the shadow depth/stencil view for this light
+	// Get the shadow depth/stencil view for one cascade
 	// --------------------------------------------------------
-	ID3D11DepthStencilView* GetShadowDSV();
+	ID3D11DepthStencilView* GetShadowDSV(int cascade = 0);
 
 	// --------------------------------------------------------
 	// Get the shadow SRV for this light
@@ -156,10 +192,49 @@ public:
 	ID3D11ShaderResourceView* GetShadowSRV();
 
 	// --------------------------------------------------------
-	// Create the SRV for this light's shadow map
+	// Get the shadow map texture for this light
+	// --------------------------------------------------------
+	ID3D11Texture2D* GetShadowTexture();
+
+	// --------------------------------------------------------
+	// Get the cached static caster layer for this light
+	// --------------------------------------------------------
+	ID3D11Texture2D* GetStaticShadowTexture();
+	ID3D11DepthStencilView* GetStaticShadowDSV(int cascade = 0);
+
+	// --------------------------------------------------------
+	// Get the cache state of one cascade of the shadow map
+	// --------------------------------------------------------
+	ShadowCache* GetShadowCache(int cascade = 0);
+
+	// --------------------------------------------------------
+	// Create the SRV for this light's shadow map, with one
+	// array slice per cascade
 	// --------------------------------------------------------
 	void InitShadowMap(ID3D11Device* device);
 
+	// --------------------------------------------------------
+	// Get how many cascades this light's shadow map has
+	// --------------------------------------------------------
+	virtual int GetCascadeCount();
+
+	// --------------------------------------------------------
+	// Fit the shadow cascades to a camera's view.
+	// Lights with a single shadow map do not need the camera
+	// --------------------------------------------------------
+	virtual void FitToCamera(Camera* camera);
+
+	// --------------------------------------------------------
+	// Get the view and projection one cascade renders with
+	// --------------------------------------------------------
+	virtual DirectX::XMFLOAT4X4 GetCascadeViewMatrix(int cascade);
+	virtual DirectX::XMFLOAT4X4 GetCascadeProjectionMatrix(int cascade);
+
+	// --------------------------------------------------------
+	// Get the view depth at which a cascade ends
+	// --------------------------------------------------------
+	virtual float GetCascadeSplit(int cascade);
+
 	// --------------------------------------------------------
 	// Get this light's view matrix (for shadows)
 	// --------------------------------------------------------
@@ -179,6 +254,22 @@ public:
 // --------------------------------------------------------
 class DirectionalLight : public Light
 {
+private:
+	//Cascade setup
+	int cascadeCount;
+	float splitLambda;
+	float shadowDistance;
+
+	//Fitted by FitToCamera
+	DirectX::XMFLOAT4X4 cascadeViews[MAX_SHADOW_CASCADES];
+	DirectX::XMFLOAT4X4 cascadeProjs[MAX_SHADOW_CASCADES];
+	float cascadeSplits[MAX_SHADOW_CASCADES];
+
+	// --------------------------------------------------------
+	// Set the default cascade setup
+	// --------------------------------------------------------
+	void InitCascades();
+
 protected:
 	// --------------------------------------------------------
 	// Calculate view for shadow rendering
@@ -223,6 +314,51 @@ public:
 	// Get this light's projection matrix (for shadows)
 	// --------------------------------------------------------
 	virtual DirectX::XMFLOAT4X4 GetProjectionMatrix();
+
+	// --------------------------------------------------------
+	// Set how many cascades the shadow map is split into.
+	// Recreates the shadow map
+	//
+	// count - between 1 and MAX_SHADOW_CASCADES
+	// --------------------------------------------------------
+	void SetCascadeCount(int count);
+
+	// --------------------------------------------------------
+	// Set how the camera's view is split between cascades
+	//
+	// lambda - 0 splits evenly, 1 splits logarithmically
+	// --------------------------------------------------------
+	void SetSplitLambda(float lambda);
+	float GetSplitLambda();
+
+	// --------------------------------------------------------
+	// Set how far from the camera shadows are drawn.
+	// Clamped to the camera's far clip
+	// --------------------------------------------------------
+	void SetShadowDistance(float distance);
+	float GetShadowDistance();
+
+	// --------------------------------------------------------
+	// Get how many cascades the shadow map has
+	// --------------------------------------------------------
+	virtual int GetCascadeCount();
+
+	// --------------------------------------------------------
+	// Split the camera's view into slices and fit a texel
+	// snapped orthographic projection around each of them
+	// --------------------------------------------------------
+	virtual void FitToCamera(Camera* camera);
+
+	// --------------------------------------------------------
+	// Get the view and projection one cascade renders with
+	// --------------------------------------------------------
+	virtual DirectX::XMFLOAT4X4 GetCascadeViewMatrix(int cascade);
+	virtual DirectX::XMFLOAT4X4 GetCascadeProjectionMatrix(int cascade);
+
+	// --------------------------------------------------------
+	// Get the view depth at which a cascade ends
+	// --------------------------------------------------------
+	virtual float GetCascadeSplit(int cascade);
 };
 
 // --------------------------------------------------------
@@ -346,7 +482,7 @@ public:
 	// --------------------------------------------------------
 	// Get the direction of this light
 	// --------------------------------------------------------
-	DirectX::XMFLOAT3 SpotLight::GetDirection();
+	DirectX::XMFLOAT3 GetDirection();
 
 	// --------------------------------------------------------
 	// Get this light's view matrix (for shadows)
@@ -1,10 +1,20 @@
 #include "Material.h"
+#include "LightManager.h"
+
+using namespace DirectX;
 
 // Constructor - Set up a material
 Material::Material(SimpleVertexShader * vertexShader, SimplePixelShader * pixelShader)
 {
 	this->vertexShader = vertexShader;
 	this->pixelShader = pixelShader;
+
+	vsPerComboBuffer = vertexShader->GetBufferIndex("perCombo");
+	psPerComboBuffer = pixelShader->GetBufferIndex("perCombo");
+	vsPerObjectBuffer = vertexShader->GetBufferIndex("perObject");
+	psPerObjectBuffer = pixelShader->GetBufferIndex("perObject");
+	shadowsBuffer = pixelShader->GetBufferIndex("shadows");
+	clustersBuffer = pixelShader->GetBufferIndex("clusters");
 }
 
 // Release all data in the material
@@ -17,8 +27,82 @@ SimpleVertexShader* Material::GetVertexShader()
 	return vertexShader;
 }
 
+// Check if this material draws with hardware instancing
+bool Material::UsesInstancing()
+{
+	return vertexShader->GetPerInstanceCompatible();
+}
+
 // Get this materials pixel shader
 SimplePixelShader* Material::GetPixelShader()
 {
 	return pixelShader;
 }
+
+// Record this material's per object variables into a command list
+void Material::RecordMaterialObject(RenderCommandList& list, GameObject* entityObj)
+{
+	const SimpleConstantBuffer* cb = vertexShader->GetBufferInfo(vsPerObjectBuffer);
+	if (cb == nullptr || cb->Size != sizeof(PerObjectVSConstants))
+		return;
+
+	//The renderer already rebuilt the world matrices this frame, so these only read
+	PerObjectVSConstants vsData = {};
+	vsData.world = entityObj->GetWorldMatrix();
+	vsData.worldInvTrans = entityObj->GetWorldInvTransMatrix();
+	list.SetConstants(cb->ConstantBuffer, vsData);
+}
+
+// Tell the shaders their per object buffers were written by a command list
+void Material::InvalidateObjectConstants()
+{
+	vertexShader->InvalidateBuffer(vsPerObjectBuffer);
+}
+
+// Send the cascades of the first shadow casting light to the pixel shader
+void Material::PrepareShadows(Camera* cam, ID3D11SamplerState* shadowSampler)
+{
+	std::vector<Light*> lights = LightManager::GetInstance()->GetShadowCastingLights();
+
+	ShadowConstants shadows = {};
+	ID3D11ShaderResourceView* shadowSRV = nullptr;
+	if (lights.size() > 0)
+	{
+		Light* light = lights[0];
+		shadows.CascadeCount = light->GetCascadeCount();
+		shadowSRV = light->GetShadowSRV();
+		for (int i = 0; i < shadows.CascadeCount; i++)
+		{
+			//Both are stored transposed, so (V * P)^T = P^T * V^T
+			XMFLOAT4X4 view = light->GetCascadeViewMatrix(i);
+			XMFLOAT4X4 proj = light->GetCascadeProjectionMatrix(i);
+			XMStoreFloat4x4(&shadows.ShadowViewProj[i], XMMatrixMultiply(XMLoadFloat4x4(&proj), XMLoadFloat4x4(&view)));
+			shadows.CascadeSplits[i] = light->GetCascadeSplit(i);
+		}
+	}
+	shadows.ShadowCameraPosition = cam->GetPosition();
+	shadows.ShadowCameraForward = cam->GetForwardAxis();
+
+	pixelShader->SetBufferData(shadowsBuffer, shadows);
+	pixelShader->SetShaderResourceView("ShadowMap", shadowSRV);
+	pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
+	pixelShader->CopyBufferData(shadowsBuffer);
+}
+
+// Send this frame's light clusters to the pixel shader
+void Material::PrepareLights()
+{
+	LightClusters* clusters = LightManager::GetInstance()->GetClusters();
+
+	ClusterConstants constants = {};
+	constants.ClusterTileScale = clusters->GetTileScale();
+	constants.ClusterDepthScale = clusters->GetDepthScale();
+	constants.ClusterDepthBias = clusters->GetDepthBias();
+	constants.DirectionalLightCount = clusters->GetDirectionalCount();
+
+	pixelShader->SetBufferData(clustersBuffer, constants);
+	pixelShader->SetShaderResourceView("Lights", clusters->GetLightSRV());
+	pixelShader->SetShaderResourceView("ClusterLightGrid", clusters->GetGridSRV());
+	pixelShader->SetShaderResourceView("ClusterLightIndices", clusters->GetIndexSRV());
+	pixelShader->CopyBufferData(clustersBuffer);
+}
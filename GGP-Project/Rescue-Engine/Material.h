@@ -1,5 +1,7 @@
 #pragma once
 #include "SimpleShader.h"
+#include "ShaderConstants.h"
+#include "RenderCommandList.h"
 #include "GameObject.h"
 #include "Camera.h"
 
@@ -15,6 +17,14 @@ protected:
 	SimpleVertexShader* vertexShader;
 	SimplePixelShader* pixelShader;
 
+	//Constant buffers filled from ShaderConstants.h structs, resolved once
+	unsigned int vsPerComboBuffer;
+	unsigned int psPerComboBuffer;
+	unsigned int vsPerObjectBuffer;
+	unsigned int psPerObjectBuffer;
+	unsigned int shadowsBuffer;
+	unsigned int clustersBuffer;
+
 	// --------------------------------------------------------
 	// Constructor - Set up a material
 	//
@@ -23,6 +33,21 @@ protected:
 	// --------------------------------------------------------
 	Material(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
 
+	// --------------------------------------------------------
+	// Send the cascades of the first shadow casting light to
+	// the pixel shader's "shadows" buffer (see Shadows.hlsli)
+	//
+	// cam - the camera the cascades were fitted to
+	// shadowSampler - comparison sampler for the shadow map
+	// --------------------------------------------------------
+	void PrepareShadows(Camera* cam, ID3D11SamplerState* shadowSampler);
+
+	// --------------------------------------------------------
+	// Send this frame's light clusters to the pixel shader's
+	// "clusters" buffer and light buffers (see Clusters.hlsli)
+	// --------------------------------------------------------
+	void PrepareLights();
+
 public:
 	// --------------------------------------------------------
 	// Release all data in the material
@@ -39,6 +64,14 @@ public:
 	// --------------------------------------------------------
 	SimplePixelShader* GetPixelShader();
 
+	// --------------------------------------------------------
+	// Check if this material draws with hardware instancing.
+	// Materials opt in by using a vertex shader with _PER_INSTANCE
+	// inputs; the renderer then feeds world matrices through an
+	// instance buffer and never calls PrepareMaterialObject()
+	// --------------------------------------------------------
+	bool UsesInstancing();
+
 	// --------------------------------------------------------
 	// Prepare this material's shader's per MatMesh combo variables
 	// --------------------------------------------------------
@@ -48,5 +81,21 @@ public:
 	// Prepare this material's shader's per object variables
 	// --------------------------------------------------------
 	virtual void PrepareMaterialObject(GameObject* entityObj) = 0;
+
+	// --------------------------------------------------------
+	// Record this material's per object variables into a command
+	// list instead of setting them on the shaders. Called from
+	// recording threads, so it must only read shared data.
+	// The default writes the vertex shader's "perObject" buffer
+	// from PerObjectVSConstants, like PrepareMaterialObject()
+	// does for the game's lit materials
+	// --------------------------------------------------------
+	virtual void RecordMaterialObject(RenderCommandList& list, GameObject* entityObj);
+
+	// --------------------------------------------------------
+	// Tell the shaders their per object buffers were written by
+	// a command list, so the next PrepareMaterialObject() uploads
+	// --------------------------------------------------------
+	virtual void InvalidateObjectConstants();
 };
 
@@ -1,7 +1,11 @@
 #include "Mesh.h"
+#include "MeshSimplifier.h"
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <algorithm>
+#include <cmath>
 #include <DirectXMath.h>
 
 using namespace DirectX;
@@ -12,8 +16,14 @@ Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount,
 	//Initialize
 	vertexBuffer = 0;
 	indexBuffer = 0;
+	positionBuffer = 0;
+	positionIndexBuffer = 0;
+	this->indexCount = 0;
+	lodCount = 0;
+	boundsMin = boundsMax = sphereCenter = XMFLOAT3(0, 0, 0);
+	sphereRadius = 0;
 
-	CreateBuffers(vertices, vertexCount, indices, indexCount, device);
+	CreateBuffers(vertices, vertexCount, indices, indexCount, device, false);
 
 	//Set fields
 	this->indexCount = indexCount;
@@ -21,10 +31,23 @@ Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount,
 
 Mesh::Mesh(const char* objFile, ID3D11Device* device)
 {
+#ifdef HEADLESS
+	// Asset paths are written Windows style
+	std::string path = objFile;
+	std::replace(path.begin(), path.end(), '\\', '/');
+	objFile = path.c_str();
+#endif
+
 	// File input object
 	std::ifstream obj(objFile);
 	this->indexBuffer = nullptr;
 	this->vertexBuffer = nullptr;
+	this->positionBuffer = nullptr;
+	this->positionIndexBuffer = nullptr;
+	this->indexCount = 0;
+	lodCount = 0;
+	boundsMin = boundsMax = sphereCenter = XMFLOAT3(0, 0, 0);
+	sphereRadius = 0;
 
 	// Check for successful open
 	if (!obj.is_open())
@@ -181,6 +204,11 @@ Mesh::Mesh(const char* objFile, ID3D11Device* device)
 
 	// Close the file and create the actual buffers
 	obj.close();
+	if (verts.empty())
+	{
+		printf("File \"%s\" has no faces\n", objFile);
+		return;
+	}
 
 	// - At this point, "verts" is a vector of Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
@@ -189,7 +217,7 @@ Mesh::Mesh(const char* objFile, ID3D11Device* device)
 	//    can be used directly for the index buffer: &indices[0] is the address of the first int
 	//
 	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device, true);
 	this->indexCount = vertCounter;
 }
 
@@ -202,15 +230,41 @@ Mesh::~Mesh()
 // Release all memory used by this mesh
 void Mesh::Release()
 {
+#ifndef HEADLESS
 	if (vertexBuffer) { vertexBuffer->Release(); }
 	if (indexBuffer) { indexBuffer->Release(); }
+	if (positionBuffer) { positionBuffer->Release(); }
+	if (positionIndexBuffer) { positionIndexBuffer->Release(); }
+#endif
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+	positionBuffer = nullptr;
+	positionIndexBuffer = nullptr;
 }
 
 // Create the vertex and index buffers for the mesh
-void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount, ID3D11Device* device)
+void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount, ID3D11Device* device, bool imported)
 {
 	// Calculate the tangents before copying to buffer
 	CalculateTangents(vertices, vertexCount, indices, indexCount);
+	CalculateBounds(vertices, vertexCount);
+
+	// Keep a CPU copy for anything that needs the geometry without the GPU
+	this->vertices.assign(vertices, vertices + vertexCount);
+	this->indices.assign(indices, indices + indexCount);
+	lodStartIndex[0] = 0;
+	lodIndexCount[0] = indexCount;
+	lodCount = 1;
+	if (imported)
+	{
+		GenerateLods();
+		CreatePositionStream();
+	}
+
+#ifndef HEADLESS
+	// CPU-only mesh
+	if (device == nullptr)
+		return;
 
 	// Create the VERTEX BUFFER description -----------------------------------
 	// - The description is created on the stack because we only need
@@ -237,7 +291,7 @@ void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, i
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(int) * indexCount;         // 3 = number of indices in the buffer
+	ibd.ByteWidth = sizeof(int) * (UINT)this->indices.size(); // Every detail level
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER; // Tells DirectX this is an index buffer
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -246,11 +300,100 @@ void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, i
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indices;
+	initialIndexData.pSysMem = this->indices.data();
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	device->CreateBuffer(&ibd, &initialIndexData, &indexBuffer);
+
+	// Create the POSITION STREAM, if the mesh has one --------------------------
+	if (positions.empty())
+		return;
+
+	D3D11_BUFFER_DESC pbd = vbd;
+	pbd.ByteWidth = sizeof(XMFLOAT3) * (UINT)positions.size();
+	D3D11_SUBRESOURCE_DATA initialPositionData;
+	initialPositionData.pSysMem = positions.data();
+	device->CreateBuffer(&pbd, &initialPositionData, &positionBuffer);
+
+	D3D11_BUFFER_DESC pibd = ibd;
+	pibd.ByteWidth = sizeof(int) * (UINT)positionIndices.size();
+	D3D11_SUBRESOURCE_DATA initialPositionIndexData;
+	initialPositionIndexData.pSysMem = positionIndices.data();
+	device->CreateBuffer(&pibd, &initialPositionIndexData, &positionIndexBuffer);
+#endif
+}
+
+// Weld the CPU copy's positions into the position stream
+void Mesh::CreatePositionStream()
+{
+	std::vector<unsigned int> weld;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> groups;
+	MeshSimplifier::WeldPositions(vertices.data(), (unsigned int)vertices.size(), positions, weld, order, groups);
+
+	//Same layout as the full indices, every detail level included
+	positionIndices.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		positionIndices[i] = weld[indices[i]];
+}
+
+// Simplify the CPU copy of the mesh into lower detail levels
+void Mesh::GenerateLods()
+{
+	unsigned int triangles = lodIndexCount[0] / 3;
+	if (triangles < MESH_LOD_MIN_TRIANGLES)
+		return;
+
+	//Each level keeps simplifying the one before
+	MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size(), indices.data(), lodIndexCount[0]);
+	while (lodCount < MESH_MAX_LODS)
+	{
+		unsigned int start = (unsigned int)indices.size();
+		unsigned int levelTriangles = simplifier.Simplify((unsigned int)(triangles * MESH_LOD_REDUCTION), indices);
+
+		//Stop when the mesh will not get much simpler
+		if (levelTriangles == 0 || levelTriangles > triangles * (1.0f + MESH_LOD_REDUCTION) * 0.5f)
+		{
+			indices.resize(start);
+			break;
+		}
+
+		lodStartIndex[lodCount] = start;
+		lodIndexCount[lodCount] = levelTriangles * 3;
+		lodCount++;
+		triangles = levelTriangles;
+	}
+}
+
+// Calculates the local AABB and bounding sphere of the vertices
+void Mesh::CalculateBounds(Vertex* verts, int numVerts)
+{
+	if (numVerts < 1)
+		return;
+
+	XMVECTOR minV = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR maxV = minV;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[i].Position);
+		minV = XMVectorMin(minV, p);
+		maxV = XMVectorMax(maxV, p);
+	}
+	XMStoreFloat3(&boundsMin, minV);
+	XMStoreFloat3(&boundsMax, maxV);
+
+	//Center the sphere on the box, but size it to the furthest vertex
+	//since that is usually tighter than the box's half diagonal
+	XMVECTOR center = XMVectorScale(XMVectorAdd(minV, maxV), 0.5f);
+	float radiusSq = 0;
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[i].Position);
+		radiusSq = (std::max)(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, center))));
+	}
+	XMStoreFloat3(&sphereCenter, center);
+	sphereRadius = sqrtf(radiusSq);
 }
 
 // Calculates the tangents of the vertices in a mesh
@@ -339,13 +482,142 @@ ID3D11Buffer* Mesh::GetIndexBuffer()
 	return indexBuffer;
 }
 
+// Check if this mesh has a position stream
+bool Mesh::HasPositionStream()
+{
+#ifdef HEADLESS
+	return !positions.empty();
+#else
+	return positionBuffer != nullptr && positionIndexBuffer != nullptr;
+#endif
+}
+
+// Get the position only vertex buffer
+ID3D11Buffer* Mesh::GetPositionBuffer()
+{
+	return positionBuffer;
+}
+
+// Get the index buffer of the position stream
+ID3D11Buffer* Mesh::GetPositionIndexBuffer()
+{
+	return positionIndexBuffer;
+}
+
+// Get the CPU copy of the welded positions
+const std::vector<XMFLOAT3>& Mesh::GetPositions()
+{
+	return positions;
+}
+
+// Get the CPU copy of the position stream's indices
+const std::vector<unsigned int>& Mesh::GetPositionIndices()
+{
+	return positionIndices;
+}
+
 // Get the number of indicies in this mesh
 int Mesh::GetIndexCount()
 {
 	return indexCount;
 }
 
+// Get the number of detail levels
+int Mesh::GetLodCount()
+{
+	return lodCount;
+}
+
+// Get the first index a detail level draws
+unsigned int Mesh::GetLodStartIndex(int lod)
+{
+	return lodStartIndex[lod];
+}
+
+// Get the number of indices a detail level draws
+unsigned int Mesh::GetLodIndexCount(int lod)
+{
+	return lodIndexCount[lod];
+}
+
+// Pick the detail level for an object's size on screen
+int Mesh::SelectLod(float screenSize, int currentLod)
+{
+	//Level n starts below MESH_LOD_SCREEN_SIZE / 2^(n-1). Only
+	//change once the size is clearly past the threshold
+	int lod = (std::min)((std::max)(currentLod, 0), lodCount - 1);
+	while (lod + 1 < lodCount && screenSize < MESH_LOD_SCREEN_SIZE / (1 << lod) * (1.0f - MESH_LOD_HYSTERESIS))
+		lod++;
+	while (lod > 0 && screenSize > MESH_LOD_SCREEN_SIZE / (1 << (lod - 1)) * (1.0f + MESH_LOD_HYSTERESIS))
+		lod--;
+	return lod;
+}
+
+// Get the number of vertices in this mesh
+int Mesh::GetVertexCount()
+{
+	return (int)vertices.size();
+}
+
+// Get the CPU copy of this mesh's vertices
+const std::vector<Vertex>& Mesh::GetVertices()
+{
+	return vertices;
+}
+
+// Get the CPU copy of this mesh's indices
+const std::vector<unsigned int>& Mesh::GetIndices()
+{
+	return indices;
+}
+
+// Get the local space AABB minimum
+XMFLOAT3 Mesh::GetBoundsMin()
+{
+	return boundsMin;
+}
+
+// Get the local space AABB maximum
+XMFLOAT3 Mesh::GetBoundsMax()
+{
+	return boundsMax;
+}
+
+// Get the local space bounding sphere center
+XMFLOAT3 Mesh::GetSphereCenter()
+{
+	return sphereCenter;
+}
+
+// Get the local space bounding sphere radius
+float Mesh::GetSphereRadius()
+{
+	return sphereRadius;
+}
+
+// Move the bounding sphere into world space
+void Mesh::GetWorldSphere(const XMFLOAT4X4& world, XMFLOAT3& center, float& radius)
+{
+	XMMATRIX m = XMMatrixTranspose(XMLoadFloat4x4(&world));
+	XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&sphereCenter), m));
+
+	float scaleSq = (std::max)(XMVectorGetX(XMVector3LengthSq(m.r[0])),
+		(std::max)(XMVectorGetX(XMVector3LengthSq(m.r[1])), XMVectorGetX(XMVector3LengthSq(m.r[2]))));
+	radius = sphereRadius * sqrtf(scaleSq);
+}
+
+// Get a sphere's projected diameter over the screen height
+float Mesh::GetScreenSize(float radius, float distance, float projectionScale)
+{
+	return distance > radius ? radius * projectionScale / distance : 1.0f;
+}
+
+// Check if this mesh is loaded into memory
 bool Mesh::IsMeshLoaded()
 {
+#ifdef HEADLESS
+	return !indices.empty();
+#else
 	return (this->indexBuffer != nullptr) && (this->vertexBuffer != nullptr);
+#endif
 }
@@ -1,8 +1,26 @@
 #pragma once
 
-#include <d3d11.h>
+#include <vector>
+#include "Platform.h"
 #include "Vertex.h"
 
+//Most detail levels a mesh can have, counting the full mesh
+#define MESH_MAX_LODS 4
+
+//Share of triangles each level keeps from the one before
+#define MESH_LOD_REDUCTION 0.5f
+
+//Meshes with fewer triangles are drawn at full detail only
+#define MESH_LOD_MIN_TRIANGLES 256
+
+//Screen height share below which the first simplified level
+//is drawn. Halves for each level after it
+#define MESH_LOD_SCREEN_SIZE 0.4f
+
+//How far past a threshold the screen size has to get before
+//the level changes, so objects near one do not flicker
+#define MESH_LOD_HYSTERESIS 0.2f
+
 // --------------------------------------------------------
 // A custom mesh definition.
 //
@@ -15,16 +33,58 @@ private:
 	ID3D11Buffer* indexBuffer;
 	int indexCount;
 
+	//Detail levels, as ranges of the index buffer. All of them
+	//index the same vertices, and level 0 is the full mesh
+	unsigned int lodStartIndex[MESH_MAX_LODS];
+	unsigned int lodIndexCount[MESH_MAX_LODS];
+	int lodCount;
+
+	//Welded, position only copy of the mesh for passes that only
+	//need depth. Its indices line up with the full index buffer,
+	//so detail level ranges apply to both
+	ID3D11Buffer* positionBuffer;
+	ID3D11Buffer* positionIndexBuffer;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> positionIndices;
+
+	//CPU-side copy of the geometry
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	//Local space bounds
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	DirectX::XMFLOAT3 sphereCenter;
+	float sphereRadius;
+
+	// --------------------------------------------------------
+	// Keep a CPU copy of the geometry and create the vertex and
+	// index buffers for the mesh (skipped if device is nullptr).
+	// Imported meshes also get simplified levels, appended to
+	// the index buffer, and a position stream
+	// --------------------------------------------------------
+	void CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount, ID3D11Device* device, bool imported);
+
+	// --------------------------------------------------------
+	// Simplify the CPU copy of the mesh into lower detail levels
+	// --------------------------------------------------------
+	void GenerateLods();
+
 	// --------------------------------------------------------
-	// Create the vertex and index buffers for the mesh
+	// Weld the CPU copy's positions into the position stream
 	// --------------------------------------------------------
-	void CreateBuffers(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount, ID3D11Device* device);
+	void CreatePositionStream();
 
 	// --------------------------------------------------------
 	// Calculates the tangents of the vertices in a mesh
 	// --------------------------------------------------------
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
+	// --------------------------------------------------------
+	// Calculates the local AABB and bounding sphere of the vertices
+	// --------------------------------------------------------
+	void CalculateBounds(Vertex* verts, int numVerts);
+
 public:
 	// --------------------------------------------------------
 	// Constructor - Set up fields and buffers
@@ -33,13 +93,14 @@ public:
 	// vertexCount - The number of vertices in this mesh
 	// indices - The array of indices this mesh uses
 	// indexCount - The number of indices in this mesh
-	// device - The ID3D11Device for this mesh
+	// device - The ID3D11Device for this mesh, or nullptr for CPU-only geometry
 	// --------------------------------------------------------
 	Mesh(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount, ID3D11Device* device);
 	// --------------------------------------------------------
 	// Constructor - Set up fields and buffers
 	//
 	// filePath	- The path to the mesh file
+	// device - The ID3D11Device for this mesh, or nullptr for CPU-only geometry
 	// --------------------------------------------------------
 	Mesh(const char* objFile, ID3D11Device* device);
 	// --------------------------------------------------------
@@ -62,10 +123,93 @@ public:
 	ID3D11Buffer* GetIndexBuffer();
 
 	// --------------------------------------------------------
-	// Get the number of indicies in this mesh
+	// Check if this mesh has a position stream. Depth only
+	// passes fall back to the full buffers without one
+	// --------------------------------------------------------
+	bool HasPositionStream();
+
+	// --------------------------------------------------------
+	// Get the position only vertex buffer (one XMFLOAT3 per
+	// vertex) and the index buffer that goes with it
+	// --------------------------------------------------------
+	ID3D11Buffer* GetPositionBuffer();
+	ID3D11Buffer* GetPositionIndexBuffer();
+
+	// --------------------------------------------------------
+	// Get the CPU copy of the position stream
+	// --------------------------------------------------------
+	const std::vector<DirectX::XMFLOAT3>& GetPositions();
+	const std::vector<unsigned int>& GetPositionIndices();
+
+	// --------------------------------------------------------
+	// Get the number of indicies in this mesh at full detail
 	// --------------------------------------------------------
 	int GetIndexCount();
 
+	// --------------------------------------------------------
+	// Get the number of detail levels, at least 1
+	// --------------------------------------------------------
+	int GetLodCount();
+
+	// --------------------------------------------------------
+	// Get the range of the index buffer a detail level draws
+	// --------------------------------------------------------
+	unsigned int GetLodStartIndex(int lod);
+	unsigned int GetLodIndexCount(int lod);
+
+	// --------------------------------------------------------
+	// Pick the detail level for an object's size on screen
+	//
+	// screenSize - the object's projected diameter over the
+	//              screen height
+	// currentLod - the level it was drawn at last
+	// --------------------------------------------------------
+	int SelectLod(float screenSize, int currentLod);
+
+	// --------------------------------------------------------
+	// Get the number of vertices in this mesh
+	// --------------------------------------------------------
+	int GetVertexCount();
+
+	// --------------------------------------------------------
+	// Get the CPU copy of this mesh's vertices
+	// --------------------------------------------------------
+	const std::vector<Vertex>& GetVertices();
+
+	// --------------------------------------------------------
+	// Get the CPU copy of this mesh's indices, every detail level
+	// --------------------------------------------------------
+	const std::vector<unsigned int>& GetIndices();
+
+	// --------------------------------------------------------
+	// Get the local space axis aligned bounding box
+	// --------------------------------------------------------
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+
+	// --------------------------------------------------------
+	// Get the local space bounding sphere
+	// --------------------------------------------------------
+	DirectX::XMFLOAT3 GetSphereCenter();
+	float GetSphereRadius();
+
+	// --------------------------------------------------------
+	// Move the bounding sphere into world space. The radius is
+	// scaled by the largest axis scale
+	//
+	// world - the world matrix, transposed for HLSL as entities
+	//         store it
+	// --------------------------------------------------------
+	void GetWorldSphere(const DirectX::XMFLOAT4X4& world, DirectX::XMFLOAT3& center, float& radius);
+
+	// --------------------------------------------------------
+	// Get a sphere's projected diameter over the screen height,
+	// the size SelectLod() takes. 1 if the eye is inside it
+	//
+	// projectionScale - the projection matrix's _22
+	// --------------------------------------------------------
+	static float GetScreenSize(float radius, float distance, float projectionScale);
+
 	// --------------------------------------------------------
 	// Check if this mesh is loaded into memory
 	// --------------------------------------------------------
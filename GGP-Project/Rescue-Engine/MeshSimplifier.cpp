@@ -0,0 +1,402 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+
+//How much more an open edge resists moving than the surface
+#define SIMPLIFY_BOUNDARY_WEIGHT 10.0
+
+//How much more a texture seam resists moving than the surface
+#define SIMPLIFY_SEAM_WEIGHT 10.0
+
+//Collapses that turn a triangle's normal further than this
+//(as a cosine) are rejected
+#define SIMPLIFY_MIN_NORMAL_DOT 0.2f
+
+using namespace DirectX;
+
+// Weld the mesh and set up the quadrics
+MeshSimplifier::MeshSimplifier(const Vertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	this->vertices = vertices;
+	liveTriangles = 0;
+	maxError = 0;
+
+	WeldPositions(vertices, vertexCount, positions, vertexPosition, positionVertices, positionFirstVertex);
+
+	unsigned int positionCount = (unsigned int)positions.size();
+	collapsedTo.resize(positionCount);
+	for (unsigned int i = 0; i < positionCount; i++)
+		collapsedTo[i] = i;
+	stamps.assign(positionCount, 0);
+	Quadric zero = {};
+	quadrics.assign(positionCount, zero);
+	positionTriangles.resize(positionCount);
+
+	//Triangles and their area weighted planes
+	struct Edge
+	{
+		unsigned int a;
+		unsigned int b;
+		unsigned int triangle;
+		unsigned int vertexA;	//The triangle's vertices at a and b
+		unsigned int vertexB;
+	};
+	std::vector<Edge> edges;
+
+	unsigned int triangleCount = indexCount / 3;
+	corners.assign(indices, indices + triangleCount * 3);
+	removed.assign(triangleCount, 0);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		unsigned int p[3];
+		for (int c = 0; c < 3; c++)
+			p[c] = vertexPosition[corners[t * 3 + c]];
+		if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+		{
+			removed[t] = 1;
+			continue;
+		}
+
+		XMVECTOR p0 = XMLoadFloat3(&positions[p[0]]);
+		XMVECTOR cross = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&positions[p[1]]), p0),
+			XMVectorSubtract(XMLoadFloat3(&positions[p[2]]), p0));
+		float length = XMVectorGetX(XMVector3Length(cross));
+		if (length > 0)
+		{
+			XMVECTOR normal = XMVectorScale(cross, 1.0f / length);
+			XMFLOAT4 plane;
+			XMStoreFloat4(&plane, XMVectorSetW(normal, -XMVectorGetX(XMVector3Dot(normal, p0))));
+			for (int c = 0; c < 3; c++)
+				AddPlane(p[c], plane, length * 0.5);
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			positionTriangles[p[c]].push_back(t);
+			int next = (c + 1) % 3;
+			bool flip = p[next] < p[c];
+			Edge edge = { flip ? p[next] : p[c], flip ? p[c] : p[next], t,
+				corners[t * 3 + (flip ? next : c)], corners[t * 3 + (flip ? c : next)] };
+			edges.push_back(edge);
+		}
+		liveTriangles++;
+	}
+
+	//Edges used by one triangle, and edges where the texture
+	//coordinates on either side differ, get a plane through
+	//them at right angles to each of their triangles, so they
+	//only slide along themselves
+	std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b)
+	{
+		return a.a != b.a ? a.a < b.a : a.b < b.b;
+	});
+	size_t groupStart = 0;
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		bool sameAsNext = i + 1 < edges.size() && edges[i + 1].a == edges[i].a && edges[i + 1].b == edges[i].b;
+		if (sameAsNext)
+			continue;
+
+		double weight = 0;
+		if (i == groupStart)
+			weight = SIMPLIFY_BOUNDARY_WEIGHT;
+		else
+		{
+			for (size_t j = groupStart + 1; j <= i; j++)
+			{
+				if (!HasSameUVs(edges[groupStart].vertexA, edges[j].vertexA) || !HasSameUVs(edges[groupStart].vertexB, edges[j].vertexB))
+				{
+					weight = SIMPLIFY_SEAM_WEIGHT;
+					break;
+				}
+			}
+		}
+
+		for (size_t j = groupStart; weight > 0 && j <= i; j++)
+			AddEdgePlane(edges[j].a, edges[j].b, edges[j].triangle, weight);
+		groupStart = i + 1;
+	}
+
+	//Queue every edge once the quadrics are complete
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		if (i == 0 || edges[i - 1].a != edges[i].a || edges[i - 1].b != edges[i].b)
+			PushEdge(edges[i].a, edges[i].b);
+	}
+}
+
+// Weld vertices with the exact same position
+void MeshSimplifier::WeldPositions(const Vertex* vertices, unsigned int vertexCount,
+	std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& vertexPosition,
+	std::vector<unsigned int>& positionVertices, std::vector<unsigned int>& positionFirstVertex)
+{
+	//Sort the vertices by position so equal positions are neighbours
+	positionVertices.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+		positionVertices[i] = i;
+	std::sort(positionVertices.begin(), positionVertices.end(), [vertices](unsigned int a, unsigned int b)
+	{
+		const XMFLOAT3& pa = vertices[a].Position;
+		const XMFLOAT3& pb = vertices[b].Position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	});
+
+	positions.clear();
+	positionFirstVertex.clear();
+	vertexPosition.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		unsigned int v = positionVertices[i];
+		const XMFLOAT3& p = vertices[v].Position;
+		if (positions.empty() || p.x != positions.back().x || p.y != positions.back().y || p.z != positions.back().z)
+		{
+			positions.push_back(p);
+			positionFirstVertex.push_back(i);
+		}
+		vertexPosition[v] = (unsigned int)positions.size() - 1;
+	}
+	positionFirstVertex.push_back(vertexCount);
+}
+
+// Check if two vertices have the same texture coordinates
+bool MeshSimplifier::HasSameUVs(unsigned int a, unsigned int b)
+{
+	return vertices[a].UV.x == vertices[b].UV.x && vertices[a].UV.y == vertices[b].UV.y;
+}
+
+// Add a plane through an edge, at right angles to a triangle, to both its positions
+void MeshSimplifier::AddEdgePlane(unsigned int a, unsigned int b, unsigned int triangle, double weight)
+{
+	const unsigned int* c = &corners[triangle * 3];
+	XMVECTOR p0 = XMLoadFloat3(&vertices[c[0]].Position);
+	XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&vertices[c[1]].Position), p0),
+		XMVectorSubtract(XMLoadFloat3(&vertices[c[2]].Position), p0));
+	XMVECTOR start = XMLoadFloat3(&positions[a]);
+	XMVECTOR direction = XMVectorSubtract(XMLoadFloat3(&positions[b]), start);
+	XMVECTOR side = XMVector3Normalize(XMVector3Cross(direction, normal));
+	XMFLOAT4 plane;
+	XMStoreFloat4(&plane, XMVectorSetW(side, -XMVectorGetX(XMVector3Dot(side, start))));
+	weight *= XMVectorGetX(XMVector3LengthSq(direction));
+	AddPlane(a, plane, weight);
+	AddPlane(b, plane, weight);
+}
+
+// Min heap order for collapses
+bool MeshSimplifier::IsCheaper(const Collapse& a, const Collapse& b)
+{
+	return a.cost > b.cost;
+}
+
+// Find the live position a position was collapsed into
+unsigned int MeshSimplifier::Find(unsigned int position)
+{
+	unsigned int root = position;
+	while (collapsedTo[root] != root)
+		root = collapsedTo[root];
+
+	//Shorten the chain for next time
+	while (collapsedTo[position] != root)
+	{
+		unsigned int next = collapsedTo[position];
+		collapsedTo[position] = root;
+		position = next;
+	}
+	return root;
+}
+
+// Add a plane's quadric to a position
+void MeshSimplifier::AddPlane(unsigned int position, const XMFLOAT4& plane, double weight)
+{
+	double a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+	double* q = quadrics[position].q;
+	q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+	q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+	q[7] += weight * c * c; q[8] += weight * c * d;
+	q[9] += weight * d * d;
+}
+
+// Get the error of the combined quadrics of two positions at the second position
+double MeshSimplifier::GetCost(unsigned int from, unsigned int to)
+{
+	const double* a = quadrics[from].q;
+	const double* b = quadrics[to].q;
+	double q[10];
+	for (int i = 0; i < 10; i++)
+		q[i] = a[i] + b[i];
+
+	double x = positions[to].x, y = positions[to].y, z = positions[to].z;
+	double error = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+		q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+		q[7] * z * z + 2 * q[8] * z + q[9];
+	return (std::max)(error, 0.0);
+}
+
+// Check that moving a position onto another flips none of the triangles that stay
+bool MeshSimplifier::IsCollapseValid(unsigned int from, unsigned int to)
+{
+	XMVECTOR target = XMLoadFloat3(&positions[to]);
+	for (unsigned int t : positionTriangles[from])
+	{
+		if (removed[t])
+			continue;
+
+		unsigned int p[3];
+		for (int c = 0; c < 3; c++)
+			p[c] = Find(vertexPosition[corners[t * 3 + c]]);
+		if (p[0] == to || p[1] == to || p[2] == to)
+			continue;
+
+		XMVECTOR before[3];
+		XMVECTOR after[3];
+		for (int c = 0; c < 3; c++)
+		{
+			before[c] = XMLoadFloat3(&positions[p[c]]);
+			after[c] = p[c] == from ? target : before[c];
+		}
+		XMVECTOR oldNormal = XMVector3Cross(XMVectorSubtract(before[1], before[0]), XMVectorSubtract(before[2], before[0]));
+		XMVECTOR newNormal = XMVector3Cross(XMVectorSubtract(after[1], after[0]), XMVectorSubtract(after[2], after[0]));
+		float dot = XMVectorGetX(XMVector3Dot(oldNormal, newNormal));
+		float lengths = XMVectorGetX(XMVector3Length(oldNormal)) * XMVectorGetX(XMVector3Length(newNormal));
+		if (lengths <= 0 || dot < SIMPLIFY_MIN_NORMAL_DOT * lengths)
+			return false;
+	}
+	return true;
+}
+
+// Queue both directions of the edge between two positions
+void MeshSimplifier::PushEdge(unsigned int a, unsigned int b)
+{
+	Collapse collapse = { GetCost(a, b), a, b, stamps[a], stamps[b] };
+	heap.push_back(collapse);
+	std::push_heap(heap.begin(), heap.end(), IsCheaper);
+
+	collapse = { GetCost(b, a), b, a, stamps[b], stamps[a] };
+	heap.push_back(collapse);
+	std::push_heap(heap.begin(), heap.end(), IsCheaper);
+}
+
+// Queue every edge of a position's live triangles
+void MeshSimplifier::PushEdges(unsigned int position)
+{
+	for (unsigned int t : positionTriangles[position])
+	{
+		if (removed[t])
+			continue;
+
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int other = Find(vertexPosition[corners[t * 3 + c]]);
+			if (other != position)
+				PushEdge(position, other);
+		}
+	}
+}
+
+// Move a position onto another and remove the triangles that become degenerate
+void MeshSimplifier::ApplyCollapse(unsigned int from, unsigned int to)
+{
+	collapsedTo[from] = to;
+	for (int i = 0; i < 10; i++)
+		quadrics[to].q[i] += quadrics[from].q[i];
+	stamps[from]++;
+	stamps[to]++;
+
+	std::vector<unsigned int>& fromTriangles = positionTriangles[from];
+	std::vector<unsigned int>& toTriangles = positionTriangles[to];
+	for (unsigned int t : fromTriangles)
+	{
+		if (removed[t])
+			continue;
+
+		unsigned int p[3];
+		for (int c = 0; c < 3; c++)
+			p[c] = Find(vertexPosition[corners[t * 3 + c]]);
+		if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+		{
+			removed[t] = 1;
+			liveTriangles--;
+		}
+		else
+		{
+			toTriangles.push_back(t);
+		}
+	}
+	std::vector<unsigned int>().swap(fromTriangles);
+	toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+		[this](unsigned int t) { return removed[t] != 0; }), toTriangles.end());
+
+	PushEdges(to);
+}
+
+// Get the vertex a corner uses now
+unsigned int MeshSimplifier::GetCornerVertex(unsigned int vertex)
+{
+	unsigned int position = vertexPosition[vertex];
+	unsigned int current = Find(position);
+	if (current == position)
+		return vertex;
+
+	//Take the vertex at the new position that is shaded most alike,
+	//and of those the one nearest in texture space, so corners on
+	//either side of a seam keep to their own side
+	XMVECTOR normal = XMLoadFloat3(&vertices[vertex].Normal);
+	XMVECTOR uv = XMLoadFloat2(&vertices[vertex].UV);
+	unsigned int best = positionVertices[positionFirstVertex[current]];
+	float bestDot = -2;
+	float bestDistance = 0;
+	for (unsigned int i = positionFirstVertex[current]; i < positionFirstVertex[current + 1]; i++)
+	{
+		unsigned int candidate = positionVertices[i];
+		float dot = XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&vertices[candidate].Normal)));
+		float distance = XMVectorGetX(XMVector2LengthSq(XMVectorSubtract(uv, XMLoadFloat2(&vertices[candidate].UV))));
+		if (dot > bestDot + 1e-3f || (dot > bestDot - 1e-3f && distance < bestDistance))
+		{
+			bestDot = (std::max)(dot, bestDot);
+			bestDistance = distance;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+// Collapse edges down to a triangle count and append what is left
+unsigned int MeshSimplifier::Simplify(unsigned int targetTriangles, std::vector<unsigned int>& outIndices)
+{
+	while (liveTriangles > targetTriangles && !heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), IsCheaper);
+		Collapse collapse = heap.back();
+		heap.pop_back();
+
+		//Skip collapses of positions that have changed since they were queued
+		if (collapsedTo[collapse.from] != collapse.from || collapsedTo[collapse.to] != collapse.to ||
+			stamps[collapse.from] != collapse.fromStamp || stamps[collapse.to] != collapse.toStamp)
+			continue;
+
+		if (!IsCollapseValid(collapse.from, collapse.to))
+			continue;
+
+		maxError = (std::max)(maxError, collapse.cost);
+		ApplyCollapse(collapse.from, collapse.to);
+	}
+
+	unsigned int count = 0;
+	for (size_t t = 0; t < removed.size(); t++)
+	{
+		if (removed[t])
+			continue;
+
+		for (int c = 0; c < 3; c++)
+			outIndices.push_back(GetCornerVertex(corners[t * 3 + c]));
+		count++;
+	}
+	return count;
+}
+
+// Get the largest collapse error so far
+double MeshSimplifier::GetError()
+{
+	return maxError;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Quadric error edge collapse simplification
+//
+// Vertices are welded by position so that faceted meshes,
+// which split every corner, still collapse as one surface.
+// Each collapse moves one position onto a neighbour (a half
+// edge collapse), so every level indexes the original vertex
+// buffer: a corner keeps its own vertex while its position
+// survives, and otherwise takes the vertex at the new
+// position with the closest normal. Collapses that would
+// flip a triangle are rejected, and open edges and texture
+// seams get extra planes so holes, outlines and UV islands
+// keep their shape.
+//
+// Simplify() is progressive, so levels are asked for from
+// most to fewest triangles.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+private:
+	// --------------------------------------------------------
+	// Symmetric 4x4 error quadric, upper triangle only
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double q[10];
+	};
+
+	// --------------------------------------------------------
+	// A candidate collapse of position from onto position to
+	// --------------------------------------------------------
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int fromStamp;
+		unsigned int toStamp;
+	};
+
+	const Vertex* vertices;
+
+	//Welded positions
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> vertexPosition;		//Position of each vertex
+	std::vector<unsigned int> positionVertices;		//Vertices of each position, grouped
+	std::vector<unsigned int> positionFirstVertex;	//Start of each group, one past the end last
+	std::vector<unsigned int> collapsedTo;			//Position a position was moved onto, itself if alive
+	std::vector<unsigned int> stamps;				//Bumped whenever a position's quadric changes
+	std::vector<Quadric> quadrics;
+
+	//Triangles, as the original vertex of each corner
+	std::vector<unsigned int> corners;
+	std::vector<unsigned char> removed;
+	std::vector<std::vector<unsigned int>> positionTriangles;
+	unsigned int liveTriangles;
+
+	std::vector<Collapse> heap;
+	double maxError;
+
+	// --------------------------------------------------------
+	// Order for the collapse heap, cheapest on top
+	// --------------------------------------------------------
+	static bool IsCheaper(const Collapse& a, const Collapse& b);
+
+	// --------------------------------------------------------
+	// Find the live position a position was collapsed into
+	// --------------------------------------------------------
+	unsigned int Find(unsigned int position);
+
+	// --------------------------------------------------------
+	// Add a plane's quadric to a position
+	// --------------------------------------------------------
+	void AddPlane(unsigned int position, const DirectX::XMFLOAT4& plane, double weight);
+
+	// --------------------------------------------------------
+	// Check if two vertices have the same texture coordinates
+	// --------------------------------------------------------
+	bool HasSameUVs(unsigned int a, unsigned int b);
+
+	// --------------------------------------------------------
+	// Add a plane through the edge between two positions, at
+	// right angles to a triangle on it, to both positions
+	// --------------------------------------------------------
+	void AddEdgePlane(unsigned int a, unsigned int b, unsigned int triangle, double weight);
+
+	// --------------------------------------------------------
+	// Get the error of the combined quadrics of two positions
+	// at the second position
+	// --------------------------------------------------------
+	double GetCost(unsigned int from, unsigned int to);
+
+	// --------------------------------------------------------
+	// Check that moving a position onto another flips none of
+	// the triangles that stay
+	// --------------------------------------------------------
+	bool IsCollapseValid(unsigned int from, unsigned int to);
+
+	// --------------------------------------------------------
+	// Queue both directions of the edge between two positions
+	// --------------------------------------------------------
+	void PushEdge(unsigned int a, unsigned int b);
+
+	// --------------------------------------------------------
+	// Queue every edge of a position's live triangles
+	// --------------------------------------------------------
+	void PushEdges(unsigned int position);
+
+	// --------------------------------------------------------
+	// Move a position onto another and remove the triangles
+	// that become degenerate
+	// --------------------------------------------------------
+	void ApplyCollapse(unsigned int from, unsigned int to);
+
+	// --------------------------------------------------------
+	// Get the vertex a corner uses now
+	// --------------------------------------------------------
+	unsigned int GetCornerVertex(unsigned int vertex);
+
+public:
+	// --------------------------------------------------------
+	// Weld the mesh and set up the quadrics. Both arrays must
+	// outlive the simplifier
+	//
+	// vertices - the mesh's vertices
+	// vertexCount - the number of vertices
+	// indices - the mesh's triangle list
+	// indexCount - the number of indices
+	// --------------------------------------------------------
+	MeshSimplifier(const Vertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+
+	// --------------------------------------------------------
+	// Collapse edges until a number of triangles are left or
+	// nothing more can be collapsed, then append the triangles
+	// that are left
+	//
+	// targetTriangles - the triangle count to stop at
+	// outIndices - the triangle list is appended to this
+	// Returns the number of triangles appended
+	// --------------------------------------------------------
+	unsigned int Simplify(unsigned int targetTriangles, std::vector<unsigned int>& outIndices);
+
+	// --------------------------------------------------------
+	// Get the largest collapse error so far, in squared
+	// distance units
+	// --------------------------------------------------------
+	double GetError();
+
+	// --------------------------------------------------------
+	// Weld vertices with the exact same position
+	//
+	// vertices - the vertices to weld
+	// vertexCount - the number of vertices
+	// positions - filled with each distinct position
+	// vertexPosition - filled with the position of each vertex
+	// positionVertices - filled with the vertices of each
+	//                    position, grouped in position order
+	// positionFirstVertex - filled with the start of each
+	//                       group, one past the end last
+	// --------------------------------------------------------
+	static void WeldPositions(const Vertex* vertices, unsigned int vertexCount,
+		std::vector<DirectX::XMFLOAT3>& positions, std::vector<unsigned int>& vertexPosition,
+		std::vector<unsigned int>& positionVertices, std::vector<unsigned int>& positionFirstVertex);
+};
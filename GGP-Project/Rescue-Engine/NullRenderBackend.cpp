@@ -0,0 +1,231 @@
+#include "NullRenderBackend.h"
+#include <stdio.h>
+#include <cstring>
+
+// Construct a backend with nothing bound or counted
+NullRenderBackend::NullRenderBackend()
+{
+	Reset();
+}
+
+// Forget bindings and counts
+void NullRenderBackend::Reset()
+{
+	pipelineBound = false;
+	vertexShaderBound = false;
+	vertexBufferBound = false;
+	indexBufferBound = false;
+
+	pipeline = {};
+	memset(vertexBuffers, 0, sizeof(vertexBuffers));
+	memset(vertexStrides, 0, sizeof(vertexStrides));
+	memset(vertexOffsets, 0, sizeof(vertexOffsets));
+	indexBuffer = nullptr;
+	indexOffset = 0;
+	memset(constantBuffers, 0, sizeof(constantBuffers));
+	memset(resources, 0, sizeof(resources));
+	memset(samplers, 0, sizeof(samplers));
+
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+	{
+		commandCounts[i] = 0;
+		redundantCounts[i] = 0;
+	}
+	primitiveVertices = 0;
+	constantBytes = 0;
+	errorCount = 0;
+}
+
+// Record a validation error
+void NullRenderBackend::Error(const char* message, size_t commandIndex)
+{
+	if (errorCount < NULL_BACKEND_PRINTED_ERRORS)
+		printf("Render command %u: %s\n", (unsigned int)commandIndex, message);
+	errorCount++;
+}
+
+// Check that a draw has a pipeline and its buffers bound
+void NullRenderBackend::ValidateDraw(bool indexed, size_t commandIndex)
+{
+	if (!pipelineBound)
+		Error("draw without a pipeline", commandIndex);
+	else if (!vertexShaderBound)
+		Error("draw without a vertex shader", commandIndex);
+
+	if (indexed && !vertexBufferBound)
+		Error("indexed draw without a vertex buffer", commandIndex);
+	if (indexed && !indexBufferBound)
+		Error("indexed draw without an index buffer", commandIndex);
+}
+
+// Bind an object to a slot, returning false if it was already there
+bool NullRenderBackend::Bind(const void*& slot, const void* object)
+{
+	if (slot == object)
+		return false;
+	slot = object;
+	return true;
+}
+
+// Check and count every command in a list
+void NullRenderBackend::Execute(const RenderCommandList& list)
+{
+	const std::vector<RenderCommand>& commands = list.GetCommands();
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const RenderCommand& command = commands[i];
+		if ((int)command.type >= (int)RenderCommandType::Count)
+		{
+			Error("unknown command", i);
+			continue;
+		}
+		commandCounts[(int)command.type]++;
+		int stage = command.stage == RenderStage::Vertex ? 0 : 1;
+
+		switch (command.type)
+		{
+		case RenderCommandType::BindPipeline:
+		{
+			const RenderPipeline& bound = list.GetPipeline(command);
+			if (pipelineBound && memcmp(&bound, &pipeline, sizeof(RenderPipeline)) == 0)
+				redundantCounts[(int)command.type]++;
+			pipeline = bound;
+			pipelineBound = true;
+			vertexShaderBound = bound.vertexShader != nullptr;
+			break;
+		}
+
+		case RenderCommandType::BindVertexBuffer:
+			if (command.object != nullptr && command.args[0] == 0)
+				Error("vertex buffer without a stride", i);
+			if (command.slot >= RENDER_COMMAND_VERTEX_SLOTS)
+			{
+				Error("vertex buffer slot out of range", i);
+				break;
+			}
+			if (vertexBuffers[command.slot] == command.object &&
+				vertexStrides[command.slot] == command.args[0] && vertexOffsets[command.slot] == command.args[1])
+				redundantCounts[(int)command.type]++;
+			vertexBuffers[command.slot] = command.object;
+			vertexStrides[command.slot] = command.args[0];
+			vertexOffsets[command.slot] = command.args[1];
+			if (command.slot == 0)
+				vertexBufferBound = command.object != nullptr;
+			break;
+
+		case RenderCommandType::BindIndexBuffer:
+			if (indexBuffer == command.object && indexOffset == command.args[0])
+				redundantCounts[(int)command.type]++;
+			indexBuffer = command.object;
+			indexOffset = command.args[0];
+			indexBufferBound = command.object != nullptr;
+			break;
+
+		case RenderCommandType::BindConstantBuffer:
+			if (command.slot >= RENDER_COMMAND_CONSTANT_SLOTS)
+				Error("constant buffer slot out of range", i);
+			else if (!Bind(constantBuffers[stage][command.slot], command.object))
+				redundantCounts[(int)command.type]++;
+			break;
+
+		case RenderCommandType::BindResource:
+			if (command.slot >= RENDER_COMMAND_RESOURCE_SLOTS)
+				Error("resource slot out of range", i);
+			else if (!Bind(resources[stage][command.slot], command.object))
+				redundantCounts[(int)command.type]++;
+			break;
+
+		case RenderCommandType::BindSampler:
+			if (command.slot >= RENDER_COMMAND_SAMPLER_SLOTS)
+				Error("sampler slot out of range", i);
+			else if (!Bind(samplers[stage][command.slot], command.object))
+				redundantCounts[(int)command.type]++;
+			break;
+
+		case RenderCommandType::SetConstants:
+			//Constant buffers are sized in 16 byte registers
+			if (command.object == nullptr)
+				Error("constants for a null buffer", i);
+			else if (command.args[1] == 0 || command.args[1] % 16 != 0)
+				Error("constants are not a whole number of registers", i);
+			constantBytes += command.args[1];
+			break;
+
+		case RenderCommandType::Draw:
+			ValidateDraw(false, i);
+			primitiveVertices += command.args[0];
+			break;
+
+		case RenderCommandType::DrawIndexed:
+			ValidateDraw(true, i);
+			primitiveVertices += command.args[0];
+			break;
+
+		case RenderCommandType::DrawIndexedInstanced:
+			ValidateDraw(true, i);
+			if (command.args[3] == 0)
+				Error("instanced draw without instances", i);
+			primitiveVertices += (unsigned long long)command.args[0] * command.args[3];
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// Get how many commands of a type were executed
+unsigned long long NullRenderBackend::GetCommandCount(RenderCommandType type)
+{
+	return commandCounts[(int)type];
+}
+
+// Get how many commands of any type were executed
+unsigned long long NullRenderBackend::GetCommandCount()
+{
+	unsigned long long total = 0;
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+		total += commandCounts[i];
+	return total;
+}
+
+// Get how many binds of a type changed nothing
+unsigned long long NullRenderBackend::GetRedundantCount(RenderCommandType type)
+{
+	return redundantCounts[(int)type];
+}
+
+// Get how many binds of any type changed nothing
+unsigned long long NullRenderBackend::GetRedundantCount()
+{
+	unsigned long long total = 0;
+	for (int i = 0; i < (int)RenderCommandType::Count; i++)
+		total += redundantCounts[i];
+	return total;
+}
+
+// Get how many draw commands of any kind were executed
+unsigned long long NullRenderBackend::GetDrawCount()
+{
+	return commandCounts[(int)RenderCommandType::Draw] +
+		commandCounts[(int)RenderCommandType::DrawIndexed] +
+		commandCounts[(int)RenderCommandType::DrawIndexedInstanced];
+}
+
+// Get the vertices (or indices) draws would have processed
+unsigned long long NullRenderBackend::GetPrimitiveVertexCount()
+{
+	return primitiveVertices;
+}
+
+// Get the bytes of constants that would have been uploaded
+unsigned long long NullRenderBackend::GetConstantBytes()
+{
+	return constantBytes;
+}
+
+// Get how many commands failed validation
+unsigned int NullRenderBackend::GetErrorCount()
+{
+	return errorCount;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include "RenderCommandList.h"
+
+//Validation errors printed before the rest are only counted
+#define NULL_BACKEND_PRINTED_ERRORS 8
+
+// --------------------------------------------------------
+// A RenderBackend without a device
+//
+// Checks that every command is well formed and every draw
+// has what it needs bound, and counts what would have been
+// submitted, including binds of what was already bound. Needs no graphics API, so the cost of recording
+// can be measured anywhere, including the headless build.
+// --------------------------------------------------------
+class NullRenderBackend : public RenderBackend
+{
+private:
+	//What is bound, as far as validation cares
+	bool pipelineBound;
+	bool vertexShaderBound;
+	bool vertexBufferBound;
+	bool indexBufferBound;
+
+	//Everything bound, to spot redundant binds
+	RenderPipeline pipeline;
+	const void* vertexBuffers[RENDER_COMMAND_VERTEX_SLOTS];
+	unsigned int vertexStrides[RENDER_COMMAND_VERTEX_SLOTS];
+	unsigned int vertexOffsets[RENDER_COMMAND_VERTEX_SLOTS];
+	const void* indexBuffer;
+	unsigned int indexOffset;
+	const void* constantBuffers[2][RENDER_COMMAND_CONSTANT_SLOTS];
+	const void* resources[2][RENDER_COMMAND_RESOURCE_SLOTS];
+	const void* samplers[2][RENDER_COMMAND_SAMPLER_SLOTS];
+
+	unsigned long long commandCounts[(int)RenderCommandType::Count];
+	unsigned long long redundantCounts[(int)RenderCommandType::Count];
+	unsigned long long primitiveVertices; //Vertices or indices drawn, times instances
+	unsigned long long constantBytes;
+	unsigned int errorCount;
+
+	// --------------------------------------------------------
+	// Record a validation error
+	// --------------------------------------------------------
+	void Error(const char* message, size_t commandIndex);
+
+	// --------------------------------------------------------
+	// Check that a draw has a pipeline and its buffers bound
+	// --------------------------------------------------------
+	void ValidateDraw(bool indexed, size_t commandIndex);
+
+	// --------------------------------------------------------
+	// Bind an object to a slot, returning false if it was
+	// already there
+	// --------------------------------------------------------
+	bool Bind(const void*& slot, const void* object);
+
+public:
+	// --------------------------------------------------------
+	// Construct a backend with nothing bound or counted
+	// --------------------------------------------------------
+	NullRenderBackend();
+
+	// --------------------------------------------------------
+	// Check and count every command in a list
+	// --------------------------------------------------------
+	void Execute(const RenderCommandList& list);
+
+	// --------------------------------------------------------
+	// Forget bindings and counts
+	// --------------------------------------------------------
+	void Reset();
+
+	// --------------------------------------------------------
+	// Get how many commands of a type were executed
+	// --------------------------------------------------------
+	unsigned long long GetCommandCount(RenderCommandType type);
+
+	// --------------------------------------------------------
+	// Get how many commands of any type were executed
+	// --------------------------------------------------------
+	unsigned long long GetCommandCount();
+
+	// --------------------------------------------------------
+	// Get how many binds of a type changed nothing
+	// --------------------------------------------------------
+	unsigned long long GetRedundantCount(RenderCommandType type);
+
+	// --------------------------------------------------------
+	// Get how many binds of any type changed nothing
+	// --------------------------------------------------------
+	unsigned long long GetRedundantCount();
+
+	// --------------------------------------------------------
+	// Get how many draw commands of any kind were executed
+	// --------------------------------------------------------
+	unsigned long long GetDrawCount();
+
+	// --------------------------------------------------------
+	// Get the vertices (or indices) draws would have processed
+	// --------------------------------------------------------
+	unsigned long long GetPrimitiveVertexCount();
+
+	// --------------------------------------------------------
+	// Get the bytes of constants that would have been uploaded
+	// --------------------------------------------------------
+	unsigned long long GetConstantBytes();
+
+	// --------------------------------------------------------
+	// Get how many commands failed validation
+	// --------------------------------------------------------
+	unsigned int GetErrorCount();
+};
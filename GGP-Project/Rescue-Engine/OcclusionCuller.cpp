@@ -0,0 +1,353 @@
+#include "OcclusionCuller.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+static const int tilesX = OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE;
+static const int tilesY = (OCCLUSION_HEIGHT + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+static const int blocksX = OCCLUSION_WIDTH / OCCLUSION_BLOCK_SIZE;
+static const int blocksY = OCCLUSION_HEIGHT / OCCLUSION_BLOCK_SIZE;
+
+// Construct a culler with an empty depth buffer
+OcclusionCuller::OcclusionCuller()
+{
+	depth.assign(OCCLUSION_WIDTH * OCCLUSION_HEIGHT, 1.0f);
+	blockDepth.assign(blocksX * blocksY, 1.0f);
+	tileBins.resize(tilesX * tilesY);
+	threadCount = 1;
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+
+	occluderTriangles = 0;
+	testedCount = 0;
+	occludedCount = 0;
+}
+
+// Set how many threads rasterize occluders
+void OcclusionCuller::Init(int threads)
+{
+	threadCount = threads > 0 ? threads : WorkerPool::GetInstance()->GetThreadCount();
+	if (threadCount > OCCLUSION_MAX_THREADS)
+		threadCount = OCCLUSION_MAX_THREADS;
+	if (threadCount < 1)
+		threadCount = 1;
+}
+
+// Clear the depth buffer and set the camera for the frame
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMMATRIX v = XMMatrixTranspose(XMLoadFloat4x4(&view));
+	XMMATRIX p = XMMatrixTranspose(XMLoadFloat4x4(&projection));
+	XMStoreFloat4x4(&viewProjection, v * p);
+
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(blockDepth.begin(), blockDepth.end(), 1.0f);
+	triangles.clear();
+	for (std::vector<unsigned int>& bin : tileBins)
+		bin.clear();
+
+	occluderTriangles = 0;
+	testedCount = 0;
+	occludedCount = 0;
+}
+
+// Transform and bin an occluder's triangles
+void OcclusionCuller::AddOccluder(Mesh* mesh, const XMFLOAT4X4& world, const std::vector<unsigned int>* runs)
+{
+	const std::vector<Vertex>& vertices = mesh->GetVertices();
+	const std::vector<XMFLOAT3>& positions = mesh->GetPositions();
+	XMMATRIX worldViewProj = XMMatrixTranspose(XMLoadFloat4x4(&world)) * XMLoadFloat4x4(&viewProjection);
+
+	//The welded position stream has the same triangles with fewer vertices to transform
+	bool welded = !positions.empty();
+	const std::vector<unsigned int>& indices = welded ? mesh->GetPositionIndices() : mesh->GetIndices();
+	size_t vertexCount = welded ? positions.size() : vertices.size();
+
+	clipPositions.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR position = XMVectorSetW(XMLoadFloat3(welded ? &positions[i] : &vertices[i].Position), 1.0f);
+		XMStoreFloat4(&clipPositions[i], XMVector4Transform(position, worldViewProj));
+	}
+
+	//Occluders are drawn at full detail, simpler levels could let things show through
+	if (runs == nullptr)
+	{
+		size_t indexCount = (size_t)mesh->GetIndexCount();
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+			ClipTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+		return;
+	}
+
+	//The welded indices share the full indices' layout, so runs index both
+	for (size_t r = 0; r + 1 < runs->size(); r += 2)
+	{
+		size_t end = (size_t)(*runs)[r] + (*runs)[r + 1];
+		for (size_t i = (*runs)[r]; i + 2 < end; i += 3)
+			ClipTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+	}
+}
+
+// Clip a triangle against the near plane and bin the result
+void OcclusionCuller::ClipTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2)
+{
+	const XMFLOAT4* in[3] = { &v0, &v1, &v2 };
+	int behind = (v0.z < 0) + (v1.z < 0) + (v2.z < 0);
+	if (behind == 3)
+		return;
+	if (behind == 0)
+	{
+		BinTriangle(v0, v1, v2);
+		return;
+	}
+
+	//Keep the part where z >= 0, at most a quad
+	XMFLOAT4 out[4];
+	int outCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& a = *in[i];
+		const XMFLOAT4& b = *in[(i + 1) % 3];
+		if (a.z >= 0)
+			out[outCount++] = a;
+		if ((a.z >= 0) != (b.z >= 0))
+			XMStoreFloat4(&out[outCount++], XMVectorLerp(XMLoadFloat4(&a), XMLoadFloat4(&b), a.z / (a.z - b.z)));
+	}
+
+	BinTriangle(out[0], out[1], out[2]);
+	if (outCount == 4)
+		BinTriangle(out[0], out[2], out[3]);
+}
+
+// Set up a triangle and add it to the bins of the tiles it covers
+void OcclusionCuller::BinTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2)
+{
+	const XMFLOAT4* corners[3] = { &v0, &v1, &v2 };
+	float x[3];
+	float y[3];
+	OccluderTriangle triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		if (corners[i]->w <= 1e-6f)
+			return;
+		float invW = 1.0f / corners[i]->w;
+		x[i] = (corners[i]->x * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		y[i] = (0.5f - corners[i]->y * invW * 0.5f) * OCCLUSION_HEIGHT;
+		triangle.depth[i] = corners[i]->z * invW;
+	}
+
+	//Clockwise on screen faces the camera, like D3D's default
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0)
+		return;
+
+	triangle.minX = std::max((int)floorf(std::min(x[0], std::min(x[1], x[2]))), 0);
+	triangle.minY = std::max((int)floorf(std::min(y[0], std::min(y[1], y[2]))), 0);
+	triangle.maxX = std::min((int)ceilf(std::max(x[0], std::max(x[1], x[2]))), OCCLUSION_WIDTH - 1);
+	triangle.maxY = std::min((int)ceilf(std::max(y[0], std::max(y[1], y[2]))), OCCLUSION_HEIGHT - 1);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	//Edge i is opposite corner i, so it weighs that corner
+	for (int i = 0; i < 3; i++)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		triangle.edgeA[i] = y[a] - y[b];
+		triangle.edgeB[i] = x[b] - x[a];
+		triangle.edgeC[i] = -(triangle.edgeB[i] * y[a] + triangle.edgeA[i] * x[a]);
+		triangle.topLeft[i] = (y[a] == y[b] && x[b] > x[a]) || y[b] < y[a];
+	}
+	triangle.invArea = 1.0f / area;
+
+	unsigned int index = (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+	occluderTriangles++;
+	for (int ty = triangle.minY / OCCLUSION_TILE_SIZE; ty <= triangle.maxY / OCCLUSION_TILE_SIZE; ty++)
+	{
+		for (int tx = triangle.minX / OCCLUSION_TILE_SIZE; tx <= triangle.maxX / OCCLUSION_TILE_SIZE; tx++)
+			tileBins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+// Rasterize a tile's triangles and update its blocks
+void OcclusionCuller::RasterizeTile(int tile)
+{
+	int tileX = (tile % tilesX) * OCCLUSION_TILE_SIZE;
+	int tileY = (tile / tilesX) * OCCLUSION_TILE_SIZE;
+	int tileMaxX = tileX + OCCLUSION_TILE_SIZE - 1;
+	int tileMaxY = std::min(tileY + OCCLUSION_TILE_SIZE, OCCLUSION_HEIGHT) - 1;
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (unsigned int index : tileBins[tile])
+	{
+		const OccluderTriangle& t = triangles[index];
+		int minX = std::max(t.minX, tileX) & ~3;
+		int maxX = std::min(t.maxX, tileMaxX);
+		int minY = std::max(t.minY, tileY);
+		int maxY = std::min(t.maxY, tileMaxY);
+
+		XMVECTOR invArea = XMVectorReplicate(t.invArea);
+		XMVECTOR depth0 = XMVectorReplicate(t.depth[0]);
+		XMVECTOR depthStep1 = XMVectorReplicate(t.depth[1] - t.depth[0]);
+		XMVECTOR depthStep2 = XMVectorReplicate(t.depth[2] - t.depth[0]);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				XMVECTOR weights[3];
+				XMVECTOR mask = XMVectorTrueInt();
+				for (int e = 0; e < 3; e++)
+				{
+					weights[e] = XMVectorMultiplyAdd(XMVectorReplicate(t.edgeA[e]), px, XMVectorReplicate(t.edgeB[e] * py + t.edgeC[e]));
+					XMVECTOR inside = t.topLeft[e] ? XMVectorGreaterOrEqual(weights[e], XMVectorZero()) : XMVectorGreater(weights[e], XMVectorZero());
+					mask = XMVectorAndInt(mask, inside);
+				}
+				if (XMVector4EqualInt(mask, XMVectorFalseInt()))
+					continue;
+
+				//Keep the nearest depth
+				float* row = &depth[y * OCCLUSION_WIDTH + x];
+				XMVECTOR z = XMVectorMultiplyAdd(depthStep2, XMVectorMultiply(weights[2], invArea),
+					XMVectorMultiplyAdd(depthStep1, XMVectorMultiply(weights[1], invArea), depth0));
+				XMVECTOR stored = XMLoadFloat4((const XMFLOAT4*)row);
+				mask = XMVectorAndInt(mask, XMVectorLess(z, stored));
+				XMStoreFloat4((XMFLOAT4*)row, XMVectorSelect(stored, z, mask));
+			}
+		}
+	}
+
+	//Farthest depth of each block in the tile
+	for (int by = tileY; by <= tileMaxY; by += OCCLUSION_BLOCK_SIZE)
+	{
+		for (int bx = tileX; bx <= tileMaxX; bx += OCCLUSION_BLOCK_SIZE)
+		{
+			XMVECTOR farthest = XMVectorZero();
+			for (int y = by; y < by + OCCLUSION_BLOCK_SIZE; y++)
+			{
+				for (int x = bx; x < bx + OCCLUSION_BLOCK_SIZE; x += 4)
+					farthest = XMVectorMax(farthest, XMLoadFloat4((const XMFLOAT4*)&depth[y * OCCLUSION_WIDTH + x]));
+			}
+			float lanes[4];
+			XMStoreFloat4((XMFLOAT4*)lanes, farthest);
+			blockDepth[(by / OCCLUSION_BLOCK_SIZE) * blocksX + bx / OCCLUSION_BLOCK_SIZE] =
+				std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+		}
+	}
+}
+
+// Rasterize every occluder added since BeginFrame()
+void OcclusionCuller::Rasterize()
+{
+	if (triangles.empty())
+		return;
+
+	//Pool threads take tiles until there are none left
+	WorkerPool::GetInstance()->ParallelFor(tilesX * tilesY, threadCount,
+		[this](int tile, int) { RasterizeTile(tile); });
+}
+
+// Check if any part of a box could be seen past the occluders
+bool OcclusionCuller::IsVisible(XMFLOAT3 boundsMin, XMFLOAT3 boundsMax, const XMFLOAT4X4& world)
+{
+	testedCount++;
+	if (triangles.empty())
+		return true;
+
+	//Screen rectangle and nearest depth of the box's corners
+	XMMATRIX worldViewProj = XMMatrixTranspose(XMLoadFloat4x4(&world)) * XMLoadFloat4x4(&viewProjection);
+	float minX = (float)OCCLUSION_WIDTH;
+	float minY = (float)OCCLUSION_HEIGHT;
+	float maxX = 0;
+	float maxY = 0;
+	float nearest = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, worldViewProj));
+
+		//Crossing the near plane, assume it can be seen
+		if (clip.z < 0 || clip.w <= 1e-6f)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		float y = (0.5f - clip.y * invW * 0.5f) * OCCLUSION_HEIGHT;
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip.z * invW);
+	}
+
+	//Every pixel the box touches
+	int x0 = std::max((int)floorf(minX), 0);
+	int y0 = std::max((int)floorf(minY), 0);
+	int x1 = std::min((int)floorf(maxX), OCCLUSION_WIDTH - 1);
+	int y1 = std::min((int)floorf(maxY), OCCLUSION_HEIGHT - 1);
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	XMVECTOR boxDepth = XMVectorReplicate(nearest);
+	XMVECTOR first = XMVectorReplicate((float)x0);
+	XMVECTOR last = XMVectorReplicate((float)x1);
+	const XMVECTOR lanes = XMVectorSet(0, 1, 2, 3);
+
+	for (int by = y0 / OCCLUSION_BLOCK_SIZE; by <= y1 / OCCLUSION_BLOCK_SIZE; by++)
+	{
+		for (int bx = x0 / OCCLUSION_BLOCK_SIZE; bx <= x1 / OCCLUSION_BLOCK_SIZE; bx++)
+		{
+			//Everything in the block is nearer than the box
+			if (blockDepth[by * blocksX + bx] < nearest)
+				continue;
+
+			//Otherwise look for a pixel the box is in front of
+			int startY = std::max(by * OCCLUSION_BLOCK_SIZE, y0);
+			int endY = std::min(by * OCCLUSION_BLOCK_SIZE + OCCLUSION_BLOCK_SIZE - 1, y1);
+			int startX = std::max(bx * OCCLUSION_BLOCK_SIZE, x0) & ~3;
+			int endX = std::min(bx * OCCLUSION_BLOCK_SIZE + OCCLUSION_BLOCK_SIZE - 1, x1);
+			for (int y = startY; y <= endY; y++)
+			{
+				for (int x = startX; x <= endX; x += 4)
+				{
+					XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), lanes);
+					XMVECTOR inRect = XMVectorAndInt(XMVectorGreaterOrEqual(px, first), XMVectorLessOrEqual(px, last));
+					XMVECTOR stored = XMLoadFloat4((const XMFLOAT4*)&depth[y * OCCLUSION_WIDTH + x]);
+					XMVECTOR seen = XMVectorAndInt(inRect, XMVectorGreaterOrEqual(stored, boxDepth));
+					if (!XMVector4EqualInt(seen, XMVectorFalseInt()))
+						return true;
+				}
+			}
+		}
+	}
+
+	occludedCount++;
+	return false;
+}
+
+// Get the occluder triangles binned this frame
+unsigned int OcclusionCuller::GetOccluderTriangleCount()
+{
+	return occluderTriangles;
+}
+
+// Get how many boxes were tested this frame
+unsigned int OcclusionCuller::GetTestedCount()
+{
+	return testedCount;
+}
+
+// Get how many tested boxes were hidden this frame
+unsigned int OcclusionCuller::GetOccludedCount()
+{
+	return occludedCount;
+}
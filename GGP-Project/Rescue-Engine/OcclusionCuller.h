@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "Mesh.h"
+
+//Size of the occlusion depth buffer. Width is a multiple of the tile size
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+
+//Tiles occluders are binned into and rasterized in parallel
+#define OCCLUSION_TILE_SIZE 64
+
+//Blocks of the coarse level, which keeps each block's farthest depth
+#define OCCLUSION_BLOCK_SIZE 8
+
+//Most threads used to rasterize occluders
+#define OCCLUSION_MAX_THREADS 4
+
+// --------------------------------------------------------
+// CPU occlusion culling against a low resolution depth buffer
+//
+// Each frame the designated occluders are rasterized, depth
+// only, into a small buffer of z/w values. Triangles are
+// binned into tiles that are rasterized in parallel, four
+// pixels at a time, and every 8x8 block also stores its
+// farthest depth. A bounding box is hidden when its nearest
+// point is behind everything already drawn over its screen
+// rectangle; the coarse level settles most blocks without
+// touching their pixels. Boxes crossing the near plane are
+// always visible.
+//
+// Occluders cover the pixels whose centres they cover, so
+// culling is approximate: something only seen through less
+// than a pixel of this buffer may be hidden.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+private:
+	// --------------------------------------------------------
+	// An occluder triangle after setup, in buffer pixels
+	// --------------------------------------------------------
+	struct OccluderTriangle
+	{
+		float edgeA[3];		//Edge functions: A * x + B * y + C
+		float edgeB[3];
+		float edgeC[3];
+		bool topLeft[3];	//Edges that own the pixels exactly on them
+		float invArea;
+		float depth[3];		//z/w at each corner
+		int minX, minY, maxX, maxY;
+	};
+
+	std::vector<float> depth;		//OCCLUSION_WIDTH x OCCLUSION_HEIGHT
+	std::vector<float> blockDepth;	//Farthest depth of each block
+	int threadCount;
+
+	std::vector<OccluderTriangle> triangles;
+	std::vector<std::vector<unsigned int>> tileBins;
+	std::vector<DirectX::XMFLOAT4> clipPositions; //Scratch for the current occluder
+
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	//Stats
+	unsigned int occluderTriangles;
+	unsigned int testedCount;
+	unsigned int occludedCount;
+
+	// --------------------------------------------------------
+	// Clip a triangle against the near plane and bin the result
+	// --------------------------------------------------------
+	void ClipTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2);
+
+	// --------------------------------------------------------
+	// Set up a triangle in front of the near plane and add it
+	// to the bins of the tiles it covers
+	// --------------------------------------------------------
+	void BinTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2);
+
+	// --------------------------------------------------------
+	// Rasterize a tile's triangles and update its blocks
+	// --------------------------------------------------------
+	void RasterizeTile(int tile);
+
+public:
+	// --------------------------------------------------------
+	// Construct a culler with an empty depth buffer
+	// --------------------------------------------------------
+	OcclusionCuller();
+
+	// --------------------------------------------------------
+	// Set how many threads rasterize occluders
+	//
+	// threads - 0 for the whole WorkerPool, up to OCCLUSION_MAX_THREADS
+	// --------------------------------------------------------
+	void Init(int threads = 0);
+
+	// --------------------------------------------------------
+	// Clear the depth buffer and set the camera for the frame.
+	// Matrices are transposed, as cameras keep them
+	// --------------------------------------------------------
+	void BeginFrame(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// --------------------------------------------------------
+	// Transform and bin an occluder's triangles. Back faces
+	// are skipped like they are when drawing
+	//
+	// mesh - the occluder's mesh, with its CPU-side geometry
+	// world - the transposed world matrix
+	// runs - (start index, index count) pairs to draw instead
+	//        of the full detail level, or null
+	// --------------------------------------------------------
+	void AddOccluder(Mesh* mesh, const DirectX::XMFLOAT4X4& world, const std::vector<unsigned int>* runs = nullptr);
+
+	// --------------------------------------------------------
+	// Rasterize every occluder added since BeginFrame()
+	// --------------------------------------------------------
+	void Rasterize();
+
+	// --------------------------------------------------------
+	// Check if any part of a box could be seen past the
+	// occluders
+	//
+	// boundsMin, boundsMax - the box in local space
+	// world - the transposed world matrix
+	// --------------------------------------------------------
+	bool IsVisible(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, const DirectX::XMFLOAT4X4& world);
+
+	// --------------------------------------------------------
+	// Get the occluder triangles binned this frame
+	// --------------------------------------------------------
+	unsigned int GetOccluderTriangleCount();
+
+	// --------------------------------------------------------
+	// Get how many boxes were tested this frame
+	// --------------------------------------------------------
+	unsigned int GetTestedCount();
+
+	// --------------------------------------------------------
+	// Get how many tested boxes were hidden this frame
+	// --------------------------------------------------------
+	unsigned int GetOccludedCount();
+};
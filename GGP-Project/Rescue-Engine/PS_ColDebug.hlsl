@@ -1,5 +1,4 @@
-
-//Pixel shader for when drawing debug collider outlines
+//Pixel shader for debug lines, see DebugDraw
 
 // Struct representing the data we expect to receive from earlier pipeline stages
 struct VertexToPixel
@@ -10,8 +9,7 @@ struct VertexToPixel
 	//  |    |                |
 	//  v    v                v
 	float4 position		: SV_POSITION;
-	float3 worldPos		: POSITION;		 // world position of the vertex
-	float2 uv			: TEXCOORD;		 // XY uv
+	float4 color		: COLOR;		 // RGBA line color
 };
 
 // --------------------------------------------------------
@@ -20,5 +18,5 @@ struct VertexToPixel
 float4 main(VertexToPixel input) : SV_TARGET
 {
 	//Return final pixel color
-	return float4(1, 0, 0, 1);
+	return input.color;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+// --------------------------------------------------------
+// Platform shim
+//
+// Windows builds include the real Win32 and D3D11 headers.
+// HEADLESS builds (the Linux simulation runner) get stand-ins
+// for the handful of Win32 types, virtual-key codes and calls
+// the gameplay code touches, and only ever see D3D11 objects
+// as opaque pointers.
+// --------------------------------------------------------
+#ifndef HEADLESS
+
+#include <Windows.h>
+#include <d3d11.h>
+
+#else
+
+#include <cstdio>
+
+//Win32 types
+typedef void* HWND;
+typedef unsigned long long WPARAM;
+typedef unsigned int UINT;
+struct POINT { long x; long y; };
+struct RECT { long left; long top; long right; long bottom; };
+
+//Virtual-key codes used by gameplay
+#define VK_SPACE	0x20
+#define VK_ESCAPE	0x1B
+#define VK_LEFT		0x25
+#define VK_UP		0x26
+#define VK_RIGHT	0x27
+#define VK_DOWN		0x28
+
+//The secure CRT variants are MSVC only
+#define sscanf_s sscanf
+
+//There is no window or cursor, so these do nothing
+inline HWND GetFocus() { return nullptr; }
+inline bool GetCursorPos(POINT* point) { point->x = 0; point->y = 0; return true; }
+inline bool SetCursorPos(int, int) { return true; }
+inline HWND SetCapture(HWND) { return nullptr; }
+inline bool ReleaseCapture() { return true; }
+inline bool GetWindowRect(HWND, RECT* rect) { *rect = RECT{ 0, 0, 0, 0 }; return true; }
+
+//Graphics objects only exist as pointers without a device
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+
+#endif
@@ -0,0 +1,383 @@
+#include "RenderCapture.h"
+#include <fstream>
+#include <cstring>
+#include <stdio.h>
+
+//The header is read back with a straight copy
+static_assert(sizeof(RenderCaptureHeader) == 16, "RenderCaptureHeader layout changed, bump RENDER_CAPTURE_VERSION");
+
+//Smallest a pass (name length, command count, stream size) and a
+//command (type, stage, slot, object id) can be on disk, so counts
+//read from a file can be checked against the bytes left in it
+#define RENDER_CAPTURE_MIN_PASS_BYTES 12
+#define RENDER_CAPTURE_MIN_COMMAND_BYTES 8
+
+//Arguments stored for each command type. SetConstants only stores
+//its size, the payload follows it
+static const unsigned int commandArgCounts[(int)RenderCommandType::Count] =
+{
+	0,	//BindPipeline
+	2,	//BindVertexBuffer
+	1,	//BindIndexBuffer
+	0,	//BindConstantBuffer
+	0,	//BindResource
+	0,	//BindSampler
+	1,	//SetConstants
+	2,	//Draw
+	3,	//DrawIndexed
+	5,	//DrawIndexedInstanced
+};
+
+// Append a value to a stream
+template<typename T>
+static void Write(std::vector<unsigned char>& stream, T value)
+{
+	size_t offset = stream.size();
+	stream.resize(offset + sizeof(T));
+	memcpy(&stream[offset], &value, sizeof(T));
+}
+
+// Read a value from a stream, failing past the end
+template<typename T>
+static bool Read(const std::vector<unsigned char>& stream, size_t& offset, T& value)
+{
+	if (offset + sizeof(T) > stream.size())
+		return false;
+	memcpy(&value, &stream[offset], sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+// Forget every pass and object
+void RenderCapture::Clear()
+{
+	passes.clear();
+	objectIds.clear();
+	objects.clear();
+}
+
+// Get the id an object is written as, assigning new ones
+unsigned int RenderCapture::GetObjectId(const void* object)
+{
+	if (object == nullptr)
+		return 0;
+
+	auto found = objectIds.find(object);
+	if (found != objectIds.end())
+		return found->second;
+
+	unsigned int id = (unsigned int)objectIds.size() + 1;
+	objectIds[object] = id;
+	return id;
+}
+
+// Get the stand-in for an object id of a loaded capture
+const void* RenderCapture::GetStandIn(unsigned int id)
+{
+	if (id == 0)
+		return nullptr;
+	return &objects[id - 1];
+}
+
+// Start a pass
+void RenderCapture::BeginPass(const char* name)
+{
+	passes.push_back(CapturedPass());
+	passes.back().name = name;
+	passes.back().commandCount = 0;
+}
+
+// Append a list's commands to the current pass
+void RenderCapture::AddList(const RenderCommandList& list)
+{
+	if (passes.empty())
+		BeginPass("Unnamed");
+	CapturedPass& pass = passes.back();
+
+	for (const RenderCommand& command : list.GetCommands())
+	{
+		Write<unsigned char>(pass.stream, (unsigned char)command.type);
+		Write<unsigned char>(pass.stream, (unsigned char)command.stage);
+		Write<unsigned short>(pass.stream, (unsigned short)command.slot);
+		Write<unsigned int>(pass.stream, GetObjectId(command.object));
+
+		if (command.type == RenderCommandType::SetConstants)
+		{
+			//Only the size, the offset into the list's data is rebuilt on load
+			Write<unsigned int>(pass.stream, command.args[1]);
+			if (command.args[1] > 0)
+			{
+				const unsigned char* constants = (const unsigned char*)list.GetConstants(command);
+				pass.stream.insert(pass.stream.end(), constants, constants + command.args[1]);
+			}
+		}
+		else
+		{
+			for (unsigned int a = 0; a < commandArgCounts[(int)command.type]; a++)
+				Write<unsigned int>(pass.stream, command.args[a]);
+		}
+
+		if (command.type == RenderCommandType::BindPipeline)
+		{
+			const RenderPipeline& pipeline = list.GetPipeline(command);
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.inputLayout));
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.vertexShader));
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.pixelShader));
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.rasterizerState));
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.blendState));
+			Write<unsigned int>(pass.stream, GetObjectId(pipeline.depthStencilState));
+		}
+
+		pass.commandCount++;
+	}
+}
+
+// Write the captured passes
+bool RenderCapture::Save(const char* path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Could not open render capture \"%s\" for writing\n", path);
+		return false;
+	}
+
+	RenderCaptureHeader header = {};
+	memcpy(header.magic, "SMRC", 4);
+	header.version = RENDER_CAPTURE_VERSION;
+	header.passCount = (unsigned int)passes.size();
+	header.objectCount = (unsigned int)objectIds.size();
+	file.write((const char*)&header, sizeof(header));
+
+	//Each pass: name, command count, stream size, stream
+	for (const CapturedPass& pass : passes)
+	{
+		unsigned int nameLength = (unsigned int)pass.name.size();
+		unsigned int streamSize = (unsigned int)pass.stream.size();
+		file.write((const char*)&nameLength, sizeof(nameLength));
+		file.write(pass.name.data(), nameLength);
+		file.write((const char*)&pass.commandCount, sizeof(pass.commandCount));
+		file.write((const char*)&streamSize, sizeof(streamSize));
+		if (streamSize > 0)
+			file.write((const char*)pass.stream.data(), streamSize);
+	}
+
+	if (!file)
+	{
+		printf("Could not write render capture \"%s\"\n", path);
+		return false;
+	}
+	return true;
+}
+
+// Load a capture written by Save()
+bool RenderCapture::Load(const char* path)
+{
+	Clear();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		printf("Render capture \"%s\" could not be found\n", path);
+		return false;
+	}
+	unsigned long long fileSize = (unsigned long long)file.tellg();
+	file.seekg(0);
+
+	//Sizes come from the file, so each is checked against what is
+	//left of it before anything is allocated
+	auto bytesLeft = [&]() { return fileSize - (unsigned long long)file.tellg(); };
+
+	RenderCaptureHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || memcmp(header.magic, "SMRC", 4) != 0)
+	{
+		printf("\"%s\" is not a render capture\n", path);
+		return false;
+	}
+	if (header.version != RENDER_CAPTURE_VERSION)
+	{
+		printf("Render capture \"%s\" is version %u, expected %u\n", path, header.version, RENDER_CAPTURE_VERSION);
+		return false;
+	}
+
+	//Every pass takes some bytes, and every object is referenced
+	//by at least one command
+	if (header.passCount > bytesLeft() / RENDER_CAPTURE_MIN_PASS_BYTES ||
+		header.objectCount > bytesLeft() / RENDER_CAPTURE_MIN_COMMAND_BYTES)
+	{
+		printf("Render capture \"%s\" is truncated\n", path);
+		return false;
+	}
+
+	//Stand-ins must not move once lists point at them
+	objects.resize(header.objectCount);
+
+	passes.resize(header.passCount);
+	for (CapturedPass& pass : passes)
+	{
+		unsigned int nameLength = 0;
+		unsigned int streamSize = 0;
+		file.read((char*)&nameLength, sizeof(nameLength));
+		if (!file || nameLength > 1024 || nameLength > bytesLeft())
+		{
+			file.setstate(std::ios::failbit);
+			break;
+		}
+		pass.name.resize(nameLength);
+		file.read(&pass.name[0], nameLength);
+		file.read((char*)&pass.commandCount, sizeof(pass.commandCount));
+		file.read((char*)&streamSize, sizeof(streamSize));
+		if (!file || streamSize > bytesLeft() || pass.commandCount > streamSize / RENDER_CAPTURE_MIN_COMMAND_BYTES)
+		{
+			file.setstate(std::ios::failbit);
+			break;
+		}
+		pass.stream.resize(streamSize);
+		if (streamSize > 0)
+			file.read((char*)pass.stream.data(), streamSize);
+		if (!file)
+			break;
+
+		if (!Decode(pass))
+		{
+			printf("Render capture \"%s\" has a malformed pass \"%s\"\n", path, pass.name.c_str());
+			Clear();
+			return false;
+		}
+	}
+
+	if (!file)
+	{
+		printf("Render capture \"%s\" is truncated\n", path);
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+// Rebuild a pass's command list from its stream
+bool RenderCapture::Decode(CapturedPass& pass)
+{
+	pass.commands.Clear();
+
+	size_t offset = 0;
+	for (unsigned int i = 0; i < pass.commandCount; i++)
+	{
+		unsigned char type = 0;
+		unsigned char stage = 0;
+		unsigned short slot = 0;
+		unsigned int objectId = 0;
+		if (!Read(pass.stream, offset, type) || !Read(pass.stream, offset, stage) ||
+			!Read(pass.stream, offset, slot) || !Read(pass.stream, offset, objectId))
+			return false;
+		if (type >= (unsigned char)RenderCommandType::Count || objectId > objects.size())
+			return false;
+
+		unsigned int args[5] = {};
+		for (unsigned int a = 0; a < commandArgCounts[type]; a++)
+		{
+			if (!Read(pass.stream, offset, args[a]))
+				return false;
+		}
+		const void* object = GetStandIn(objectId);
+
+		switch ((RenderCommandType)type)
+		{
+		case RenderCommandType::BindPipeline:
+		{
+			unsigned int ids[6];
+			for (int p = 0; p < 6; p++)
+			{
+				if (!Read(pass.stream, offset, ids[p]) || ids[p] > objects.size())
+					return false;
+			}
+
+			RenderPipeline pipeline;
+			pipeline.inputLayout = GetStandIn(ids[0]);
+			pipeline.vertexShader = GetStandIn(ids[1]);
+			pipeline.pixelShader = GetStandIn(ids[2]);
+			pipeline.rasterizerState = GetStandIn(ids[3]);
+			pipeline.blendState = GetStandIn(ids[4]);
+			pipeline.depthStencilState = GetStandIn(ids[5]);
+			pass.commands.BindPipeline(pipeline);
+			break;
+		}
+
+		case RenderCommandType::BindVertexBuffer:
+			pass.commands.BindVertexBuffer(slot, object, args[0], args[1]);
+			break;
+
+		case RenderCommandType::BindIndexBuffer:
+			pass.commands.BindIndexBuffer(object, args[0]);
+			break;
+
+		case RenderCommandType::BindConstantBuffer:
+			pass.commands.BindConstantBuffer((RenderStage)stage, slot, object);
+			break;
+
+		case RenderCommandType::BindResource:
+			pass.commands.BindResource((RenderStage)stage, slot, object);
+			break;
+
+		case RenderCommandType::BindSampler:
+			pass.commands.BindSampler((RenderStage)stage, slot, object);
+			break;
+
+		case RenderCommandType::SetConstants:
+			if (offset + args[0] > pass.stream.size())
+				return false;
+			pass.commands.SetConstants(object, args[0] > 0 ? &pass.stream[offset] : nullptr, args[0]);
+			offset += args[0];
+			break;
+
+		case RenderCommandType::Draw:
+			pass.commands.Draw(args[0], args[1]);
+			break;
+
+		case RenderCommandType::DrawIndexed:
+			pass.commands.DrawIndexed(args[0], args[1], (int)args[2]);
+			break;
+
+		case RenderCommandType::DrawIndexedInstanced:
+			pass.commands.DrawIndexedInstanced(args[0], args[3], args[1], (int)args[2], args[4]);
+			break;
+
+		default:
+			return false;
+		}
+	}
+
+	return offset == pass.stream.size();
+}
+
+// Get the number of captured passes
+int RenderCapture::GetPassCount()
+{
+	return (int)passes.size();
+}
+
+// Get the name of a captured pass
+const char* RenderCapture::GetPassName(int pass)
+{
+	return passes[pass].name.c_str();
+}
+
+// Get the number of commands in a captured pass
+unsigned int RenderCapture::GetPassCommandCount(int pass)
+{
+	return passes[pass].commandCount;
+}
+
+// Get the commands of a pass of a loaded capture
+const RenderCommandList& RenderCapture::GetPassCommands(int pass)
+{
+	return passes[pass].commands;
+}
+
+// Get the number of distinct objects referenced
+unsigned int RenderCapture::GetObjectCount()
+{
+	//Captured objects have ids, loaded ones have stand-ins
+	return objectIds.empty() ? (unsigned int)objects.size() : (unsigned int)objectIds.size();
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "RenderCommandList.h"
+
+// --------------------------------------------------------
+// Header at the start of every render capture
+// --------------------------------------------------------
+struct RenderCaptureHeader
+{
+	char magic[4];				//"SMRC"
+	unsigned int version;
+	unsigned int passCount;		//Passes stored after the header
+	unsigned int objectCount;	//Distinct objects the commands reference
+};
+
+#define RENDER_CAPTURE_VERSION 1
+
+// --------------------------------------------------------
+// Serializes a frame's render command lists to a binary file
+// and loads them back
+//
+// Commands are grouped into named passes. Objects are
+// written as small ids (0 is null) since their addresses mean
+// nothing outside the frame, and only the arguments each
+// command type uses are stored. A loaded capture references
+// stand-in objects, so replay it on a backend that does not
+// dereference them, like NullRenderBackend.
+// --------------------------------------------------------
+class RenderCapture
+{
+private:
+	// --------------------------------------------------------
+	// A pass's serialized commands, and once loaded, the list
+	// rebuilt from them
+	// --------------------------------------------------------
+	struct CapturedPass
+	{
+		std::string name;
+		unsigned int commandCount;
+		std::vector<unsigned char> stream;
+		RenderCommandList commands;
+	};
+
+	std::vector<CapturedPass> passes;
+	std::unordered_map<const void*, unsigned int> objectIds;
+	std::vector<unsigned char> objects; //Stand-ins a loaded capture points at
+
+	// --------------------------------------------------------
+	// Get the id an object is written as, assigning new ones
+	// --------------------------------------------------------
+	unsigned int GetObjectId(const void* object);
+
+	// --------------------------------------------------------
+	// Get the stand-in for an object id of a loaded capture
+	// --------------------------------------------------------
+	const void* GetStandIn(unsigned int id);
+
+	// --------------------------------------------------------
+	// Rebuild a pass's command list from its stream
+	// --------------------------------------------------------
+	bool Decode(CapturedPass& pass);
+
+public:
+	// --------------------------------------------------------
+	// Forget every pass and object
+	// --------------------------------------------------------
+	void Clear();
+
+	// --------------------------------------------------------
+	// Start a pass. Lists added after this belong to it
+	// --------------------------------------------------------
+	void BeginPass(const char* name);
+
+	// --------------------------------------------------------
+	// Append a list's commands to the current pass. The list
+	// is copied, so it can be cleared or reused afterwards
+	// --------------------------------------------------------
+	void AddList(const RenderCommandList& list);
+
+	// --------------------------------------------------------
+	// Write the captured passes, overwriting any existing file
+	// --------------------------------------------------------
+	bool Save(const char* path);
+
+	// --------------------------------------------------------
+	// Load a capture written by Save()
+	// --------------------------------------------------------
+	bool Load(const char* path);
+
+	// --------------------------------------------------------
+	// Get the number of captured passes
+	// --------------------------------------------------------
+	int GetPassCount();
+
+	// --------------------------------------------------------
+	// Get the name of a captured pass
+	// --------------------------------------------------------
+	const char* GetPassName(int pass);
+
+	// --------------------------------------------------------
+	// Get the number of commands in a captured pass
+	// --------------------------------------------------------
+	unsigned int GetPassCommandCount(int pass);
+
+	// --------------------------------------------------------
+	// Get the commands of a pass of a loaded capture
+	// --------------------------------------------------------
+	const RenderCommandList& GetPassCommands(int pass);
+
+	// --------------------------------------------------------
+	// Get the number of distinct objects referenced
+	// --------------------------------------------------------
+	unsigned int GetObjectCount();
+};
@@ -0,0 +1,133 @@
+#include "RenderCommandList.h"
+#include <cstring>
+
+// Append a command and get it to fill in
+RenderCommand& RenderCommandList::Add(RenderCommandType type)
+{
+	RenderCommand command = {};
+	command.type = type;
+	commands.push_back(command);
+	return commands.back();
+}
+
+// Remove every command, keeping the memory
+void RenderCommandList::Clear()
+{
+	commands.clear();
+	pipelines.clear();
+	data.clear();
+}
+
+// Bind shaders, input layout and fixed function state
+void RenderCommandList::BindPipeline(const RenderPipeline& pipeline)
+{
+	RenderCommand& command = Add(RenderCommandType::BindPipeline);
+	command.args[0] = (unsigned int)pipelines.size();
+	pipelines.push_back(pipeline);
+}
+
+// Bind a vertex buffer
+void RenderCommandList::BindVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset)
+{
+	RenderCommand& command = Add(RenderCommandType::BindVertexBuffer);
+	command.slot = slot;
+	command.object = buffer;
+	command.args[0] = stride;
+	command.args[1] = offset;
+}
+
+// Bind a buffer of 32 bit indices
+void RenderCommandList::BindIndexBuffer(const void* buffer, unsigned int offset)
+{
+	RenderCommand& command = Add(RenderCommandType::BindIndexBuffer);
+	command.object = buffer;
+	command.args[0] = offset;
+}
+
+// Bind a constant buffer to a stage
+void RenderCommandList::BindConstantBuffer(RenderStage stage, unsigned int slot, const void* buffer)
+{
+	RenderCommand& command = Add(RenderCommandType::BindConstantBuffer);
+	command.stage = stage;
+	command.slot = slot;
+	command.object = buffer;
+}
+
+// Bind a shader resource to a stage
+void RenderCommandList::BindResource(RenderStage stage, unsigned int slot, const void* resource)
+{
+	RenderCommand& command = Add(RenderCommandType::BindResource);
+	command.stage = stage;
+	command.slot = slot;
+	command.object = resource;
+}
+
+// Bind a sampler to a stage
+void RenderCommandList::BindSampler(RenderStage stage, unsigned int slot, const void* sampler)
+{
+	RenderCommand& command = Add(RenderCommandType::BindSampler);
+	command.stage = stage;
+	command.slot = slot;
+	command.object = sampler;
+}
+
+// Replace the whole contents of a constant buffer
+void RenderCommandList::SetConstants(const void* buffer, const void* constants, unsigned int size)
+{
+	RenderCommand& command = Add(RenderCommandType::SetConstants);
+	command.object = buffer;
+	command.args[0] = (unsigned int)data.size();
+	command.args[1] = size;
+
+	if (size == 0)
+		return;
+	data.resize(data.size() + size);
+	memcpy(&data[command.args[0]], constants, size);
+}
+
+// Draw non-indexed vertices
+void RenderCommandList::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	RenderCommand& command = Add(RenderCommandType::Draw);
+	command.args[0] = vertexCount;
+	command.args[1] = startVertex;
+}
+
+// Draw indexed vertices
+void RenderCommandList::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	RenderCommand& command = Add(RenderCommandType::DrawIndexed);
+	command.args[0] = indexCount;
+	command.args[1] = startIndex;
+	command.args[2] = (unsigned int)baseVertex;
+}
+
+// Draw instances of indexed vertices
+void RenderCommandList::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount,
+	unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	RenderCommand& command = Add(RenderCommandType::DrawIndexedInstanced);
+	command.args[0] = indexCount;
+	command.args[1] = startIndex;
+	command.args[2] = (unsigned int)baseVertex;
+	command.args[3] = instanceCount;
+	command.args[4] = startInstance;
+}
+
+// Get the recorded commands
+const std::vector<RenderCommand>& RenderCommandList::GetCommands() const
+{
+	return commands;
+}
+
+// Get the pipeline a BindPipeline command binds
+const RenderPipeline& RenderCommandList::GetPipeline(const RenderCommand& command) const
+{
+	return pipelines[command.args[0]];
+}
+
+// Get the payload of a SetConstants command
+const void* RenderCommandList::GetConstants(const RenderCommand& command) const
+{
+	return &data[command.args[0]];
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <vector>
+
+//Slots a command list may bind, matching D3D11's limits
+#define RENDER_COMMAND_CONSTANT_SLOTS 14
+#define RENDER_COMMAND_RESOURCE_SLOTS 128
+#define RENDER_COMMAND_SAMPLER_SLOTS 16
+#define RENDER_COMMAND_VERTEX_SLOTS 2
+
+// --------------------------------------------------------
+// Kinds of recorded commands
+// --------------------------------------------------------
+enum class RenderCommandType : unsigned char
+{
+	BindPipeline,
+	BindVertexBuffer,
+	BindIndexBuffer,
+	BindConstantBuffer,
+	BindResource,
+	BindSampler,
+	SetConstants,
+	Draw,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	Count
+};
+
+// --------------------------------------------------------
+// Shader stage a binding applies to
+// --------------------------------------------------------
+enum class RenderStage : unsigned char
+{
+	Vertex,
+	Pixel
+};
+
+// --------------------------------------------------------
+// Everything a draw needs besides its resources. Objects are
+// opaque to the command list; the backend knows their types
+// (for D3D11 the input layout, shaders and state objects).
+// Null state objects mean the defaults
+// --------------------------------------------------------
+struct RenderPipeline
+{
+	const void* inputLayout;
+	const void* vertexShader;
+	const void* pixelShader;
+	const void* rasterizerState;
+	const void* blendState;
+	const void* depthStencilState;
+};
+
+// --------------------------------------------------------
+// A recorded command. What the arguments mean depends on the
+// type, see the RenderCommandList method that records it
+// --------------------------------------------------------
+struct RenderCommand
+{
+	RenderCommandType type;
+	RenderStage stage;
+	unsigned int slot;
+	const void* object;
+	unsigned int args[5];
+};
+
+// --------------------------------------------------------
+// A list of draw submission commands independent of the
+// graphics API.
+//
+// Lists are recorded without touching the device, so several
+// threads can each record their own list at once. A
+// RenderBackend then turns a list into device calls on the
+// thread that owns the device, or just checks it (see
+// NullRenderBackend). Clear() keeps the memory, so reuse
+// lists between frames.
+// --------------------------------------------------------
+class RenderCommandList
+{
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<RenderPipeline> pipelines;
+	std::vector<unsigned char> data; //Constant payloads
+
+	// --------------------------------------------------------
+	// Append a command and get it to fill in
+	// --------------------------------------------------------
+	RenderCommand& Add(RenderCommandType type);
+
+public:
+	// --------------------------------------------------------
+	// Remove every command, keeping the memory
+	// --------------------------------------------------------
+	void Clear();
+
+	// --------------------------------------------------------
+	// Bind shaders, input layout and fixed function state
+	// --------------------------------------------------------
+	void BindPipeline(const RenderPipeline& pipeline);
+
+	// --------------------------------------------------------
+	// Bind a vertex buffer
+	// --------------------------------------------------------
+	void BindVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset);
+
+	// --------------------------------------------------------
+	// Bind a buffer of 32 bit indices
+	// --------------------------------------------------------
+	void BindIndexBuffer(const void* buffer, unsigned int offset = 0);
+
+	// --------------------------------------------------------
+	// Bind a constant buffer to a stage
+	// --------------------------------------------------------
+	void BindConstantBuffer(RenderStage stage, unsigned int slot, const void* buffer);
+
+	// --------------------------------------------------------
+	// Bind a shader resource to a stage
+	// --------------------------------------------------------
+	void BindResource(RenderStage stage, unsigned int slot, const void* resource);
+
+	// --------------------------------------------------------
+	// Bind a sampler to a stage
+	// --------------------------------------------------------
+	void BindSampler(RenderStage stage, unsigned int slot, const void* sampler);
+
+	// --------------------------------------------------------
+	// Replace the whole contents of a constant buffer. The data
+	// is copied into the list
+	// --------------------------------------------------------
+	void SetConstants(const void* buffer, const void* constants, unsigned int size);
+
+	template<typename T>
+	void SetConstants(const void* buffer, const T& constants) { SetConstants(buffer, &constants, sizeof(T)); }
+
+	// --------------------------------------------------------
+	// Draw non-indexed vertices
+	// --------------------------------------------------------
+	void Draw(unsigned int vertexCount, unsigned int startVertex = 0);
+
+	// --------------------------------------------------------
+	// Draw indexed vertices
+	// --------------------------------------------------------
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex = 0, int baseVertex = 0);
+
+	// --------------------------------------------------------
+	// Draw instances of indexed vertices
+	// --------------------------------------------------------
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount,
+		unsigned int startIndex = 0, int baseVertex = 0, unsigned int startInstance = 0);
+
+	// --------------------------------------------------------
+	// Get the recorded commands
+	// --------------------------------------------------------
+	const std::vector<RenderCommand>& GetCommands() const;
+
+	// --------------------------------------------------------
+	// Get the pipeline a BindPipeline command binds
+	// --------------------------------------------------------
+	const RenderPipeline& GetPipeline(const RenderCommand& command) const;
+
+	// --------------------------------------------------------
+	// Get the payload of a SetConstants command
+	// --------------------------------------------------------
+	const void* GetConstants(const RenderCommand& command) const;
+};
+
+// --------------------------------------------------------
+// Turns command lists into work for a graphics API
+// --------------------------------------------------------
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	// --------------------------------------------------------
+	// Run every command in a list, in order. Bindings carry
+	// over between lists
+	// --------------------------------------------------------
+	virtual void Execute(const RenderCommandList& list) = 0;
+};
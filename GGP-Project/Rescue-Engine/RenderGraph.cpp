@@ -0,0 +1,386 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <stdio.h>
+
+// Sample a resource
+RenderGraphPass& RenderGraphPass::Read(RenderGraphResource resource)
+{
+	reads.push_back(resource);
+	return *this;
+}
+
+// Write a resource the pass binds itself
+RenderGraphPass& RenderGraphPass::Write(RenderGraphResource resource)
+{
+	writes.push_back(resource);
+	return *this;
+}
+
+// Render to a color target, optionally clearing it first
+RenderGraphPass& RenderGraphPass::WriteColor(RenderGraphResource resource, const float* clearColor)
+{
+	writes.push_back(resource);
+	colorTargets.push_back(resource);
+	clearColorTargets.push_back(clearColor != nullptr);
+	for (int i = 0; i < 4; i++)
+		clearColors.push_back(clearColor != nullptr ? clearColor[i] : 0.0f);
+	return *this;
+}
+
+// Bind a depth buffer
+RenderGraphPass& RenderGraphPass::UseDepth(RenderGraphResource resource, bool write, bool clear)
+{
+	depthTarget = resource;
+	clearDepth = clear;
+	if (write || clear)
+		writes.push_back(resource);
+	else
+		depthTests.push_back(resource);
+	return *this;
+}
+
+// Keep the pass even if nothing uses what it writes
+RenderGraphPass& RenderGraphPass::HasSideEffects()
+{
+	sideEffects = true;
+	return *this;
+}
+
+// Constructor - Call Init() before use
+RenderGraph::RenderGraph()
+{
+	device = nullptr;
+	frame = 0;
+	culledPasses = 0;
+}
+
+// Release every pooled texture
+RenderGraph::~RenderGraph()
+{
+	for (auto& pooled : pool)
+		ReleasePooledTexture(pooled);
+}
+
+// Set the device transient textures are created on
+void RenderGraph::Init(ID3D11Device* device)
+{
+	this->device = device;
+}
+
+// Remove every pass and resource to start a new frame
+void RenderGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	order.clear();
+}
+
+// Add a resource and get its handle
+RenderGraphResource RenderGraph::AddResource(const char* name, bool imported)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.imported = imported;
+	resource.physical = -1;
+	resource.firstUse = -1;
+	resource.lastUse = -1;
+	resources.push_back(resource);
+	return (RenderGraphResource)resources.size() - 1;
+}
+
+// Import a render target owned outside the graph
+RenderGraphResource RenderGraph::ImportTarget(const char* name, ID3D11RenderTargetView* rtv, UINT width, UINT height)
+{
+	RenderGraphResource handle = AddResource(name, true);
+	resources[handle].rtv = rtv;
+	resources[handle].width = width;
+	resources[handle].height = height;
+	return handle;
+}
+
+// Import a depth buffer owned outside the graph
+RenderGraphResource RenderGraph::ImportDepth(const char* name, ID3D11DepthStencilView* dsv, UINT width, UINT height)
+{
+	RenderGraphResource handle = AddResource(name, true);
+	resources[handle].dsv = dsv;
+	resources[handle].width = width;
+	resources[handle].height = height;
+	return handle;
+}
+
+// Import a resource the graph never binds, only tracks
+RenderGraphResource RenderGraph::Import(const char* name, ID3D11ShaderResourceView* srv)
+{
+	RenderGraphResource handle = AddResource(name, true);
+	resources[handle].srv = srv;
+	return handle;
+}
+
+// Declare a transient texture
+RenderGraphResource RenderGraph::CreateTexture(const char* name, const RenderGraphTextureDesc& desc)
+{
+	RenderGraphResource handle = AddResource(name, false);
+	resources[handle].desc = desc;
+	resources[handle].width = desc.width;
+	resources[handle].height = desc.height;
+	return handle;
+}
+
+// Add a pass
+RenderGraphPass& RenderGraph::AddPass(const char* name, std::function<void(RenderGraph& graph)> execute)
+{
+	passes.push_back(RenderGraphPass());
+	RenderGraphPass& pass = passes.back();
+	pass.name = name;
+	pass.execute = execute;
+	pass.depthTarget = -1;
+	pass.clearDepth = false;
+	pass.sideEffects = false;
+	pass.live = false;
+	return pass;
+}
+
+// Mark the passes that contribute to an imported resource or have side effects
+void RenderGraph::Cull()
+{
+	//Imported resources outlive the frame, so writing them is always useful
+	std::vector<bool> needed(resources.size());
+	for (size_t i = 0; i < resources.size(); i++)
+		needed[i] = resources[i].imported;
+
+	//Walk backwards so every pass knows whether a later pass uses its results
+	culledPasses = 0;
+	for (int p = (int)passes.size() - 1; p >= 0; p--)
+	{
+		RenderGraphPass& pass = passes[p];
+		pass.live = pass.sideEffects;
+		for (auto w : pass.writes)
+			pass.live = pass.live || needed[w];
+
+		if (!pass.live)
+		{
+			culledPasses++;
+			continue;
+		}
+
+		//Cleared targets don't need what earlier passes wrote to them,
+		//unless they are imported
+		for (size_t c = 0; c < pass.colorTargets.size(); c++)
+		{
+			if (pass.clearColorTargets[c] && !resources[pass.colorTargets[c]].imported)
+				needed[pass.colorTargets[c]] = false;
+		}
+		if (pass.clearDepth && !resources[pass.depthTarget].imported)
+			needed[pass.depthTarget] = false;
+
+		for (auto r : pass.reads)
+			needed[r] = true;
+		for (auto d : pass.depthTests)
+			needed[d] = true;
+	}
+
+	//Live passes run in declaration order
+	for (size_t p = 0; p < passes.size(); p++)
+	{
+		if (passes[p].live)
+			order.push_back((int)p);
+	}
+}
+
+// Find resource lifetimes and place transient resources in pooled textures
+void RenderGraph::Allocate()
+{
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const RenderGraphPass& pass = passes[order[i]];
+		auto use = [&](RenderGraphResource r)
+		{
+			Resource& resource = resources[r];
+			if (resource.firstUse < 0)
+				resource.firstUse = (int)i;
+			resource.lastUse = (int)i;
+		};
+		for (auto r : pass.reads) use(r);
+		for (auto d : pass.depthTests) use(d);
+		for (auto w : pass.writes) use(w);
+	}
+
+	//Place transient resources in order of first use so a pooled
+	//texture is handed on as soon as its last user is done
+	std::vector<int> transients;
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		if (!resources[i].imported && resources[i].firstUse >= 0)
+			transients.push_back((int)i);
+	}
+	std::sort(transients.begin(), transients.end(), [this](int a, int b)
+	{
+		return resources[a].firstUse < resources[b].firstUse;
+	});
+
+	for (auto& pooled : pool)
+		pooled.busyUntil = -1;
+
+	for (auto t : transients)
+	{
+		Resource& resource = resources[t];
+		for (size_t p = 0; p < pool.size(); p++)
+		{
+			if (pool[p].desc == resource.desc && pool[p].busyUntil < resource.firstUse)
+			{
+				resource.physical = (int)p;
+				break;
+			}
+		}
+
+		if (resource.physical < 0)
+		{
+			PooledTexture pooled = {};
+			if (!CreatePooledTexture(resource.desc, pooled))
+				continue;
+			pool.push_back(pooled);
+			resource.physical = (int)pool.size() - 1;
+		}
+
+		pool[resource.physical].busyUntil = resource.lastUse;
+		pool[resource.physical].lastFrame = frame;
+	}
+}
+
+// Create a pooled texture and its views
+bool RenderGraph::CreatePooledTexture(const RenderGraphTextureDesc& desc, PooledTexture& pooled)
+{
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.width;
+	textureDesc.Height = desc.height;
+	textureDesc.ArraySize = 1;
+	textureDesc.MipLevels = 1;
+	textureDesc.Format = desc.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = desc.depth ?
+		D3D11_BIND_DEPTH_STENCIL :
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	pooled.desc = desc;
+	if (FAILED(device->CreateTexture2D(&textureDesc, 0, &pooled.texture)))
+	{
+		printf("Could not create a %ux%u render graph texture\n", desc.width, desc.height);
+		return false;
+	}
+
+	HRESULT hr;
+	if (desc.depth)
+	{
+		hr = device->CreateDepthStencilView(pooled.texture, 0, &pooled.dsv);
+	}
+	else
+	{
+		hr = device->CreateRenderTargetView(pooled.texture, 0, &pooled.rtv);
+		if (SUCCEEDED(hr))
+			hr = device->CreateShaderResourceView(pooled.texture, 0, &pooled.srv);
+	}
+
+	if (FAILED(hr))
+	{
+		printf("Could not create views for a render graph texture\n");
+		ReleasePooledTexture(pooled);
+		return false;
+	}
+	return true;
+}
+
+// Release a pooled texture's views and texture
+void RenderGraph::ReleasePooledTexture(PooledTexture& pooled)
+{
+	if (pooled.rtv != nullptr) { pooled.rtv->Release(); pooled.rtv = nullptr; }
+	if (pooled.dsv != nullptr) { pooled.dsv->Release(); pooled.dsv = nullptr; }
+	if (pooled.srv != nullptr) { pooled.srv->Release(); pooled.srv = nullptr; }
+	if (pooled.texture != nullptr) { pooled.texture->Release(); pooled.texture = nullptr; }
+}
+
+// Cull the passes and run the rest
+void RenderGraph::Execute(ID3D11DeviceContext* context, RenderStateCache* stateCache)
+{
+	frame++;
+	Cull();
+	Allocate();
+
+	for (auto p : order)
+	{
+		RenderGraphPass& pass = passes[p];
+
+		//Bind the pass's targets and size the viewport to them
+		if (!pass.colorTargets.empty() || pass.depthTarget >= 0)
+		{
+			ID3D11RenderTargetView* rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+			UINT rtvCount = (UINT)std::min(pass.colorTargets.size(), (size_t)D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+			for (UINT c = 0; c < rtvCount; c++)
+			{
+				const Resource& target = resources[pass.colorTargets[c]];
+				rtvs[c] = target.physical >= 0 ? pool[target.physical].rtv : target.rtv;
+				if (pass.clearColorTargets[c])
+					context->ClearRenderTargetView(rtvs[c], &pass.clearColors[c * 4]);
+			}
+
+			ID3D11DepthStencilView* dsv = nullptr;
+			if (pass.depthTarget >= 0)
+			{
+				const Resource& depth = resources[pass.depthTarget];
+				dsv = depth.physical >= 0 ? pool[depth.physical].dsv : depth.dsv;
+				if (pass.clearDepth)
+					context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+			}
+			stateCache->SetRenderTargets(rtvCount, rtvs, dsv);
+
+			const Resource& sizing = resources[rtvCount > 0 ? pass.colorTargets[0] : pass.depthTarget];
+			D3D11_VIEWPORT vp = {};
+			vp.Width = (float)sizing.width;
+			vp.Height = (float)sizing.height;
+			vp.MaxDepth = 1.0f;
+			context->RSSetViewports(1, &vp);
+		}
+
+		pass.execute(*this);
+
+		//Whatever the pass sampled may be a target of a later pass or
+		//reused by the next frame, so unbind it while we know it is done
+		for (auto r : pass.reads)
+			stateCache->UnbindPSShaderResource(GetSRV(r));
+	}
+
+	//Drop pooled textures nothing has used for a while, e.g. after a resize
+	for (int i = (int)pool.size() - 1; i >= 0; i--)
+	{
+		if (frame - pool[i].lastFrame > RENDER_GRAPH_POOL_FRAMES)
+		{
+			ReleasePooledTexture(pool[i]);
+			pool.erase(pool.begin() + i);
+		}
+	}
+}
+
+// Get the shader resource view of a transient texture
+ID3D11ShaderResourceView* RenderGraph::GetSRV(RenderGraphResource resource)
+{
+	const Resource& r = resources[resource];
+	return r.physical >= 0 ? pool[r.physical].srv : r.srv;
+}
+
+// Get how many passes ran in the last Execute()
+int RenderGraph::GetExecutedPassCount()
+{
+	return (int)order.size();
+}
+
+// Get how many passes were culled in the last Execute()
+int RenderGraph::GetCulledPassCount()
+{
+	return culledPasses;
+}
+
+// Get the number of pooled textures backing transient resources
+int RenderGraph::GetPooledTextureCount()
+{
+	return (int)pool.size();
+}
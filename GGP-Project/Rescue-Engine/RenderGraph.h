@@ -0,0 +1,266 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include <functional>
+#include "RenderStateCache.h"
+
+//Frames an unused pooled texture is kept before it is released
+#define RENDER_GRAPH_POOL_FRAMES 4
+
+class RenderGraph;
+
+// --------------------------------------------------------
+// Handle to a resource in a render graph. Only valid for the
+// frame it was created in
+// --------------------------------------------------------
+typedef int RenderGraphResource;
+
+// --------------------------------------------------------
+// Describes a transient texture. Textures with equal
+// descriptions can share memory when their lifetimes do
+// not overlap
+// --------------------------------------------------------
+struct RenderGraphTextureDesc
+{
+	UINT width;
+	UINT height;
+	DXGI_FORMAT format;
+	bool depth; //bound as a depth buffer instead of a render target
+
+	bool operator==(const RenderGraphTextureDesc& other) const
+	{
+		return width == other.width && height == other.height &&
+			format == other.format && depth == other.depth;
+	}
+};
+
+// --------------------------------------------------------
+// A pass in a render graph and the resources it uses.
+// Returned by RenderGraph::AddPass() to declare them
+// --------------------------------------------------------
+struct RenderGraphPass
+{
+	const char* name;
+	std::function<void(RenderGraph& graph)> execute;
+
+	std::vector<RenderGraphResource> reads;		//Sampled by the pass
+	std::vector<RenderGraphResource> depthTests;	//Depth tested but not written
+	std::vector<RenderGraphResource> writes;	//Written by the pass
+	std::vector<RenderGraphResource> colorTargets;
+	RenderGraphResource depthTarget;
+
+	//Clears done before the pass runs
+	std::vector<float> clearColors; //4 per color target
+	std::vector<bool> clearColorTargets;
+	bool clearDepth;
+
+	bool sideEffects; //Never culled
+	bool live;
+
+	// --------------------------------------------------------
+	// Sample a resource. The graph unbinds its shader resource
+	// view from the slots the pass bound it to afterwards
+	// --------------------------------------------------------
+	RenderGraphPass& Read(RenderGraphResource resource);
+
+	// --------------------------------------------------------
+	// Write a resource the pass binds itself, e.g. a token for
+	// targets owned outside the graph
+	// --------------------------------------------------------
+	RenderGraphPass& Write(RenderGraphResource resource);
+
+	// --------------------------------------------------------
+	// Render to a color target, optionally clearing it first
+	// --------------------------------------------------------
+	RenderGraphPass& WriteColor(RenderGraphResource resource, const float* clearColor = nullptr);
+
+	// --------------------------------------------------------
+	// Bind a depth buffer
+	//
+	// write - whether the pass writes depth, or only tests it
+	// clear - clear depth and stencil before the pass
+	// --------------------------------------------------------
+	RenderGraphPass& UseDepth(RenderGraphResource resource, bool write, bool clear = false);
+
+	// --------------------------------------------------------
+	// Keep the pass even if nothing uses what it writes
+	// --------------------------------------------------------
+	RenderGraphPass& HasSideEffects();
+};
+
+// --------------------------------------------------------
+// One per renderer
+//
+// Rebuilt every frame. Passes declare what they read and
+// write, then Execute() culls passes whose results never
+// reach an imported resource, binds and clears each pass's
+// targets and viewport, and unbinds the views a pass sampled
+// before they can be written again. Only the slots holding
+// those views are touched; depth a pass only tests is never
+// bound as a shader resource, so it is not unbound.
+//
+// Passes run in the order they were added, which is also the
+// order their writes to a shared resource happen in, so add a
+// pass after the passes whose results it uses.
+//
+// Transient textures come from a pool. Textures with the same
+// description whose lifetimes do not overlap share one pooled
+// texture, and pooled textures that go unused for
+// RENDER_GRAPH_POOL_FRAMES frames are released, so resizing
+// the window needs no extra handling.
+// --------------------------------------------------------
+class RenderGraph
+{
+private:
+	// --------------------------------------------------------
+	// A resource declared this frame
+	// --------------------------------------------------------
+	struct Resource
+	{
+		const char* name;
+		bool imported;
+		RenderGraphTextureDesc desc;
+		int physical; //pool index of a transient texture
+
+		//Views of imported resources
+		ID3D11RenderTargetView* rtv;
+		ID3D11DepthStencilView* dsv;
+		ID3D11ShaderResourceView* srv;
+		UINT width;
+		UINT height;
+
+		//Positions in the execution order of the first and last pass using it
+		int firstUse;
+		int lastUse;
+	};
+
+	// --------------------------------------------------------
+	// A pooled texture transient resources are placed in
+	// --------------------------------------------------------
+	struct PooledTexture
+	{
+		RenderGraphTextureDesc desc;
+		ID3D11Texture2D* texture;
+		ID3D11RenderTargetView* rtv;
+		ID3D11DepthStencilView* dsv;
+		ID3D11ShaderResourceView* srv;
+		int busyUntil;		//Last pass using it this frame, -1 if free
+		unsigned int lastFrame;	//Frame it was last used in
+	};
+
+	ID3D11Device* device;
+	unsigned int frame;
+
+	std::vector<Resource> resources;
+	std::vector<RenderGraphPass> passes;
+	std::vector<int> order; //Live passes in execution order
+	int culledPasses;
+	std::vector<PooledTexture> pool;
+
+	// --------------------------------------------------------
+	// Mark the passes that contribute to an imported resource
+	// or have side effects
+	// --------------------------------------------------------
+	void Cull();
+
+	// --------------------------------------------------------
+	// Find resource lifetimes and place transient resources in
+	// pooled textures, sharing them where lifetimes allow
+	// --------------------------------------------------------
+	void Allocate();
+
+	// --------------------------------------------------------
+	// Create a pooled texture and its views
+	// --------------------------------------------------------
+	bool CreatePooledTexture(const RenderGraphTextureDesc& desc, PooledTexture& pooled);
+
+	// --------------------------------------------------------
+	// Release a pooled texture's views and texture
+	// --------------------------------------------------------
+	void ReleasePooledTexture(PooledTexture& pooled);
+
+	// --------------------------------------------------------
+	// Add a resource and get its handle
+	// --------------------------------------------------------
+	RenderGraphResource AddResource(const char* name, bool imported);
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty graph. Call Init() before use
+	// --------------------------------------------------------
+	RenderGraph();
+
+	// --------------------------------------------------------
+	// Release every pooled texture
+	// --------------------------------------------------------
+	~RenderGraph();
+
+	// --------------------------------------------------------
+	// Set the device transient textures are created on
+	// --------------------------------------------------------
+	void Init(ID3D11Device* device);
+
+	// --------------------------------------------------------
+	// Remove every pass and resource to start a new frame
+	// --------------------------------------------------------
+	void Reset();
+
+	// --------------------------------------------------------
+	// Import a render target owned outside the graph
+	// --------------------------------------------------------
+	RenderGraphResource ImportTarget(const char* name, ID3D11RenderTargetView* rtv, UINT width, UINT height);
+
+	// --------------------------------------------------------
+	// Import a depth buffer owned outside the graph
+	// --------------------------------------------------------
+	RenderGraphResource ImportDepth(const char* name, ID3D11DepthStencilView* dsv, UINT width, UINT height);
+
+	// --------------------------------------------------------
+	// Import a resource the graph never binds, only tracks.
+	// Use it for data passes manage themselves, e.g. shadow maps
+	//
+	// srv - the view passes reading it sample, unbound after
+	//       each of them. Null if it is never sampled
+	// --------------------------------------------------------
+	RenderGraphResource Import(const char* name, ID3D11ShaderResourceView* srv = nullptr);
+
+	// --------------------------------------------------------
+	// Declare a transient texture. It only exists while the
+	// passes using it run and its contents do not carry over
+	// between frames
+	// --------------------------------------------------------
+	RenderGraphResource CreateTexture(const char* name, const RenderGraphTextureDesc& desc);
+
+	// --------------------------------------------------------
+	// Add a pass. Declare its resources on the returned pass
+	// before adding the next one
+	//
+	// execute - records the pass's draws
+	// --------------------------------------------------------
+	RenderGraphPass& AddPass(const char* name, std::function<void(RenderGraph& graph)> execute);
+
+	// --------------------------------------------------------
+	// Cull the passes and run the rest
+	// --------------------------------------------------------
+	void Execute(ID3D11DeviceContext* context, RenderStateCache* stateCache);
+
+	// --------------------------------------------------------
+	// Get the shader resource view of a transient texture, or
+	// the one an imported resource was given. Only valid while
+	// a pass that reads it runs
+	// --------------------------------------------------------
+	ID3D11ShaderResourceView* GetSRV(RenderGraphResource resource);
+
+	// --------------------------------------------------------
+	// Get how many passes ran and how many were culled in the
+	// last Execute()
+	// --------------------------------------------------------
+	int GetExecutedPassCount();
+	int GetCulledPassCount();
+
+	// --------------------------------------------------------
+	// Get the number of pooled textures backing transient
+	// resources
+	// --------------------------------------------------------
+	int GetPooledTextureCount();
+};
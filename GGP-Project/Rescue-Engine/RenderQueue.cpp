@@ -0,0 +1,222 @@
+#include "RenderQueue.h"
+#include <cstring>
+#include <cstdio>
+
+//Bits sorted per radix pass
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Construct an empty render queue
+RenderQueue::RenderQueue()
+{ }
+
+// Destructor for when an instance is deleted
+RenderQueue::~RenderQueue()
+{ }
+
+// Build the part of a sort key that does not change between frames
+unsigned long long RenderQueue::MakeKey(RenderPass pass, unsigned int shader, unsigned int material, unsigned int mesh)
+{
+	unsigned long long key = 0;
+	key |= (unsigned long long)((unsigned int)pass & ((1u << RENDER_KEY_PASS_BITS) - 1)) << RENDER_KEY_PASS_SHIFT;
+	key |= (unsigned long long)(shader & ((1u << RENDER_KEY_SHADER_BITS) - 1)) << RENDER_KEY_SHADER_SHIFT;
+	key |= (unsigned long long)(material & ((1u << RENDER_KEY_MATERIAL_BITS) - 1)) << RENDER_KEY_MATERIAL_SHIFT;
+	key |= (unsigned long long)(mesh & ((1u << RENDER_KEY_MESH_BITS) - 1)) << RENDER_KEY_MESH_SHIFT;
+	return key;
+}
+
+// Quantize a non-negative depth into the key's depth bits
+unsigned long long RenderQueue::MakeDepth(float depth)
+{
+	//Positive floats order the same as their bit patterns, so the
+	//top bits (minus the sign) make a cheap monotonic quantization
+	if (!(depth > 0))
+		return 0;
+	unsigned int bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return (unsigned long long)(bits >> (31 - RENDER_KEY_DEPTH_BITS)) << RENDER_KEY_DEPTH_SHIFT;
+}
+
+// Get the pass of a sort key
+RenderPass RenderQueue::GetPass(unsigned long long key)
+{
+	return (RenderPass)((key >> RENDER_KEY_PASS_SHIFT) & ((1u << RENDER_KEY_PASS_BITS) - 1));
+}
+
+// Get the material id of a sort key
+unsigned int RenderQueue::GetMaterial(unsigned long long key)
+{
+	return (unsigned int)((key >> RENDER_KEY_MATERIAL_SHIFT) & ((1u << RENDER_KEY_MATERIAL_BITS) - 1));
+}
+
+// Get the mesh id of a sort key
+unsigned int RenderQueue::GetMesh(unsigned long long key)
+{
+	return (unsigned int)((key >> RENDER_KEY_MESH_SHIFT) & ((1u << RENDER_KEY_MESH_BITS) - 1));
+}
+
+// Remove every packet, keeping the storage
+void RenderQueue::Clear()
+{
+	packets.clear();
+}
+
+// Reserve room for a number of packets
+void RenderQueue::Reserve(size_t count)
+{
+	packets.reserve(count);
+}
+
+// Add a draw packet to the queue
+void RenderQueue::Add(unsigned long long key, unsigned int transformIndex)
+{
+	DrawPacket packet;
+	packet.key = key;
+	packet.transformIndex = transformIndex;
+	packets.push_back(packet);
+}
+
+// Sort the queue by key with an LSD radix sort
+void RenderQueue::Sort()
+{
+	size_t count = packets.size();
+	if (count < 2)
+		return;
+
+	//Bytes that never differ would be a wasted pass
+	unsigned long long orBits = 0;
+	unsigned long long andBits = ~0ull;
+	for (size_t i = 0; i < count; i++)
+	{
+		orBits |= packets[i].key;
+		andBits &= packets[i].key;
+	}
+	unsigned long long varying = orBits ^ andBits;
+	if (varying == 0)
+		return;
+
+	scratch.resize(count);
+	DrawPacket* src = packets.data();
+	DrawPacket* dst = scratch.data();
+
+	for (int shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		if (((varying >> shift) & (RADIX_BUCKETS - 1)) == 0)
+			continue;
+
+		//Count each digit
+		size_t offsets[RADIX_BUCKETS] = {};
+		for (size_t i = 0; i < count; i++)
+			offsets[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+
+		//Turn counts into starting offsets
+		size_t total = 0;
+		for (int b = 0; b < RADIX_BUCKETS; b++)
+		{
+			size_t c = offsets[b];
+			offsets[b] = total;
+			total += c;
+		}
+
+		//Scatter
+		for (size_t i = 0; i < count; i++)
+			dst[offsets[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+
+		DrawPacket* temp = src;
+		src = dst;
+		dst = temp;
+	}
+
+	//Make sure the result ends up in packets
+	if (src != packets.data())
+		packets.swap(scratch);
+}
+
+// Find the packets of a pass in a sorted queue
+size_t RenderQueue::GetPassRange(RenderPass pass, size_t& first) const
+{
+	size_t count = packets.size();
+	size_t i = 0;
+	while (i < count && GetPass(packets[i].key) < pass)
+		i++;
+	first = i;
+	while (i < count && GetPass(packets[i].key) == pass)
+		i++;
+	return i - first;
+}
+
+// Get the packets in the queue
+const DrawPacket* RenderQueue::GetPackets() const
+{
+	return packets.data();
+}
+
+// Get the number of packets in the queue
+size_t RenderQueue::GetCount() const
+{
+	return packets.size();
+}
+
+// Construct an empty id table
+RenderIdTable::RenderIdTable(const char* kind, unsigned int limit)
+{
+	this->kind = kind;
+	this->limit = limit;
+	nextId = 0;
+	warned = false;
+}
+
+// Get an object's id, assigning one the first time it is seen
+unsigned int RenderIdTable::Acquire(const void* object)
+{
+	auto it = entries.find(object);
+	if (it != entries.end())
+	{
+		it->second.users++;
+		return it->second.id;
+	}
+
+	//Reuse freed ids first so they stay small
+	unsigned int id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else id = nextId++;
+
+	if (id >= limit)
+	{
+		if (!warned)
+			printf("More than %u %s are in use, their sort keys will share ids\n", limit, kind);
+		warned = true;
+		id %= limit;
+	}
+
+	entries.emplace(object, Entry{ id, 1 });
+	return id;
+}
+
+// Count one less user of an object
+void RenderIdTable::Release(const void* object)
+{
+	auto it = entries.find(object);
+	if (it == entries.end())
+		return;
+
+	if (--it->second.users > 0)
+		return;
+
+	//Once ids have wrapped a freed id can still belong to another
+	//object, so recycling stops
+	unsigned int id = it->second.id;
+	entries.erase(it);
+	if (nextId <= limit)
+		freeIds.push_back(id);
+}
+
+// Get the number of objects that have an id
+size_t RenderIdTable::GetCount() const
+{
+	return entries.size();
+}
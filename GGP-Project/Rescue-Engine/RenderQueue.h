@@ -0,0 +1,189 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Bit layout of a draw packet's sort key, high bits first:
+//   pass (4) | shader (12) | material (12) | mesh (12) | depth (24)
+// Sorting by key groups draws by pass, then by the most
+// expensive state to change, and finally by depth. The
+// renderer gives each of a mesh's detail levels its own
+// mesh id (see MESH_MAX_LODS)
+// --------------------------------------------------------
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_SHADER_BITS 12
+#define RENDER_KEY_MATERIAL_BITS 12
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24
+
+#define RENDER_KEY_DEPTH_SHIFT 0
+#define RENDER_KEY_MESH_SHIFT (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT (RENDER_KEY_MESH_SHIFT + RENDER_KEY_MESH_BITS)
+#define RENDER_KEY_SHADER_SHIFT (RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT (RENDER_KEY_SHADER_SHIFT + RENDER_KEY_SHADER_BITS)
+
+// --------------------------------------------------------
+// The passes a draw packet can belong to, in draw order
+// --------------------------------------------------------
+enum class RenderPass : unsigned char
+{
+	StaticShadow = 0,
+	Shadow = 1,
+	Opaque = 2
+};
+
+// --------------------------------------------------------
+// A single draw in the render queue
+// --------------------------------------------------------
+struct DrawPacket
+{
+	unsigned long long key;
+	unsigned int transformIndex; //index into the frame's transforms
+};
+
+// --------------------------------------------------------
+// A per-frame list of draw packets.
+//
+// Filled every frame, sorted with an LSD radix sort and
+// then walked linearly. Storage is kept between frames so
+// steady state frames do not allocate.
+// --------------------------------------------------------
+class RenderQueue
+{
+private:
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> scratch;
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty render queue
+	// --------------------------------------------------------
+	RenderQueue();
+	~RenderQueue();
+
+	// --------------------------------------------------------
+	// Build the part of a sort key that does not change
+	// between frames. Ids are masked to their field width
+	//
+	// pass - the pass the draw belongs to
+	// shader - the shader id
+	// material - the material id
+	// mesh - the mesh id
+	// --------------------------------------------------------
+	static unsigned long long MakeKey(RenderPass pass, unsigned int shader, unsigned int material, unsigned int mesh);
+
+	// --------------------------------------------------------
+	// Quantize a non-negative depth into the key's depth bits.
+	// Monotonic, so closer objects always sort first
+	//
+	// depth - the (squared) distance from the viewer
+	// --------------------------------------------------------
+	static unsigned long long MakeDepth(float depth);
+
+	// --------------------------------------------------------
+	// Get a field back out of a sort key
+	// --------------------------------------------------------
+	static RenderPass GetPass(unsigned long long key);
+	static unsigned int GetMaterial(unsigned long long key);
+	static unsigned int GetMesh(unsigned long long key);
+
+	// --------------------------------------------------------
+	// Remove every packet, keeping the storage
+	// --------------------------------------------------------
+	void Clear();
+
+	// --------------------------------------------------------
+	// Reserve room for a number of packets
+	// --------------------------------------------------------
+	void Reserve(size_t count);
+
+	// --------------------------------------------------------
+	// Add a draw packet to the queue
+	//
+	// key - the packet's sort key
+	// transformIndex - index of the packet's transform
+	// --------------------------------------------------------
+	void Add(unsigned long long key, unsigned int transformIndex);
+
+	// --------------------------------------------------------
+	// Sort the queue by key. Stable, linear in the packet count.
+	// Byte positions that are the same in every key are skipped
+	// --------------------------------------------------------
+	void Sort();
+
+	// --------------------------------------------------------
+	// Find the packets of a pass in a sorted queue
+	//
+	// pass - the pass to look for
+	// first - set to the index of the first packet in the pass
+	// Returns the number of packets in the pass
+	// --------------------------------------------------------
+	size_t GetPassRange(RenderPass pass, size_t& first) const;
+
+	// --------------------------------------------------------
+	// Get the packets in the queue
+	// --------------------------------------------------------
+	const DrawPacket* GetPackets() const;
+
+	// --------------------------------------------------------
+	// Get the number of packets in the queue
+	// --------------------------------------------------------
+	size_t GetCount() const;
+};
+
+// --------------------------------------------------------
+// Hands out the small ids objects go by in sort keys
+//
+// An object keeps its id while anything uses it, and the id
+// is recycled once nothing does, so ids fit their key field
+// as long as no more objects than that are in use at once.
+// Past that, ids wrap and a warning is printed once; the
+// renderer compares the objects themselves wherever a
+// shared id would matter, so that only costs sorting
+// --------------------------------------------------------
+class RenderIdTable
+{
+private:
+	// --------------------------------------------------------
+	// An object's id and how many users it has
+	// --------------------------------------------------------
+	struct Entry
+	{
+		unsigned int id;
+		unsigned int users;
+	};
+
+	std::unordered_map<const void*, Entry> entries;
+	std::vector<unsigned int> freeIds;
+	unsigned int nextId;
+	unsigned int limit;
+	const char* kind;
+	bool warned;
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty table
+	//
+	// kind - what the ids are for, used in the warning
+	// limit - ids must be below this to fit the key field
+	// --------------------------------------------------------
+	RenderIdTable(const char* kind, unsigned int limit);
+
+	// --------------------------------------------------------
+	// Get an object's id and count one more user of it,
+	// assigning an id the first time the object is seen
+	// --------------------------------------------------------
+	unsigned int Acquire(const void* object);
+
+	// --------------------------------------------------------
+	// Count one less user of an object, freeing its id once
+	// it has none left
+	// --------------------------------------------------------
+	void Release(const void* object);
+
+	// --------------------------------------------------------
+	// Get the number of objects that have an id
+	// --------------------------------------------------------
+	size_t GetCount() const;
+};
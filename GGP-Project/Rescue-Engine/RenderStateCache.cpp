@@ -0,0 +1,274 @@
+#include "RenderStateCache.h"
+#include "ExtendedMath.h"
+#include <stdio.h>
+#include <string.h>
+
+// Find or create a state object for a descriptor
+template<typename S, typename D, typename F>
+static S* GetCachedState(std::unordered_multimap<unsigned long long, CachedState<S, D>>& states, const D& desc, F create)
+{
+	//The hash only narrows the search, the descriptor has to match
+	unsigned long long hash = ExtendedMath::HashBytes(&desc, sizeof(D));
+	auto range = states.equal_range(hash);
+	for (auto found = range.first; found != range.second; ++found)
+	{
+		if (memcmp(&found->second.desc, &desc, sizeof(D)) == 0)
+			return found->second.state;
+	}
+
+	S* state = nullptr;
+	if (FAILED(create(&desc, &state)))
+	{
+		printf("Could not create a pipeline state object\n");
+		return nullptr;
+	}
+	CachedState<S, D> cached = { desc, state };
+	states.emplace(hash, cached);
+	return state;
+}
+
+// Release every state object in a cache
+template<typename S, typename D>
+static void ReleaseStates(std::unordered_multimap<unsigned long long, CachedState<S, D>>& states)
+{
+	for (auto& pair : states)
+		pair.second.state->Release();
+	states.clear();
+}
+
+// Constructor - Call Init() before use
+RenderStateCache::RenderStateCache()
+{
+	device = nullptr;
+	context = nullptr;
+	skippedCalls = 0;
+	Invalidate();
+}
+
+// Release every cached state object
+RenderStateCache::~RenderStateCache()
+{
+	ReleaseStates(rasterizerStates);
+	ReleaseStates(blendStates);
+	ReleaseStates(depthStencilStates);
+	ReleaseStates(samplerStates);
+}
+
+// Set the device state objects are created on
+void RenderStateCache::Init(ID3D11Device* device)
+{
+	this->device = device;
+}
+
+// Start tracking a context for a frame
+void RenderStateCache::BeginFrame(ID3D11DeviceContext* context)
+{
+	this->context = context;
+	skippedCalls = 0;
+	Invalidate();
+}
+
+// Forget all bindings
+void RenderStateCache::Invalidate()
+{
+	inputLayout.known = false;
+	vertexShader.known = false;
+	pixelShader.known = false;
+	for (int i = 0; i < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; i++)
+	{
+		vsConstantBuffers[i].known = false;
+		psConstantBuffers[i].known = false;
+	}
+	ForgetResources();
+	for (int i = 0; i < STATE_CACHE_SAMPLER_SLOTS; i++)
+		psSamplers[i].known = false;
+	for (int i = 0; i < STATE_CACHE_VERTEX_BUFFER_SLOTS; i++)
+		vertexBuffers[i].known = false;
+	indexBuffer.known = false;
+	rasterizerState.known = false;
+	blendState.known = false;
+	depthStencilState.known = false;
+}
+
+// Forget the shader resources
+void RenderStateCache::ForgetResources()
+{
+	for (int i = 0; i < STATE_CACHE_SRV_SLOTS; i++)
+		psResources[i].known = false;
+}
+
+// Get the context being tracked
+ID3D11DeviceContext* RenderStateCache::GetContext()
+{
+	return context;
+}
+
+// Get how many calls were dropped since BeginFrame()
+unsigned int RenderStateCache::GetSkippedCalls()
+{
+	return skippedCalls;
+}
+
+// Bind an input layout
+void RenderStateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (!inputLayout.Update(layout)) { skippedCalls++; return; }
+	context->IASetInputLayout(layout);
+}
+
+// Bind a vertex shader
+void RenderStateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (!vertexShader.Update(shader)) { skippedCalls++; return; }
+	context->VSSetShader(shader, 0, 0);
+}
+
+// Bind a pixel shader, or null to turn the stage off
+void RenderStateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (!pixelShader.Update(shader)) { skippedCalls++; return; }
+	context->PSSetShader(shader, 0, 0);
+}
+
+// Bind a vertex shader constant buffer
+void RenderStateCache::SetVSConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	if (slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT && !vsConstantBuffers[slot].Update(buffer)) { skippedCalls++; return; }
+	context->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+// Bind a pixel shader constant buffer
+void RenderStateCache::SetPSConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	if (slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT && !psConstantBuffers[slot].Update(buffer)) { skippedCalls++; return; }
+	context->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+// Bind a pixel shader resource
+void RenderStateCache::SetPSShaderResource(UINT slot, ID3D11ShaderResourceView* srv)
+{
+	if (slot < STATE_CACHE_SRV_SLOTS && !psResources[slot].Update(srv)) { skippedCalls++; return; }
+	context->PSSetShaderResources(slot, 1, &srv);
+}
+
+// Bind a pixel shader sampler
+void RenderStateCache::SetPSSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if (slot < STATE_CACHE_SAMPLER_SLOTS && !psSamplers[slot].Update(sampler)) { skippedCalls++; return; }
+	context->PSSetSamplers(slot, 1, &sampler);
+}
+
+// Get the shader resource bound to a pixel shader slot
+ID3D11ShaderResourceView* RenderStateCache::GetPSShaderResource(UINT slot)
+{
+	if (slot >= STATE_CACHE_SRV_SLOTS || !psResources[slot].known)
+		return nullptr;
+	return psResources[slot].value;
+}
+
+// Get the sampler bound to a pixel shader slot
+ID3D11SamplerState* RenderStateCache::GetPSSampler(UINT slot)
+{
+	if (slot >= STATE_CACHE_SAMPLER_SLOTS || !psSamplers[slot].known)
+		return nullptr;
+	return psSamplers[slot].value;
+}
+
+// Bind a vertex buffer
+void RenderStateCache::SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	VertexBufferBinding binding = { buffer, stride, offset };
+	if (slot < STATE_CACHE_VERTEX_BUFFER_SLOTS && !vertexBuffers[slot].Update(binding)) { skippedCalls++; return; }
+	context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+// Bind an index buffer
+void RenderStateCache::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	IndexBufferBinding binding = { buffer, format, offset };
+	if (!indexBuffer.Update(binding)) { skippedCalls++; return; }
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+// Bind a rasterizer state, or null for the default
+void RenderStateCache::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	if (!rasterizerState.Update(state)) { skippedCalls++; return; }
+	context->RSSetState(state);
+}
+
+// Bind a blend state, or null for the default
+void RenderStateCache::SetBlendState(ID3D11BlendState* state, UINT sampleMask)
+{
+	StateBinding<ID3D11BlendState, UINT> binding = { state, sampleMask };
+	if (!blendState.Update(binding)) { skippedCalls++; return; }
+	context->OMSetBlendState(state, 0, sampleMask);
+}
+
+// Bind a depth stencil state, or null for the default
+void RenderStateCache::SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	StateBinding<ID3D11DepthStencilState, UINT> binding = { state, stencilRef };
+	if (!depthStencilState.Update(binding)) { skippedCalls++; return; }
+	context->OMSetDepthStencilState(state, stencilRef);
+}
+
+// Unbind the pixel shader resources in [0, count)
+void RenderStateCache::ClearPSShaderResources(UINT count)
+{
+	ID3D11ShaderResourceView* nullSRVs[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+	if (count > D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT)
+		count = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	context->PSSetShaderResources(0, count, nullSRVs);
+
+	for (UINT i = 0; i < count && i < STATE_CACHE_SRV_SLOTS; i++)
+		psResources[i].Update(nullptr);
+}
+
+// Unbind a view from every pixel shader slot it is bound to
+void RenderStateCache::UnbindPSShaderResource(ID3D11ShaderResourceView* srv)
+{
+	if (srv == nullptr)
+		return;
+
+	for (UINT i = 0; i < STATE_CACHE_SRV_SLOTS; i++)
+	{
+		if (psResources[i].known && psResources[i].value == srv)
+			SetPSShaderResource(i, nullptr);
+	}
+}
+
+// Bind render targets
+void RenderStateCache::SetRenderTargets(UINT count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv)
+{
+	context->OMSetRenderTargets(count, rtvs, dsv);
+	ForgetResources();
+}
+
+// Get a rasterizer state for a descriptor
+ID3D11RasterizerState* RenderStateCache::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+{
+	return GetCachedState(rasterizerStates, desc,
+		[this](const D3D11_RASTERIZER_DESC* d, ID3D11RasterizerState** s) { return device->CreateRasterizerState(d, s); });
+}
+
+// Get a blend state for a descriptor
+ID3D11BlendState* RenderStateCache::GetBlendState(const D3D11_BLEND_DESC& desc)
+{
+	return GetCachedState(blendStates, desc,
+		[this](const D3D11_BLEND_DESC* d, ID3D11BlendState** s) { return device->CreateBlendState(d, s); });
+}
+
+// Get a depth stencil state for a descriptor
+ID3D11DepthStencilState* RenderStateCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+	return GetCachedState(depthStencilStates, desc,
+		[this](const D3D11_DEPTH_STENCIL_DESC* d, ID3D11DepthStencilState** s) { return device->CreateDepthStencilState(d, s); });
+}
+
+// Get a sampler state for a descriptor
+ID3D11SamplerState* RenderStateCache::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+{
+	return GetCachedState(samplerStates, desc,
+		[this](const D3D11_SAMPLER_DESC* d, ID3D11SamplerState** s) { return device->CreateSamplerState(d, s); });
+}
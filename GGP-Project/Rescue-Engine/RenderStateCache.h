@@ -0,0 +1,221 @@
+#pragma once
+#include <d3d11.h>
+#include <unordered_map>
+
+//Shader resource and sampler slots the cache tracks.
+//Binds to higher slots are always passed through
+#define STATE_CACHE_SRV_SLOTS 16
+#define STATE_CACHE_SAMPLER_SLOTS 16
+#define STATE_CACHE_VERTEX_BUFFER_SLOTS 2
+
+// --------------------------------------------------------
+// A binding the cache last set, or unknown after Invalidate()
+// --------------------------------------------------------
+template<typename T>
+struct CachedBinding
+{
+	T value;
+	bool known;
+
+	// Remember a new value. Returns false if it is already bound
+	bool Update(const T& newValue)
+	{
+		if (known && value == newValue)
+			return false;
+		value = newValue;
+		known = true;
+		return true;
+	}
+};
+
+// --------------------------------------------------------
+// A vertex buffer slot binding
+// --------------------------------------------------------
+struct VertexBufferBinding
+{
+	ID3D11Buffer* buffer;
+	UINT stride;
+	UINT offset;
+
+	bool operator==(const VertexBufferBinding& other) const
+	{
+		return buffer == other.buffer && stride == other.stride && offset == other.offset;
+	}
+};
+
+// --------------------------------------------------------
+// An index buffer binding
+// --------------------------------------------------------
+struct IndexBufferBinding
+{
+	ID3D11Buffer* buffer;
+	DXGI_FORMAT format;
+	UINT offset;
+
+	bool operator==(const IndexBufferBinding& other) const
+	{
+		return buffer == other.buffer && format == other.format && offset == other.offset;
+	}
+};
+
+// --------------------------------------------------------
+// An output merger state object plus its extra parameters
+// --------------------------------------------------------
+template<typename T, typename P>
+struct StateBinding
+{
+	T* state;
+	P param;
+
+	bool operator==(const StateBinding& other) const
+	{
+		return state == other.state && param == other.param;
+	}
+};
+
+// --------------------------------------------------------
+// A cached state object and the descriptor it was made from
+// --------------------------------------------------------
+template<typename S, typename D>
+struct CachedState
+{
+	D desc;
+	S* state;
+};
+
+// --------------------------------------------------------
+// One per renderer
+//
+// Thin layer over a device context that remembers what is
+// bound and drops calls that would not change anything.
+// Everything the renderer and SimpleShader bind during a
+// frame goes through it; anything bound behind its back must
+// be followed by Invalidate(). Shaders are handed the cache
+// with ISimpleShader::SetStateCache().
+//
+// It also caches immutable state objects by their descriptor,
+// so equal descriptors share one object. Zero-initialize
+// descriptors (= {}) so unused fields hash the same.
+// --------------------------------------------------------
+class RenderStateCache
+{
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	//Current bindings
+	CachedBinding<ID3D11InputLayout*> inputLayout;
+	CachedBinding<ID3D11VertexShader*> vertexShader;
+	CachedBinding<ID3D11PixelShader*> pixelShader;
+	CachedBinding<ID3D11Buffer*> vsConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	CachedBinding<ID3D11Buffer*> psConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	CachedBinding<ID3D11ShaderResourceView*> psResources[STATE_CACHE_SRV_SLOTS];
+	CachedBinding<ID3D11SamplerState*> psSamplers[STATE_CACHE_SAMPLER_SLOTS];
+	CachedBinding<VertexBufferBinding> vertexBuffers[STATE_CACHE_VERTEX_BUFFER_SLOTS];
+	CachedBinding<IndexBufferBinding> indexBuffer;
+	CachedBinding<ID3D11RasterizerState*> rasterizerState;
+	CachedBinding<StateBinding<ID3D11BlendState, UINT>> blendState; //param is the sample mask
+	CachedBinding<StateBinding<ID3D11DepthStencilState, UINT>> depthStencilState; //param is the stencil ref
+
+	//Immutable state objects by descriptor hash. Equal hashes
+	//are told apart by their descriptors
+	std::unordered_multimap<unsigned long long, CachedState<ID3D11RasterizerState, D3D11_RASTERIZER_DESC>> rasterizerStates;
+	std::unordered_multimap<unsigned long long, CachedState<ID3D11BlendState, D3D11_BLEND_DESC>> blendStates;
+	std::unordered_multimap<unsigned long long, CachedState<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC>> depthStencilStates;
+	std::unordered_multimap<unsigned long long, CachedState<ID3D11SamplerState, D3D11_SAMPLER_DESC>> samplerStates;
+
+	//Calls dropped since the last BeginFrame()
+	unsigned int skippedCalls;
+
+	// --------------------------------------------------------
+	// Forget the shader resources. Binding a render target or
+	// depth buffer silently unbinds it where it was an input
+	// --------------------------------------------------------
+	void ForgetResources();
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty cache. Call Init() before use
+	// --------------------------------------------------------
+	RenderStateCache();
+
+	// --------------------------------------------------------
+	// Release every cached state object
+	// --------------------------------------------------------
+	~RenderStateCache();
+
+	// --------------------------------------------------------
+	// Set the device state objects are created on
+	// --------------------------------------------------------
+	void Init(ID3D11Device* device);
+
+	// --------------------------------------------------------
+	// Start tracking a context for a frame. Forgets everything
+	// bound before, since other code may have changed it
+	// --------------------------------------------------------
+	void BeginFrame(ID3D11DeviceContext* context);
+
+	// --------------------------------------------------------
+	// Forget all bindings, so the next bind of each goes through
+	// --------------------------------------------------------
+	void Invalidate();
+
+	// --------------------------------------------------------
+	// Get the context being tracked
+	// --------------------------------------------------------
+	ID3D11DeviceContext* GetContext();
+
+	// --------------------------------------------------------
+	// Get how many calls were dropped since BeginFrame()
+	// --------------------------------------------------------
+	unsigned int GetSkippedCalls();
+
+	// --------------------------------------------------------
+	// Bind pipeline state, skipping anything already bound
+	// --------------------------------------------------------
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetVSConstantBuffer(UINT slot, ID3D11Buffer* buffer);
+	void SetPSConstantBuffer(UINT slot, ID3D11Buffer* buffer);
+	void SetPSShaderResource(UINT slot, ID3D11ShaderResourceView* srv);
+	void SetPSSampler(UINT slot, ID3D11SamplerState* sampler);
+	void SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetBlendState(ID3D11BlendState* state, UINT sampleMask = 0xFFFFFFFF);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef = 0);
+
+	// --------------------------------------------------------
+	// Get what the cache has bound to a pixel shader slot, or
+	// null if it is unbound or unknown
+	// --------------------------------------------------------
+	ID3D11ShaderResourceView* GetPSShaderResource(UINT slot);
+	ID3D11SamplerState* GetPSSampler(UINT slot);
+
+	// --------------------------------------------------------
+	// Unbind the pixel shader resources in [0, count)
+	// --------------------------------------------------------
+	void ClearPSShaderResources(UINT count);
+
+	// --------------------------------------------------------
+	// Unbind a view from every pixel shader slot the cache
+	// knows it is bound to
+	// --------------------------------------------------------
+	void UnbindPSShaderResource(ID3D11ShaderResourceView* srv);
+
+	// --------------------------------------------------------
+	// Bind render targets. Always passed through, and forgets
+	// the shader resources it may have unbound
+	// --------------------------------------------------------
+	void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv);
+
+	// --------------------------------------------------------
+	// Get a state object for a descriptor, creating it the
+	// first time. The cache owns it; do not release it
+	// --------------------------------------------------------
+	ID3D11RasterizerState* GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+	ID3D11BlendState* GetBlendState(const D3D11_BLEND_DESC& desc);
+	ID3D11DepthStencilState* GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+	ID3D11SamplerState* GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+};
@@ -1,17 +1,134 @@
 #include "Renderer.h"
 #include "LightManager.h"
 #include "ResourceManager.h"
+#include "EngineContext.h"
+#include "ExtendedMath.h"
+#include "DrawRecorder.h"
+#include "WorkerPool.h"
 #include <algorithm>
+#include <cmath>
 
 #define FXAA_ENABLED 1
 #define FXAA_PRESET 5
 #define FXAA_DEBUG 0
 
+//Starting size of the transient upload ring. It grows if a frame needs more
+#define TRANSIENT_RING_SIZE (256 * 1024)
+
+//Opaque packets per recorded command list, and the most threads recording them
+#define RENDER_RECORD_SEGMENT_PACKETS 256
+#define RENDER_RECORD_MAX_THREADS 4
+
+//Start with the depth pre-pass on. Toggle with SetDepthPrePass()
+#define RENDER_DEPTH_PRE_PASS 1
+
+//FXAA shader variables, resolved to handles once in Init()
+enum FXAAVariable
+{
+	FXAA_VAR_RESOLUTION,
+	FXAA_VAR_EDGE_THRESHOLD,
+	FXAA_VAR_EDGE_THRESHOLD_MIN,
+	FXAA_VAR_SEARCH_THRESHOLD,
+	FXAA_VAR_SUBPIX_CAP,
+	FXAA_VAR_SUBPIX_TRIM,
+	FXAA_VAR_DEBUG_GRAYSCALE,
+	FXAA_VAR_ENABLED,
+	FXAA_VAR_SEARCH_STEPS,
+	FXAA_VAR_SEARCH_ACCELERATION,
+	FXAA_VAR_SUBPIX,
+	FXAA_VAR_SUBPIX_FASTER,
+	FXAA_VAR_LUMINANCE_METHOD,
+	FXAA_VAR_DEBUG_DISCARD,
+	FXAA_VAR_DEBUG_PASSTHROUGH,
+	FXAA_VAR_DEBUG_HORZVERT,
+	FXAA_VAR_DEBUG_PAIR,
+	FXAA_VAR_DEBUG_NEGPOS,
+	FXAA_VAR_DEBUG_OFFSET,
+	FXAA_VAR_DEBUG_HIGHLIGHT,
+	FXAA_VAR_DEBUG_GRAYSCALE_CHANNEL,
+	FXAA_VAR_COUNT
+};
+
+static const char* fxaaVariableNames[FXAA_VAR_COUNT] =
+{
+	"textureResolution",
+	"FXAA_EDGE_THRESHOLD",
+	"FXAA_EDGE_THRESHOLD_MIN",
+	"FXAA_SEARCH_THRESHOLD",
+	"FXAA_SUBPIX_CAP",
+	"FXAA_SUBPIX_TRIM",
+	"FXAA_DEBUG_GRAYSCALE",
+	"FXAA_ENABLED",
+	"FXAA_SEARCH_STEPS",
+	"FXAA_SEARCH_ACCELERATION",
+	"FXAA_SUBPIX",
+	"FXAA_SUBPIX_FASTER",
+	"FXAA_LUMINANCE_METHOD",
+	"FXAA_DEBUG_DISCARD",
+	"FXAA_DEBUG_PASSTHROUGH",
+	"FXAA_DEBUG_HORZVERT",
+	"FXAA_DEBUG_PAIR",
+	"FXAA_DEBUG_NEGPOS",
+	"FXAA_DEBUG_OFFSET",
+	"FXAA_DEBUG_HIGHLIGHT",
+	"FXAA_DEBUG_GRAYSCALE_CHANNEL"
+};
+
 using namespace DirectX;
 
+// Constructor - Device resources are created later in Init()
+Renderer::Renderer() :
+	shaderIds("shaders", 1u << RENDER_KEY_SHADER_BITS),
+	materialIds("materials", 1u << RENDER_KEY_MATERIAL_BITS),
+	meshIds("meshes", (1u << RENDER_KEY_MESH_BITS) / MESH_MAX_LODS)
+{
+	cubeMesh = nullptr;
+	instanceOffset = 0;
+	vs_debug = nullptr;
+	ps_debug = nullptr;
+	debugOverlayDepthState = nullptr;
+	waterMat = nullptr;
+	water = nullptr;
+	waterBlendState = nullptr;
+	waterDepthState = nullptr;
+	skyboxMat = nullptr;
+	skyRasterState = nullptr;
+	skyDepthState = nullptr;
+	opaqueDepthState = nullptr;
+	shadowRasterizer = nullptr;
+	shadowVS = nullptr;
+	fxaaVS = nullptr;
+	fxaaPS = nullptr;
+	fxaaSettings = nullptr;
+}
+
+// Get the renderer of the current context
+Renderer* Renderer::GetInstance()
+{
+	return EngineContext::GetCurrent()->GetRenderer();
+}
+
+// Get the state cache everything this renderer draws binds through
+RenderStateCache* Renderer::GetStateCache()
+{
+	return &stateCache;
+}
+
+// Get the debug drawer whose lines this renderer draws
+DebugDraw* Renderer::GetDebugDraw()
+{
+	return &debugDraw;
+}
+
 // Initialize values in the renderer
 void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 {
+	stateCache.Init(device);
+	commandBackend.Init(&stateCache);
+	occlusionCuller.Init();
+	occlusionCulling = true;
+	depthPrePass = RENDER_DEPTH_PRE_PASS != 0;
+
 	// Assign default clear color. We should pull this in from Game at some point.
 	this->SetClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
@@ -31,13 +148,21 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	skyRD.CullMode = D3D11_CULL_FRONT;
 	skyRD.FillMode = D3D11_FILL_SOLID;
 	skyRD.DepthClipEnable = true;
-	device->CreateRasterizerState(&skyRD, &skyRasterState);
+	skyRasterState = stateCache.GetRasterizerState(skyRD);
 
 	D3D11_DEPTH_STENCIL_DESC skyDS = {};
 	skyDS.DepthEnable = true;
 	skyDS.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
 	skyDS.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&skyDS, &skyDepthState);
+	skyDepthState = stateCache.GetDepthStencilState(skyDS);
+
+	// --------------------------------------------------------
+	//Opaque objects pass where they match the depth pre-pass
+	D3D11_DEPTH_STENCIL_DESC opaqueDS = {};
+	opaqueDS.DepthEnable = true;
+	opaqueDS.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	opaqueDS.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	opaqueDepthState = stateCache.GetDepthStencilState(opaqueDS);
 
 	// --------------------------------------------------------
 	//Set states for water
@@ -45,7 +170,7 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	// Depth state
 	D3D11_DEPTH_STENCIL_DESC ds = {};
 	ds.DepthEnable = true;
-	device->CreateDepthStencilState(&ds, &waterDepthState);
+	waterDepthState = stateCache.GetDepthStencilState(ds);
 	//context->OMSetDepthStencilState(waterDepthState, 0);
 
 	//blend
@@ -62,7 +187,7 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
 	bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
 	bd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-	device->CreateBlendState(&bd, &waterBlendState);
+	waterBlendState = stateCache.GetBlendState(bd);
 
 	//DEBUG water
 	water = new Entity(
@@ -74,6 +199,11 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	// --------------------------------------------------------
 	//Get shadow information
 	shadowVS = ResourceManager::GetInstance()->GetVertexShader("VS_Shadow.cso");
+	shadowViewHandle = shadowVS->GetVariableHandle("view");
+	shadowProjHandle = shadowVS->GetVariableHandle("projection");
+	shadowWorldHandle = shadowVS->GetVariableHandle("world");
+	shadowOnceBuffer = shadowVS->GetBufferIndex("once");
+	shadowPerObjectBuffer = shadowVS->GetBufferIndex("perObject");
 
 	// Create a rasterizer state
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
@@ -83,7 +213,7 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	shadowRastDesc.DepthBias = 1000; // Multiplied by (smallest possible value > 0 in depth buffer)
 	shadowRastDesc.DepthBiasClamp = 0.0f;
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f;
-	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	shadowRasterizer = stateCache.GetRasterizerState(shadowRastDesc);
 
 
 	// --------------------------------------------------------
@@ -111,41 +241,37 @@ void Renderer::Init(ID3D11Device* device, UINT width, UINT height)
 	fxaaSettings->DEBUG_GRAYSCALE_CHANNEL = 1;
 #endif
 
-	CreatePostProcessingResources(device, width, height);
+	renderGraph.Init(device);
 
 	// Get fxaa shader information.
 	fxaaVS = ResourceManager::GetInstance()->GetVertexShader("FXAAShaderVS.cso");
 	fxaaPS = ResourceManager::GetInstance()->GetPixelShader("FXAAShaderPS.cso");
+	fxaaHandles.resize(FXAA_VAR_COUNT);
+	for (int i = 0; i < FXAA_VAR_COUNT; i++)
+		fxaaHandles[i] = fxaaPS->GetVariableHandle(fxaaVariableNames[i]);
 
-	//Wireframe rasterizer state
-	D3D11_RASTERIZER_DESC RD_wireframe = {};
-	RD_wireframe.FillMode = D3D11_FILL_WIREFRAME;
-	RD_wireframe.CullMode = D3D11_CULL_NONE;
-	device->CreateRasterizerState(&RD_wireframe, &RS_wireframe);
+	//Overlay debug lines ignore the depth buffer
+	D3D11_DEPTH_STENCIL_DESC overlayDepthDesc = {};
+	overlayDepthDesc.DepthEnable = false;
+	overlayDepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	overlayDepthDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	debugOverlayDepthState = stateCache.GetDepthStencilState(overlayDepthDesc);
+
+	// --------------------------------------------------------
+	//Transient data: instance data for instanced materials and debug lines
+	transientRing.Init(device, TRANSIENT_RING_SIZE, D3D11_BIND_VERTEX_BUFFER);
 }
 
-// Destructor for when the singleton instance is deleted
+// Destructor for when the context is deleted
 Renderer::~Renderer()
 {
-	// Clean up rasterizer state.
-	RS_wireframe->Release();
-
-	//Clean up skybox
-	skyDepthState->Release();
-	skyRasterState->Release();
-
-	//Clean up water
-	waterBlendState->Release();
-	if(waterDepthState != nullptr) waterDepthState->Release();
 	//delete water;
 
-	//Clean up shadow map
-	shadowRasterizer->Release();
-
 	// Clean up post process.
-	fxaaRTV->Release();
-	fxaaSRV->Release();
-	delete fxaaSettings;
+	if (fxaaSettings != nullptr) delete fxaaSettings;
+
+	for (size_t i = 0; i < staticBatches.size(); i++)
+		delete staticBatches[i];
 }
 
 // Draw all entities in the render list
@@ -157,200 +283,540 @@ void Renderer::Draw(ID3D11DeviceContext* context,
 					ID3D11SamplerState* sampler,
 					UINT width, UINT height)
 {
-	// Clear the render target and depth buffer (erases what's on the screen)
-	//  - Do this ONCE PER FRAME
-	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV, this->clearColor);
-	context->ClearDepthStencilView(
-		depthStencilView,
-		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-		1.0f,
-		0);
+	//Other code may have bound anything since the last frame
+	stateCache.BeginFrame(context);
+
+	BuildRenderQueue(camera);
 
-	RenderShadowMaps(context, device, camera, backBufferRTV, depthStencilView, width, height);
+	transientRing.BeginFrame(context);
+	UploadInstances(context);
+	RecordOpaqueObjects();
 
-	PreparePostProcess(context, fxaaRTV, depthStencilView);
+	//The opaque pass adds its lists as it draws them
+	if (!capturePath.empty())
+	{
+		capture.Clear();
+		capture.BeginPass("Opaque");
+	}
 
-	DrawOpaqueObjects(context, camera);
+	LightManager::GetInstance()->BuildClusters(context, device, camera, width, height);
 
-	DrawSky(context, camera);
+	//Create shadow maps up front so the graph knows the view materials
+	//sample, which is the first shadow casting light's
+	std::vector<Light*> shadowLights = LightManager::GetInstance()->GetShadowCastingLights();
+	for (auto l : shadowLights)
+	{
+		if (l->GetShadowSRV() == nullptr)
+			l->InitShadowMap(device);
+	}
+	ID3D11ShaderResourceView* shadowSRV = shadowLights.empty() ? nullptr : shadowLights[0]->GetShadowSRV();
 
-	DrawWater(context, camera);
+	//Declare the frame's passes. The graph binds and clears their
+	//targets, and culls any whose output is never used
+	renderGraph.Reset();
+	RenderGraphResource backBuffer = renderGraph.ImportTarget("Back buffer", backBufferRTV, width, height);
+	RenderGraphResource depth = renderGraph.ImportDepth("Depth", depthStencilView, width, height);
+	RenderGraphResource shadowMaps = renderGraph.Import("Shadow maps", shadowSRV);
 
-	ApplyPostProcess(context, backBufferRTV, depthStencilView, fxaaRTV, fxaaSRV, sampler, width, height);
+	RenderGraphTextureDesc sceneDesc = {};
+	sceneDesc.width = width;
+	sceneDesc.height = height;
+	sceneDesc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	RenderGraphResource sceneColor = renderGraph.CreateTexture("Scene color", sceneDesc);
 
-	DrawDebugColliders(context, camera);
+	renderGraph.AddPass("Shadows", [=](RenderGraph&) { RenderShadowMaps(context, camera); })
+		.Write(shadowMaps);
 
-	// Need to unbind the shadow map from pixel shader stage
-	// so it can be rendered into properly next frame
-	// (Just unbinding all since we don't know which register its in)
-	ID3D11ShaderResourceView* nullSRVs[16] = {};
-	context->PSSetShaderResources(0, 16, nullSRVs);
-}
+	if (depthPrePass)
+	{
+		renderGraph.AddPass("Depth pre-pass", [=](RenderGraph&) { DrawDepthPrePass(context, camera); })
+			.UseDepth(depth, true, true);
+	}
 
-// Prepare for post processsing.
-void Renderer::PreparePostProcess(ID3D11DeviceContext* context,
-	ID3D11RenderTargetView* ppRTV, ID3D11DepthStencilView* ppDSV)
-{
-	// POST PROCESS PRE-RENDER ///////////////
+	renderGraph.AddPass("Opaque", [=](RenderGraph&) { DrawOpaqueObjects(context, device, camera); })
+		.Read(shadowMaps)
+		.WriteColor(sceneColor, clearColor)
+		.UseDepth(depth, true, !depthPrePass);
+
+	renderGraph.AddPass("Sky", [=](RenderGraph&) { DrawSky(context, camera); })
+		.WriteColor(sceneColor)
+		.UseDepth(depth, true);
+
+	renderGraph.AddPass("Water", [=](RenderGraph&) { DrawWater(context, camera); })
+		.Read(shadowMaps)
+		.WriteColor(sceneColor)
+		.UseDepth(depth, false);
+
+	renderGraph.AddPass("FXAA", [=](RenderGraph& graph) { ApplyPostProcess(context, graph.GetSRV(sceneColor), sampler, width, height); })
+		.Read(sceneColor)
+		.WriteColor(backBuffer);
+
+	renderGraph.AddPass("Debug", [=](RenderGraph&) { DrawDebug(context, camera); })
+		.WriteColor(backBuffer)
+		.UseDepth(depth, false);
 
-	// Clear post process texture.
-	context->ClearRenderTargetView(ppRTV, this->clearColor);
+	renderGraph.Execute(context, &stateCache);
 
-	// Set the post process RTV as the current render target.
-	context->OMSetRenderTargets(1, &ppRTV, ppDSV);
+	if (!capturePath.empty())
+	{
+		if (capture.Save(capturePath.c_str()))
+			printf("Captured %u render commands to \"%s\"\n", capture.GetPassCommandCount(0), capturePath.c_str());
+		capturePath.clear();
+	}
+
+	transientRing.EndFrame(context);
 }
 
 // Render shadow maps for all lights that cast shadows
-void Renderer::RenderShadowMaps(ID3D11DeviceContext* context,
-	ID3D11Device* device,
-	Camera* camera,
-	ID3D11RenderTargetView* backBufferRTV,
-	ID3D11DepthStencilView* depthStencilView,
-	UINT width, UINT height)
+void Renderer::RenderShadowMaps(ID3D11DeviceContext* context, Camera* camera)
 {
 	std::vector<Light*> lights = LightManager::GetInstance()->GetShadowCastingLights();
-	context->RSSetState(shadowRasterizer);
-	context->PSSetShader(0, 0, 0); // Turns OFF the pixel shader
 
-	// SET A VIEWPORT!!!
+	bool statesSet = false;
 	D3D11_VIEWPORT vp = {};
-	vp.TopLeftX = 0;
-	vp.TopLeftY = 0;
-	vp.Width = (float)SHADOW_MAP_SIZE;
-	vp.Height = (float)SHADOW_MAP_SIZE;
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &vp);
 
 	//Loop through all lights that cast shadows and draw to their textures
 	for (auto l : lights)
 	{
-		//Create shadow SRV if it does not exist
-		if (l->GetShadowSRV() == nullptr)
-			l->InitShadowMap(device);
+		//Directional lights split the camera's view between cascades
+		l->FitToCamera(camera);
+
+		for (int c = 0; c < l->GetCascadeCount(); c++)
+		{
+			XMFLOAT4X4 lightView = l->GetCascadeViewMatrix(c);
+			XMFLOAT4X4 lightProj = l->GetCascadeProjectionMatrix(c);
+
+			//Only casters inside the cascade's volume can land in it
+			Frustum lightFrustum;
+			lightFrustum.SetFromMatrices(lightView, lightProj);
+			int visibleCount = CullFrameEntities(lightFrustum);
+			casterVisible.assign(frameEntities.size(), 0);
+			for (int i = 0; i < visibleCount; i++)
+				casterVisible[visibleIndices[i]] = 1;
+
+			//Hash everything the cascade depends on, layer by layer
+			int staticCount = 0;
+			int dynamicCount = 0;
+			unsigned long long lightHash = ExtendedMath::HashBytes(&lightView, sizeof(lightView), ExtendedMath::HashBytes(&lightProj, sizeof(lightProj)));
+			unsigned long long staticHash = HashShadowCasters(RenderPass::StaticShadow, lightHash, staticCount);
+			unsigned long long dynamicHash = HashShadowCasters(RenderPass::Shadow, staticHash, dynamicCount);
+
+			//Nothing that lands in this cascade changed
+			ShadowCache* cache = l->GetShadowCache(c);
+			if (cache->valid && cache->dynamicHash == dynamicHash)
+				continue;
 
-		ID3D11DepthStencilView* shadowDSV = l->GetShadowDSV();
-		ID3D11ShaderResourceView* shadowSRV = l->GetShadowSRV();
+			if (!statesSet)
+			{
+				stateCache.SetRasterizerState(shadowRasterizer);
+				stateCache.SetPixelShader(nullptr); // Turns OFF the pixel shader
+
+				// SET A VIEWPORT!!!
+				vp.TopLeftX = 0;
+				vp.TopLeftY = 0;
+				vp.Width = (float)SHADOW_MAP_SIZE;
+				vp.Height = (float)SHADOW_MAP_SIZE;
+				vp.MinDepth = 0.0f;
+				vp.MaxDepth = 1.0f;
+				context->RSSetViewports(1, &vp);
+				statesSet = true;
+			}
 
-		// Initial setup - No RTV necessary - Clear shadow map
-		context->OMSetRenderTargets(0, 0, shadowDSV);
-		context->ClearDepthStencilView(shadowDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
+			// Set up the shaders
+			shadowVS->SetShader();
+			shadowVS->SetMatrix4x4(shadowViewHandle, lightView);
+			shadowVS->SetMatrix4x4(shadowProjHandle, lightProj);
+			shadowVS->CopyBufferData(shadowOnceBuffer);
 
-		// Set up the shaders
-		shadowVS->SetShader();
-		shadowVS->SetMatrix4x4("view", l->GetViewMatrix());
-		shadowVS->SetMatrix4x4("projection", l->GetProjectionMatrix());
-		shadowVS->CopyBufferData("once");
+			//Re-render the static layer only when it is stale
+			if (!cache->staticValid || cache->staticHash != staticHash)
+			{
+				ID3D11DepthStencilView* staticDSV = l->GetStaticShadowDSV(c);
+				stateCache.SetRenderTargets(0, 0, staticDSV);
+				context->ClearDepthStencilView(staticDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
+				DrawShadowCasters(context, RenderPass::StaticShadow, lightFrustum);
 
-		//Loop through entities (simplified. Look at DrawOpaqueObjects for better documentation)
-		for (auto const& mapPair : renderMap)
-		{
-			if (mapPair.second.size() < 1)
-				return;
+				cache->staticHash = staticHash;
+				cache->staticValid = true;
+			}
 
-			std::vector<Entity*> list = mapPair.second;
+			//Start from the cascade's static slice and draw moving casters on top
+			UINT subresource = D3D11CalcSubresource(0, c, 1);
+			stateCache.SetRenderTargets(0, 0, 0);
+			context->CopySubresourceRegion(l->GetShadowTexture(), subresource, 0, 0, 0,
+				l->GetStaticShadowTexture(), subresource, nullptr);
+			if (dynamicCount > 0)
+			{
+				stateCache.SetRenderTargets(0, 0, l->GetShadowDSV(c));
+				DrawShadowCasters(context, RenderPass::Shadow, lightFrustum);
+			}
 
-			Mesh* mesh = list[0]->GetMesh();
+			cache->dynamicHash = dynamicHash;
+			cache->valid = true;
+		}
+	}
 
-			// Set buffers in the input assembler
-			UINT stride = sizeof(Vertex);
-			UINT offset = 0;
-			ID3D11Buffer* vertexBuffer = mesh->GetVertexBuffer();
-			ID3D11Buffer* indexBuffer = mesh->GetIndexBuffer();
-			context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-			context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	//The render graph binds the next pass's targets and viewport
+	if (statesSet)
+		stateCache.SetRasterizerState(nullptr);
+}
 
-			//Loop through each entity in the list
-			for (size_t i = 0; i < list.size(); i++)
-			{
-				// Grab the data from the first entity's mesh
-				Entity* e = list[i];
+// Hash the visible casters of a shadow pass
+unsigned long long Renderer::HashShadowCasters(RenderPass pass, unsigned long long seed, int& casterCount)
+{
+	size_t first = 0;
+	size_t count = renderQueue.GetPassRange(pass, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
 
-				shadowVS->SetMatrix4x4("world", e->GetWorldMatrix());
-				shadowVS->CopyBufferData("perObject");
+	unsigned long long hash = seed;
+	casterCount = 0;
+	for (size_t i = first; i < first + count; i++)
+	{
+		unsigned int index = packets[i].transformIndex;
+		if (!casterVisible[index])
+			continue;
 
-				// Finally do the actual drawing
-				context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
-			}
+		hash = ExtendedMath::HashBytes(&packets[i].key, sizeof(packets[i].key), hash);
+		hash = ExtendedMath::HashBytes(&frameTransforms[index], sizeof(XMFLOAT4X4), hash);
+		casterCount++;
+
+		//Batches cast less once their merged entities are disabled or deleted
+		StaticBatch* batch = frameEntities[index]->staticBatch;
+		for (int r = 0; batch != nullptr && r < batch->GetRangeCount(); r++)
+		{
+			bool drawn = batch->IsRangeDrawn(r);
+			hash = ExtendedMath::HashBytes(&drawn, sizeof(drawn), hash);
 		}
 	}
 
-	// Revert to original pipeline state
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
-	vp.Width = (float)width;
-	vp.Height = (float)height;
-	context->RSSetViewports(1, &vp);
-	context->RSSetState(0);
+	//Caster count keeps "same casters, one fewer" from colliding
+	return ExtendedMath::HashBytes(&casterCount, sizeof(casterCount), hash);
+}
+
+// Bind a mesh's position stream, or its full buffers if it has none
+void Renderer::BindDepthOnlyBuffers(Mesh* mesh)
+{
+	if (mesh->HasPositionStream())
+	{
+		stateCache.SetVertexBuffer(0, mesh->GetPositionBuffer(), sizeof(XMFLOAT3), 0);
+		stateCache.SetIndexBuffer(mesh->GetPositionIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+	}
+	else
+	{
+		stateCache.SetVertexBuffer(0, mesh->GetVertexBuffer(), sizeof(Vertex), 0);
+		stateCache.SetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+	}
+}
+
+// Draw the visible casters of a shadow pass
+void Renderer::DrawShadowCasters(ID3D11DeviceContext* context, RenderPass pass, const Frustum& frustum)
+{
+	size_t first = 0;
+	size_t count = renderQueue.GetPassRange(pass, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+
+	//Walk the shadow packets, which are sorted by mesh
+	Mesh* lastMesh = nullptr;
+	for (size_t i = first; i < first + count; i++)
+	{
+		const DrawPacket& packet = packets[i];
+		if (!casterVisible[packet.transformIndex])
+			continue;
+
+		Mesh* mesh = frameEntities[packet.transformIndex]->GetMesh();
+
+		// Set buffers in the input assembler when the mesh changes.
+		// Detail levels of a mesh share its buffers
+		if (mesh != lastMesh)
+		{
+			BindDepthOnlyBuffers(mesh);
+			lastMesh = mesh;
+		}
+
+		shadowVS->SetMatrix4x4(shadowWorldHandle, frameTransforms[packet.transformIndex]);
+		shadowVS->CopyBufferData(shadowPerObjectBuffer);
+
+		//Batches only draw the ranges inside the light's volume
+		StaticBatch* batch = frameEntities[packet.transformIndex]->staticBatch;
+		if (batch != nullptr)
+		{
+			batch->Cull(frustum, batchRuns);
+			for (size_t r = 0; r < batchRuns.size(); r += 2)
+				context->DrawIndexed(batchRuns[r + 1], batchRuns[r], 0);
+			continue;
+		}
+
+		// Finally do the actual drawing
+		int lod = RenderQueue::GetMesh(packet.key) % MESH_MAX_LODS;
+		context->DrawIndexed(mesh->GetLodIndexCount(lod), mesh->GetLodStartIndex(lod), 0);
+	}
 }
 
-// Draw opaque objects
-void Renderer::DrawOpaqueObjects(ID3D11DeviceContext* context, Camera* camera)
+// Draw the depth of opaque objects without shading them
+void Renderer::DrawDepthPrePass(ID3D11DeviceContext* context, Camera* camera)
 {
-	//TODO: Apply attenuation
-	context->OMSetDepthStencilState(waterDepthState, 0);
-	for (auto const& mapPair : renderMap)
+	size_t first = 0;
+	size_t count = renderQueue.GetPassRange(RenderPass::Opaque, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+
+	//The shadow shader transforms positions exactly like the default
+	//vertex shader, and both mark them precise, so the opaque pass
+	//lands on the same depths
+	stateCache.SetPixelShader(nullptr);
+	shadowVS->SetShader();
+	shadowVS->SetMatrix4x4(shadowViewHandle, camera->GetViewMatrix());
+	shadowVS->SetMatrix4x4(shadowProjHandle, camera->GetProjectionMatrix());
+	shadowVS->CopyBufferData(shadowOnceBuffer);
+
+	Mesh* lastMesh = nullptr;
+	for (size_t i = first; i < first + count; i++)
 	{
-		if (mapPair.second.size() < 1)
-			return;
+		const DrawPacket& packet = packets[i];
+		Entity* e = frameEntities[packet.transformIndex];
+
+		//The instanced shader builds positions in a different order, so
+		//its depths might not match. Those write their own depth later
+		if (e->GetMaterial()->UsesInstancing())
+			continue;
 
-		//Get list, material, and mesh
-		std::vector<Entity*> list = mapPair.second;
+		Mesh* mesh = e->GetMesh();
+		if (mesh != lastMesh)
+		{
+			BindDepthOnlyBuffers(mesh);
+			lastMesh = mesh;
+		}
 
-		//Get the first valid entity
-		Entity* firstValid = list[0];
+		shadowVS->SetMatrix4x4(shadowWorldHandle, frameTransforms[packet.transformIndex]);
+		shadowVS->CopyBufferData(shadowPerObjectBuffer);
 
-		Material* mat = list[0]->GetMaterial();
-		Mesh* mesh = list[0]->GetMesh();
+		if (e->staticBatch != nullptr)
+		{
+			const std::vector<unsigned int>& runs = e->staticBatch->GetCameraRuns();
+			for (size_t r = 0; r < runs.size(); r += 2)
+				context->DrawIndexed(runs[r + 1], runs[r], 0);
+			continue;
+		}
 
-		// Turn shaders on
-		mat->GetVertexShader()->SetShader();
-		mat->GetPixelShader()->SetShader();
+		context->DrawIndexed(mesh->GetLodIndexCount(e->lodLevel), mesh->GetLodStartIndex(e->lodLevel), 0);
+	}
+}
 
-		//Prepare the material's combo specific variables
-		mat->PrepareMaterialCombo(list[0], camera);
+// Draw opaque objects from the recorded command lists
+void Renderer::DrawOpaqueObjects(ID3D11DeviceContext* context, ID3D11Device* device, Camera* camera)
+{
+	size_t first = 0;
+	renderQueue.GetPassRange(RenderPass::Opaque, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+	bool capturing = !capturePath.empty();
 
-		// Set buffers in the input assembler
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* vertexBuffer = mesh->GetVertexBuffer();
-		ID3D11Buffer* indexBuffer = mesh->GetIndexBuffer();
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	for (size_t s = 0; s < opaqueSegments.size(); s++)
+	{
+		const OpaqueSegment& segment = opaqueSegments[s];
+		Entity* e = frameEntities[packets[first + segment.first].transformIndex];
+		Material* mat = e->GetMaterial();
 
-		//Loop through each entity in the list
-		for (size_t i = 0; i < list.size(); i++)
+		//Combo variables go through the material's shaders, so they
+		//are set here rather than recorded
+		if (segment.firstOfMaterial)
 		{
-			//Don't draw disabled entities
-			if (!list[i]->GetEnabled())
-				continue;
+			// Turn shaders on
+			mat->GetVertexShader()->SetShader();
+			mat->GetPixelShader()->SetShader();
 
-			//Don't draw water
-			if (list[i]->GetName() == "water")
-				continue;
+			//Prepare the material's combo specific variables
+			mat->PrepareMaterialCombo(e, camera);
+
+			//Captures get what the combo bound as commands of their own
+			if (capturing)
+			{
+				RenderCommandList setup;
+				mat->GetVertexShader()->RecordState(setup, RenderStage::Vertex);
+				mat->GetPixelShader()->RecordState(setup, RenderStage::Pixel);
+				capture.AddList(setup);
+			}
+		}
 
-			//Prepare the material's object specific variables
-			mat->PrepareMaterialObject(list[i]);
-
-			// Finally do the actual drawing
-			//  - Do this ONCE PER OBJECT you intend to draw
-			//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-			//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-			//     vertices in the currently set VERTEX BUFFER
-			context->DrawIndexed(
-				mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-				0,     // Offset to the first index we want to use
-				0);    // Offset to add to each index when looking up vertices
+		if (capturing)
+			capture.AddList(opaqueLists[s]);
+		commandBackend.Execute(opaqueLists[s]);
+
+		//The lists wrote the per object buffers behind the shaders' backs
+		if (s + 1 == opaqueSegments.size() || opaqueSegments[s + 1].firstOfMaterial)
+			mat->InvalidateObjectConstants();
+	}
+	stateCache.SetDepthStencilState(nullptr);
+
+	//Unbind instance data so per-vertex-only layouts don't see a stray slot
+	stateCache.SetVertexBuffer(1, nullptr, 0, 0);
+}
+
+// Split the opaque pass into segments and record them, in parallel when there are enough
+void Renderer::RecordOpaqueObjects()
+{
+	size_t first = 0;
+	size_t count = renderQueue.GetPassRange(RenderPass::Opaque, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+
+	//Packets are sorted by shader, material then mesh. Cut a segment
+	//at every material change and every RENDER_RECORD_SEGMENT_PACKETS
+	opaqueSegments.clear();
+	size_t i = 0;
+	while (i < count)
+	{
+		//Ids can be shared past their limit (see RenderIdTable), so the
+		//material itself is compared too
+		unsigned int materialId = RenderQueue::GetMaterial(packets[first + i].key);
+		Material* mat = frameEntities[packets[first + i].transformIndex]->GetMaterial();
+		size_t materialEnd = i + 1;
+		while (materialEnd < count && RenderQueue::GetMaterial(packets[first + materialEnd].key) == materialId &&
+			frameEntities[packets[first + materialEnd].transformIndex]->GetMaterial() == mat)
+			materialEnd++;
+
+		for (size_t start = i; start < materialEnd; start += RENDER_RECORD_SEGMENT_PACKETS)
+		{
+			OpaqueSegment segment;
+			segment.first = start;
+			segment.end = std::min(start + RENDER_RECORD_SEGMENT_PACKETS, materialEnd);
+			segment.firstOfMaterial = start == i;
+			opaqueSegments.push_back(segment);
 		}
+		i = materialEnd;
+	}
+	if (opaqueLists.size() < opaqueSegments.size())
+		opaqueLists.resize(opaqueSegments.size());
+
+	//Pool threads, this one included, take segments until there are none left
+	WorkerPool::GetInstance()->ParallelFor((int)opaqueSegments.size(), RENDER_RECORD_MAX_THREADS,
+		[this](int segment, int) { RecordOpaqueSegment(segment); });
+}
+
+// --------------------------------------------------------
+// Feeds the opaque pass's packets to DrawRecorder. Objects
+// are packet indices relative to the start of the pass
+// --------------------------------------------------------
+class Renderer::OpaqueRecorder : public DrawRecorder
+{
+private:
+	Renderer* renderer;
+	const DrawPacket* packets;
+	Material* material;
+
+	Entity* GetEntity(size_t object)
+	{
+		return renderer->frameEntities[packets[object].transformIndex];
+	}
+
+protected:
+	Mesh* GetMesh(size_t object) override { return GetEntity(object)->GetMesh(); }
+	int GetLod(size_t object) override { return GetEntity(object)->lodLevel; }
+
+	void RecordObject(RenderCommandList& list, size_t object) override
+	{
+		material->RecordMaterialObject(list, GetEntity(object));
+	}
+
+	//Batches draw the ranges the camera can see
+	const std::vector<unsigned int>* GetRuns(size_t object) override
+	{
+		StaticBatch* batch = GetEntity(object)->staticBatch;
+		return batch != nullptr ? &batch->GetCameraRuns() : nullptr;
+	}
+
+	void RecordInstances(RenderCommandList& list, size_t object, size_t count, Mesh* mesh, int lod) override
+	{
+		renderer->RecordInstanced(list, object, count, mesh, lod);
+	}
+
+public:
+	OpaqueRecorder(Renderer* renderer, const DrawPacket* packets, Material* material)
+	{
+		this->renderer = renderer;
+		this->packets = packets;
+		this->material = material;
+	}
+};
+
+// Record one opaque segment into its command list
+void Renderer::RecordOpaqueSegment(size_t segmentIndex)
+{
+	const OpaqueSegment& segment = opaqueSegments[segmentIndex];
+	RenderCommandList& list = opaqueLists[segmentIndex];
+	list.Clear();
+
+	size_t first = 0;
+	renderQueue.GetPassRange(RenderPass::Opaque, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+
+	//Every packet in a segment shares the material
+	Material* mat = frameEntities[packets[first + segment.first].transformIndex]->GetMaterial();
+	RenderPipeline pipeline = {};
+	pipeline.inputLayout = mat->GetVertexShader()->GetInputLayout();
+	pipeline.vertexShader = mat->GetVertexShader()->GetDirectXShader();
+	pipeline.pixelShader = mat->GetPixelShader()->GetDirectXShader();
+	pipeline.depthStencilState = opaqueDepthState;
+
+	//Instanced materials draw each mesh run at once
+	OpaqueRecorder recorder(this, packets + first, mat);
+	recorder.Record(list, pipeline, segment.first, segment.end, mat->UsesInstancing());
+}
+
+// Upload the instance data of every instanced opaque packet in one go
+void Renderer::UploadInstances(ID3D11DeviceContext* context)
+{
+	size_t first = 0;
+	size_t count = renderQueue.GetPassRange(RenderPass::Opaque, first);
+	const DrawPacket* packets = renderQueue.GetPackets();
+
+	//Gather the world matrices of instanced packets, in packet
+	//order so every run's instances are contiguous
+	instanceData.clear();
+	packetInstances.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const DrawPacket& packet = packets[first + i];
+		packetInstances[i] = (unsigned int)instanceData.size();
+		if (!frameEntities[packet.transformIndex]->GetMaterial()->UsesInstancing())
+			continue;
+
+		const XMFLOAT4X4& world = frameTransforms[packet.transformIndex];
+		InstanceData instance;
+		instance.world[0] = XMFLOAT4(world._11, world._12, world._13, world._14);
+		instance.world[1] = XMFLOAT4(world._21, world._22, world._23, world._24);
+		instance.world[2] = XMFLOAT4(world._31, world._32, world._33, world._34);
+		instanceData.push_back(instance);
 	}
-	context->OMSetDepthStencilState(0, 0);
+	if (instanceData.empty())
+		return;
+
+	UINT size = (UINT)(sizeof(InstanceData) * instanceData.size());
+	void* mapped = transientRing.Map(context, size, sizeof(InstanceData), instanceOffset);
+	if (mapped == nullptr)
+	{
+		instanceData.clear();
+		return;
+	}
+	memcpy(mapped, instanceData.data(), size);
+	transientRing.Unmap(context);
+}
+
+// Record a run of packets that share a material and mesh as one instanced draw call
+void Renderer::RecordInstanced(RenderCommandList& list, size_t packetIndex, size_t count, Mesh* mesh, int lod)
+{
+	//Nothing was uploaded this frame
+	if (instanceData.empty())
+		return;
+
+	//Instance data lives in slot 1, see SimpleVertexShader's _PER_INSTANCE handling.
+	//Nothing maps the ring between recording and the opaque pass, so its buffer is still current
+	list.BindVertexBuffer(1, transientRing.GetBuffer(), sizeof(InstanceData), instanceOffset);
+	list.DrawIndexedInstanced(mesh->GetLodIndexCount(lod), (unsigned int)count, mesh->GetLodStartIndex(lod), 0, packetInstances[packetIndex]);
 }
 
 void Renderer::DrawWater(ID3D11DeviceContext * context, Camera * camera)
 {
 	//Set render states
-	context->OMSetBlendState(waterBlendState, 0, 0xFFFFFFFF);
-	context->OMSetDepthStencilState(waterDepthState, 0);
+	stateCache.SetBlendState(waterBlendState);
+	stateCache.SetDepthStencilState(waterDepthState);
 
 	// Turn shaders on
 	waterMat->GetVertexShader()->SetShader();
@@ -365,8 +831,8 @@ void Renderer::DrawWater(ID3D11DeviceContext * context, Camera * camera)
 	UINT offset = 0;
 	ID3D11Buffer* vertexBuffer = cubeMesh->GetVertexBuffer();
 	ID3D11Buffer* indexBuffer = cubeMesh->GetIndexBuffer();
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	stateCache.SetVertexBuffer(0, vertexBuffer, stride, offset);
+	stateCache.SetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
 	//Prepare the material's object specific variables
 	waterMat->PrepareMaterialObject(water);
@@ -375,16 +841,34 @@ void Renderer::DrawWater(ID3D11DeviceContext * context, Camera * camera)
 	context->DrawIndexed(cubeMesh->GetIndexCount(), 0, 0);
 
 	// Reset states
-	context->OMSetDepthStencilState(0, 0);
-	context->OMSetBlendState(0, 0, 0xFFFFFFFF);
+	stateCache.SetDepthStencilState(nullptr);
+	stateCache.SetBlendState(nullptr);
 
 }
 
-// Draw debug rectangles
-void Renderer::DrawDebugColliders(ID3D11DeviceContext* context, Camera* camera)
+// Draw the frame's debug lines and clear them
+void Renderer::DrawDebug(ID3D11DeviceContext* context, Camera* camera)
 {
-	//Set wireframe
-	context->RSSetState(RS_wireframe);
+	size_t vertexCount = debugDraw.GetVertexCount();
+	if (vertexCount == 0)
+		return;
+
+	//Upload every batch with one map, depth tested lines first
+	UINT offset = 0;
+	UINT size = (UINT)(sizeof(DebugVertex) * vertexCount);
+	unsigned char* mapped = (unsigned char*)transientRing.Map(context, size, sizeof(DebugVertex), offset);
+	if (mapped == nullptr)
+	{
+		debugDraw.Clear();
+		return;
+	}
+	for (int i = 0; i < (int)DebugDepth::Count; i++)
+	{
+		const std::vector<DebugVertex>& batch = debugDraw.GetVertices((DebugDepth)i);
+		memcpy(mapped, batch.data(), sizeof(DebugVertex) * batch.size());
+		mapped += sizeof(DebugVertex) * batch.size();
+	}
+	transientRing.Unmap(context);
 
 	//Set shaders
 	vs_debug->SetShader();
@@ -395,30 +879,27 @@ void Renderer::DrawDebugColliders(ID3D11DeviceContext* context, Camera* camera)
 	vs_debug->SetMatrix4x4("view", camera->GetViewMatrix());
 	vs_debug->CopyBufferData("perFrame");
 
-	//Loop
-	for (auto const& world : debugCubes)
+	stateCache.SetVertexBuffer(0, transientRing.GetBuffer(), sizeof(DebugVertex), offset);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+
+	//One draw per batch
+	ID3D11DepthStencilState* depthStates[(int)DebugDepth::Count] = { nullptr, debugOverlayDepthState };
+	UINT start = 0;
+	for (int i = 0; i < (int)DebugDepth::Count; i++)
 	{
-		// Assign collider world to VS
-		vs_debug->SetMatrix4x4("world", world);
-		vs_debug->CopyBufferData("perObject");
-
-		// Set buffers in the input assembler
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* vertexBuffer = cubeMesh->GetVertexBuffer();
-		ID3D11Buffer* indexBuffer = cubeMesh->GetIndexBuffer();
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-		// Draw object
-		context->DrawIndexed(
-			cubeMesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
+		UINT count = (UINT)debugDraw.GetVertices((DebugDepth)i).size();
+		if (count == 0)
+			continue;
+
+		stateCache.SetDepthStencilState(depthStates[i]);
+		context->Draw(count, start);
+		start += count;
 	}
-	//Clear debug collider list and reset raster state
-	debugCubes.clear();
-	context->RSSetState(0);
+
+	//Clear debug lines and reset state
+	debugDraw.Clear();
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache.SetDepthStencilState(nullptr);
 }
 
 void Renderer::DrawSky(ID3D11DeviceContext* context, Camera* camera)
@@ -435,34 +916,27 @@ void Renderer::DrawSky(ID3D11DeviceContext* context, Camera* camera)
 	UINT offset = 0;
 	ID3D11Buffer* vertexBuffer = cubeMesh->GetVertexBuffer();
 	ID3D11Buffer* indexBuffer = cubeMesh->GetIndexBuffer();
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	stateCache.SetVertexBuffer(0, vertexBuffer, stride, offset);
+	stateCache.SetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
 	// Set up any new render states
-	context->RSSetState(skyRasterState);
-	context->OMSetDepthStencilState(skyDepthState, 0);
+	stateCache.SetRasterizerState(skyRasterState);
+	stateCache.SetDepthStencilState(skyDepthState);
 
 	// Draw
 	context->DrawIndexed(cubeMesh->GetIndexCount(), 0, 0);
 
 	// Reset states
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
+	stateCache.SetRasterizerState(nullptr);
+	stateCache.SetDepthStencilState(nullptr);
 }
 
 // Apply the post process.
 void Renderer::ApplyPostProcess(ID3D11DeviceContext* context,
-	ID3D11RenderTargetView* backBufferRTV,
-	ID3D11DepthStencilView* depthStencilView,
-	ID3D11RenderTargetView* ppRTV,
-	ID3D11ShaderResourceView* ppSRV,
+	ID3D11ShaderResourceView* sceneSRV,
 	ID3D11SamplerState* sampler,
 	UINT width, UINT height)
 {
-
-	// Set target back to back buffer.
-	context->OMSetRenderTargets(1, &backBufferRTV, 0);
-
 	// Render a full-screen triangle using the post process vertex shader.
 	fxaaVS->SetShader();
 
@@ -470,150 +944,225 @@ void Renderer::ApplyPostProcess(ID3D11DeviceContext* context,
 	fxaaPS->SetShader();
 
 	// Set $GLOBAL cbuffer data.
-	fxaaPS->SetShaderResourceView("g_RenderTextureView", fxaaSRV);
+	fxaaPS->SetShaderResourceView("g_RenderTextureView", sceneSRV);
 	fxaaPS->SetSamplerState("g_Sampler", sampler);
 
 	// Set UniformData cbuffer data.
-	fxaaPS->SetFloat2("textureResolution", DirectX::XMFLOAT2((float)width, (float)height));
-	fxaaPS->CopyAllBufferData(); // Copy data to shader.
+	fxaaPS->SetFloat2(fxaaHandles[FXAA_VAR_RESOLUTION], DirectX::XMFLOAT2((float)width, (float)height));
 
 	// Set FXAASettings cbuffer data.
-	fxaaPS->SetFloat("FXAA_EDGE_THRESHOLD", fxaaSettings->EDGE_THRESHOLD);
-	fxaaPS->SetFloat("FXAA_EDGE_THRESHOLD_MIN", fxaaSettings->EDGE_THRESHOLD_MIN);
-	fxaaPS->SetFloat("FXAA_SEARCH_THRESHOLD", fxaaSettings->SEARCH_THRESHOLD);
-	fxaaPS->SetFloat("FXAA_SUBPIX_CAP", fxaaSettings->SUBPIX_CAP);
-	fxaaPS->SetFloat("FXAA_SUBPIX_TRIM", fxaaSettings->SUBPIX_TRIM);
-	fxaaPS->SetFloat("FXAA_DEBUG_GRAYSCALE", fxaaSettings->DEBUG_GRAYSCALE);
-
-	fxaaPS->SetInt("FXAA_ENABLED", fxaaSettings->FXAA);
-	fxaaPS->SetInt("FXAA_SEARCH_STEPS", fxaaSettings->SEARCH_STEPS);
-	fxaaPS->SetInt("FXAA_SEARCH_ACCELERATION", fxaaSettings->SEARCH_ACCELERATION);
-	fxaaPS->SetInt("FXAA_SUBPIX", fxaaSettings->SUBPIX);
-	fxaaPS->SetInt("FXAA_SUBPIX_FASTER", fxaaSettings->SUBPIX_FASTER);
-	fxaaPS->SetInt("FXAA_LUMINANCE_METHOD", fxaaSettings->LUMINANCE_METHOD);
-
-	fxaaPS->SetInt("FXAA_DEBUG_DISCARD", fxaaSettings->DEBUG_DISCARD);
-	fxaaPS->SetInt("FXAA_DEBUG_PASSTHROUGH", fxaaSettings->DEBUG_PASSTHROUGH);
-	fxaaPS->SetInt("FXAA_DEBUG_HORZVERT", fxaaSettings->DEBUG_HORZVERT);
-	fxaaPS->SetInt("FXAA_DEBUG_PAIR", fxaaSettings->DEBUG_PAIR);
-	fxaaPS->SetInt("FXAA_DEBUG_NEGPOS", fxaaSettings->DEBUG_NEGPOS);
-	fxaaPS->SetInt("FXAA_DEBUG_OFFSET", fxaaSettings->DEBUG_OFFSET);
-	fxaaPS->SetInt("FXAA_DEBUG_HIGHLIGHT", fxaaSettings->DEBUG_HIGHLIGHT);
-	fxaaPS->SetInt("FXAA_DEBUG_GRAYSCALE_CHANNEL", fxaaSettings->DEBUG_GRAYSCALE_CHANNEL);
-
-	fxaaPS->CopyAllBufferData(); // Copy data to shader.
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_EDGE_THRESHOLD], fxaaSettings->EDGE_THRESHOLD);
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_EDGE_THRESHOLD_MIN], fxaaSettings->EDGE_THRESHOLD_MIN);
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_SEARCH_THRESHOLD], fxaaSettings->SEARCH_THRESHOLD);
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_SUBPIX_CAP], fxaaSettings->SUBPIX_CAP);
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_SUBPIX_TRIM], fxaaSettings->SUBPIX_TRIM);
+	fxaaPS->SetFloat(fxaaHandles[FXAA_VAR_DEBUG_GRAYSCALE], fxaaSettings->DEBUG_GRAYSCALE);
+
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_ENABLED], fxaaSettings->FXAA);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_SEARCH_STEPS], fxaaSettings->SEARCH_STEPS);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_SEARCH_ACCELERATION], fxaaSettings->SEARCH_ACCELERATION);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_SUBPIX], fxaaSettings->SUBPIX);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_SUBPIX_FASTER], fxaaSettings->SUBPIX_FASTER);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_LUMINANCE_METHOD], fxaaSettings->LUMINANCE_METHOD);
+
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_DISCARD], fxaaSettings->DEBUG_DISCARD);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_PASSTHROUGH], fxaaSettings->DEBUG_PASSTHROUGH);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_HORZVERT], fxaaSettings->DEBUG_HORZVERT);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_PAIR], fxaaSettings->DEBUG_PAIR);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_NEGPOS], fxaaSettings->DEBUG_NEGPOS);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_OFFSET], fxaaSettings->DEBUG_OFFSET);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_HIGHLIGHT], fxaaSettings->DEBUG_HIGHLIGHT);
+	fxaaPS->SetInt(fxaaHandles[FXAA_VAR_DEBUG_GRAYSCALE_CHANNEL], fxaaSettings->DEBUG_GRAYSCALE_CHANNEL);
+
+	// Copy data to shader. Only buffers that changed are uploaded
+	fxaaPS->CopyAllBufferData();
 
 	// Deactivate vertex and index buffers.
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	ID3D11Buffer* nothing = 0;
-	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
-	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+	stateCache.SetVertexBuffer(0, nullptr, sizeof(Vertex), 0);
+	stateCache.SetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
 
 	// Draw a set number of vertices.
 	context->Draw(3, 0);
-
-	// Unbind all pixel shader SRVs.
-	ID3D11ShaderResourceView* nullSRVs[16] = {};
-	context->PSSetShaderResources(0, 16, nullSRVs);
-
-	// Reset depth stencil view.
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
 }
 
-// Add an entity to the render list
-void Renderer::AddEntityToRenderer(Entity* e)
+// Fill and sort the render queue with every enabled entity
+void Renderer::BuildRenderQueue(Camera* camera)
 {
-	//Get identifier
-	std::string identifier = e->GetMatMeshIdentifier();
+	renderQueue.Clear();
+	renderQueue.Reserve(renderables.size() * 2);
+	frameEntities.clear();
+	frameTransforms.clear();
+	boundsX.clear();
+	boundsY.clear();
+	boundsZ.clear();
+	boundsRadius.clear();
+
+	XMFLOAT3 cameraPosition = camera->GetPosition();
+	XMVECTOR eye = XMLoadFloat3(&cameraPosition);
+
+	//Projected diameter over screen height is radius * this / distance
+	float projectionScale = camera->GetProjectionMatrix()._22;
+
+	for (size_t i = 0; i < renderables.size(); i++)
+	{
+		Entity* e = renderables[i];
+
+		//Don't draw disabled entities
+		if (!e->GetEnabled())
+			continue;
+
+		unsigned int index = (unsigned int)frameTransforms.size();
+		XMFLOAT4X4 transform = e->GetWorldMatrix();
+		frameEntities.push_back(e);
+		frameTransforms.push_back(transform);
+
+		//Outline debug colliders once per frame
+		if (e->IsDebug() && e->GetCollider() != nullptr)
+			debugDraw.AddBox(e->GetCollider()->GetWorldMatrix(), XMFLOAT4(1, 0, 0, 1), e);
+
+		//Move the mesh's bounding sphere into world space
+		Mesh* mesh = e->GetMesh();
+		XMFLOAT3 center;
+		float radius;
+		mesh->GetWorldSphere(transform, center, radius);
+
+		boundsX.push_back(center.x);
+		boundsY.push_back(center.y);
+		boundsZ.push_back(center.z);
+		boundsRadius.push_back(radius);
+
+		//Pick the detail level from the camera, every pass draws it
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&center), eye)));
+		e->lodLevel = mesh->SelectLod(Mesh::GetScreenSize(radius, distance, projectionScale), e->lodLevel);
+		unsigned long long lodKey = (unsigned long long)e->lodLevel << RENDER_KEY_MESH_SHIFT;
+
+		//Everything casts a shadow, static casters go in a cached layer
+		renderQueue.Add((e->IsStatic() ? e->staticShadowKey : e->shadowKey) | lodKey, index);
+	}
+
+	//Only what the camera can see goes into the opaque pass
+	int visibleCount = CullFrameEntities(camera->GetFrustum());
 
-	//Check if we already have the mat/mesh combo in the map
-	if (renderMap.find(identifier) != renderMap.end())
+	//Batches can be partly in view, find the ranges that are
+	for (int i = 0; i < visibleCount; i++)
 	{
-		//Get render list
-		std::vector<Entity*> list = renderMap[identifier];
+		StaticBatch* batch = frameEntities[visibleIndices[i]]->staticBatch;
+		if (batch != nullptr)
+			batch->CullForCamera(camera->GetFrustum());
+	}
 
-		//Check the iterator of the entity
-		if (std::find(list.begin(), list.end(), e) != list.end())
+	//Draw the visible occluders into the occlusion buffer first
+	occlusionCuller.BeginFrame(camera->GetViewMatrix(), camera->GetProjectionMatrix());
+	if (occlusionCulling)
+	{
+		for (int i = 0; i < visibleCount; i++)
 		{
-			printf("Cannot add entity %s because it is already in renderer", e->GetName().c_str());
-			return;
+			Entity* e = frameEntities[visibleIndices[i]];
+			if (e->IsOccluder())
+				occlusionCuller.AddOccluder(e->GetMesh(), frameTransforms[visibleIndices[i]],
+					e->staticBatch != nullptr ? &e->staticBatch->GetCameraRuns() : nullptr);
 		}
-
-		//Add to the list
-		renderMap[identifier].push_back(e);
+		occlusionCuller.Rasterize();
 	}
-	//else make a new entry
-	else
+
+	for (int i = 0; i < visibleCount; i++)
 	{
-		std::vector<Entity*> list;
-		list.push_back(e);
-		renderMap.emplace(identifier, list);
+		unsigned int index = (unsigned int)visibleIndices[i];
+		Entity* e = frameEntities[index];
+
+		//Water is drawn on its own after the sky
+		if (e == water)
+			continue;
+
+		//Skip what is hidden behind the occluders
+		Mesh* mesh = e->GetMesh();
+		if (occlusionCulling && !e->IsOccluder() &&
+			!occlusionCuller.IsVisible(mesh->GetBoundsMin(), mesh->GetBoundsMax(), frameTransforms[index]))
+			continue;
+
+		//Skip batches with no ranges left to draw
+		if (e->staticBatch != nullptr && e->staticBatch->GetCameraRuns().empty())
+			continue;
+
+		XMVECTOR center = XMVectorSet(boundsX[index], boundsY[index], boundsZ[index], 0);
+		float depth = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(center, eye)));
+		unsigned long long key = e->renderKey | RenderQueue::MakeDepth(depth);
+		if (e->GetMaterial()->UsesInstancing())
+			key |= (unsigned long long)e->lodLevel << RENDER_KEY_MESH_SHIFT;
+		renderQueue.Add(key, index);
 	}
+
+	renderQueue.Sort();
 }
 
-// Remove an entity from the render list
-void Renderer::RemoveEntityFromRenderer(Entity* e)
+// Cull the frame's entities against a frustum
+int Renderer::CullFrameEntities(const Frustum& frustum)
 {
-	//Get iterator
-	std::string identifier = e->GetMatMeshIdentifier();
-	auto mapIt = renderMap.find(identifier);
+	int count = (int)boundsX.size();
+	visibleIndices.resize(count);
+	if (count == 0)
+		return 0;
+
+	return frustum.CullSpheres(boundsX.data(), boundsY.data(), boundsZ.data(), boundsRadius.data(),
+		count, visibleIndices.data());
+}
 
-	//Check if we are in the map
-	if (mapIt == renderMap.end())
+// Add an entity to the render list
+void Renderer::AddEntityToRenderer(Entity* e)
+{
+	if (IsEntityInRenderer(e))
 	{
-		printf("Cannot remove entity because it is not in renderer");
+		printf("Cannot add entity %s because it is already in renderer", e->GetName().c_str());
 		return;
 	}
 
-	//Get correct render list
-	std::vector<Entity*>* list = &renderMap[identifier];
-
-	//Get the iterator of the entity
-	std::vector<Entity*>::iterator listIt = std::find((*list).begin(), (*list).end(), e);
+	//Cache the parts of the sort keys that never change
+	Material* mat = e->GetMaterial();
+	unsigned int shaderId = shaderIds.Acquire(mat->GetVertexShader());
+	unsigned int materialId = materialIds.Acquire(mat);
+	unsigned int meshId = meshIds.Acquire(e->GetMesh()) * MESH_MAX_LODS; //Room for the detail level
+	//Instanced materials batch draws of the same mesh. The rest leave
+	//the mesh out so their draws go front to back within the material
+	unsigned int opaqueMeshId = mat->UsesInstancing() ? meshId : 0;
+	e->renderKey = RenderQueue::MakeKey(RenderPass::Opaque, shaderId, materialId, opaqueMeshId);
+	e->shadowKey = RenderQueue::MakeKey(RenderPass::Shadow, 0, 0, meshId);
+	e->staticShadowKey = RenderQueue::MakeKey(RenderPass::StaticShadow, 0, 0, meshId);
+
+	e->renderIndex = (int)renderables.size();
+	renderables.push_back(e);
+}
 
+// Remove an entity from the render list
+void Renderer::RemoveEntityFromRenderer(Entity* e)
+{
 	//Check if we are in the list
-	if (listIt == (*list).end())
+	if (!IsEntityInRenderer(e))
 	{
 		printf("Cannot remove entity because it is not in renderer");
 		return;
 	}
 
+	//Free the ids nothing else uses
+	shaderIds.Release(e->GetMaterial()->GetVertexShader());
+	materialIds.Release(e->GetMaterial());
+	meshIds.Release(e->GetMesh());
+
 	//Swap it for the last one
-	std::swap(*listIt, (*list).back());
+	Entity* last = renderables.back();
+	renderables[e->renderIndex] = last;
+	last->renderIndex = e->renderIndex;
 
 	//Pop the last one
-	(*list).pop_back();
-
-	//Check if the list is empty
-	if ((*list).size() == 0)
-	{
-		//Erase
-		renderMap.erase(e->GetMatMeshIdentifier());
-	}
+	renderables.pop_back();
+	e->renderIndex = -1;
 }
 
-// Check if an entity is in the render list. O(n) complexity
-//	(n is the amount of entities that share the material and mesh)
+// Check if an entity is in the render list. O(1) complexity
 bool Renderer::IsEntityInRenderer(Entity* e)
 {
-	//Early return if render list is empty and if the entity is in it
-	std::string identifier = e->GetMatMeshIdentifier();
-	if (renderMap.find(identifier) == renderMap.end())
-		return false;
-
-	//Get render list
-	std::vector<Entity*> list = renderMap[identifier];
-
-	//Early return if render list is empty
-	if (list.size() == 0)
-		return false;
-
-	//Check the iterator of the entity
-	if (std::find(list.begin(), list.end(), e) == list.end())
-		return false;
-
-	return true;
+	return e->renderIndex >= 0 &&
+		e->renderIndex < (int)renderables.size() &&
+		renderables[e->renderIndex] == e;
 }
 
 // Tell the renderer to render a collider this frame
@@ -624,7 +1173,7 @@ void Renderer::AddDebugCubeToThisFrame(DirectX::XMFLOAT3 position, float size)
 	XMMATRIX world = XMMatrixTranspose(scaling * translation);
 	XMFLOAT4X4 cubeWorld;
 	XMStoreFloat4x4(&cubeWorld, world);
-	debugCubes.push_back(cubeWorld);
+	AddDebugCubeToThisFrame(cubeWorld);
 }
 
 // Tell the renderer to render a collider this frame
@@ -636,13 +1185,37 @@ void Renderer::AddDebugCubeToThisFrame(DirectX::XMFLOAT3 position, DirectX::XMFL
 	XMMATRIX world = XMMatrixTranspose(scaling * rot * translation);
 	XMFLOAT4X4 cubeWorld;
 	XMStoreFloat4x4(&cubeWorld, world);
-	debugCubes.push_back(cubeWorld);
+	AddDebugCubeToThisFrame(cubeWorld);
 }
 
 // Tell the renderer to render a collider this frame
 void Renderer::AddDebugCubeToThisFrame(XMFLOAT4X4 world)
 {
-	debugCubes.push_back(world);
+	debugDraw.AddBox(world, XMFLOAT4(1, 0, 0, 1));
+}
+
+// Write the next frame's recorded command lists to a render capture
+void Renderer::CaptureNextFrame(const char* path)
+{
+	capturePath = path;
+}
+
+// Turn culling of entities hidden behind occluders on or off
+void Renderer::SetOcclusionCulling(bool enabled)
+{
+	occlusionCulling = enabled;
+}
+
+// Turn the depth pre-pass on or off
+void Renderer::SetDepthPrePass(bool enabled)
+{
+	depthPrePass = enabled;
+}
+
+// Get the occlusion culler and this frame's stats
+OcclusionCuller* Renderer::GetOcclusionCuller()
+{
+	return &occlusionCuller;
 }
 
 // Set the clear color.
@@ -663,43 +1236,47 @@ void Renderer::SetClearColor(float r, float g, float b, float a)
 	clearColor[3] = a;
 }
 
-// Create the post-processing texture
-void Renderer::CreatePostProcessingResources(ID3D11Device* device, UINT width, UINT height)
-{
-	// Create post-process resources.
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = width;
-	textureDesc.Height = height;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	ID3D11Texture2D* ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, &ppTexture);
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-	device->CreateRenderTargetView(ppTexture, &rtvDesc, &fxaaRTV);
-
-	// Create the Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-	device->CreateShaderResourceView(ppTexture, &srvDesc, &fxaaSRV);
-
-	// We don't need the texture reference itself no mo'
-	ppTexture->Release();
-}
\ No newline at end of file
+// Merge static entities that share a material into static batches
+void Renderer::BuildStaticBatches(ID3D11Device* device)
+{
+	//Group the static entities by material. Occluders are kept apart
+	//so the batch can stay an occluder without hiding its neighbours
+	std::vector<std::vector<Entity*>> groups;
+	for (size_t i = 0; i < renderables.size(); i++)
+	{
+		Entity* e = renderables[i];
+		if (!e->IsStatic() || !e->GetEnabled() || e == water || e->IsDebug() ||
+			e->staticBatch != nullptr || e->GetMaterial()->UsesInstancing())
+			continue;
+
+		size_t g = 0;
+		for (; g < groups.size(); g++)
+		{
+			Entity* other = groups[g][0];
+			if (other->GetMaterial() == e->GetMaterial() && other->IsOccluder() == e->IsOccluder())
+				break;
+		}
+		if (g == groups.size())
+			groups.push_back(std::vector<Entity*>());
+		groups[g].push_back(e);
+	}
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		std::vector<Entity*>& group = groups[g];
+		if (group.size() < STATIC_BATCH_MIN_ENTITIES)
+			continue;
+
+		StaticBatch* batch = new StaticBatch(group, device);
+		staticBatches.push_back(batch);
+
+		//The batch draws with an identity transform in place of its entities
+		Entity* batchEntity = new Entity(batch->GetMesh(), group[0]->GetMaterial(), "static batch");
+		batchEntity->SetStatic(true);
+		batchEntity->SetOccluder(group[0]->IsOccluder());
+		batchEntity->staticBatch = batch;
+
+		for (size_t i = 0; i < group.size(); i++)
+			RemoveEntityFromRenderer(group[i]);
+	}
+}
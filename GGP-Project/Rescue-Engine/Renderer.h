@@ -5,86 +5,241 @@
 #include "Entity.h"
 #include "Camera.h"
 #include "FXAA.h"
+#include "RenderQueue.h"
+#include "RenderStateCache.h"
+#include "UploadRing.h"
+#include "DebugDraw.h"
+#include "RenderGraph.h"
+#include "D3D11RenderBackend.h"
+#include "RenderCapture.h"
+#include "OcclusionCuller.h"
+#include "StaticBatch.h"
 
-// Basis from: https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+// --------------------------------------------------------
+// Per-instance data for instanced draws: the top three rows
+// of an entity's (transposed) world matrix
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4 world[3];
+};
+
+// --------------------------------------------------------
+// A range of opaque packets recorded into one command list.
+// Packet indices are relative to the start of the opaque pass
+// --------------------------------------------------------
+struct OpaqueSegment
+{
+	size_t first;
+	size_t end;
+	bool firstOfMaterial; //The material's combo must be prepared first
+};
 
 // --------------------------------------------------------
-// Singleton
+// One per EngineContext
 //
 // Handles rendering entities to the screen
 // --------------------------------------------------------
 class Renderer
 {
 private:
+	//Drops redundant binds and owns the pipeline state objects
+	RenderStateCache stateCache;
+
 	//Render list management
-	//renderMap uses Mat/Mesh identifiers to point to the correct list
-	std::unordered_map<std::string, std::vector<Entity*>> renderMap;
+	//Each entity remembers its own index so add/remove/lookup are O(1)
+	std::vector<Entity*> renderables;
 	Mesh* cubeMesh;
 
-	//Collider debugging
-	std::vector<DirectX::XMFLOAT4X4> debugCubes;
+	//Small ids for sort keys, held while any entity in the render list uses the object
+	RenderIdTable shaderIds;
+	RenderIdTable materialIds;
+	RenderIdTable meshIds;
+
+	//Per-frame render queue. Packets index into the frame's transforms
+	RenderQueue renderQueue;
+	std::vector<Entity*> frameEntities;
+	std::vector<DirectX::XMFLOAT4X4> frameTransforms;
+
+	//World bounding spheres of the frame's entities, one array per component
+	std::vector<float> boundsX;
+	std::vector<float> boundsY;
+	std::vector<float> boundsZ;
+	std::vector<float> boundsRadius;
+	std::vector<int> visibleIndices;
+	std::vector<unsigned char> casterVisible; //per frame entity, set by the current light's cull
+
+	//Hides what is behind the frame's occluders before it enters the queue
+	OcclusionCuller occlusionCuller;
+	bool occlusionCulling;
+
+	//Static entities merged at scene load, see BuildStaticBatches()
+	std::vector<StaticBatch*> staticBatches;
+	std::vector<unsigned int> batchRuns; //Scratch for culling a batch against a light
+
+	//Opaque depth is drawn first so only visible pixels are lit
+	bool depthPrePass;
+	ID3D11DepthStencilState* opaqueDepthState; //owned by stateCache
+
+	//Transient per-frame GPU data
+	UploadRing transientRing;
+
+	//Instancing. The frame's instances are uploaded to the ring
+	//in one go, in opaque packet order
+	std::vector<InstanceData> instanceData;
+	std::vector<unsigned int> packetInstances; //first instance of each opaque packet
+	UINT instanceOffset; //byte offset of the frame's instances in the ring
+
+	//Opaque draws are recorded into command lists, one per segment,
+	//and submitted through the backend during the opaque pass
+	D3D11RenderBackend commandBackend;
+	std::vector<OpaqueSegment> opaqueSegments;
+	std::vector<RenderCommandList> opaqueLists;
+
+	//Feeds a segment's packets to DrawRecorder, see Renderer.cpp
+	class OpaqueRecorder;
+
+	//Where to write the next frame's opaque pass, empty when not capturing
+	RenderCapture capture;
+	std::string capturePath;
+
+	//Debug lines, drawn in one batch per DebugDepth
+	DebugDraw debugDraw;
 	SimpleVertexShader* vs_debug;
 	SimplePixelShader* ps_debug;
-	ID3D11RasterizerState* RS_wireframe;
+	ID3D11DepthStencilState* debugOverlayDepthState; //owned by stateCache
 
 	//Water
 	Material* waterMat;
 	Entity* water;
-	ID3D11BlendState* waterBlendState;
+	ID3D11BlendState* waterBlendState; //owned by stateCache
 	ID3D11DepthStencilState* waterDepthState;
 
 	//Skybox
 	Material* skyboxMat;
-	ID3D11RasterizerState* skyRasterState;
+	ID3D11RasterizerState* skyRasterState; //owned by stateCache
 	ID3D11DepthStencilState* skyDepthState;
 
 
 
 	//Shadows
-	ID3D11RasterizerState* shadowRasterizer;
+	ID3D11RasterizerState* shadowRasterizer; //owned by stateCache
 	SimpleVertexShader* shadowVS;
+	SimpleShaderHandle shadowViewHandle;
+	SimpleShaderHandle shadowProjHandle;
+	SimpleShaderHandle shadowWorldHandle;
+	unsigned int shadowOnceBuffer;
+	unsigned int shadowPerObjectBuffer;
+
+	//Frame passes, rebuilt every frame
+	RenderGraph renderGraph;
 
 	// Post-Process: FXAA ------------------
-	ID3D11RenderTargetView* fxaaRTV; // Allow us to render to a texture.
-	ID3D11ShaderResourceView* fxaaSRV; // Allow us to sample from the same texture.
 	SimpleVertexShader* fxaaVS;
 	SimplePixelShader* fxaaPS;
 	FXAA_DESC* fxaaSettings;
+	std::vector<SimpleShaderHandle> fxaaHandles; //indexed by FXAAVariable
 
 	// Clear color.
 	float clearColor[4];
 
 	// --------------------------------------------------------
-	// Singleton Constructor - Set up the singleton instance of the renderer
+	// Constructor - Only an EngineContext creates renderers
 	// --------------------------------------------------------
-	Renderer() {}
+	Renderer();
 
 	// --------------------------------------------------------
-	// Destructor for when the singleton instance is deleted
+	// Destructor for when the context is deleted
 	// --------------------------------------------------------
 	~Renderer();
+	friend class EngineContext;
 
 	// --------------------------------------------------------
-	// Prepare post-process render texture.
+	// Fill and sort the render queue with every enabled entity.
+	// Only entities inside the camera's frustum and not hidden
+	// behind occluders are drawn
 	// --------------------------------------------------------
-	void PreparePostProcess(ID3D11DeviceContext* context, 
-		ID3D11RenderTargetView* ppRTV, 
-		ID3D11DepthStencilView* ppDSV);
+	void BuildRenderQueue(Camera* camera);
 
 	// --------------------------------------------------------
-	// Render shadow maps for all lights that cast shadows
+	// Cull the frame's entities against a frustum.
+	// Works for the camera and for light frusta alike
+	//
+	// frustum - the frustum to test against
+	// Returns the number of entities in visibleIndices
 	// --------------------------------------------------------
-	void RenderShadowMaps(ID3D11DeviceContext* context,
-		ID3D11Device* device,
-		Camera* camera,
-		ID3D11RenderTargetView* backBufferRTV,
-		ID3D11DepthStencilView* depthStencilView,
-		UINT width, UINT height);
+	int CullFrameEntities(const Frustum& frustum);
+
+	// --------------------------------------------------------
+	// Render shadow maps for all lights that cast shadows.
+	// Binds its own targets and viewport
+	// --------------------------------------------------------
+	void RenderShadowMaps(ID3D11DeviceContext* context, Camera* camera);
+
+	// --------------------------------------------------------
+	// Hash the visible casters of a shadow pass so unchanged
+	// shadow maps can be skipped
+	//
+	// pass - StaticShadow or Shadow
+	// seed - hash to continue from
+	// casterCount - set to the number of visible casters
+	// --------------------------------------------------------
+	unsigned long long HashShadowCasters(RenderPass pass, unsigned long long seed, int& casterCount);
+
+	// --------------------------------------------------------
+	// Draw the visible casters of a shadow pass into the
+	// currently bound depth buffer
+	//
+	// frustum - the light's frustum, static batches are culled
+	//           against it range by range
+	// --------------------------------------------------------
+	void DrawShadowCasters(ID3D11DeviceContext* context, RenderPass pass, const Frustum& frustum);
+
+	// --------------------------------------------------------
+	// Bind the buffers depth only passes draw a mesh with: its
+	// position stream when it has one, since VS_Shadow only
+	// reads positions
+	// --------------------------------------------------------
+	void BindDepthOnlyBuffers(Mesh* mesh);
+
+	// --------------------------------------------------------
+	// Draw the depth of opaque objects without shading them,
+	// so the opaque pass only lights the nearest surface
+	// --------------------------------------------------------
+	void DrawDepthPrePass(ID3D11DeviceContext* context, Camera* camera);
+
+	// --------------------------------------------------------
+	// Draw opaque objects from the recorded command lists
+	// --------------------------------------------------------
+	void DrawOpaqueObjects(ID3D11DeviceContext* context, ID3D11Device* device, Camera* camera);
+
+	// --------------------------------------------------------
+	// Split the opaque pass into segments and record each into
+	// a command list. Segments are recorded on the WorkerPool
+	// when there are several, so recording must only read
+	// frame data (see Material::RecordMaterialObject)
+	// --------------------------------------------------------
+	void RecordOpaqueObjects();
+
+	// --------------------------------------------------------
+	// Record one opaque segment into its command list
+	// --------------------------------------------------------
+	void RecordOpaqueSegment(size_t segmentIndex);
+
+	// --------------------------------------------------------
+	// Record a run of packets that share a material and mesh
+	// as one instanced draw call
+	//
+	// packetIndex - index of the run's first packet in the opaque pass
+	// lod - the detail level of the mesh the run draws
+	// --------------------------------------------------------
+	void RecordInstanced(RenderCommandList& list, size_t packetIndex, size_t count, Mesh* mesh, int lod);
 
 	// --------------------------------------------------------
-	// Draw opaque objects
+	// Upload the instance data of every instanced opaque packet
+	// to the transient ring with a single map
 	// --------------------------------------------------------
-	void DrawOpaqueObjects(ID3D11DeviceContext* context, Camera* camera);
+	void UploadInstances(ID3D11DeviceContext* context);
 
 	// --------------------------------------------------------
 	// Draw transparent water
@@ -92,9 +247,9 @@ private:
 	void DrawWater(ID3D11DeviceContext* context, Camera* camera);
 
 	// --------------------------------------------------------
-	// Draw debug colider rectangles
+	// Draw the frame's debug lines and clear them
 	// --------------------------------------------------------
-	void DrawDebugColliders(ID3D11DeviceContext* context, Camera* camera);
+	void DrawDebug(ID3D11DeviceContext* context, Camera* camera);
 
 	// --------------------------------------------------------
 	// Draw the skybox
@@ -102,32 +257,67 @@ private:
 	void DrawSky(ID3D11DeviceContext* context, Camera* camera);
 
 	// --------------------------------------------------------
-	// Apply post processing.
+	// Apply post processing to the scene color, drawing into
+	// the bound render target
 	// --------------------------------------------------------
 	void ApplyPostProcess(ID3D11DeviceContext* context,
-		ID3D11RenderTargetView* backBufferRTV,
-		ID3D11DepthStencilView* depthStencilView,
-		ID3D11RenderTargetView* ppRTV,
-		ID3D11ShaderResourceView* ppSRV,
+		ID3D11ShaderResourceView* sceneSRV,
 		ID3D11SamplerState* sampler,
 		UINT width, UINT height);
 
 public:
 	// --------------------------------------------------------
-	// Get the singleton instance of the renderer
+	// Get the renderer of the current context
+	// --------------------------------------------------------
+	static Renderer* GetInstance();
+
+	// --------------------------------------------------------
+	// Get the state cache everything this renderer draws
+	// binds through
 	// --------------------------------------------------------
-	static Renderer* GetInstance()
-	{
-		static Renderer instance;
+	RenderStateCache* GetStateCache();
 
-		return &instance;
-	}
+	// --------------------------------------------------------
+	// Get the debug drawer whose lines this renderer draws
+	// --------------------------------------------------------
+	DebugDraw* GetDebugDraw();
 
 	// --------------------------------------------------------
 	// Initialize values in the renderer
 	// --------------------------------------------------------
 	void Init(ID3D11Device* device, UINT width, UINT height);
 
+	// --------------------------------------------------------
+	// Write the next frame's recorded command lists to a
+	// render capture (see RenderCapture)
+	// --------------------------------------------------------
+	void CaptureNextFrame(const char* path);
+
+	// --------------------------------------------------------
+	// Turn culling of entities hidden behind occluders on or
+	// off (see Entity::SetOccluder). On by default
+	// --------------------------------------------------------
+	void SetOcclusionCulling(bool enabled);
+
+	// --------------------------------------------------------
+	// Turn the depth pre-pass on or off. On by default
+	// --------------------------------------------------------
+	void SetDepthPrePass(bool enabled);
+
+	// --------------------------------------------------------
+	// Get the occlusion culler and this frame's stats
+	// --------------------------------------------------------
+	OcclusionCuller* GetOcclusionCuller();
+
+	// --------------------------------------------------------
+	// Merge static entities that share a material into static
+	// batches, which draw in one call each. Call once the
+	// level's entities are placed. Merged entities leave the
+	// render list and must not move afterwards; disabling or
+	// deleting one still stops it drawing
+	// --------------------------------------------------------
+	void BuildStaticBatches(ID3D11Device* device);
+
 	//Delete this
 	Renderer(Renderer const&) = delete;
 	void operator=(Renderer const&) = delete;
@@ -159,7 +349,7 @@ public:
 	void RemoveEntityFromRenderer(Entity* e);
 
 	// --------------------------------------------------------
-	// Check if an entity is in the render list. O(n) complexity
+	// Check if an entity is in the render list. O(1) complexity
 	// --------------------------------------------------------
 	bool IsEntityInRenderer(Entity* e);
 
@@ -183,9 +373,4 @@ public:
 	// --------------------------------------------------------
 	void SetClearColor(const float color[4]);
 	void SetClearColor(float r, float g, float b, float a = 1.0);
-
-	// --------------------------------------------------------
-	// Create the post-processing texture
-	// --------------------------------------------------------
-	void CreatePostProcessingResources(ID3D11Device* device, UINT width, UINT height);
 };
\ No newline at end of file
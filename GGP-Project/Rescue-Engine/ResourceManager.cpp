@@ -5,6 +5,14 @@ using namespace DirectX;
 
 ResourceManager::~ResourceManager()
 {
+	//Delete Meshes
+	for (auto const& pair : meshMap)
+	{
+		if (pair.second) { delete pair.second; }
+	}
+	meshMap.clear();
+
+#ifndef HEADLESS
 	//Delete Texture2Ds
 	for (auto const& pair : texture2DMap)
 	{
@@ -19,13 +27,6 @@ ResourceManager::~ResourceManager()
 	}
 	cubemapMap.clear();
 
-	//Delete Meshes
-	for (auto const& pair : meshMap)
-	{
-		if (pair.second) { delete pair.second; }
-	}
-	meshMap.clear();
-
 	//Delete Pixel Shaders
 	for (auto const& pair : pixelShaderMap)
 	{
@@ -46,8 +47,10 @@ ResourceManager::~ResourceManager()
 		if (pair.second) { delete pair.second; }
 	}
 	materialMap.clear();
+#endif
 }
 
+#ifndef HEADLESS
 // Load a Texture2D from the specified address with MipMaps
 bool ResourceManager::LoadTexture2D(const char* address, ID3D11Device* device, ID3D11DeviceContext* context)
 {
@@ -167,6 +170,7 @@ bool ResourceManager::LoadCubeMap(const char* address, ID3D11Device* device)
 	cubemapMap.emplace(str, tex);
 	return true;
 }
+#endif
 
 // Load a Mesh from the specified address
 bool ResourceManager::LoadMesh(const char* address, ID3D11Device* device)
@@ -197,6 +201,7 @@ bool ResourceManager::LoadMesh(const char* address, ID3D11Device* device)
 	return true;
 }
 
+#ifndef HEADLESS
 // Load a Material from the specified address
 bool ResourceManager::AddMaterial(const char* name, Material* material)
 {
@@ -277,6 +282,16 @@ bool ResourceManager::LoadVertexShader(const char* name, ID3D11Device* device, I
 	return false;
 }
 
+// Bind every loaded shader through a renderer's state cache
+void ResourceManager::SetShaderStateCache(RenderStateCache* stateCache)
+{
+	for (auto const& pair : pixelShaderMap)
+		pair.second->SetStateCache(stateCache);
+
+	for (auto const& pair : vertexShaderMap)
+		pair.second->SetStateCache(stateCache);
+}
+
 // Get a loaded Texture2D
 ID3D11ShaderResourceView* ResourceManager::GetTexture2D(std::string address)
 {
@@ -302,6 +317,7 @@ ID3D11ShaderResourceView* ResourceManager::GetCubeMap(std::string address)
 
 	return cubemapMap[address];
 }
+#endif
 
 // Get a loaded Mesh
 Mesh* ResourceManager::GetMesh(std::string address)
@@ -319,6 +335,10 @@ Mesh* ResourceManager::GetMesh(std::string address)
 // Get a added Material
 Material* ResourceManager::GetMaterial(std::string name)
 {
+#ifdef HEADLESS
+	//Materials need a device, headless entities have none
+	return nullptr;
+#else
 	//Check if the Material is in the map
 	if (materialMap.find(name) == materialMap.end())
 	{
@@ -327,8 +347,10 @@ Material* ResourceManager::GetMaterial(std::string name)
 	}
 
 	return materialMap[name];
+#endif
 }
 
+#ifndef HEADLESS
 // Get a loaded Pixel Shader
 SimplePixelShader* ResourceManager::GetPixelShader(std::string name)
 {
@@ -354,3 +376,4 @@ SimpleVertexShader* ResourceManager::GetVertexShader(std::string name)
 
 	return vertexShaderMap[name];
 }
+#endif
\ No newline at end of file
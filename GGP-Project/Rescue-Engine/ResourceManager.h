@@ -1,10 +1,23 @@
 #pragma once
-#include "WICTextureLoader.h"
-#include "DDSTextureLoader.h"
 #include <unordered_map>
+#include <string>
 #include "Mesh.h"
+#ifndef HEADLESS
+#include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
 #include "Material.h"
-
+#else
+class Material;
+#endif
+
+// --------------------------------------------------------
+// Singleton
+//
+// Process-wide and shared by every EngineContext. Load all
+// resources up front; once worlds are running it is read-only
+//
+// HEADLESS builds only load CPU-side mesh geometry
+// --------------------------------------------------------
 class ResourceManager
 {
 private:
@@ -15,12 +28,14 @@ private:
 	~ResourceManager();
 
 	//Resource maps
+	std::unordered_map<std::string, Mesh*> meshMap;
+#ifndef HEADLESS
 	std::unordered_map<std::string, ID3D11ShaderResourceView*> texture2DMap;
 	std::unordered_map<std::string, ID3D11ShaderResourceView*> cubemapMap;
-	std::unordered_map<std::string, Mesh*> meshMap;
 	std::unordered_map<std::string, Material*> materialMap;
 	std::unordered_map<std::string, SimplePixelShader*> pixelShaderMap;
 	std::unordered_map<std::string, SimpleVertexShader*> vertexShaderMap;
+#endif
 
 public:
 	// --------------------------------------------------------
@@ -37,6 +52,7 @@ public:
 	ResourceManager(ResourceManager const&) = delete;
 	void operator=(ResourceManager const&) = delete;
 
+#ifndef HEADLESS
 	// --------------------------------------------------------
 	// Load a Texture2D from the specified address with MipMaps
 	// --------------------------------------------------------
@@ -56,12 +72,14 @@ public:
 	// Load a CubeMap from the specified address with NO MipMaps
 	// --------------------------------------------------------
 	bool LoadCubeMap(const char* address, ID3D11Device* device);
+#endif
 
 	// --------------------------------------------------------
 	// Load a Mesh from the specified address
 	// --------------------------------------------------------
 	bool LoadMesh(const char* address, ID3D11Device* device);
 
+#ifndef HEADLESS
 	// --------------------------------------------------------
 	// Add an existing Material to the manager
 	// --------------------------------------------------------
@@ -77,6 +95,13 @@ public:
 	// --------------------------------------------------------
 	bool LoadVertexShader(const char* name, ID3D11Device* device, ID3D11DeviceContext* context);
 
+	// --------------------------------------------------------
+	// Bind every loaded shader through a renderer's state cache.
+	// Shaders are shared, so this is the renderer that draws
+	// with them on the device's immediate context
+	// --------------------------------------------------------
+	void SetShaderStateCache(RenderStateCache* stateCache);
+
 	// --------------------------------------------------------
 	// Get a loaded Texture2D
 	//
@@ -90,6 +115,7 @@ public:
 	// address - The file address of the CubeMap
 	// --------------------------------------------------------
 	ID3D11ShaderResourceView* GetCubeMap(std::string address);
+#endif
 
 	// --------------------------------------------------------
 	// Get a loaded Mesh
@@ -105,6 +131,7 @@ public:
 	// --------------------------------------------------------
 	Material* GetMaterial(std::string name);
 
+#ifndef HEADLESS
 	// --------------------------------------------------------
 	// Get a loaded Pixel Shader
 	//
@@ -118,5 +145,5 @@ public:
 	// name - The name of the Vertex Shader file
 	// --------------------------------------------------------
 	SimpleVertexShader* GetVertexShader(std::string name);
+#endif
 };
-
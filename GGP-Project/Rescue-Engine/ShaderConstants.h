@@ -0,0 +1,101 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include "Lights.h"
+
+// --------------------------------------------------------
+// C++ mirrors of shader constant buffers.
+//
+// Each struct matches one HLSL cbuffer's packing, so it can be
+// filled directly and uploaded with a single
+// ISimpleShader::SetBufferData() instead of a name lookup per
+// variable. The asserts pin every member to its HLSL offset;
+// change a cbuffer and its struct together. SetBufferData()
+// also checks the size against the shader's reflection
+// --------------------------------------------------------
+
+//Pin a member to its HLSL packing offset
+#define CHECK_CONSTANT_OFFSET(type, member, offset) \
+	static_assert(offsetof(type, member) == offset, #type "::" #member " does not match its HLSL offset")
+
+//Pin a struct to its HLSL size
+#define CHECK_CONSTANT_SIZE(type, size) \
+	static_assert(sizeof(type) == size, #type " does not match its HLSL size")
+
+//Light in Lighting.hlsli
+CHECK_CONSTANT_OFFSET(LightStruct, Type, 0);
+CHECK_CONSTANT_OFFSET(LightStruct, Direction, 4);
+CHECK_CONSTANT_OFFSET(LightStruct, Range, 16);
+CHECK_CONSTANT_OFFSET(LightStruct, Position, 20);
+CHECK_CONSTANT_OFFSET(LightStruct, Intensity, 32);
+CHECK_CONSTANT_OFFSET(LightStruct, Color, 36);
+CHECK_CONSTANT_OFFSET(LightStruct, SpotFalloff, 48);
+CHECK_CONSTANT_SIZE(LightStruct, 64);
+
+//AmbientLight in Lighting.hlsli
+CHECK_CONSTANT_OFFSET(AmbientLightStruct, Intensity, 0);
+CHECK_CONSTANT_OFFSET(AmbientLightStruct, Color, 4);
+CHECK_CONSTANT_SIZE(AmbientLightStruct, 16);
+
+// --------------------------------------------------------
+// perCombo in VertexShader.hlsl and VS_Instanced.hlsl
+// --------------------------------------------------------
+struct PerComboVSConstants
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT2 uvScale;
+	DirectX::XMFLOAT2 padding;
+};
+CHECK_CONSTANT_OFFSET(PerComboVSConstants, view, 0);
+CHECK_CONSTANT_OFFSET(PerComboVSConstants, projection, 64);
+CHECK_CONSTANT_OFFSET(PerComboVSConstants, uvScale, 128);
+CHECK_CONSTANT_SIZE(PerComboVSConstants, 144);
+
+// --------------------------------------------------------
+// perObject in VertexShader.hlsl
+// --------------------------------------------------------
+struct PerObjectVSConstants
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTrans;
+};
+CHECK_CONSTANT_OFFSET(PerObjectVSConstants, world, 0);
+CHECK_CONSTANT_OFFSET(PerObjectVSConstants, worldInvTrans, 64);
+CHECK_CONSTANT_SIZE(PerObjectVSConstants, 128);
+
+// --------------------------------------------------------
+// shadows in Shadows.hlsli
+// --------------------------------------------------------
+struct ShadowConstants
+{
+	DirectX::XMFLOAT4X4 ShadowViewProj[MAX_SHADOW_CASCADES];
+	float CascadeSplits[MAX_SHADOW_CASCADES];
+	DirectX::XMFLOAT3 ShadowCameraPosition;
+	int CascadeCount;
+	DirectX::XMFLOAT3 ShadowCameraForward;
+	float ShadowPadding;
+};
+CHECK_CONSTANT_OFFSET(ShadowConstants, ShadowViewProj, 0);
+CHECK_CONSTANT_OFFSET(ShadowConstants, CascadeSplits, 64 * MAX_SHADOW_CASCADES);
+CHECK_CONSTANT_OFFSET(ShadowConstants, ShadowCameraPosition, 64 * MAX_SHADOW_CASCADES + 16);
+CHECK_CONSTANT_OFFSET(ShadowConstants, CascadeCount, 64 * MAX_SHADOW_CASCADES + 28);
+CHECK_CONSTANT_OFFSET(ShadowConstants, ShadowCameraForward, 64 * MAX_SHADOW_CASCADES + 32);
+CHECK_CONSTANT_SIZE(ShadowConstants, 64 * MAX_SHADOW_CASCADES + 48);
+
+// --------------------------------------------------------
+// clusters in Clusters.hlsli
+// --------------------------------------------------------
+struct ClusterConstants
+{
+	DirectX::XMFLOAT2 ClusterTileScale;
+	float ClusterDepthScale;
+	float ClusterDepthBias;
+	int DirectionalLightCount;
+	DirectX::XMFLOAT3 ClusterPadding;
+};
+CHECK_CONSTANT_OFFSET(ClusterConstants, ClusterTileScale, 0);
+CHECK_CONSTANT_OFFSET(ClusterConstants, ClusterDepthScale, 8);
+CHECK_CONSTANT_OFFSET(ClusterConstants, ClusterDepthBias, 12);
+CHECK_CONSTANT_OFFSET(ClusterConstants, DirectionalLightCount, 16);
+CHECK_CONSTANT_SIZE(ClusterConstants, 32);
@@ -1,4 +1,7 @@
 #include "SimpleShader.h"
+#include "RenderStateCache.h"
+#include <cassert>
+#include <cstdio>
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -12,6 +15,7 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
+	this->stateCache = nullptr;
 
 	// Set up fields
 	constantBufferCount = 0;
@@ -55,6 +59,7 @@ void ISimpleShader::CleanUp()
 		delete samplerStates[i];
 
 	// Clean up tables
+	variables.clear();
 	varTable.clear();
 	cbTable.clear();
 	samplerTable.clear();
@@ -116,6 +121,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // Structured and raw buffers bind as SRVs too
+		case D3D_SIT_BYTEADDRESS:
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
@@ -165,12 +172,13 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		constantBuffers[b].Name = bufferDesc.Name;
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
+		// Create this constant buffer. It is dynamic, since it is
+		// rewritten whole with Map(WRITE_DISCARD) whenever it changes
 		D3D11_BUFFER_DESC newBuffDesc;
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.Usage = D3D11_USAGE_DYNAMIC;
 		newBuffDesc.ByteWidth = max(bufferDesc.Size, 16); // NEW: Must be multiple of 16
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
@@ -179,6 +187,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		constantBuffers[b].Size = bufferDesc.Size;
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].Dirty = true; // Nothing uploaded yet
+		constantBuffers[b].SizeMismatchReported = false;
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -201,7 +211,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			std::string varName(varDesc.Name);
 
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.insert(std::pair<std::string, SimpleShaderHandle>(varName, (SimpleShaderHandle)variables.size()));
+			variables.push_back(varStruct);
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
@@ -221,15 +232,15 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
+	std::unordered_map<std::string, SimpleShaderHandle>::iterator result =
 		varTable.find(name);
 
 	// Did we find the key?
 	if (result == varTable.end())
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the variable the handle points to
+	SimpleShaderVariable* var = &variables[result->second];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -256,6 +267,24 @@ SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 	return result->second;
 }
 
+// --------------------------------------------------------
+// Helper for uploading a constant buffer's local data. Buffers
+// whose data hasn't changed since the last upload are skipped
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (!cb->Dirty) return;
+
+	// Discard the old contents and write the whole buffer
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(deviceContext->Map(cb->ConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, cb->LocalDataBuffer, cb->Size);
+	deviceContext->Unmap(cb->ConstantBuffer, 0);
+
+	cb->Dirty = false;
+}
+
 // --------------------------------------------------------
 // Sets the shader and associated constant buffers in DirectX
 // --------------------------------------------------------
@@ -279,13 +308,10 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any that changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -313,10 +339,8 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	SimpleConstantBuffer* cb = &this->constantBuffers[index];
 	if (!cb) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data if it changed and get out
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -335,10 +359,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
 	if (!cb) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data if it changed and get out
+	UploadBuffer(cb);
 }
 
 
@@ -360,13 +382,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
-
-	// Success
-	return true;
+	return SetData((SimpleShaderHandle)(var - &variables[0]), data, size);
 }
 
 // --------------------------------------------------------
@@ -449,6 +465,230 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Gets a handle to a shader variable for setting it without
+// a name lookup, or SIMPLE_SHADER_INVALID_HANDLE if it
+// doesn't exist. Handles stay valid as long as the shader does
+//
+// name - The name of the shader variable
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	// Look for the key
+	std::unordered_map<std::string, SimpleShaderHandle>::iterator result =
+		varTable.find(name);
+
+	// Did we find the key?
+	if (result == varTable.end())
+		return SIMPLE_SHADER_INVALID_HANDLE;
+
+	// Success
+	return result->second;
+}
+
+// --------------------------------------------------------
+// Gets the index of a constant buffer, for use with
+// CopyBufferData(index), or -1 if it doesn't exist
+//
+// bufferName - The name of the constant buffer
+// --------------------------------------------------------
+unsigned int ISimpleShader::GetBufferIndex(std::string bufferName)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (!cb) return (unsigned int)-1;
+
+	return (unsigned int)(cb - constantBuffers);
+}
+
+// --------------------------------------------------------
+// Sets a variable through its handle with arbitrary data of
+// the specified size. The buffer is only marked for upload
+// if the data actually changes
+//
+// handle - The handle from GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must match the variable's size)
+//
+// Returns true if data is set, false if the handle isn't
+// valid or sizes don't match
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleShaderHandle handle, const void* data, unsigned int size)
+{
+	// Validate the handle and size
+	if (handle < 0 || handle >= (SimpleShaderHandle)variables.size())
+		return false;
+	SimpleShaderVariable* var = &variables[handle];
+	if (var->Size != size)
+		return false;
+
+	// Nothing to do if the value is the same
+	SimpleConstantBuffer* cb = &constantBuffers[var->ConstantBufferIndex];
+	unsigned char* dest = cb->LocalDataBuffer + var->ByteOffset;
+	if (memcmp(dest, data, size) == 0)
+		return true;
+
+	// Set the data in the local data buffer
+	memcpy(dest, data, size);
+	cb->Dirty = true;
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Binds through a state cache from now on, so nothing already
+// bound is set again
+//
+// stateCache - The cache, or null to bind straight to DirectX
+// --------------------------------------------------------
+void ISimpleShader::SetStateCache(RenderStateCache* stateCache)
+{
+	this->stateCache = stateCache;
+}
+
+// --------------------------------------------------------
+// Records the shader's constant buffers and their local data,
+// and for pixel shaders whatever the state cache has bound to
+// the shader's texture and sampler slots, so a render capture
+// holds what a material set up through the shader
+//
+// list - The list to record into
+// stage - The stage this shader runs in
+// --------------------------------------------------------
+void ISimpleShader::RecordState(RenderCommandList& list, RenderStage stage)
+{
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		// Skip "buffers" that aren't true constant buffers
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (cb->Type != D3D11_CT_CBUFFER)
+			continue;
+
+		list.BindConstantBuffer(stage, cb->BindIndex, cb->ConstantBuffer);
+		list.SetConstants(cb->ConstantBuffer, cb->LocalDataBuffer, cb->Size);
+	}
+
+	// Only pixel shader slots are tracked by the cache
+	RenderStateCache* cache = GetStateCache();
+	if (stage != RenderStage::Pixel || cache == nullptr)
+		return;
+
+	for (SimpleSRV* srv : shaderResourceViews)
+		list.BindResource(stage, srv->BindIndex, cache->GetPSShaderResource(srv->BindIndex));
+	for (SimpleSampler* sampler : samplerStates)
+		list.BindSampler(stage, sampler->BindIndex, cache->GetPSSampler(sampler->BindIndex));
+}
+
+// --------------------------------------------------------
+// Gets the state cache to bind through, or null if it isn't
+// tracking this shader's context
+// --------------------------------------------------------
+RenderStateCache* ISimpleShader::GetStateCache()
+{
+	if (stateCache && stateCache->GetContext() == deviceContext)
+		return stateCache;
+	return nullptr;
+}
+
+// --------------------------------------------------------
+// Sets the whole local data of a constant buffer at once. The
+// buffer is only marked for upload if the data actually changes
+//
+// index - The index of the buffer, from GetBufferIndex()
+// data - The data to set in the buffer
+// size - The size of the data (this must match the buffer's size)
+//
+// Returns true if data is set, false if the index isn't
+// valid or sizes don't match. A size mismatch means a struct
+// in ShaderConstants.h is out of date, so it is reported once
+// per buffer and asserts in debug builds
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(unsigned int index, const void* data, unsigned int size)
+{
+	// Validate the index and size
+	if (index >= constantBufferCount)
+		return false;
+	SimpleConstantBuffer* cb = &constantBuffers[index];
+	if (cb->Size != size)
+	{
+		if (!cb->SizeMismatchReported)
+		{
+			printf("Constant buffer \"%s\" is %u bytes, but was given %u\n", cb->Name.c_str(), cb->Size, size);
+			cb->SizeMismatchReported = true;
+		}
+		assert(false && "SetBufferData() size does not match the constant buffer");
+		return false;
+	}
+
+	// Nothing to do if the data is the same
+	if (memcmp(cb->LocalDataBuffer, data, size) == 0)
+		return true;
+
+	memcpy(cb->LocalDataBuffer, data, size);
+	cb->Dirty = true;
+	return true;
+}
+
+// --------------------------------------------------------
+// Forces the next copy of a buffer to upload, for when its
+// GPU copy was written without going through this shader
+//
+// index - The index of the buffer, from GetBufferIndex()
+// --------------------------------------------------------
+void ISimpleShader::InvalidateBuffer(unsigned int index)
+{
+	if (index < constantBufferCount)
+		constantBuffers[index].Dirty = true;
+}
+
+// --------------------------------------------------------
+// Sets INTEGER data through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(SimpleShaderHandle handle, int data)
+{
+	return this->SetData(handle, (void*)(&data), sizeof(int));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat(SimpleShaderHandle handle, float data)
+{
+	return this->SetData(handle, (void*)(&data), sizeof(float));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2 data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3 data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4 data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
@@ -757,9 +997,21 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Bind through the state cache when it tracks this context,
+	// so nothing already bound is set again
+	RenderStateCache* cache = GetStateCache();
+
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout);
-	deviceContext->VSSetShader(shader, 0, 0);
+	if (cache)
+	{
+		cache->SetInputLayout(inputLayout);
+		cache->SetVertexShader(shader);
+	}
+	else
+	{
+		deviceContext->IASetInputLayout(inputLayout);
+		deviceContext->VSSetShader(shader, 0, 0);
+	}
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -769,10 +1021,13 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		if (cache)
+			cache->SetVSConstantBuffer(constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
+		else
+			deviceContext->VSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				&constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -884,8 +1139,14 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 	
+	// Bind through the state cache when it tracks this context
+	RenderStateCache* cache = GetStateCache();
+
 	// Set the shader
-	deviceContext->PSSetShader(shader, 0, 0);
+	if (cache)
+		cache->SetPixelShader(shader);
+	else
+		deviceContext->PSSetShader(shader, 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -895,10 +1156,13 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
+		if (cache)
+			cache->SetPSConstantBuffer(constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
+		else
+			deviceContext->PSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				&constantBuffers[i].ConstantBuffer);
 	}
 }
 
@@ -918,7 +1182,11 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 		return false;
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStateCache* cache = GetStateCache();
+	if (cache)
+		cache->SetPSShaderResource(srvInfo->BindIndex, srv);
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
 
 	// Success
 	return true;
@@ -939,8 +1207,12 @@ bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* sa
 	if (sampInfo == 0)
 		return false;
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	// Set the sampler state
+	RenderStateCache* cache = GetStateCache();
+	if (cache)
+		cache->SetPSSampler(sampInfo->BindIndex, samplerState);
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
 
 	// Success
 	return true;
@@ -9,6 +9,9 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include "RenderCommandList.h"
+
+class RenderStateCache;
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -21,6 +24,13 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// Pre-resolved shader variable, so hot paths can set data
+// without a name lookup. Get one with GetVariableHandle()
+// --------------------------------------------------------
+typedef int SimpleShaderHandle;
+#define SIMPLE_SHADER_INVALID_HANDLE -1
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -34,6 +44,8 @@ struct SimpleConstantBuffer
 	unsigned int BindIndex;
 	ID3D11Buffer* ConstantBuffer;
 	unsigned char* LocalDataBuffer;
+	bool Dirty; // Local data differs from the GPU copy
+	bool SizeMismatchReported; // SetBufferData() was given the wrong size
 	std::vector<SimpleShaderVariable> Variables;
 };
 
@@ -91,6 +103,35 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Sets shader data through a pre-resolved handle
+	SimpleShaderHandle GetVariableHandle(std::string name);
+	unsigned int GetBufferIndex(std::string bufferName);
+	bool SetData(SimpleShaderHandle handle, const void* data, unsigned int size);
+
+	bool SetInt(SimpleShaderHandle handle, int data);
+	bool SetFloat(SimpleShaderHandle handle, float data);
+	bool SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4 data);
+
+	// Sets a whole constant buffer from a struct matching its layout
+	// (see ShaderConstants.h)
+	bool SetBufferData(unsigned int index, const void* data, unsigned int size);
+	template<typename T>
+	bool SetBufferData(unsigned int index, const T& data) { return SetBufferData(index, &data, sizeof(T)); }
+
+	// Binds through a state cache instead of straight to DirectX
+	void SetStateCache(RenderStateCache* stateCache);
+
+	// Records the shader's constant buffers, and for pixel shaders
+	// what its state cache has bound to its texture and sampler slots
+	void RecordState(RenderCommandList& list, RenderStage stage);
+
+	// Forces the next copy of a buffer to upload, for when its GPU
+	// copy was written elsewhere (e.g. by a RenderCommandList)
+	void InvalidateBuffer(unsigned int index);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
 	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
@@ -121,6 +162,7 @@ protected:
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
+	RenderStateCache* stateCache;
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -130,7 +172,8 @@ protected:
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
 	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
+	std::vector<SimpleShaderVariable> variables; // Indexed by handle
+	std::unordered_map<std::string, SimpleShaderHandle> varTable;
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
@@ -143,6 +186,12 @@ protected:
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Uploads a constant buffer if its local data changed
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
+	// Gets the state cache if it tracks this shader's context
+	RenderStateCache* GetStateCache();
 };
 
 // --------------------------------------------------------
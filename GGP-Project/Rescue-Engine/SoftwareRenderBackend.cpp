@@ -0,0 +1,548 @@
+#include "SoftwareRenderBackend.h"
+#include "WorkerPool.h"
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdio.h>
+
+using namespace DirectX;
+
+// Pack a color into RGBA8
+static unsigned int PackColor(float r, float g, float b)
+{
+	r = r < 0 ? 0 : (r > 1 ? 1 : r);
+	g = g < 0 ? 0 : (g > 1 ? 1 : g);
+	b = b < 0 ? 0 : (b > 1 ? 1 : b);
+	return (unsigned int)(r * 255.0f + 0.5f) |
+		((unsigned int)(g * 255.0f + 0.5f) << 8) |
+		((unsigned int)(b * 255.0f + 0.5f) << 16) |
+		0xFF000000;
+}
+
+// Construct a backend. Call Init() before use
+SoftwareRenderBackend::SoftwareRenderBackend()
+{
+	width = 0;
+	height = 0;
+	pitch = 0;
+	threadCount = 1;
+	tilesX = 0;
+	tilesY = 0;
+	clearColor = PackColor(0, 0, 0);
+	objectConstantBuffer = nullptr;
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInvTrans, XMMatrixIdentity());
+	SetLighting(XMFLOAT3(1, -1, 1), XMFLOAT3(1, 1, 1), XMFLOAT3(0.2f, 0.2f, 0.2f), XMFLOAT3(0.8f, 0.8f, 0.8f));
+
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+	indexOffset = 0;
+
+	submittedTriangles = 0;
+	culledTriangles = 0;
+	shadedPixels = 0;
+	skippedDraws = 0;
+	drawStamp = 0;
+}
+
+// Create the color and depth targets
+void SoftwareRenderBackend::Init(int width, int height, int threads)
+{
+	this->width = width;
+	this->height = height;
+	pitch = (width + 3) & ~3;
+	tilesX = (pitch + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	tilesY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+
+	colorBuffer.assign((size_t)pitch * height, clearColor);
+	depthBuffer.assign((size_t)pitch * height, 1.0f);
+	tileBins.resize((size_t)tilesX * tilesY);
+
+	threadCount = threads > 0 ? threads : WorkerPool::GetInstance()->GetThreadCount();
+}
+
+// Register the vertices behind a vertex buffer handle
+void SoftwareRenderBackend::SetVertexData(const void* buffer, const Vertex* vertices, unsigned int count)
+{
+	VertexData data;
+	data.vertices = vertices;
+	data.count = count;
+	vertexData[buffer] = data;
+}
+
+// Register the indices behind an index buffer handle
+void SoftwareRenderBackend::SetIndexData(const void* buffer, const unsigned int* indices, unsigned int count)
+{
+	IndexData data;
+	data.indices = indices;
+	data.count = count;
+	indexData[buffer] = data;
+}
+
+// Set which constant buffer holds per object constants
+void SoftwareRenderBackend::SetObjectConstantBuffer(const void* buffer)
+{
+	objectConstantBuffer = buffer;
+}
+
+// Set the camera
+void SoftwareRenderBackend::SetCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMMATRIX v = XMMatrixTranspose(XMLoadFloat4x4(&view));
+	XMMATRIX p = XMMatrixTranspose(XMLoadFloat4x4(&projection));
+	XMStoreFloat4x4(&viewProjection, v * p);
+}
+
+// Set the directional light and material color draws are lit with
+void SoftwareRenderBackend::SetLighting(XMFLOAT3 direction, XMFLOAT3 color, XMFLOAT3 ambient, XMFLOAT3 albedo)
+{
+	XMStoreFloat3(&lightDirection, XMVector3Normalize(XMLoadFloat3(&direction)));
+	lightColor = color;
+	ambientColor = ambient;
+	this->albedo = albedo;
+}
+
+// Clear the targets and bins and reset the stats
+void SoftwareRenderBackend::BeginFrame(float r, float g, float b)
+{
+	clearColor = PackColor(r, g, b);
+	std::fill(colorBuffer.begin(), colorBuffer.end(), clearColor);
+	std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+
+	triangles.clear();
+	for (std::vector<unsigned int>& bin : tileBins)
+		bin.clear();
+
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+	indexOffset = 0;
+
+	submittedTriangles = 0;
+	culledTriangles = 0;
+	shadedPixels = 0;
+	skippedDraws = 0;
+}
+
+// Light, clip and bin every draw in a list
+void SoftwareRenderBackend::Execute(const RenderCommandList& list)
+{
+	for (const RenderCommand& command : list.GetCommands())
+	{
+		switch (command.type)
+		{
+		case RenderCommandType::BindVertexBuffer:
+			//Slot 1 only carries instance data
+			if (command.slot == 0)
+				vertexBuffer = command.args[0] == sizeof(Vertex) ? command.object : nullptr;
+			break;
+
+		case RenderCommandType::BindIndexBuffer:
+			indexBuffer = command.object;
+			indexOffset = command.args[0];
+			break;
+
+		case RenderCommandType::SetConstants:
+			if (command.object == objectConstantBuffer && command.args[1] >= sizeof(XMFLOAT4X4) * 2)
+			{
+				const unsigned char* constants = (const unsigned char*)list.GetConstants(command);
+				memcpy(&world, constants, sizeof(XMFLOAT4X4));
+				memcpy(&worldInvTrans, constants + sizeof(XMFLOAT4X4), sizeof(XMFLOAT4X4));
+			}
+			break;
+
+		case RenderCommandType::DrawIndexed:
+			DrawIndexed(command.args[0], command.args[1], (int)command.args[2]);
+			break;
+
+		case RenderCommandType::Draw:
+		case RenderCommandType::DrawIndexedInstanced:
+			skippedDraws++;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// Transform, light, clip and bin an indexed draw
+void SoftwareRenderBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	auto vertices = vertexData.find(vertexBuffer);
+	auto indices = indexData.find(indexBuffer);
+	if (vertices == vertexData.end() || indices == indexData.end())
+	{
+		skippedDraws++;
+		return;
+	}
+
+	const VertexData& vd = vertices->second;
+	const IndexData& id = indices->second;
+	unsigned int firstIndex = indexOffset / sizeof(unsigned int) + startIndex;
+	if (firstIndex + indexCount > id.count)
+	{
+		skippedDraws++;
+		return;
+	}
+
+	//World matrices come in transposed
+	XMMATRIX worldViewProj = XMMatrixTranspose(XMLoadFloat4x4(&world)) * XMLoadFloat4x4(&viewProjection);
+	XMMATRIX normalMatrix = XMMatrixTranspose(XMLoadFloat4x4(&worldInvTrans));
+	XMVECTOR toLight = XMVectorNegate(XMLoadFloat3(&lightDirection));
+	XMVECTOR ambient = XMLoadFloat3(&ambientColor);
+	XMVECTOR diffuse = XMLoadFloat3(&lightColor);
+	XMVECTOR surface = XMLoadFloat3(&albedo);
+
+	//Scratch vertices are stamped with the draw they were lit for, so
+	//each vertex the indices reach is lit once and the rest (other
+	//detail levels, other batched objects) not at all
+	if (transformed.size() < vd.count)
+	{
+		transformed.resize(vd.count);
+		transformedDraw.resize(vd.count, 0);
+	}
+	if (++drawStamp == 0)
+	{
+		std::fill(transformedDraw.begin(), transformedDraw.end(), 0);
+		drawStamp = 1;
+	}
+	auto transform = [&](unsigned int index) -> const ClipVertex&
+	{
+		ClipVertex& out = transformed[index];
+		if (transformedDraw[index] == drawStamp)
+			return out;
+		transformedDraw[index] = drawStamp;
+
+		const Vertex& v = vd.vertices[index];
+		XMVECTOR position = XMVector4Transform(XMVectorSetW(XMLoadFloat3(&v.Position), 1.0f), worldViewProj);
+		XMVECTOR normal = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.Normal), normalMatrix));
+		XMVECTOR nDotL = XMVectorMax(XMVector3Dot(normal, toLight), XMVectorZero());
+
+		XMStoreFloat4(&out.position, position);
+		XMStoreFloat3(&out.color, XMVectorMultiply(surface, XMVectorMultiplyAdd(diffuse, nDotL, ambient)));
+		return out;
+	};
+
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		submittedTriangles++;
+		unsigned int i0 = id.indices[firstIndex + i] + baseVertex;
+		unsigned int i1 = id.indices[firstIndex + i + 1] + baseVertex;
+		unsigned int i2 = id.indices[firstIndex + i + 2] + baseVertex;
+		if (i0 >= vd.count || i1 >= vd.count || i2 >= vd.count)
+		{
+			culledTriangles++;
+			continue;
+		}
+		ClipTriangle(transform(i0), transform(i1), transform(i2));
+	}
+}
+
+// Clip a triangle against the near plane and bin the result
+void SoftwareRenderBackend::ClipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	const ClipVertex* in[3] = { &v0, &v1, &v2 };
+	int behind = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		if (in[i]->position.z < 0)
+			behind++;
+	}
+
+	if (behind == 3)
+	{
+		culledTriangles++;
+		return;
+	}
+	if (behind == 0)
+	{
+		BinTriangle(v0, v1, v2);
+		return;
+	}
+
+	//Keep the part where z >= 0, at most a quad
+	ClipVertex out[4];
+	int outCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const ClipVertex& a = *in[i];
+		const ClipVertex& b = *in[(i + 1) % 3];
+		if (a.position.z >= 0)
+			out[outCount++] = a;
+		if ((a.position.z >= 0) != (b.position.z >= 0))
+		{
+			float t = a.position.z / (a.position.z - b.position.z);
+			ClipVertex& c = out[outCount++];
+			XMStoreFloat4(&c.position, XMVectorLerp(XMLoadFloat4(&a.position), XMLoadFloat4(&b.position), t));
+			XMStoreFloat3(&c.color, XMVectorLerp(XMLoadFloat3(&a.color), XMLoadFloat3(&b.color), t));
+		}
+	}
+
+	BinTriangle(out[0], out[1], out[2]);
+	if (outCount == 4)
+		BinTriangle(out[0], out[2], out[3]);
+}
+
+// Set up a triangle and add it to the bins of the tiles it covers
+void SoftwareRenderBackend::BinTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	const ClipVertex* corners[3] = { &v0, &v1, &v2 };
+	float x[3];
+	float y[3];
+	SoftwareTriangle triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& p = corners[i]->position;
+		if (p.w <= 1e-6f)
+		{
+			culledTriangles++;
+			return;
+		}
+
+		float invW = 1.0f / p.w;
+		x[i] = (p.x * invW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - p.y * invW * 0.5f) * height;
+		triangle.depth[i] = p.z * invW;
+		triangle.invW[i] = invW;
+		triangle.color[i] = XMFLOAT3(corners[i]->color.x * invW, corners[i]->color.y * invW, corners[i]->color.z * invW);
+	}
+
+	//Clockwise on screen faces the camera, like D3D's default
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0)
+	{
+		culledTriangles++;
+		return;
+	}
+
+	triangle.minX = (int)floorf(fminf(x[0], fminf(x[1], x[2])));
+	triangle.minY = (int)floorf(fminf(y[0], fminf(y[1], y[2])));
+	triangle.maxX = (int)ceilf(fmaxf(x[0], fmaxf(x[1], x[2])));
+	triangle.maxY = (int)ceilf(fmaxf(y[0], fmaxf(y[1], y[2])));
+	if (triangle.minX < 0) triangle.minX = 0;
+	if (triangle.minY < 0) triangle.minY = 0;
+	if (triangle.maxX > width - 1) triangle.maxX = width - 1;
+	if (triangle.maxY > height - 1) triangle.maxY = height - 1;
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+	{
+		culledTriangles++;
+		return;
+	}
+
+	//Edge i is opposite corner i, so it weighs that corner
+	for (int i = 0; i < 3; i++)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		triangle.edgeA[i] = y[a] - y[b];
+		triangle.edgeB[i] = x[b] - x[a];
+		triangle.edgeC[i] = -(triangle.edgeB[i] * y[a] + triangle.edgeA[i] * x[a]);
+		triangle.topLeft[i] = (y[a] == y[b] && x[b] > x[a]) || y[b] < y[a];
+	}
+	triangle.invArea = 1.0f / area;
+
+	unsigned int index = (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+	for (int ty = triangle.minY / SOFTWARE_TILE_SIZE; ty <= triangle.maxY / SOFTWARE_TILE_SIZE; ty++)
+	{
+		for (int tx = triangle.minX / SOFTWARE_TILE_SIZE; tx <= triangle.maxX / SOFTWARE_TILE_SIZE; tx++)
+			tileBins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+// Rasterize every triangle binned to a tile
+unsigned long long SoftwareRenderBackend::RasterizeTile(int tile)
+{
+	int tileX = (tile % tilesX) * SOFTWARE_TILE_SIZE;
+	int tileY = (tile / tilesX) * SOFTWARE_TILE_SIZE;
+	int tileMaxX = (tileX + SOFTWARE_TILE_SIZE < pitch ? tileX + SOFTWARE_TILE_SIZE : pitch) - 1;
+	int tileMaxY = (tileY + SOFTWARE_TILE_SIZE < height ? tileY + SOFTWARE_TILE_SIZE : height) - 1;
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	unsigned long long pixels = 0;
+
+	for (unsigned int index : tileBins[tile])
+	{
+		const SoftwareTriangle& t = triangles[index];
+
+		//Spans start on 4 pixel boundaries, which tiles and rows are padded to
+		int minX = (t.minX > tileX ? t.minX : tileX) & ~3;
+		int maxX = t.maxX < tileMaxX ? t.maxX : tileMaxX;
+		int minY = t.minY > tileY ? t.minY : tileY;
+		int maxY = t.maxY < tileMaxY ? t.maxY : tileMaxY;
+
+		XMVECTOR edgeA[3];
+		for (int e = 0; e < 3; e++)
+			edgeA[e] = XMVectorReplicate(t.edgeA[e]);
+		XMVECTOR invArea = XMVectorReplicate(t.invArea);
+		XMVECTOR depth0 = XMVectorReplicate(t.depth[0]);
+		XMVECTOR depthStep1 = XMVectorReplicate(t.depth[1] - t.depth[0]);
+		XMVECTOR depthStep2 = XMVectorReplicate(t.depth[2] - t.depth[0]);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			XMVECTOR rowC[3];
+			for (int e = 0; e < 3; e++)
+				rowC[e] = XMVectorReplicate(t.edgeB[e] * py + t.edgeC[e]);
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				//Inside all three edges, owning pixels on top and left edges
+				XMVECTOR weights[3];
+				XMVECTOR mask = XMVectorTrueInt();
+				for (int e = 0; e < 3; e++)
+				{
+					weights[e] = XMVectorMultiplyAdd(edgeA[e], px, rowC[e]);
+					XMVECTOR inside = t.topLeft[e] ? XMVectorGreaterOrEqual(weights[e], XMVectorZero()) : XMVectorGreater(weights[e], XMVectorZero());
+					mask = XMVectorAndInt(mask, inside);
+				}
+				if (x + 4 > width)
+					mask = XMVectorAndInt(mask, XMVectorLess(px, XMVectorReplicate((float)width)));
+				if (XMVector4EqualInt(mask, XMVectorFalseInt()))
+					continue;
+
+				//Depth test
+				size_t offset = (size_t)y * pitch + x;
+				XMVECTOR b1 = XMVectorMultiply(weights[1], invArea);
+				XMVECTOR b2 = XMVectorMultiply(weights[2], invArea);
+				XMVECTOR z = XMVectorMultiplyAdd(depthStep2, b2, XMVectorMultiplyAdd(depthStep1, b1, depth0));
+				XMVECTOR stored = XMLoadFloat4((const XMFLOAT4*)&depthBuffer[offset]);
+				mask = XMVectorAndInt(mask, XMVectorLess(z, stored));
+				if (XMVector4EqualInt(mask, XMVectorFalseInt()))
+					continue;
+				XMStoreFloat4((XMFLOAT4*)&depthBuffer[offset], XMVectorSelect(stored, z, mask));
+
+				//Perspective correct color for the pixels that passed
+				uint32_t lanes[4];
+				XMFLOAT4 w0, w1, w2;
+				XMStoreInt4(lanes, mask);
+				XMStoreFloat4(&w0, XMVectorMultiply(weights[0], invArea));
+				XMStoreFloat4(&w1, b1);
+				XMStoreFloat4(&w2, b2);
+				const float* bary0 = &w0.x;
+				const float* bary1 = &w1.x;
+				const float* bary2 = &w2.x;
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if (lanes[lane] == 0)
+						continue;
+
+					float invW = bary0[lane] * t.invW[0] + bary1[lane] * t.invW[1] + bary2[lane] * t.invW[2];
+					float w = 1.0f / invW;
+					colorBuffer[offset + lane] = PackColor(
+						(bary0[lane] * t.color[0].x + bary1[lane] * t.color[1].x + bary2[lane] * t.color[2].x) * w,
+						(bary0[lane] * t.color[0].y + bary1[lane] * t.color[1].y + bary2[lane] * t.color[2].y) * w,
+						(bary0[lane] * t.color[0].z + bary1[lane] * t.color[1].z + bary2[lane] * t.color[2].z) * w);
+					pixels++;
+				}
+			}
+		}
+	}
+
+	return pixels;
+}
+
+// Rasterize everything binned since BeginFrame()
+void SoftwareRenderBackend::Finish()
+{
+	//Pool threads take tiles until there are none left, counting pixels per thread
+	std::vector<unsigned long long> pixels(threadCount, 0);
+	WorkerPool::GetInstance()->ParallelFor(tilesX * tilesY, threadCount,
+		[this, &pixels](int tile, int thread) { pixels[thread] += RasterizeTile(tile); });
+
+	for (unsigned long long count : pixels)
+		shadedPixels += count;
+}
+
+// Get the RGBA8 color target
+const unsigned int* SoftwareRenderBackend::GetColor()
+{
+	return colorBuffer.data();
+}
+
+// Get the pixels per row of the color target
+int SoftwareRenderBackend::GetPitch()
+{
+	return pitch;
+}
+
+// Write the color target as a binary PPM image
+bool SoftwareRenderBackend::SaveImage(const char* path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Could not open image \"%s\" for writing\n", path);
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<unsigned char> row((size_t)width * 3);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			unsigned int color = colorBuffer[(size_t)y * pitch + x];
+			row[x * 3] = (unsigned char)(color & 0xFF);
+			row[x * 3 + 1] = (unsigned char)((color >> 8) & 0xFF);
+			row[x * 3 + 2] = (unsigned char)((color >> 16) & 0xFF);
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+
+	if (!file)
+	{
+		printf("Could not write image \"%s\"\n", path);
+		return false;
+	}
+	return true;
+}
+
+// Get a hash of the visible pixels (FNV-1a)
+unsigned int SoftwareRenderBackend::GetImageHash()
+{
+	unsigned int hash = 2166136261u;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			unsigned int color = colorBuffer[(size_t)y * pitch + x];
+			for (int c = 0; c < 3; c++)
+			{
+				hash ^= (color >> (c * 8)) & 0xFF;
+				hash *= 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+// Get how many triangles were drawn since BeginFrame()
+unsigned long long SoftwareRenderBackend::GetTriangleCount()
+{
+	return submittedTriangles;
+}
+
+// Get how many triangles were culled or clipped away
+unsigned long long SoftwareRenderBackend::GetCulledTriangleCount()
+{
+	return culledTriangles;
+}
+
+// Get how many pixels passed the depth test in Finish()
+unsigned long long SoftwareRenderBackend::GetShadedPixelCount()
+{
+	return shadedPixels;
+}
+
+// Get how many draws were skipped for missing data or being unsupported
+unsigned int SoftwareRenderBackend::GetSkippedDrawCount()
+{
+	return skippedDraws;
+}
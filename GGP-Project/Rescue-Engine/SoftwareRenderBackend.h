@@ -0,0 +1,235 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <DirectXMath.h>
+#include "RenderCommandList.h"
+#include "Vertex.h"
+
+//Width and height of the screen tiles triangles are binned into
+#define SOFTWARE_TILE_SIZE 64
+
+// --------------------------------------------------------
+// A triangle after clipping and setup, in pixels
+// --------------------------------------------------------
+struct SoftwareTriangle
+{
+	float edgeA[3];			//Edge functions: A * x + B * y + C
+	float edgeB[3];
+	float edgeC[3];
+	bool topLeft[3];		//Edges that own the pixels exactly on them
+	float invArea;
+	float depth[3];			//z/w at each corner
+	float invW[3];
+	DirectX::XMFLOAT3 color[3]; //Lit color at each corner, divided by w
+	int minX, minY, maxX, maxY; //Pixel bounds, clamped to the target
+};
+
+// --------------------------------------------------------
+// A RenderBackend that rasterizes on the CPU
+//
+// Draws are lit per vertex with one directional light (the
+// fixed-function equivalent for the engine's Vertex format),
+// clipped, and binned into screen tiles. Finish() then
+// rasterizes the tiles on the WorkerPool, four pixels at a
+// time, with a LESS depth test. Tiles are independent and
+// keep submission order, so the image does not depend on the
+// thread count.
+//
+// Buffers in the lists are only handles, so the data behind
+// them is registered up front with SetVertexData() and
+// SetIndexData(). Constants written to the buffer given to
+// SetObjectConstantBuffer() are read as per object
+// constants (world and world inverse transpose, transposed).
+// Instanced draws are not supported and are skipped.
+// --------------------------------------------------------
+class SoftwareRenderBackend : public RenderBackend
+{
+private:
+	// --------------------------------------------------------
+	// Geometry registered for a buffer handle
+	// --------------------------------------------------------
+	struct VertexData
+	{
+		const Vertex* vertices;
+		unsigned int count;
+	};
+
+	struct IndexData
+	{
+		const unsigned int* indices;
+		unsigned int count;
+	};
+
+	// --------------------------------------------------------
+	// A vertex after lighting, in clip space
+	// --------------------------------------------------------
+	struct ClipVertex
+	{
+		DirectX::XMFLOAT4 position;
+		DirectX::XMFLOAT3 color;
+	};
+
+	int width;
+	int height;
+	int pitch; //Pixels per row, padded to whole 4 pixel spans
+	int threadCount;
+	std::vector<unsigned int> colorBuffer; //RGBA8
+	std::vector<float> depthBuffer;
+	unsigned int clearColor;
+
+	//Binned triangles
+	int tilesX;
+	int tilesY;
+	std::vector<SoftwareTriangle> triangles;
+	std::vector<std::vector<unsigned int>> tileBins;
+
+	//Registered data
+	std::unordered_map<const void*, VertexData> vertexData;
+	std::unordered_map<const void*, IndexData> indexData;
+	const void* objectConstantBuffer;
+
+	//Scene state
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMFLOAT3 lightDirection;
+	DirectX::XMFLOAT3 lightColor;
+	DirectX::XMFLOAT3 ambientColor;
+	DirectX::XMFLOAT3 albedo;
+
+	//Bound state
+	const void* vertexBuffer;
+	const void* indexBuffer;
+	unsigned int indexOffset;
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTrans;
+	std::vector<ClipVertex> transformed; //Scratch for the current draw
+	std::vector<unsigned int> transformedDraw; //Draw each scratch vertex was transformed for
+	unsigned int drawStamp;
+
+	//Stats
+	unsigned long long submittedTriangles;
+	unsigned long long culledTriangles;
+	unsigned long long shadedPixels;
+	unsigned int skippedDraws;
+
+	// --------------------------------------------------------
+	// Transform, light, clip and bin an indexed draw
+	// --------------------------------------------------------
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+
+	// --------------------------------------------------------
+	// Clip a triangle against the near plane and bin the result
+	// --------------------------------------------------------
+	void ClipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+
+	// --------------------------------------------------------
+	// Set up a triangle in front of the near plane and add it
+	// to the bins of the tiles it covers
+	// --------------------------------------------------------
+	void BinTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+
+	// --------------------------------------------------------
+	// Rasterize every triangle binned to a tile, returning the
+	// number of pixels written
+	// --------------------------------------------------------
+	unsigned long long RasterizeTile(int tile);
+
+public:
+	// --------------------------------------------------------
+	// Construct a backend. Call Init() before use
+	// --------------------------------------------------------
+	SoftwareRenderBackend();
+
+	// --------------------------------------------------------
+	// Create the color and depth targets
+	//
+	// threads - WorkerPool threads for Finish(), 0 for all of them
+	// --------------------------------------------------------
+	void Init(int width, int height, int threads = 0);
+
+	// --------------------------------------------------------
+	// Register the vertices behind a vertex buffer handle. The
+	// data must outlive the frames it is drawn in
+	// --------------------------------------------------------
+	void SetVertexData(const void* buffer, const Vertex* vertices, unsigned int count);
+
+	// --------------------------------------------------------
+	// Register the indices behind an index buffer handle. The
+	// data must outlive the frames it is drawn in
+	// --------------------------------------------------------
+	void SetIndexData(const void* buffer, const unsigned int* indices, unsigned int count);
+
+	// --------------------------------------------------------
+	// Set which constant buffer holds per object constants
+	// --------------------------------------------------------
+	void SetObjectConstantBuffer(const void* buffer);
+
+	// --------------------------------------------------------
+	// Set the camera. Matrices are transposed, as they are
+	// uploaded to shaders
+	// --------------------------------------------------------
+	void SetCamera(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// --------------------------------------------------------
+	// Set the directional light and material color draws are
+	// lit with
+	// --------------------------------------------------------
+	void SetLighting(DirectX::XMFLOAT3 direction, DirectX::XMFLOAT3 color, DirectX::XMFLOAT3 ambient, DirectX::XMFLOAT3 albedo);
+
+	// --------------------------------------------------------
+	// Clear the targets and bins and reset the stats
+	// --------------------------------------------------------
+	void BeginFrame(float r, float g, float b);
+
+	// --------------------------------------------------------
+	// Light, clip and bin every draw in a list
+	// --------------------------------------------------------
+	void Execute(const RenderCommandList& list);
+
+	// --------------------------------------------------------
+	// Rasterize everything binned since BeginFrame()
+	// --------------------------------------------------------
+	void Finish();
+
+	// --------------------------------------------------------
+	// Get the RGBA8 color target, GetPitch() pixels per row
+	// --------------------------------------------------------
+	const unsigned int* GetColor();
+
+	// --------------------------------------------------------
+	// Get the pixels per row of the color target
+	// --------------------------------------------------------
+	int GetPitch();
+
+	// --------------------------------------------------------
+	// Write the color target as a binary PPM image
+	// --------------------------------------------------------
+	bool SaveImage(const char* path);
+
+	// --------------------------------------------------------
+	// Get a hash of the visible pixels, for comparing images
+	// against known good ones
+	// --------------------------------------------------------
+	unsigned int GetImageHash();
+
+	// --------------------------------------------------------
+	// Get how many triangles were drawn since BeginFrame()
+	// --------------------------------------------------------
+	unsigned long long GetTriangleCount();
+
+	// --------------------------------------------------------
+	// Get how many triangles were culled or clipped away
+	// --------------------------------------------------------
+	unsigned long long GetCulledTriangleCount();
+
+	// --------------------------------------------------------
+	// Get how many pixels passed the depth test in Finish()
+	// --------------------------------------------------------
+	unsigned long long GetShadedPixelCount();
+
+	// --------------------------------------------------------
+	// Get how many draws were skipped for missing data or
+	// being unsupported
+	// --------------------------------------------------------
+	unsigned int GetSkippedDrawCount();
+};
@@ -0,0 +1,166 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Construct a spatial hash with the given cell size
+SpatialHash::SpatialHash(float cellSize)
+{
+	this->cellSize = cellSize;
+	invCellSize = 1.0f / cellSize;
+	tableMask = 0;
+	cellStart.resize(2, 0);
+}
+
+// Destructor for when an instance is deleted
+SpatialHash::~SpatialHash()
+{ }
+
+// Get the cell coordinate a position falls in
+XMINT2 SpatialHash::GetCell(XMFLOAT3 position) const
+{
+	return XMINT2((int)floorf(position.x * invCellSize), (int)floorf(position.z * invCellSize));
+}
+
+// Hash a cell coordinate into the table
+unsigned int SpatialHash::HashCell(int x, int z) const
+{
+	return (((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u)) & tableMask;
+}
+
+// Rebuild the hash with a counting sort
+void SpatialHash::Build(const XMFLOAT3* positions, int count)
+{
+	//Table is the next power of two at or above twice the point count
+	unsigned int tableSize = 1;
+	while (tableSize < (unsigned int)count * 2)
+		tableSize <<= 1;
+	tableMask = tableSize - 1;
+
+	cellStart.assign(tableSize + 1, 0);
+	pointHash.resize(count);
+	sortedIndices.resize(count);
+	sortedPositions.resize(count);
+	sortedCells.resize(count);
+
+	//Count the points in each cell
+	for (int i = 0; i < count; i++)
+	{
+		XMINT2 cell = GetCell(positions[i]);
+		pointHash[i] = HashCell(cell.x, cell.y);
+		cellStart[pointHash[i] + 1]++;
+	}
+
+	//Prefix sum the counts into start offsets
+	for (unsigned int i = 0; i < tableSize; i++)
+		cellStart[i + 1] += cellStart[i];
+
+	//Scatter the points into their cell's run.
+	//cellStart[h] is used as the write cursor, which leaves it pointing at the
+	//end of cell h, so the offsets are shifted back down afterwards
+	for (int i = 0; i < count; i++)
+	{
+		unsigned int slot = cellStart[pointHash[i]]++;
+		sortedIndices[slot] = i;
+		sortedPositions[slot] = positions[i];
+		sortedCells[slot] = GetCell(positions[i]);
+	}
+	for (unsigned int i = tableSize; i > 0; i--)
+		cellStart[i] = cellStart[i - 1];
+	cellStart[0] = 0;
+}
+
+// Gather every point in a cell within a squared radius
+void SpatialHash::GatherCell(int cellX, int cellZ, XMFLOAT3 position, float radiusSq, int ignore)
+{
+	unsigned int hash = HashCell(cellX, cellZ);
+	unsigned int end = cellStart[hash + 1];
+	for (unsigned int i = cellStart[hash]; i < end; i++)
+	{
+		//Different cells can share a bucket, only take points from this cell
+		if (sortedCells[i].x != cellX || sortedCells[i].y != cellZ)
+			continue;
+		if (sortedIndices[i] == ignore)
+			continue;
+
+		float dx = sortedPositions[i].x - position.x;
+		float dy = sortedPositions[i].y - position.y;
+		float dz = sortedPositions[i].z - position.z;
+		float distSq = dx * dx + dy * dy + dz * dz;
+		if (distSq <= radiusSq)
+			candidates.push_back(std::make_pair(distSq, sortedIndices[i]));
+	}
+}
+
+// Find every point within a radius of a position
+int SpatialHash::QueryRadius(XMFLOAT3 position, float radius, std::vector<int>& out, int ignore)
+{
+	out.clear();
+	candidates.clear();
+	if (sortedIndices.empty())
+		return 0;
+
+	XMINT2 minCell = GetCell(XMFLOAT3(position.x - radius, 0, position.z - radius));
+	XMINT2 maxCell = GetCell(XMFLOAT3(position.x + radius, 0, position.z + radius));
+	float radiusSq = radius * radius;
+
+	for (int z = minCell.y; z <= maxCell.y; z++)
+		for (int x = minCell.x; x <= maxCell.x; x++)
+			GatherCell(x, z, position, radiusSq, ignore);
+
+	for (size_t i = 0; i < candidates.size(); i++)
+		out.push_back(candidates[i].second);
+	return (int)out.size();
+}
+
+// Find the k nearest points to a position by searching outward in rings of cells
+int SpatialHash::QueryKNearest(XMFLOAT3 position, int k, float maxRadius, std::vector<int>& out, int ignore)
+{
+	out.clear();
+	candidates.clear();
+	if (sortedIndices.empty() || k <= 0)
+		return 0;
+
+	XMINT2 center = GetCell(position);
+	int maxRing = (int)ceilf(maxRadius * invCellSize);
+	float maxRadiusSq = maxRadius * maxRadius;
+
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		//Visit only the cells on the border of this ring
+		for (int z = -ring; z <= ring; z++)
+		{
+			int step = (z == -ring || z == ring) ? 1 : ring * 2;
+			for (int x = -ring; x <= ring; x += step)
+				GatherCell(center.x + x, center.y + z, position, maxRadiusSq, ignore);
+		}
+
+		//Anything outside this ring is at least ring * cellSize away
+		if ((int)candidates.size() >= k)
+		{
+			std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+			float covered = ring * cellSize;
+			if (candidates[k - 1].first <= covered * covered)
+				break;
+		}
+	}
+
+	int found = (std::min)(k, (int)candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + found, candidates.end());
+	for (int i = 0; i < found; i++)
+		out.push_back(candidates[i].second);
+	return found;
+}
+
+// Get the cell size of this hash
+float SpatialHash::GetCellSize() const
+{
+	return cellSize;
+}
+
+// Get the number of points currently in the hash
+int SpatialHash::GetCount() const
+{
+	return (int)sortedIndices.size();
+}
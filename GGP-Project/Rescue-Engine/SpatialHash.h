@@ -0,0 +1,98 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <utility>
+
+// --------------------------------------------------------
+// A uniform grid spatial hash over the XZ plane.
+//
+// Rebuilt from scratch every tick with a counting sort, so
+// every cell's points live in one contiguous run of memory.
+// Building is linear in the number of points.
+// --------------------------------------------------------
+class SpatialHash
+{
+private:
+	//Grid vars
+	float cellSize;
+	float invCellSize;
+	unsigned int tableMask;
+
+	//Counting sort storage
+	std::vector<unsigned int> cellStart; //tableSize + 1 offsets into the sorted arrays
+	std::vector<unsigned int> pointHash; //hash of each input point
+	std::vector<int> sortedIndices; //input indices grouped by cell
+	std::vector<DirectX::XMFLOAT3> sortedPositions; //positions grouped by cell
+	std::vector<DirectX::XMINT2> sortedCells; //cell coordinates grouped by cell
+
+	//Scratch for k-nearest queries
+	std::vector<std::pair<float, int>> candidates;
+
+	// --------------------------------------------------------
+	// Get the cell coordinate a position falls in
+	// --------------------------------------------------------
+	DirectX::XMINT2 GetCell(DirectX::XMFLOAT3 position) const;
+
+	// --------------------------------------------------------
+	// Hash a cell coordinate into the table
+	// --------------------------------------------------------
+	unsigned int HashCell(int x, int z) const;
+
+	// --------------------------------------------------------
+	// Gather every point in a cell within a squared radius
+	//
+	// cellX, cellZ - the cell to search
+	// position - the query position
+	// radiusSq - the squared search radius
+	// ignore - an input index to skip (-1 for none)
+	// --------------------------------------------------------
+	void GatherCell(int cellX, int cellZ, DirectX::XMFLOAT3 position, float radiusSq, int ignore);
+
+public:
+	// --------------------------------------------------------
+	// Construct a spatial hash
+	//
+	// cellSize - width of a grid cell. Works best near the query radius
+	// --------------------------------------------------------
+	SpatialHash(float cellSize);
+	~SpatialHash();
+
+	// --------------------------------------------------------
+	// Rebuild the hash from a set of positions
+	//
+	// positions - the positions to insert
+	// count - the number of positions
+	// --------------------------------------------------------
+	void Build(const DirectX::XMFLOAT3* positions, int count);
+
+	// --------------------------------------------------------
+	// Find every point within a radius of a position
+	//
+	// position - the query position
+	// radius - the search radius
+	// out - filled with the input indices found (cleared first)
+	// ignore - an input index to skip, usually the querying agent
+	// --------------------------------------------------------
+	int QueryRadius(DirectX::XMFLOAT3 position, float radius, std::vector<int>& out, int ignore = -1);
+
+	// --------------------------------------------------------
+	// Find the k nearest points to a position, closest first
+	//
+	// position - the query position
+	// k - the maximum number of points to return
+	// maxRadius - the furthest distance to search
+	// out - filled with the input indices found (cleared first)
+	// ignore - an input index to skip, usually the querying agent
+	// --------------------------------------------------------
+	int QueryKNearest(DirectX::XMFLOAT3 position, int k, float maxRadius, std::vector<int>& out, int ignore = -1);
+
+	// --------------------------------------------------------
+	// Get the cell size of this hash
+	// --------------------------------------------------------
+	float GetCellSize() const;
+
+	// --------------------------------------------------------
+	// Get the number of points currently in the hash
+	// --------------------------------------------------------
+	int GetCount() const;
+};
@@ -0,0 +1,142 @@
+#include "StaticBatch.h"
+#include "Entity.h"
+
+using namespace DirectX;
+
+// Merge entities into a batch
+StaticBatch::StaticBatch(const std::vector<Entity*>& entities, ID3D11Device* device)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		Entity* e = entities[i];
+		Mesh* source = e->GetMesh();
+		this->entities.push_back(e);
+		e->mergedInto = this;
+
+		//The stored matrices are transposed for HLSL
+		XMFLOAT4X4 worldT = e->GetWorldMatrix();
+		XMFLOAT4X4 invTransT = e->GetWorldInvTransMatrix();
+		XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&worldT));
+		XMMATRIX invTrans = XMMatrixTranspose(XMLoadFloat4x4(&invTransT));
+
+		//Bake the transform into the vertices, the mesh recalculates tangents
+		const std::vector<Vertex>& sourceVertices = source->GetVertices();
+		unsigned int baseVertex = (unsigned int)vertices.size();
+		for (size_t v = 0; v < sourceVertices.size(); v++)
+		{
+			Vertex vertex = sourceVertices[v];
+			XMStoreFloat3(&vertex.Position, XMVector3TransformCoord(XMLoadFloat3(&vertex.Position), world));
+			XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.Normal), invTrans)));
+			vertices.push_back(vertex);
+		}
+
+		//Only the full detail level is merged
+		const std::vector<unsigned int>& sourceIndices = source->GetIndices();
+		unsigned int start = source->GetLodStartIndex(0);
+		unsigned int count = source->GetLodIndexCount(0);
+		rangeStart.push_back((unsigned int)indices.size());
+		rangeCount.push_back(count);
+		for (unsigned int j = 0; j < count; j++)
+			indices.push_back(sourceIndices[start + j] + baseVertex);
+
+		//Move the bounding sphere into world space
+		XMFLOAT3 center;
+		float radius;
+		source->GetWorldSphere(worldT, center, radius);
+
+		boundsX.push_back(center.x);
+		boundsY.push_back(center.y);
+		boundsZ.push_back(center.z);
+		boundsRadius.push_back(radius);
+	}
+
+	mesh = new Mesh(vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size(), device);
+	visibleRanges.resize(rangeStart.size());
+}
+
+// Release the merged mesh
+StaticBatch::~StaticBatch()
+{
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		if (entities[i] != nullptr)
+			entities[i]->mergedInto = nullptr;
+	}
+	delete mesh;
+}
+
+// Get the merged mesh
+Mesh* StaticBatch::GetMesh()
+{
+	return mesh;
+}
+
+// Get the number of merged entities
+int StaticBatch::GetRangeCount()
+{
+	return (int)rangeStart.size();
+}
+
+// Check if a merged entity still draws
+bool StaticBatch::IsRangeDrawn(int range)
+{
+	return entities[range] != nullptr && entities[range]->GetEnabled();
+}
+
+// Stop drawing a merged entity for good
+void StaticBatch::RemoveEntity(Entity* entity)
+{
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		if (entities[i] == entity)
+			entities[i] = nullptr;
+	}
+	entity->mergedInto = nullptr;
+}
+
+// Find the index ranges inside a frustum
+int StaticBatch::Cull(const Frustum& frustum, std::vector<unsigned int>& runs)
+{
+	runs.clear();
+	int count = (int)rangeStart.size();
+	if (count == 0)
+		return 0;
+
+	int visibleCount = frustum.CullSpheres(boundsX.data(), boundsY.data(), boundsZ.data(), boundsRadius.data(),
+		count, visibleRanges.data());
+
+	//Ranges are back to back, so visible neighbours become one draw
+	int drawnCount = 0;
+	for (int i = 0; i < visibleCount; i++)
+	{
+		int range = visibleRanges[i];
+		if (!IsRangeDrawn(range))
+			continue;
+
+		drawnCount++;
+		if (!runs.empty() && runs[runs.size() - 2] + runs[runs.size() - 1] == rangeStart[range])
+		{
+			runs[runs.size() - 1] += rangeCount[range];
+			continue;
+		}
+		runs.push_back(rangeStart[range]);
+		runs.push_back(rangeCount[range]);
+	}
+
+	return drawnCount;
+}
+
+// Cull against the camera's frustum and keep the result
+int StaticBatch::CullForCamera(const Frustum& frustum)
+{
+	return Cull(frustum, cameraRuns);
+}
+
+// Get the runs found by the last CullForCamera()
+const std::vector<unsigned int>& StaticBatch::GetCameraRuns()
+{
+	return cameraRuns;
+}
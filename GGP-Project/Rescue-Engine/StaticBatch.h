@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "Mesh.h"
+#include "Frustum.h"
+
+class Entity;
+
+//Fewest static entities sharing a material that get merged
+#define STATIC_BATCH_MIN_ENTITIES 2
+
+// --------------------------------------------------------
+// Static entities that share a material, merged into one
+// mesh at scene load
+//
+// Every entity's full detail geometry is transformed into
+// world space and appended to a combined vertex and index
+// buffer, so the batch draws with an identity transform and
+// needs no per frame work from its entities. Each entity
+// keeps an index range and a world space bounding sphere,
+// so ranges outside a frustum are skipped and neighbouring
+// visible ranges are drawn with a single call.
+//
+// Merged entities stay in the EntityManager. Disabling one
+// skips its range until it is enabled again, and deleting
+// one skips it for good.
+// --------------------------------------------------------
+class StaticBatch
+{
+private:
+	Mesh* mesh;
+
+	//Merged entity of each range, null once it is deleted
+	std::vector<Entity*> entities;
+
+	//Index range and world space bounding sphere of each entity
+	std::vector<unsigned int> rangeStart;
+	std::vector<unsigned int> rangeCount;
+	std::vector<float> boundsX;
+	std::vector<float> boundsY;
+	std::vector<float> boundsZ;
+	std::vector<float> boundsRadius;
+	std::vector<int> visibleRanges; //Scratch for Cull()
+
+	//Ranges visible to the camera this frame, see CullForCamera()
+	std::vector<unsigned int> cameraRuns;
+
+public:
+	// --------------------------------------------------------
+	// Merge entities into a batch. They should share a
+	// material and not move afterwards
+	//
+	// entities - the entities to merge, in draw order
+	// device - the ID3D11Device, or nullptr for CPU-only geometry
+	// --------------------------------------------------------
+	StaticBatch(const std::vector<Entity*>& entities, ID3D11Device* device);
+
+	// --------------------------------------------------------
+	// Release the merged mesh
+	// --------------------------------------------------------
+	~StaticBatch();
+
+	// --------------------------------------------------------
+	// Get the merged mesh
+	// --------------------------------------------------------
+	Mesh* GetMesh();
+
+	// --------------------------------------------------------
+	// Get the number of merged entities
+	// --------------------------------------------------------
+	int GetRangeCount();
+
+	// --------------------------------------------------------
+	// Check if a merged entity still draws: it is enabled and
+	// has not been deleted
+	// --------------------------------------------------------
+	bool IsRangeDrawn(int range);
+
+	// --------------------------------------------------------
+	// Stop drawing a merged entity for good. Called when the
+	// entity is deleted
+	// --------------------------------------------------------
+	void RemoveEntity(Entity* entity);
+
+	// --------------------------------------------------------
+	// Find the index ranges inside a frustum that still draw,
+	// merging neighbours into one draw
+	//
+	// frustum - the frustum to cull against
+	// runs - filled with (start index, index count) pairs
+	// Returns the number of visible entities that draw
+	// --------------------------------------------------------
+	int Cull(const Frustum& frustum, std::vector<unsigned int>& runs);
+
+	// --------------------------------------------------------
+	// Cull against the camera's frustum and keep the result
+	// for the camera's passes
+	// Returns the number of visible entities
+	// --------------------------------------------------------
+	int CullForCamera(const Frustum& frustum);
+
+	// --------------------------------------------------------
+	// Get the (start index, index count) pairs found by the
+	// last CullForCamera()
+	// --------------------------------------------------------
+	const std::vector<unsigned int>& GetCameraRuns();
+};
@@ -0,0 +1,187 @@
+#include "UploadRing.h"
+#include <stdio.h>
+
+// Constructor - Call Init() before use
+UploadRing::UploadRing()
+{
+	device = nullptr;
+	buffer = nullptr;
+	bindFlags = 0;
+	capacity = 0;
+	for (int i = 0; i < UPLOAD_RING_FRAMES; i++)
+	{
+		frameQueries[i] = nullptr;
+		frameEnds[i] = 0;
+	}
+	Reset();
+}
+
+UploadRing::~UploadRing()
+{
+	Release();
+}
+
+// Release the buffer and queries
+void UploadRing::Release()
+{
+	if (buffer != nullptr) { buffer->Release(); buffer = nullptr; }
+	for (int i = 0; i < UPLOAD_RING_FRAMES; i++)
+	{
+		if (frameQueries[i] != nullptr) { frameQueries[i]->Release(); frameQueries[i] = nullptr; }
+	}
+}
+
+// Create the ring's buffer
+bool UploadRing::Init(ID3D11Device* device, UINT capacity, UINT bindFlags)
+{
+	this->device = device;
+	this->bindFlags = bindFlags;
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (int i = 0; i < UPLOAD_RING_FRAMES; i++)
+	{
+		if (frameQueries[i] == nullptr && FAILED(device->CreateQuery(&queryDesc, &frameQueries[i])))
+		{
+			printf("Could not create an upload ring frame query\n");
+			return false;
+		}
+	}
+
+	return CreateBuffer(capacity);
+}
+
+// Create the buffer, releasing any old one
+bool UploadRing::CreateBuffer(UINT capacity)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = bindFlags;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ID3D11Buffer* newBuffer = nullptr;
+	if (FAILED(device->CreateBuffer(&desc, 0, &newBuffer)))
+	{
+		printf("Could not create a %u byte upload ring\n", capacity);
+		return false;
+	}
+
+	//The driver keeps the old buffer alive while the GPU uses it
+	if (buffer != nullptr) buffer->Release();
+	buffer = newBuffer;
+	this->capacity = capacity;
+	Reset();
+	return true;
+}
+
+// Forget everything in the ring
+void UploadRing::Reset()
+{
+	head = 0;
+	tail = 0;
+	firstFrame = 0;
+	framesInFlight = 0;
+	discardNext = true;
+}
+
+// Retire frames the GPU has finished with
+void UploadRing::BeginFrame(ID3D11DeviceContext* context)
+{
+	while (framesInFlight > 0)
+	{
+		//Don't flush, a frame that isn't done yet is simply kept
+		if (context->GetData(frameQueries[firstFrame], nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			break;
+
+		tail = frameEnds[firstFrame];
+		firstFrame = (firstFrame + 1) % UPLOAD_RING_FRAMES;
+		framesInFlight--;
+	}
+
+	//Start from the front again whenever the ring drains
+	if (framesInFlight == 0 && head == tail)
+	{
+		head = 0;
+		tail = 0;
+	}
+}
+
+// Mark where this frame's data ends
+void UploadRing::EndFrame(ID3D11DeviceContext* context)
+{
+	//Out of fences, so stop tracking and orphan the buffer instead
+	if (framesInFlight == UPLOAD_RING_FRAMES)
+	{
+		Reset();
+		return;
+	}
+
+	int frame = (firstFrame + framesInFlight) % UPLOAD_RING_FRAMES;
+	frameEnds[frame] = head;
+	context->End(frameQueries[frame]);
+	framesInFlight++;
+}
+
+// Allocate and map a region of the ring
+void* UploadRing::Map(ID3D11DeviceContext* context, UINT size, UINT alignment, UINT& offset)
+{
+	//Grow if this could never fit
+	if (size >= capacity)
+	{
+		UINT newCapacity = capacity > 0 ? capacity : 1;
+		while (newCapacity <= size)
+			newCapacity *= 2;
+		if (!CreateBuffer(newCapacity))
+			return nullptr;
+	}
+
+	//Find room between the GPU's data and the end of the buffer,
+	//then between the front of the buffer and the GPU's data.
+	//The head never catches up with the tail, so head == tail means empty
+	if (alignment == 0) alignment = 1;
+	UINT start = (head + alignment - 1) / alignment * alignment;
+	bool fits;
+	if (head >= tail)
+	{
+		fits = start + size <= capacity;
+		if (!fits && size < tail)
+		{
+			start = 0;
+			fits = true;
+		}
+	}
+	else
+	{
+		fits = start + size < tail;
+	}
+
+	//Caught up with the GPU, get fresh memory from the driver
+	if (!fits)
+	{
+		Reset();
+		start = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	D3D11_MAP mapType = discardNext ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped)))
+		return nullptr;
+
+	discardNext = false;
+	head = start + size;
+	offset = start;
+	return static_cast<unsigned char*>(mapped.pData) + start;
+}
+
+// Unmap the region from Map()
+void UploadRing::Unmap(ID3D11DeviceContext* context)
+{
+	context->Unmap(buffer, 0);
+}
+
+// Get the buffer to bind
+ID3D11Buffer* UploadRing::GetBuffer()
+{
+	return buffer;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <d3d11.h>
+
+//Frames the GPU may still be reading ring data from
+#define UPLOAD_RING_FRAMES 3
+
+// --------------------------------------------------------
+// A large dynamic buffer transient per-frame data is
+// sub-allocated from.
+//
+// Allocations are appended with Map(WRITE_NO_OVERWRITE) and
+// bound by offset. Each frame ends with an event query, and
+// space is only reused once the GPU has passed the frame that
+// wrote it. If the ring catches up with the GPU it falls back
+// to Map(WRITE_DISCARD), which lets the driver hand out fresh
+// memory instead of stalling.
+// --------------------------------------------------------
+class UploadRing
+{
+private:
+	ID3D11Device* device;
+	ID3D11Buffer* buffer;
+	UINT bindFlags;
+	UINT capacity;
+
+	UINT head;				//Next free byte
+	UINT tail;				//Oldest byte the GPU may still read
+	bool discardNext;		//Orphan the buffer on the next map
+
+	//Ring position at the end of each frame in flight, oldest first
+	ID3D11Query* frameQueries[UPLOAD_RING_FRAMES];
+	UINT frameEnds[UPLOAD_RING_FRAMES];
+	int firstFrame;
+	int framesInFlight;
+
+	// --------------------------------------------------------
+	// Release the buffer and queries
+	// --------------------------------------------------------
+	void Release();
+
+	// --------------------------------------------------------
+	// Create the buffer, releasing any old one
+	// --------------------------------------------------------
+	bool CreateBuffer(UINT capacity);
+
+	// --------------------------------------------------------
+	// Forget everything in the ring. The next map orphans the
+	// buffer, so data the GPU still reads stays intact
+	// --------------------------------------------------------
+	void Reset();
+
+public:
+	// --------------------------------------------------------
+	// Construct an empty ring. Call Init() before use
+	// --------------------------------------------------------
+	UploadRing();
+	~UploadRing();
+
+	// --------------------------------------------------------
+	// Create the ring's buffer
+	//
+	// capacity - size of the ring in bytes
+	// bindFlags - how the ring is bound, e.g. D3D11_BIND_VERTEX_BUFFER
+	// --------------------------------------------------------
+	bool Init(ID3D11Device* device, UINT capacity, UINT bindFlags);
+
+	// --------------------------------------------------------
+	// Retire frames the GPU has finished with
+	// --------------------------------------------------------
+	void BeginFrame(ID3D11DeviceContext* context);
+
+	// --------------------------------------------------------
+	// Mark where this frame's data ends so it can be reused
+	// once the GPU is done with it
+	// --------------------------------------------------------
+	void EndFrame(ID3D11DeviceContext* context);
+
+	// --------------------------------------------------------
+	// Allocate and map a region of the ring. Write the whole
+	// frame's data into one region where possible, and Unmap()
+	// before drawing with it
+	//
+	// size - bytes to allocate
+	// alignment - alignment of the region, e.g. the vertex stride
+	// offset - set to the region's byte offset into the buffer
+	//
+	// Returns the mapped region, or null if it could not be mapped
+	// --------------------------------------------------------
+	void* Map(ID3D11DeviceContext* context, UINT size, UINT alignment, UINT& offset);
+
+	// --------------------------------------------------------
+	// Unmap the region from Map()
+	// --------------------------------------------------------
+	void Unmap(ID3D11DeviceContext* context);
+
+	// --------------------------------------------------------
+	// Get the buffer to bind
+	// --------------------------------------------------------
+	ID3D11Buffer* GetBuffer();
+};
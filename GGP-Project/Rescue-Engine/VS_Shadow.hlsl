@@ -12,12 +12,12 @@ cbuffer perObject : register(b1)
 };
 
 // Struct representing a single vertex worth of data
+// - Only the position is read, so the same input layout works
+//   for a mesh's position stream and its full vertex buffer,
+//   where the position comes first
 struct VertexShaderInput
 {
 	float3 position		: POSITION;
-	float2 uv			: TEXCOORD;
-	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
 };
 
 // Out of the vertex shader (and eventually input to the PS)
@@ -34,9 +34,11 @@ VertexToPixel main(VertexShaderInput input)
 	// Set up output
 	VertexToPixel output;
 
-	// Calculate output position
+	// Calculate output position. precise keeps it bit for bit the same as
+	// the default vertex shader's, which the depth pre-pass relies on
 	matrix worldViewProj = mul(mul(world, view), projection);
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	precise float4 position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = position;
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "WorkerPool.h"
+
+// Singleton Constructor - Start one worker per extra core
+WorkerPool::WorkerPool()
+{
+	job = nullptr;
+	jobCount = 0;
+	nextIndex = 0;
+	helpersWanted = 0;
+	helpersJoined = 0;
+	helpersRunning = 0;
+	generation = 0;
+	open = false;
+	stopping = false;
+
+	int cores = (int)std::thread::hardware_concurrency();
+	if (cores > WORKER_POOL_MAX_THREADS)
+		cores = WORKER_POOL_MAX_THREADS;
+	for (int t = 1; t < cores; t++)
+		threads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+}
+
+// Stop and join the workers
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// Wait for jobs and help with them until the pool stops
+void WorkerPool::WorkerLoop()
+{
+	unsigned int seen = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [&]() { return stopping || generation != seen; });
+		if (stopping)
+			return;
+		seen = generation;
+
+		//Late wakers find the job closed or already fully staffed
+		if (!open || helpersJoined >= helpersWanted)
+			continue;
+		int thread = ++helpersJoined;
+		helpersRunning++;
+
+		lock.unlock();
+		RunJob(thread);
+		lock.lock();
+
+		if (--helpersRunning == 0)
+			done.notify_all();
+	}
+}
+
+// Run indices of the current job until there are none left
+void WorkerPool::RunJob(int thread)
+{
+	for (int index = nextIndex++; index < jobCount; index = nextIndex++)
+		(*job)(index, thread);
+}
+
+// Get how many threads a job can run on
+int WorkerPool::GetThreadCount()
+{
+	return (int)threads.size() + 1;
+}
+
+// Run body(index, thread) for every index in [0, count)
+void WorkerPool::ParallelFor(int count, int maxThreads, const std::function<void(int index, int thread)>& body)
+{
+	if (count <= 0)
+		return;
+
+	int threadCount = GetThreadCount();
+	if (maxThreads > 0 && maxThreads < threadCount)
+		threadCount = maxThreads;
+	if (count < threadCount)
+		threadCount = count;
+
+	//Run on this thread alone when that's all it needs, or the pool is busy
+	std::unique_lock<std::mutex> dispatch(dispatchMutex, std::defer_lock);
+	if (threadCount <= 1 || !dispatch.try_lock())
+	{
+		for (int index = 0; index < count; index++)
+			body(index, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &body;
+		jobCount = count;
+		nextIndex = 0;
+		helpersWanted = threadCount - 1;
+		helpersJoined = 0;
+		open = true;
+		generation++;
+	}
+	wake.notify_all();
+
+	RunJob(0);
+
+	//Close the job to late wakers and wait for the helpers still in it
+	std::unique_lock<std::mutex> lock(mutex);
+	open = false;
+	done.wait(lock, [&]() { return helpersRunning == 0; });
+	job = nullptr;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//Most threads the pool runs, the calling thread included
+#define WORKER_POOL_MAX_THREADS 16
+
+// --------------------------------------------------------
+// Singleton
+//
+// Process-wide pool of worker threads, started once and kept
+// for the whole run, so per frame parallel work doesn't pay
+// to create and join threads every time.
+//
+// ParallelFor() runs one job at a time. A call made while
+// another is running (from another EngineContext's thread,
+// or from inside a job) runs on the calling thread instead
+// of waiting for the pool.
+// --------------------------------------------------------
+class WorkerPool
+{
+private:
+	// --------------------------------------------------------
+	// Singleton Constructor - Start one worker per extra core
+	// --------------------------------------------------------
+	WorkerPool();
+	~WorkerPool();
+
+	std::vector<std::thread> threads;
+	std::mutex dispatchMutex; //Held by the caller of the running job
+
+	//Job state, guarded by mutex except where noted
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int, int)>* job;
+	int jobCount;
+	std::atomic<int> nextIndex; //Taken without the lock
+	int helpersWanted;
+	int helpersJoined;
+	int helpersRunning;
+	unsigned int generation;
+	bool open;
+	bool stopping;
+
+	// --------------------------------------------------------
+	// Wait for jobs and help with them until the pool stops
+	// --------------------------------------------------------
+	void WorkerLoop();
+
+	// --------------------------------------------------------
+	// Run indices of the current job until there are none left
+	// --------------------------------------------------------
+	void RunJob(int thread);
+
+public:
+	// --------------------------------------------------------
+	// Get the singleton instance of the WorkerPool
+	// --------------------------------------------------------
+	static WorkerPool* GetInstance()
+	{
+		static WorkerPool instance;
+
+		return &instance;
+	}
+
+	//Delete this
+	WorkerPool(WorkerPool const&) = delete;
+	void operator=(WorkerPool const&) = delete;
+
+	// --------------------------------------------------------
+	// Get how many threads a job can run on, the calling
+	// thread included
+	// --------------------------------------------------------
+	int GetThreadCount();
+
+	// --------------------------------------------------------
+	// Run body(index, thread) for every index in [0, count)
+	// and return once all of them are done. Indices are handed
+	// out one at a time to whichever thread is free
+	//
+	// count - the number of indices
+	// maxThreads - most threads to use, or 0 for all of them
+	// body - the work, given an index and the thread running
+	//        it, from 0 (the caller) to the threads used - 1
+	// --------------------------------------------------------
+	void ParallelFor(int count, int maxThreads, const std::function<void(int index, int thread)>& body);
+};
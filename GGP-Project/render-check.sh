@@ -0,0 +1,12 @@
+#!/bin/sh
+# Render a scripted headless run on the CPU and compare the image against
+# the known good hash. Build ./headless first (see README.md).
+#
+# The hash is from the reference x86-64 g++ -O2 build. Other compilers or
+# math flags can round differently; if the image looks right on such a
+# build, the mismatch is rounding rather than a rendering change.
+# Update RENDER_CHECK_HASH whenever the image is meant to change.
+RENDER_CHECK_HASH=a3a0d08f
+
+cd "$(dirname "$0")/Game-App" || exit 1
+../headless -frames 1200 -script ../render-check.txt -render ../render-check.ppm -expect-hash $RENDER_CHECK_HASH